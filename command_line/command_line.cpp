@@ -2,10 +2,14 @@
 //
 
 #include <iostream>
+#include <optional>
+#include <unordered_set>
 #include "Parser.h"
-#include "Lexer.h"
+#include "TokenStream.h"
 #include "ILGenerator.h"
 #include "ILPrinter.h"
+#include "PassManager.h"
+#include "spdlog/spdlog.h"
 
 /* Things to do:
 * Make DeepCopy a visitor class. dont know why we embedded it in the classes
@@ -34,17 +38,79 @@ fn equal_msg(var : u8) -> u8:
     12
 )";
 
-int main()
+// appends a file after the files it imports, the IL generator only knows what it has already seen
+static void parseImportsFirst(u32 file, std::unordered_set<u32>& parsed, Stmt::Program& program)
 {
-    auto tokens = Lexer{ test }.generateTokens();
-    auto program = Parser{ tokens }.program();
-    auto il = ILGenerator{}.generate(std::move(program));
+    parsed.insert(file);
+    TokenStream tokens{ file };
+    auto fileProgram = Parser{ tokens }.program();
+    for (auto& stmt : fileProgram) 
+    {
+        if (!stmt->is<Stmt::Import>()) continue;
+        u32 imported = static_cast<Stmt::Import const&>(*stmt).fileId;
+        //a file imported in a cycle is already on its way, it lands after the file that started it
+        if (!parsed.contains(imported)) parseImportsFirst(imported, parsed, program);
+    }
+    std::move(fileProgram.begin(), fileProgram.end(), std::back_inserter(program));
+}
+
+// usage: command_line [file] [-O0|-O1|-O2|-Os] [--time-passes]
+// without a file the test program above is compiled
+int main(int argc, char** argv)
+{
+    std::string_view pipeline = "-O0";
+    std::optional<std::string_view> path;
+    bool timePasses = false;
+    for (int i = 1; i < argc; ++i) 
+    {
+        std::string_view arg = argv[i];
+        if (arg == "--time-passes") timePasses = true;
+        else if (arg.starts_with('-')) pipeline = arg;
+        else path = arg;
+    }
+    auto passManager = opt::PassManager::fromPipeline(pipeline);
+    if (!passManager.has_value()) 
+    {
+        spdlog::error("Unknown optimization level '{}', expected -O0, -O1, -O2 or -Os", pipeline);
+        return 1;
+    }
+
+    //the whole AST is freed at once, after everything that refers to it
+    util::Arena astArena;
+    util::Arena::Scope astScope{ astArena };
+    Stmt::Program program;
+    try 
+    {
+        auto& sources = SourceManager::instance();
+        std::optional<u32> mainFile = path.has_value() ? sources.load(path.value()) : sources.add("test", test);
+        if (!mainFile.has_value()) 
+        {
+            spdlog::error("Cannot open source file '{}'", path.value());
+            return 1;
+        }
+        std::unordered_set<u32> parsed;
+        parseImportsFirst(mainFile.value(), parsed, program);
+    }
+    catch (SourceLimitError& error) 
+    {
+        spdlog::error("{}", error.what());
+        return 1;
+    }
+    ILGenerator generator{ std::move(passManager.value()) };
+    auto il = generator.generate(std::move(program));
     if (!il.has_value()) return 1;
     for (auto& instr : il.value()) 
     {
         IL::Printer{}.printIL(instr);
     }
-
+    if (timePasses) 
+    {
+        for (auto& timing : generator.passes().timings()) 
+        {
+            spdlog::info("{:<16} {:>4} runs {:>4} changed {:>10.3f} ms", timing.name, timing.runs, timing.changes,
+                std::chrono::duration<double, std::milli>(timing.total).count());
+        }
+    }
     return 0;
 }
 
@@ -3,7 +3,8 @@
 #include "Assembler.h"
 #include "InstructionFormat.h"
 #include "OperandDecoder.h"
-#include <spdlog\spdlog.h>
+#include "SourceManager.h"
+#include <spdlog/spdlog.h>
 
 namespace Asm {
 	
@@ -25,15 +26,15 @@ namespace Asm {
 			return FormatParser(instrucFormat.getFormat()).format(operands);
 		}
 		catch (TooManyOperands const& err) {
-			spdlog::error("[Line: {}] No opcode takes more than 2 operands.", instruct.sourcePos.line);
+			spdlog::error("[Line: {}] No opcode takes more than 2 operands.", SourceManager::instance().line(instruct.sourcePos));
 		}
 		catch (UnknownOpcode const& err) {
 			spdlog::error("[Line: {}] Unknown Opcode: {}.", 
-				instruct.sourcePos.line, instruct.opcode);
+				SourceManager::instance().line(instruct.sourcePos), instruct.opcode);
 		}
 		catch (InvalidOperands const& err) {
 			spdlog::error("[Line: {}] Opcode: \"{}\" does not match specified operands.", 
-				instruct.sourcePos.line, instruct.opcode);
+				SourceManager::instance().line(instruct.sourcePos), instruct.opcode);
 		}
 		return Bytes{};
 	}
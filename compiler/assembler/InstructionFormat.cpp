@@ -3,11 +3,17 @@
 
 namespace Asm {
 
+	// a dereferenced number stands for every address, like (nn)
+	static bool isAddress(Operand const& operand) {
+		auto deref = std::get_if<Dereference>(&operand);
+		return deref && std::holds_alternative<Number>(deref->address);
+	}
+
 	bool InstructionFormat::OperandRule::allows(Operand const& operand) const {
-		//no validValues means, everythings valid
-		if (validValues.size() == 0) return true;
+		//no validValues means, every operand of the rule's kind is valid
+		if (validValues.size() == 0) return operand.index() == operandIndex;
 		for (auto const& validValue : validValues) {
-			if (operand == validValue) return true;
+			if (operand == validValue || (isAddress(operand) && isAddress(validValue))) return true;
 		}
 		return false;
 	}
@@ -25,6 +31,20 @@ namespace Asm {
 		return byteFormat;
 	}
 
+	size_t InstructionFormat::size() const
+	{
+		size_t bytes = 0, hexDigits = 0;
+		for (char symbol : byteFormat) {
+			switch (symbol) {
+			case 'N': case 'O': bytes++; break;
+			case 'R': case 'S': case 'T': case 'P': case '<': break;
+			default:
+				if (++hexDigits % 2 == 0) bytes++;
+			}
+		}
+		return bytes;
+	}
+
 	Bytes FormatParser::format(std::vector<Operand> const& operands)
 	{
 		auto subs = calcOperandSubstitutions(operands);
@@ -47,10 +67,12 @@ namespace Asm {
 		if (bits.has_value()) {
 			rr = bits.value();
 		}
-		else {
-			auto bits = reg8ToBits(reg.str);
+		else if (auto bits = reg8ToBits(reg.str); bits.has_value()) {
+			s = sawRegister ? s : bits.value();
 			r = bits.value();
+			sawRegister = true;
 		}
+		//ix and iy are encoded by the prefix alone
 	}
 	void FormatParser::OperandSubstitutions::operator()(OffsetRegister const& offsetReg)
 	{
@@ -87,9 +109,13 @@ namespace Asm {
 					) : (//need to throw error for when this is losing data cast
 					addByte(static_cast<uint8_t>(subs.nn))
 					);
+				break;
 			case 'O':
 				addByte(subs.o);
 				break;
+			case 'S':
+				shiftIntoLastByte(subs.s);
+				break;
 			case 'T':
 				shiftIntoLastByte(subs.t);
 				break;
@@ -124,7 +150,7 @@ namespace Asm {
 	{
 		auto byteView = currentView();
 		if (byteView.size == 2) {
-			auto nextByte = hexToIntegral<uint8_t>({ byteView.data, byteView.size });
+			auto nextByte = util::hexToIntegral<uint8_t>({ byteView.data, byteView.size });
 			addByte(nextByte);
 		}
 	}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "Operand.h"
 #include "VariantUtil.h"
 #include "StreamViewer.h"
@@ -36,7 +37,7 @@ namespace Asm {
 			static OperandRule make(AcceptedValues...acceptedValues) {
 				std::vector<Operand> validValues;
 				(validValues.emplace_back(OperandType(acceptedValues)), ...);
-				return OperandRule(variantIndex<Operand, OperandType>(), std::move(validValues));
+				return OperandRule(util::variantIndex<Operand, OperandType>(), std::move(validValues));
 			}
 			bool allows(Operand const& operand) const;
 
@@ -48,16 +49,21 @@ namespace Asm {
 		};
 
 
+		// tStates is the time taken, for a conditional jump or call it is the time when taken
 		template<typename...Rules>
-		InstructionFormat(std::string_view byteFormat, Rules...rule)
-			: byteFormat(byteFormat) {
+		InstructionFormat(std::string_view byteFormat, unsigned tStates, Rules...rule)
+			: byteFormat(byteFormat), tStates(tStates) {
 			(rules.push_back(rule), ...);
 		}
 
 		bool follows(std::vector<Operand> const& operands) const;
 		auto getFormat() const->std::string_view;
+		// length of the encoding in bytes
+		size_t size() const;
+		unsigned tStateCount() const { return tStates; }
 	private:
 		std::string_view byteFormat;
+		unsigned tStates;
 		std::vector<OperandRule> rules;
 	};
 
@@ -66,6 +72,7 @@ namespace Asm {
 	Special Symbols:
 		O : offset, N : 8 bit number, NN : 16 bit number
 		R : 8 bit Register, RR : 16 bit Register
+		S : first 8 bit Register, when there are two (R is always the last one)
 		T : bit tested, P : (ph)flag, < : shift mapping and mask 
 	*/
 	class FormatParser {
@@ -85,7 +92,8 @@ namespace Asm {
 			void operator()(Flag const& flag);
 			void operator()(Dereference const& deref);
 
-			uint8_t r = 0, rr = 0, o = 0, t = 0, p = 0;
+			uint8_t r = 0, s = 0, rr = 0, o = 0, t = 0, p = 0;
+			bool sawRegister = false;
 			uint16_t nn = 0; //theres no n, because we need to throw if we cant fit nn in n
 		};
 
@@ -1,21 +1,39 @@
 #include "InstructionFormat.h"
-#include "spdlog\spdlog.h"
+#include "ReservedIdentifiers.h"
+#include "CompilerError.h"
+#include "spdlog/spdlog.h"
 
 namespace Asm {
 
 	auto findValidRule(
 		std::vector<InstructionFormat> const& formats, 
 		std::vector<Operand> const& operands
-	) -> std::string_view 
+	) -> InstructionFormat const&
 	{
 		for (auto& format : formats) {
 			if (format.follows(operands)) {
-				return format.getFormat();
+				return format;
 			}
 		}
 		throw InvalidOperands(operands);
 	}
 
+	using OpcodeFormats = std::array<std::vector<InstructionFormat>, static_cast<size_t>(Opcode::NONE)>;
+
+	//the formats are written by mnemonic and stored by opcode id, which the lexer's perfect hash gives
+	auto makeOpcodeFormats(
+		std::initializer_list<std::pair<std::string_view, std::vector<InstructionFormat>>> byMnemonic
+	) -> OpcodeFormats
+	{
+		OpcodeFormats formats;
+		for (auto& [mnemonic, mnemonicFormats] : byMnemonic) {
+			auto opcode = reserved::findOpcode(mnemonic);
+			COMPILER_ASSERT("every mnemonic in the table is a reserved opcode", opcode != Opcode::NONE);
+			formats[static_cast<size_t>(opcode)] = mnemonicFormats;
+		}
+		return formats;
+	}
+
 	auto getInstructionFormat(
 		std::string_view opcode, 
 		std::vector<Operand> const& operands
@@ -26,6 +44,7 @@ namespace Asm {
 
 		static auto reg8 = Rule::make<Register>("a", "b", "c", "d", "e", "h", "l");
 		static auto reg16 = Rule::make<Register>("bc", "de", "hl", "sp");
+		static auto stackReg16 = Rule::make<Register>("bc", "de", "hl", "af");
 		static auto shadowRegAF = Rule::make<Register>(R"(af')");
 		static auto extendIX = Rule::make<Register>("ixh", "ixl");
 		static auto extendIY = Rule::make<Register>("iyh", "iyl");
@@ -41,123 +60,226 @@ namespace Asm {
 
 		static auto number = Rule::make<Number>();
 		static auto flag = Rule::make<Flag>();
+		static auto relativeFlag = Rule::make<Flag>("nz", "z", "nc", "c");
 
 		static auto derefIX = Rule::make<Dereference>(Dereference{ OffsetRegister{{"ix"}, 0} });
 		static auto derefIY = Rule::make<Dereference>(Dereference{ OffsetRegister{{"iy"}, 0} });
 		static auto derefC  = Rule::make<Dereference>(Dereference{ Register("c") });
+		static auto derefBC = Rule::make<Dereference>(Dereference{ Register("bc") });
+		static auto derefDE = Rule::make<Dereference>(Dereference{ Register("de") });
 		static auto derefHL = Rule::make<Dereference>(Dereference{ Register("hl") });
 		static auto derefSP = Rule::make<Dereference>(Dereference{ Register("sp") });
-
-		using OpcodeFormats = std::unordered_map<std::string_view, std::vector<InstructionFormat>>;
+		static auto derefAddress = Rule::make<Dereference>(Dereference{ Number(0) });
 
 		//WE NEED TO FIX OFFSET REGISTERS, SHADOW REGISTERS, AND NUMBERS IN "IM"
-		static OpcodeFormats opcodeFormats = {
+		static OpcodeFormats opcodeFormats = makeOpcodeFormats({
 			{"adc",{
-				IFormat("8E",	 regA, derefHL),
-				IFormat("DD8EO", regA, derefIX),
-				IFormat("FD8EO", regA, derefIY),
-				IFormat("88R",	 regA, reg8),
-				IFormat("DD88R", regA, extendIX),
-				IFormat("FD88R", regA, extendIY),
-				IFormat("CEN",	 regA, number),
-				IFormat("ED4A<<<<RR", derefHL, reg16)
+				IFormat("8E",	 7,	 regA, derefHL),
+				IFormat("DD8EO", 19, regA, derefIX),
+				IFormat("FD8EO", 19, regA, derefIY),
+				IFormat("88R",	 4,	 regA, reg8),
+				IFormat("DD88R", 8,	 regA, extendIX),
+				IFormat("FD88R", 8,	 regA, extendIY),
+				IFormat("CEN",	 7,	 regA, number),
+				IFormat("ED4A<<<<RR", 15, regHL, reg16)
 			}},
 			{"add",{
-				IFormat("86",	 regA, derefHL),
-				IFormat("DD86O", regA, derefIX),
-				IFormat("FD86O", regA, derefIY),
-				IFormat("80R",	 regA, reg8),
-				IFormat("DD80R", regA, extendIX),
-				IFormat("FD80R", regA, extendIY),
-				IFormat("C6N",	 regA, number),
-
-				IFormat("09<<<<RR", regHL, reg16),
-				IFormat("DD09<<<<RR", regIX, reg16),
-				IFormat("FD09<<<<RR", regIY, reg16)
+				IFormat("86",	 7,	 regA, derefHL),
+				IFormat("DD86O", 19, regA, derefIX),
+				IFormat("FD86O", 19, regA, derefIY),
+				IFormat("80R",	 4,	 regA, reg8),
+				IFormat("DD80R", 8,	 regA, extendIX),
+				IFormat("FD80R", 8,	 regA, extendIY),
+				IFormat("C6N",	 7,	 regA, number),
+
+				IFormat("09<<<<RR",	  11, regHL, reg16),
+				IFormat("DD09<<<<RR", 15, regIX, reg16),
+				IFormat("FD09<<<<RR", 15, regIY, reg16)
 			}},
 			{"and",{
-				IFormat("A6",	 derefHL),
-				IFormat("DDA6O", derefIX),
-				IFormat("FDA6O", derefIY),
-				IFormat("A0R",	 regA, reg8),
-				IFormat("DDA0R", regA, extendIX),
-				IFormat("FDA0R", regA, extendIY),
-				IFormat("E6N",	 regA, number)
+				IFormat("A6",	 7,	 derefHL),
+				IFormat("DDA6O", 19, derefIX),
+				IFormat("FDA6O", 19, derefIY),
+				IFormat("A0R",	 4,	 reg8),
+				IFormat("DDA0R", 8,	 extendIX),
+				IFormat("FDA0R", 8,	 extendIY),
+				IFormat("E6N",	 7,	 number)
 			}},
 			{"bit",{
-				IFormat("CB46<<<T",		derefHL),
-				IFormat("DDCBO46<<<T",	derefIX),
-				IFormat("FDCBO46<<<T",	derefIY),
-				IFormat("CB60R<<<T",	number, reg8)
+				IFormat("CB46<<<T",		12, number, derefHL),
+				IFormat("DDCBO46<<<T",	20, number, derefIX),
+				IFormat("FDCBO46<<<T",	20, number, derefIY),
+				IFormat("CB40R<<<T",	8,	number, reg8)
 			}},
 			{"call",{
-				IFormat("CDNN",	 number),
-				IFormat("C4<<<PNN", flag, number)
+				IFormat("CDNN",		17, number),
+				IFormat("C4<<<PNN", 17, flag, number)
 			}},
-			{"ccf", { IFormat("3F")	}},
+			{"ccf", { IFormat("3F", 4) }},
 			{"cp",{
-				IFormat("BE",	 derefHL),
-				IFormat("DDBEO", derefIX),
-				IFormat("FDBEO", derefIY),
-				IFormat("B8R",	 reg8),
-				IFormat("FEN",	 number)
-			}},
-			{"cpd",	 { IFormat("EDA9") }},
-			{"cpdr", { IFormat("EDB9") }},
-			{"cpi",  { IFormat("EDA1") }},
-			{"cpir", { IFormat("EDB1") }},
-			{"cpl",  { IFormat("2F") }},
-			{"daa",  { IFormat("27") }},
+				IFormat("BE",	 7,	 derefHL),
+				IFormat("DDBEO", 19, derefIX),
+				IFormat("FDBEO", 19, derefIY),
+				IFormat("B8R",	 4,	 reg8),
+				IFormat("FEN",	 7,	 number)
+			}},
+			{"cpd",	 { IFormat("EDA9", 16) }},
+			{"cpdr", { IFormat("EDB9", 21) }},
+			{"cpi",  { IFormat("EDA1", 16) }},
+			{"cpir", { IFormat("EDB1", 21) }},
+			{"cpl",  { IFormat("2F", 4) }},
+			{"daa",  { IFormat("27", 4) }},
 
 			{"dec", {
-				IFormat("35", derefHL),
-				IFormat("DD350", derefIX),
-				IFormat("FD350", derefIY),
-				IFormat("05<<<R", reg8),
-				IFormat("DDA0<<<R", regA, extendIX),
-				IFormat("FDA0<<<R", regA, extendIY),
-				IFormat("03<<<<RR", reg16)
+				IFormat("35",		11, derefHL),
+				IFormat("DD35O",	23, derefIX),
+				IFormat("FD35O",	23, derefIY),
+				IFormat("05<<<R",	4,	reg8),
+				IFormat("DD05<<<R", 8,	extendIX),
+				IFormat("FD05<<<R", 8,	extendIY),
+				IFormat("0B<<<<RR", 6,	reg16),
+				IFormat("DD2B",		10, regIX),
+				IFormat("FD2B",		10, regIY)
 			}},
 
-			{"di",  { IFormat("F3") }},
+			{"di",  { IFormat("F3", 4) }},
 			{"djnz",  {
-				IFormat("10N", number)
+				IFormat("10N", 13, number)
 			}},
-			{"ei",  { IFormat("FB") }},
+			{"ei",  { IFormat("FB", 4) }},
 
 			{"ex", {
-				IFormat("E3", derefSP, regHL),
-				IFormat("DDE3", derefSP, regIX),
-				IFormat("FDE3", derefSP, regIY),
+				IFormat("E3",	19, derefSP, regHL),
+				IFormat("DDE3", 23, derefSP, regIX),
+				IFormat("FDE3", 23, derefSP, regIY),
 				//IFormat("08", shadowRegisterAF,),
-				IFormat("EB", regDE, regHL)
+				IFormat("EB",	4,	regDE, regHL)
 			}},
-			{"exx",  { IFormat("D9") }},
-			{"halt",  { IFormat("76") }},
+			{"exx",  { IFormat("D9", 4) }},
+			{"halt",  { IFormat("76", 4) }},
 			//IM 0
 			//IM 1
 			//IM 2
 			{"in", {
-				IFormat("ED40<<<R", reg8, derefC),
-				IFormat("ED70", regF, derefC),
-				IFormat("DBN", regA, number)
+				IFormat("ED40<<<R", 12, reg8, derefC),
+				IFormat("ED70",		12, regF, derefC),
+				IFormat("DBN",		11, regA, number)
 			}},
 			{"inc", {
-				IFormat("34", derefHL),
-				IFormat("DD340", derefIX),
-				IFormat("FD340", derefIY),
-				IFormat("03<<<<RR", regHL),
-				IFormat("DD03<<<<RRO", regIX),
-				IFormat("FD03<<<<RRO", regIY),
+				IFormat("34",		11, derefHL),
+				IFormat("DD34O",	23, derefIX),
+				IFormat("FD34O",	23, derefIY),
+				IFormat("04<<<R",	4,	reg8),
+				IFormat("DD04<<<R", 8,	extendIX),
+				IFormat("FD04<<<R", 8,	extendIY),
+				IFormat("03<<<<RR", 6,	reg16),
+				IFormat("DD23",		10, regIX),
+				IFormat("FD23",		10, regIY)
+			}},
+			{"jp", {
+				IFormat("C3NN",		10, number),
+				IFormat("C2<<<PNN", 10, flag, number),
+				IFormat("E9",		4,	derefHL)
 			}},
+			{"jr", {
+				IFormat("18N",		12, number),
+				IFormat("20<<<PN",	12, relativeFlag, number)
+			}},
+			{"ld", {
+				IFormat("40<<<SR",	  4,  reg8, reg8),
+				IFormat("06<<<RN",	  7,  reg8, number),
+				IFormat("46<<<R",	  7,  reg8, derefHL),
+				IFormat("DD46<<<RO",  19, reg8, derefIX),
+				IFormat("FD46<<<RO",  19, reg8, derefIY),
+				IFormat("70R",		  7,  derefHL, reg8),
+				IFormat("DD70RO",	  19, derefIX, reg8),
+				IFormat("FD70RO",	  19, derefIY, reg8),
+				IFormat("36N",		  10, derefHL, number),
+				IFormat("DD36ON",	  19, derefIX, number),
+				IFormat("FD36ON",	  19, derefIY, number),
+				IFormat("0A",		  7,  regA, derefBC),
+				IFormat("1A",		  7,  regA, derefDE),
+				IFormat("02",		  7,  derefBC, regA),
+				IFormat("12",		  7,  derefDE, regA),
+
+				IFormat("01<<<<RRNN", 10, reg16, number),
+				IFormat("DD21NN",	  14, regIX, number),
+				IFormat("FD21NN",	  14, regIY, number),
+				IFormat("F9",		  6,  regSP, regHL),
+				IFormat("DDF9",		  10, regSP, regIX),
+				IFormat("FDF9",		  10, regSP, regIY),
 
-			{"nop",  { IFormat("00") }},
-		};
+				IFormat("3ANN",		  13, regA, derefAddress),
+				IFormat("32NN",		  13, derefAddress, regA),
+				IFormat("2ANN",		  16, regHL, derefAddress),
+				IFormat("22NN",		  16, derefAddress, regHL),
+				IFormat("ED4B<<<<RRNN", 20, reg16, derefAddress),
+				IFormat("ED43<<<<RRNN", 20, derefAddress, reg16),
+				IFormat("FD2ANN",	  20, regIY, derefAddress),
+				IFormat("FD22NN",	  20, derefAddress, regIY)
+			}},
+			{"ldir", { IFormat("EDB0", 21) }},
+			{"neg",  { IFormat("ED44", 8) }},
+			{"nop",  { IFormat("00", 4) }},
+			{"or",{
+				IFormat("B6",	 7,	 derefHL),
+				IFormat("DDB6O", 19, derefIX),
+				IFormat("FDB6O", 19, derefIY),
+				IFormat("B0R",	 4,	 reg8),
+				IFormat("F6N",	 7,	 number)
+			}},
+			{"pop", {
+				IFormat("C1<<<<RR", 10, stackReg16),
+				IFormat("DDE1",		14, regIX),
+				IFormat("FDE1",		14, regIY)
+			}},
+			{"push", {
+				IFormat("C5<<<<RR", 11, stackReg16),
+				IFormat("DDE5",		15, regIX),
+				IFormat("FDE5",		15, regIY)
+			}},
+			{"ret", {
+				IFormat("C9",		10),
+				IFormat("C0<<<P",	11, flag)
+			}},
+			{"rl",  { IFormat("CB10R", 8, reg8), IFormat("CB16", 15, derefHL) }},
+			{"rla", { IFormat("17", 4) }},
+			{"rlca", { IFormat("07", 4) }},
+			{"rr",  { IFormat("CB18R", 8, reg8), IFormat("CB1E", 15, derefHL) }},
+			{"rra", { IFormat("1F", 4) }},
+			{"rrca", { IFormat("0F", 4) }},
+			{"sbc",{
+				IFormat("9E",	 7,	 regA, derefHL),
+				IFormat("DD9EO", 19, regA, derefIX),
+				IFormat("FD9EO", 19, regA, derefIY),
+				IFormat("98R",	 4,	 regA, reg8),
+				IFormat("DEN",	 7,	 regA, number),
+				IFormat("ED42<<<<RR", 15, regHL, reg16)
+			}},
+			{"scf", { IFormat("37", 4) }},
+			{"sla", { IFormat("CB20R", 8, reg8), IFormat("CB26", 15, derefHL) }},
+			{"sra", { IFormat("CB28R", 8, reg8), IFormat("CB2E", 15, derefHL) }},
+			{"srl", { IFormat("CB38R", 8, reg8), IFormat("CB3E", 15, derefHL) }},
+			{"sub",{
+				IFormat("96",	 7,	 derefHL),
+				IFormat("DD96O", 19, derefIX),
+				IFormat("FD96O", 19, derefIY),
+				IFormat("90R",	 4,	 reg8),
+				IFormat("D6N",	 7,	 number)
+			}},
+			{"xor",{
+				IFormat("AE",	 7,	 derefHL),
+				IFormat("DDAEO", 19, derefIX),
+				IFormat("FDAEO", 19, derefIY),
+				IFormat("A8R",	 4,	 reg8),
+				IFormat("EEN",	 7,	 number)
+			}},
+		});
 
-		auto opcodeInstructionFormats = opcodeFormats.find(opcode);
-		if (opcodeInstructionFormats == opcodeFormats.end()) {
+		auto opcodeId = reserved::findOpcode(opcode);
+		if (opcodeId == Opcode::NONE || opcodeFormats[static_cast<size_t>(opcodeId)].empty()) {
 			throw UnknownOpcode(opcode);
 		}
-		return findValidRule(opcodeInstructionFormats->second, operands);
+		return findValidRule(opcodeFormats[static_cast<size_t>(opcodeId)], operands);
 	}
 }
\ No newline at end of file
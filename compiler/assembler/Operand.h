@@ -2,6 +2,8 @@
 #include <unordered_map>
 #include <variant>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 namespace Asm {
 
@@ -0,0 +1,130 @@
+#include "Constraints.h"
+#include "ILOperators.h"
+
+namespace z80
+{
+	namespace
+	{
+		bool isShift(Token::Type operation)
+		{
+			return operation == Token::Type::SHIFT_LEFT || operation == Token::Type::SHIFT_RIGHT;
+		}
+
+		class ConstraintVisitor
+			: public IL::Visitor
+		{
+		public:
+			InstructionConstraints collect(IL::UniquePtr const& instr)
+			{
+				this->IL::Visitor::visitChild(instr);
+				return std::move(constraints);
+			}
+
+		private:
+			InstructionConstraints constraints;
+
+			void hint(IL::Value const& value, Register reg)
+			{
+				if (auto var = std::get_if<IL::Variable>(&value); var && !var->is_global) {
+					constraints.hints.push_back(RegisterHint{ *var, reg });
+				}
+			}
+
+			virtual void visit(IL::Binary& expr) override
+			{
+				Register accumulator = accumulatorFor(expr.dest.type);
+				hint(expr.dest.variable, accumulator);
+				hint(expr.lhs, accumulator);
+				if (IL::isHelperCall(expr.operation)) {
+					constraints.clobbers = unitsOf(Register::A) | unitsOf(Register::HL);
+				}
+				else if (classOf(expr.dest.type) == RegisterClass::BYTE) {
+					constraints.clobbers = unitsOf(Register::A);
+				}
+				else if (expr.operation == Token::Type::PLUS || expr.operation == Token::Type::MINUS) {
+					constraints.clobbers = unitsOf(Register::HL);
+				}
+				else {
+					constraints.clobbers = unitsOf(Register::A) | unitsOf(Register::HL);
+				}
+				if (isShift(expr.operation) && !std::holds_alternative<int>(expr.rhs)) {
+					constraints.clobbers |= unitsOf(Register::B);
+				}
+			}
+			virtual void visit(IL::Unary& expr) override
+			{
+				Register accumulator = accumulatorFor(expr.dest.type);
+				hint(expr.dest.variable, accumulator);
+				hint(expr.src, accumulator);
+				constraints.clobbers = unitsOf(Register::A) | unitsOf(accumulator);
+			}
+			virtual void visit(IL::Cast& cast) override
+			{
+				hint(cast.dest, accumulatorFor(cast.cast));
+				constraints.clobbers = unitsOf(Register::A);
+			}
+			virtual void visit(IL::Deref& deref) override
+			{
+				hint(deref.ptr, Register::HL);
+			}
+			virtual void visit(IL::Store& store) override
+			{
+				hint(store.ptr, Register::HL);
+			}
+			virtual void visit(IL::MemCopy& copy) override
+			{
+				hint(copy.dest, Register::DE);
+				hint(copy.src, Register::HL);
+				constraints.clobbers = unitsOf(Register::BC) | unitsOf(Register::DE) | unitsOf(Register::HL);
+			}
+			virtual void visit(IL::FunctionCall& call) override
+			{
+				hint(call.dest.variable, accumulatorFor(call.dest.type));
+				// like a return, the allocator only follows the hint of the argument's class
+				if (call.args.size() == 1) {
+					hint(call.args.front(), Register::A);
+					hint(call.args.front(), Register::HL);
+				}
+				constraints.clobbers = unitsOf(Register::A) | unitsOf(Register::HL);
+				if (auto pointer = std::get_if<IL::Variable>(&call.function)) {
+					hint(*pointer, Register::IY);
+					constraints.clobbers |= unitsOf(Register::IY);
+				}
+			}
+			virtual void visit(IL::Return& ret) override
+			{
+				// the type is not known here, the allocator only follows hints of the right class
+				if (ret.value.has_value()) {
+					hint(ret.value.value(), Register::A);
+					hint(ret.value.value(), Register::HL);
+				}
+			}
+			virtual void visit(IL::Allocate& allocation) override
+			{
+				hint(allocation.dest, Register::HL);
+				constraints.clobbers = unitsOf(Register::HL);
+			}
+			virtual void visit(IL::AddressOf& addressOf) override
+			{
+				hint(addressOf.ptr, Register::HL);
+				constraints.clobbers = unitsOf(Register::HL);
+			}
+			virtual void visit(IL::Instruction& instr) override
+			{
+				constraints.clobbers = unit::ALL;
+			}
+			virtual void visit(IL::TestBit& expr) override {}
+			virtual void visit(IL::Assignment& expr) override {}
+			virtual void visit(IL::Phi& expr) override {}
+			virtual void visit(IL::Test& expr) override {}
+			virtual void visit(IL::Jump& jump) override {}
+			virtual void visit(IL::Label& label) override {}
+			virtual void visit(IL::Function& func) override {}
+		};
+	}
+
+	InstructionConstraints constraintsOf(IL::UniquePtr const& instr)
+	{
+		return ConstraintVisitor{}.collect(instr);
+	}
+}
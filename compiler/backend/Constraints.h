@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "Registers.h"
+
+namespace z80
+{
+	// A register an operand would like to be in, so no copy is needed
+	struct RegisterHint
+	{
+		IL::Variable variable;
+		Register reg;
+	};
+
+	// What the Z80 code for one instruction requires of the registers
+	struct InstructionConstraints
+	{
+		RegisterUnits clobbers = 0; // registers holding garbage afterwards
+		std::vector<RegisterHint> hints;
+	};
+
+	/*
+		The conventions the lowering of each instruction follows:
+		 - 8-bit arithmetic, compares and unary operators work on A.
+		 - 16-bit adds and subtracts are ADD HL,rr and SBC HL,rr, other 16-bit
+		   operators go byte by byte through A with the result in HL.
+		 - Multiply, divide and modulo are helper calls, which like every call
+		   return in A or HL and may destroy both (see AssemblyTranslation.h).
+		   A shift by a variable amount counts down in B.
+		 - Loads and stores go through HL, memcopies are LDIR on HL, DE and BC.
+		 - Casts extend through A, and addresses of stack variables are computed in HL.
+		 - A single 8-bit argument is passed in A and a single 16-bit one in HL,
+		   8-bit values are returned in A and 16-bit ones in HL.
+		   A call through a pointer also destroys IY, which holds the pointer.
+		 - Inline assembly may touch any register.
+	*/
+	InstructionConstraints constraintsOf(IL::UniquePtr const& instr);
+
+	// the register a value of the type is passed or returned in
+	inline Register accumulatorFor(IL::Type type)
+	{
+		return classOf(type) == RegisterClass::BYTE ? Register::A : Register::HL;
+	}
+}
@@ -0,0 +1,1932 @@
+#include "InstructionSelector.h"
+#include "InstructionFormat.h"
+#include "Constraints.h"
+#include "ILOperands.h"
+#include "ILOperators.h"
+#include "ReservedIdentifiers.h"
+#include "VariantUtil.h"
+#include "spdlog/fmt/fmt.h"
+#include <unordered_map>
+
+namespace z80
+{
+	Cost costOf(MachineInstruction const& instr)
+	{
+		auto& format = Asm::getInstructionFormat(instr.opcode, instr.operands);
+		return Cost{ format.tStateCount(), format.size() };
+	}
+
+	Cost costOf(std::span<const MachineInstruction> code)
+	{
+		Cost total;
+		for (auto& instr : code) total += costOf(instr);
+		return total;
+	}
+
+	bool cheaper(Cost const& lhs, Cost const& rhs, CostModel model)
+	{
+		if (model == CostModel::SIZE) return std::tie(lhs.bytes, lhs.tStates) < std::tie(rhs.bytes, rhs.tStates);
+		return std::tie(lhs.tStates, lhs.bytes) < std::tie(rhs.tStates, rhs.bytes);
+	}
+
+	CostModel costModelFor(opt::PassManager const& passes)
+	{
+		return passes.optimizesForSize() ? CostModel::SIZE : CostModel::SPEED;
+	}
+
+	namespace
+	{
+		struct Immediate
+		{
+			int value;
+		};
+		// the memory a pointer register points at, (hl), (bc), (de) or (iy+0)
+		struct Indirect
+		{
+			Register pointer;
+		};
+		// a global variable, read and written at its address
+		struct Global
+		{
+			IL::Variable variable;
+			int offset = 0;
+		};
+		using Place = std::variant<Register, StackSlot, Immediate, Indirect, Global>;
+
+		// the d of (IX+d) is a signed byte, so the frame below IX can be no deeper
+		constexpr size_t maxFrameSize = 128;
+
+		bool isRegister(Place const& place, Register reg)
+		{
+			auto held = std::get_if<Register>(&place);
+			return held && *held == reg;
+		}
+
+		bool isByteRegister(Place const& place)
+		{
+			auto reg = std::get_if<Register>(&place);
+			return reg && classOf(*reg) == RegisterClass::BYTE;
+		}
+
+		// BC, DE or HL, whose halves 8-bit instructions can use
+		bool isPair(Place const& place)
+		{
+			auto reg = std::get_if<Register>(&place);
+			return reg && classOf(*reg) == RegisterClass::WORD && *reg != Register::IY;
+		}
+
+		bool isImmediate(Place const& place, int value)
+		{
+			auto immediate = std::get_if<Immediate>(&place);
+			return immediate && immediate->value == value;
+		}
+
+		RegisterUnits unitsOf(Place const& place)
+		{
+			if (auto reg = std::get_if<Register>(&place)) return z80::unitsOf(*reg);
+			if (auto memory = std::get_if<Indirect>(&place)) return z80::unitsOf(memory->pointer);
+			return 0;
+		}
+
+		bool samePlace(Place const& lhs, Place const& rhs)
+		{
+			if (lhs.index() != rhs.index()) return false;
+			return std::visit(util::OverloadVariant{
+				[&](Register reg) { return reg == std::get<Register>(rhs); },
+				[&](StackSlot slot) { return slot.offset == std::get<StackSlot>(rhs).offset; },
+				[&](Immediate immediate) { return immediate.value == std::get<Immediate>(rhs).value; },
+				[&](Indirect memory) { return memory.pointer == std::get<Indirect>(rhs).pointer; },
+				[&](Global global) { return global.variable == std::get<Global>(rhs).variable && global.offset == std::get<Global>(rhs).offset; }
+			}, lhs);
+		}
+
+		Register lowByte(Register pair)
+		{
+			switch (pair)
+			{
+			case Register::BC: return Register::C;
+			case Register::DE: return Register::E;
+			default: return Register::L;
+			}
+		}
+
+		Register highByte(Register pair)
+		{
+			switch (pair)
+			{
+			case Register::BC: return Register::B;
+			case Register::DE: return Register::D;
+			default: return Register::H;
+			}
+		}
+
+		// the low (0) or high (1) byte of a 16-bit value, IY and pointed at words have none
+		Place byteOf(Place const& place, int byte)
+		{
+			return std::visit(util::OverloadVariant{
+				[&](Register reg) -> Place {
+					COMPILER_ASSERT("only BC, DE and HL have 8-bit halves", isPair(reg));
+					return byte == 0 ? lowByte(reg) : highByte(reg);
+				},
+				[&](StackSlot slot) -> Place { return StackSlot{ slot.offset + byte }; },
+				[&](Immediate immediate) -> Place { return Immediate{ (immediate.value >> (8 * byte)) & 0xFF }; },
+				[&](Indirect memory) -> Place {
+					COMPILER_ASSERT("words are not read through folded pointers", false);
+					return memory;
+				},
+				[&](Global global) -> Place { return Global{ global.variable, global.offset + byte }; }
+			}, place);
+		}
+
+		// the pair push and pop save a register with
+		std::string_view savePairOf(Register reg)
+		{
+			switch (reg)
+			{
+			case Register::A: return "af";
+			case Register::B: case Register::C: case Register::BC: return "bc";
+			case Register::D: case Register::E: case Register::DE: return "de";
+			case Register::H: case Register::L: case Register::HL: return "hl";
+			case Register::IY: return "iy";
+			}
+			return "";
+		}
+
+		RegisterUnits savedUnits(Register reg)
+		{
+			switch (reg)
+			{
+			case Register::A: return unit::A;
+			case Register::B: case Register::C: case Register::BC: return unit::B | unit::C;
+			case Register::D: case Register::E: case Register::DE: return unit::D | unit::E;
+			case Register::H: case Register::L: case Register::HL: return unit::H | unit::L;
+			case Register::IY: return unit::IY;
+			}
+			return 0;
+		}
+
+		std::string_view inverse(std::string_view condition)
+		{
+			if (condition == "z") return "nz";
+			if (condition == "nz") return "z";
+			if (condition == "c") return "nc";
+			return "c";
+		}
+
+		bool isComparison(Token::Type operation)
+		{
+			switch (operation)
+			{
+			case Token::Type::EQUAL_EQUAL: case Token::Type::NOT_EQUAL: case Token::Type::LESS:
+			case Token::Type::LESS_EQUAL: case Token::Type::GREATER: case Token::Type::GREATER_EQUAL:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// the 8-bit instruction of a bitwise or additive operator, nullopt for the rest
+		std::optional<std::string_view> arithmeticOpcode(Token::Type operation, bool withCarry = false)
+		{
+			switch (operation)
+			{
+			case Token::Type::PLUS: return withCarry ? "adc" : "add";
+			case Token::Type::MINUS: return withCarry ? "sbc" : "sub";
+			case Token::Type::BIT_AND: case Token::Type::AND: return "and";
+			case Token::Type::BIT_OR: case Token::Type::OR: return "or";
+			case Token::Type::BIT_XOR: return "xor";
+			default: return std::nullopt;
+			}
+		}
+
+		std::string_view helperName(Token::Type operation, IL::Type type)
+		{
+			bool word = classOf(type) == RegisterClass::WORD, isUnsigned = IL::isIlTypeUnsigned(type);
+			switch (operation)
+			{
+			case Token::Type::STAR: return word ? "__mul16" : "__mul8";
+			case Token::Type::SLASH:
+				if (word) return isUnsigned ? "__divu16" : "__div16";
+				return isUnsigned ? "__divu8" : "__div8";
+			default:
+				if (word) return isUnsigned ? "__modu16" : "__mod16";
+				return isUnsigned ? "__modu8" : "__mod8";
+			}
+		}
+
+		// the lower case spelling of a register, flag or opcode, which is all the assembler's table knows
+		std::string_view canonical(std::string_view word)
+		{
+			auto entry = reserved::find(word);
+			return entry ? entry->word : word;
+		}
+
+		// what an argument of inline assembly stands for, nullopt for what the selector cannot read
+		std::optional<Asm::Operand> asmOperand(Expr::Expr const& expr, bool inner = false)
+		{
+			if (expr.is<Expr::Register>()) return Asm::Register(canonical(static_cast<Expr::Register const&>(expr).reg));
+			if (expr.is<Expr::Flag>() && !inner) return Asm::Flag(canonical(static_cast<Expr::Flag const&>(expr).flag));
+			if (expr.is<Expr::Literal>())
+			{
+				auto number = std::get_if<u16>(&static_cast<Expr::Literal const&>(expr).literal);
+				return number ? std::optional<Asm::Operand>(Asm::Number(*number)) : std::nullopt;
+			}
+			if (expr.is<Expr::Unary>())
+			{
+				auto& unary = static_cast<Expr::Unary const&>(expr);
+				auto operand = asmOperand(*unary.expr, true);
+				auto number = operand.has_value() ? std::get_if<Asm::Number>(&operand.value()) : nullptr;
+				if (!number || unary.oper != Token::Type::MINUS) return std::nullopt;
+				return Asm::Number(static_cast<uint16_t>(-number->val));
+			}
+			if (expr.is<Expr::Binary>())
+			{
+				auto& binary = static_cast<Expr::Binary const&>(expr);
+				if (binary.oper != Token::Type::PLUS && binary.oper != Token::Type::MINUS) return std::nullopt;
+				auto lhs = asmOperand(*binary.lhs, true), rhs = asmOperand(*binary.rhs, true);
+				if (!lhs.has_value() || !rhs.has_value()) return std::nullopt;
+				auto offset = std::get_if<Asm::Number>(&rhs.value());
+				if (!offset) return std::nullopt;
+				uint16_t value = binary.oper == Token::Type::PLUS ? offset->val : static_cast<uint16_t>(-offset->val);
+				if (auto number = std::get_if<Asm::Number>(&lhs.value())) return Asm::Number(static_cast<uint16_t>(number->val + value));
+				if (auto reg = std::get_if<Asm::Register>(&lhs.value())) return Asm::OffsetRegister(reg->str, value);
+				return std::nullopt;
+			}
+			if (expr.is<Expr::Parenthesis>() && !inner)
+			{
+				auto address = asmOperand(*static_cast<Expr::Parenthesis const&>(expr).expr, true);
+				if (!address.has_value()) return std::nullopt;
+				return std::visit(util::OverloadVariant{
+					[](Asm::Register reg) -> std::optional<Asm::Operand> { return Asm::Dereference(reg); },
+					[](Asm::OffsetRegister reg) -> std::optional<Asm::Operand> { return Asm::Dereference(reg); },
+					[](Asm::Number number) -> std::optional<Asm::Operand> { return Asm::Dereference(number); },
+					[](auto const&) -> std::optional<Asm::Operand> { return std::nullopt; }
+				}, address.value());
+			}
+			return std::nullopt;
+		}
+
+		class Sequence
+		{
+		public:
+			template<typename...Operands>
+			void emit(std::string_view opcode, Operands const&...operands)
+			{
+				MachineInstruction instr{ opcode };
+				(add(instr, operands), ...);
+				code.push_back(std::move(instr));
+			}
+
+			template<typename...Operands>
+			void emitReferencing(Reference reference, std::string_view opcode, Operands const&...operands)
+			{
+				emit(opcode, operands...);
+				code.back().reference = reference;
+			}
+
+			void append(Sequence const& other)
+			{
+				code.insert(code.end(), other.code.begin(), other.code.end());
+				repeated += other.repeated;
+			}
+
+			// what the code costs, with the loops in it run as often as they are known to
+			Cost cost() const
+			{
+				Cost total = costOf(code);
+				total += repeated;
+				return total;
+			}
+
+			std::vector<MachineInstruction> code;
+			Cost repeated; // the time loops spend past their first iteration
+			std::optional<std::string_view> condition; // the flag the code leaves for a branch
+			std::optional<Place> place; // where the code leaves its value
+
+		private:
+			static void add(MachineInstruction& instr, Asm::Operand const& operand)
+			{
+				instr.operands.push_back(operand);
+			}
+			static void add(MachineInstruction& instr, Place const& place)
+			{
+				std::visit(util::OverloadVariant{
+					[&](Register reg) { instr.operands.push_back(Asm::Register(registerName(reg))); },
+					[&](StackSlot slot) {
+						COMPILER_ASSERT("the frame was checked to be in reach of IX", slot.offset >= -int(maxFrameSize) && slot.offset < 0);
+						instr.operands.push_back(Asm::Dereference(Asm::OffsetRegister("ix", static_cast<uint16_t>(slot.offset))));
+					},
+					[&](Immediate immediate) { instr.operands.push_back(Asm::Number(static_cast<uint16_t>(immediate.value))); },
+					[&](Indirect memory) {
+						if (memory.pointer == Register::IY) instr.operands.push_back(Asm::Dereference(Asm::OffsetRegister("iy", 0)));
+						else instr.operands.push_back(Asm::Dereference(Asm::Register(registerName(memory.pointer))));
+					},
+					[&](Global global) {
+						instr.operands.push_back(Asm::Dereference(Asm::Number(static_cast<uint16_t>(global.offset))));
+						instr.reference = global.variable;
+					}
+				}, place);
+			}
+		};
+	}
+
+	class InstructionSelector
+	{
+		// the places a node of a tree can leave its value in
+		enum class Goal {
+			LOCATION, ACCUMULATOR, MEMORY, FLAGS
+		};
+
+	public:
+		InstructionSelector(ILCtrlFlowGraph const& graph, RegisterAllocation const& allocation, IL::Type returnType, CostModel model)
+			: graph(graph), allocation(allocation), returnType(returnType), model(model)
+		{
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& data = graph.nodeData(block);
+				for (auto& instr : data.body) IL::forEachUse(instr, [&](IL::Variable& var) { countUse(var); });
+				if (data.splits()) countUse(data.splitsOn());
+			}
+		}
+
+		std::vector<MachineBlock> run()
+		{
+			if (allocation.frameSize() > maxFrameSize) {
+				throw SelectionError(SourcePosition{}, fmt::format("A stack frame of {} bytes does not fit below IX, (IX+d) reaches {} bytes",
+					allocation.frameSize(), maxFrameSize));
+			}
+			auto order = allocation.intervals().order();
+			std::vector<MachineBlock> blocks;
+			for (size_t index = 0; index < order.size(); ++index)
+			{
+				std::optional<size_t> next;
+				if (index + 1 < order.size()) next = order[index + 1];
+				blocks.push_back(MachineBlock{ order[index], selectBlock(order[index], next).code });
+			}
+			return blocks;
+		}
+
+	private:
+		ILCtrlFlowGraph const& graph;
+		RegisterAllocation const& allocation;
+		IL::Type returnType;
+		CostModel model;
+		std::vector<size_t> useCounts;
+
+		// the instruction being lowered
+		size_t position = 0;
+		RegisterUnits liveAcross = 0;	// units holding values that live across it
+		RegisterUnits operandUnits = 0; // units its operands are read from
+		RegisterUnits resultUnits = 0;	// units its value is written to
+		std::unordered_map<size_t, Place> folded; // operands a child left in the accumulator or in memory
+
+		// the candidate being built
+		std::vector<std::string_view> saves; // pairs pushed before it and popped after it
+		RegisterUnits scratchUnits = 0;
+
+		void countUse(IL::Variable const& var)
+		{
+			if (var.is_global) return;
+			if (var.id >= useCounts.size()) useCounts.resize(var.id + 1);
+			useCounts[var.id]++;
+		}
+
+		IL::Type typeOf(IL::Variable const& var) const
+		{
+			auto interval = allocation.intervals().intervalOf(var);
+			return interval ? interval->type : IL::Type::u16;
+		}
+
+		bool isByte(IL::Type type) const { return classOf(type) == RegisterClass::BYTE; }
+
+		Place placeOf(IL::Value const& value) const
+		{
+			if (auto constant = std::get_if<int>(&value)) return Immediate{ *constant };
+			auto var = std::get_if<IL::Variable>(&value);
+			COMPILER_ASSERT("strings are lowered to globals before instruction selection", var != nullptr);
+			if (var->is_global) return Global{ *var };
+			if (auto operand = folded.find(var->id); operand != folded.end()) return operand->second;
+			auto location = allocation.locationOf(*var);
+			COMPILER_ASSERT("a used variable has a location", location.has_value());
+			return std::visit([](auto location) -> Place { return location; }, location.value());
+		}
+
+		std::optional<Place> locationOf(IL::Variable const& var) const
+		{
+			if (var.is_global) return Global{ var };
+			auto location = allocation.locationOf(var);
+			if (!location.has_value()) return std::nullopt;
+			return std::visit([](auto location) -> Place { return location; }, location.value());
+		}
+
+		RegisterUnits liveAcrossAt(size_t at) const
+		{
+			RegisterUnits units = 0;
+			for (auto& interval : allocation.intervals().intervals())
+			{
+				if (interval.empty() || !interval.covers(at + 1)) continue;
+				auto location = allocation.locationOf(interval.variable);
+				if (location.has_value()) {
+					if (auto reg = std::get_if<Register>(&location.value())) units |= z80::unitsOf(*reg);
+				}
+			}
+			return units;
+		}
+
+		void enter(size_t at, IL::UniquePtr const* instr)
+		{
+			position = at;
+			liveAcross = liveAcrossAt(at);
+			operandUnits = 0;
+			if (instr) IL::forEachUse(*instr, [&](IL::Variable& var) { operandUnits |= unitsOf(placeOf(var)); });
+		}
+
+		// the cheapest candidate that applies, the candidates share no state
+		template<typename Builder>
+		void consider(std::optional<Sequence>& best, Builder build)
+		{
+			auto operands = operandUnits;
+			saves.clear();
+			scratchUnits = 0;
+			std::optional<Sequence> body = build();
+			operandUnits = operands;
+			if (!body.has_value()) return;
+
+			Sequence candidate;
+			for (auto pair : saves) candidate.emit("push", Asm::Register(pair));
+			candidate.append(body.value());
+			for (auto pair = saves.rbegin(); pair != saves.rend(); ++pair) candidate.emit("pop", Asm::Register(*pair));
+			candidate.condition = body->condition;
+			if (!best.has_value() || cheaper(candidate.cost(), best->cost(), model)) best = std::move(candidate);
+		}
+
+		// takes reg for the rest of the candidate, which may still hold the operands in mayHold
+		bool takeRegister(Register reg, RegisterUnits mayHold = 0)
+		{
+			RegisterUnits units = z80::unitsOf(reg);
+			if (units & (scratchUnits | (operandUnits & ~mayHold))) return false;
+			if (units & liveAcross)
+			{
+				if (savedUnits(reg) & resultUnits) return false;
+				saves.push_back(savePairOf(reg));
+			}
+			scratchUnits |= units;
+			return true;
+		}
+
+		// any register of the class that is not an operand or the result, free ones first
+		std::optional<Register> takeScratch(RegisterClass regClass, RegisterUnits avoid = 0)
+		{
+			static constexpr std::array bytes = { Register::A, Register::L, Register::H, Register::E, Register::D, Register::C, Register::B };
+			static constexpr std::array words = { Register::HL, Register::DE, Register::BC, Register::IY };
+			std::span<const Register> order = bytes;
+			if (regClass == RegisterClass::WORD) order = words;
+			for (bool save : { false, true })
+			{
+				for (Register reg : order)
+				{
+					RegisterUnits units = z80::unitsOf(reg);
+					if (units & (avoid | scratchUnits | operandUnits | resultUnits)) continue;
+					if (units & liveAcross)
+					{
+						if (!save || (savedUnits(reg) & resultUnits)) continue;
+						saves.push_back(savePairOf(reg));
+					}
+					scratchUnits |= units;
+					return reg;
+				}
+			}
+			return std::nullopt;
+		}
+
+		std::optional<Register> takePair(RegisterUnits avoid = 0)
+		{
+			return takeScratch(RegisterClass::WORD, avoid | unit::IY);
+		}
+
+		// moves an operand out of reg, so the candidate can use reg
+		bool evacuate(Sequence& out, Place& operand, Register reg)
+		{
+			if (!(unitsOf(operand) & z80::unitsOf(reg))) return true;
+			auto other = classOf(reg) == RegisterClass::BYTE ? takeScratch(RegisterClass::BYTE, z80::unitsOf(reg)) : takePair(z80::unitsOf(reg));
+			if (!other || !move(out, *other, operand)) return false;
+			operandUnits &= ~unitsOf(operand);
+			operand = *other;
+			return true;
+		}
+
+		// runs code that destroys reg, saving reg around it when something needs it
+		template<typename Code>
+		bool usingRegister(Sequence& out, Register reg, Code code)
+		{
+			RegisterUnits units = z80::unitsOf(reg);
+			bool save = (units & (liveAcross | operandUnits | resultUnits | scratchUnits)) != 0;
+			if (save) out.emit("push", Asm::Register(savePairOf(reg)));
+			bool done = code();
+			if (save) out.emit("pop", Asm::Register(savePairOf(reg)));
+			return done;
+		}
+
+		static bool canLoad(Register reg, Place const& src)
+		{
+			if (std::holds_alternative<Immediate>(src) || std::holds_alternative<StackSlot>(src)) return true;
+			if (auto other = std::get_if<Register>(&src)) return classOf(*other) == RegisterClass::BYTE;
+			if (auto memory = std::get_if<Indirect>(&src)) {
+				return memory->pointer == Register::HL || memory->pointer == Register::IY || reg == Register::A;
+			}
+			return reg == Register::A;
+		}
+
+		static bool canStore(Place const& dst, Register reg)
+		{
+			if (auto other = std::get_if<Register>(&dst)) return classOf(*other) == RegisterClass::BYTE;
+			if (std::holds_alternative<StackSlot>(dst)) return true;
+			if (auto memory = std::get_if<Indirect>(&dst)) {
+				return memory->pointer == Register::HL || memory->pointer == Register::IY || reg == Register::A;
+			}
+			return std::holds_alternative<Global>(dst) && reg == Register::A;
+		}
+
+		// what ADD A,x, CP x, INC x and the like can take
+		static bool isArithmeticOperand(Place const& place)
+		{
+			if (auto memory = std::get_if<Indirect>(&place)) return memory->pointer == Register::HL || memory->pointer == Register::IY;
+			return isByteRegister(place) || std::holds_alternative<StackSlot>(place) || std::holds_alternative<Immediate>(place);
+		}
+
+		bool moveByte(Sequence& out, Place const& dst, Place const& src)
+		{
+			if (samePlace(dst, src)) return true;
+			auto dstReg = std::get_if<Register>(&dst);
+			auto srcReg = std::get_if<Register>(&src);
+			if ((dstReg && canLoad(*dstReg, src)) || (srcReg && canStore(dst, *srcReg)) ||
+				(std::holds_alternative<Immediate>(src) && isArithmeticOperand(dst)))
+			{
+				out.emit("ld", dst, src);
+				return true;
+			}
+			return usingRegister(out, Register::A, [&] {
+				out.emit("ld", Register::A, src);
+				out.emit("ld", dst, Register::A);
+				return true;
+			});
+		}
+
+		bool moveWord(Sequence& out, Place const& dst, Place const& src)
+		{
+			if (samePlace(dst, src)) return true;
+			auto dstReg = std::get_if<Register>(&dst);
+			auto srcReg = std::get_if<Register>(&src);
+			bool immediate = std::holds_alternative<Immediate>(src), global = std::holds_alternative<Global>(src);
+			if (dstReg && (immediate || global))
+			{
+				out.emit("ld", dst, src);
+				return true;
+			}
+			if (dstReg && srcReg && (*dstReg == Register::IY || *srcReg == Register::IY))
+			{
+				out.emit("push", src);
+				out.emit("pop", dst);
+				return true;
+			}
+			if ((isPair(dst) && (isPair(src) || std::holds_alternative<StackSlot>(src))) ||
+				(isPair(src) && std::holds_alternative<StackSlot>(dst)) ||
+				(immediate && std::holds_alternative<StackSlot>(dst)))
+			{
+				// little endian, so the low byte goes first
+				out.emit("ld", byteOf(dst, 0), byteOf(src, 0));
+				out.emit("ld", byteOf(dst, 1), byteOf(src, 1));
+				return true;
+			}
+			if (srcReg && std::holds_alternative<Global>(dst))
+			{
+				out.emit("ld", dst, src);
+				return true;
+			}
+			if (std::holds_alternative<Indirect>(dst) || std::holds_alternative<Indirect>(src)) return false;
+
+			RegisterUnits around = unitsOf(dst) | unitsOf(src);
+			for (Register temp : { Register::HL, Register::DE, Register::BC })
+			{
+				if (z80::unitsOf(temp) & around) continue;
+				return usingRegister(out, temp, [&] { return moveWord(out, temp, src) && moveWord(out, dst, temp); });
+			}
+			return false;
+		}
+
+		bool move(Sequence& out, Register dst, Place const& src)
+		{
+			return classOf(dst) == RegisterClass::BYTE ? moveByte(out, dst, src) : moveWord(out, dst, src);
+		}
+
+		// moves sources into target registers at once, breaking cycles through a scratch register
+		bool parallelMove(Sequence& out, std::vector<std::pair<Register, Place>> moves)
+		{
+			RegisterUnits involved = 0;
+			for (auto& [target, source] : moves) involved |= z80::unitsOf(target) | unitsOf(source);
+			while (!moves.empty())
+			{
+				auto ready = std::find_if(moves.begin(), moves.end(), [&](auto const& move) {
+					return std::none_of(moves.begin(), moves.end(), [&](auto const& other) {
+						return &other != &move && (unitsOf(other.second) & z80::unitsOf(move.first));
+					});
+				});
+				if (ready != moves.end())
+				{
+					if (!move(out, ready->first, ready->second)) return false;
+					moves.erase(ready);
+					continue;
+				}
+				auto& first = moves.front();
+				auto temp = takeScratch(classOf(first.first), involved | unit::IY);
+				if (!temp || !move(out, *temp, first.second)) return false;
+				first.second = *temp;
+			}
+			return true;
+		}
+
+		// a copy of place that 8-bit instructions can reach both bytes of
+		std::optional<Place> splittable(Sequence& out, Place const& place)
+		{
+			if (!isRegister(place, Register::IY)) return place;
+			auto temp = takePair();
+			if (!temp || !moveWord(out, *temp, place)) return std::nullopt;
+			return *temp;
+		}
+
+		// an operand for ADD A,x and the like, loaded into a register other than A when it is not one
+		std::optional<Place> arithmeticOperand(Sequence& out, Place const& place)
+		{
+			if (isArithmeticOperand(place)) return place;
+			auto temp = takeScratch(RegisterClass::BYTE, unit::A);
+			if (!temp || !moveByte(out, *temp, place)) return std::nullopt;
+			return *temp;
+		}
+
+		void arithmetic(Sequence& out, std::string_view opcode, Place const& operand)
+		{
+			if (opcode == "add" || opcode == "adc" || opcode == "sbc") out.emit(opcode, Register::A, operand);
+			else out.emit(opcode, operand);
+		}
+
+		void repeat(Sequence& out, size_t count, std::string_view opcode, Place const& operand)
+		{
+			for (size_t i = 0; i < count; ++i) out.emit(opcode, operand);
+		}
+
+		// the value of the flag in A as 0 or 1
+		void materialize(Sequence& out, std::string_view condition)
+		{
+			if (condition == "c")
+			{
+				out.emit("sbc", Register::A, Register::A);
+				out.emit("and", Immediate{ 1 });
+			}
+			else if (condition == "nc")
+			{
+				out.emit("sbc", Register::A, Register::A);
+				out.emit("inc", Register::A);
+			}
+			else
+			{
+				// LD keeps the flags, the jump skips the INC
+				out.emit("ld", Register::A, Immediate{ 0 });
+				out.emit("jr", Asm::Flag(inverse(condition)), Immediate{ 1 });
+				out.emit("inc", Register::A);
+			}
+		}
+
+		// the code computing a condition, stored as a byte unless the goal is the flags
+		template<typename Flags>
+		std::optional<Sequence> condition(Goal goal, std::optional<Place> const& result, Flags setFlags)
+		{
+			std::optional<Sequence> best;
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				auto flag = setFlags(out);
+				if (!flag.has_value()) return std::nullopt;
+				if (goal == Goal::FLAGS)
+				{
+					out.condition = flag;
+					return out;
+				}
+				if (!takeRegister(Register::A, scratchUnits & unit::A)) return std::nullopt;
+				materialize(out, flag.value());
+				if (!moveByte(out, result.value(), Register::A)) return std::nullopt;
+				return out;
+			});
+			return best;
+		}
+
+		//Lowering
+
+		std::optional<Sequence> lower(IL::UniquePtr const& instr, Goal goal, std::optional<Place> const& result)
+		{
+			resultUnits = result.has_value() ? unitsOf(result.value()) : 0;
+			if (auto copy = IL::getIf<IL::Assignment>(instr)) return lowerAssignment(*copy, result);
+			if (auto expr = IL::getIf<IL::Binary>(instr)) return lowerBinary(*expr, goal, result);
+			if (auto expr = IL::getIf<IL::Unary>(instr)) return lowerUnary(*expr, result);
+			if (auto cast = IL::getIf<IL::Cast>(instr)) return lowerCast(*cast, goal, result);
+			if (auto test = IL::getIf<IL::TestBit>(instr)) return lowerTestBit(*test, goal, result);
+			if (auto deref = IL::getIf<IL::Deref>(instr)) return lowerDeref(*deref, result);
+			if (auto store = IL::getIf<IL::Store>(instr)) return lowerStore(*store);
+			if (auto ret = IL::getIf<IL::Return>(instr)) return lowerReturn(*ret);
+			if (auto call = IL::getIf<IL::FunctionCall>(instr)) return lowerCall(*call, result);
+			if (auto copy = IL::getIf<IL::MemCopy>(instr)) return lowerMemCopy(*copy);
+			if (auto addressOf = IL::getIf<IL::AddressOf>(instr)) return lowerAddressOf(*addressOf, result);
+			if (auto allocation = IL::getIf<IL::Allocate>(instr)) return lowerAllocate(*allocation, result);
+			if (auto asmInstr = IL::getIf<IL::Instruction>(instr)) return lowerInstruction(asmInstr->instr);
+			return Sequence{};
+		}
+
+		// inline assembly may use any register (see Constraints.h), so it is copied as written
+		Sequence lowerInstruction(Stmt::Instruction const& instr)
+		{
+			MachineInstruction machine{ canonical(instr.opcode) };
+			for (auto& arg : instr.argList)
+			{
+				auto operand = asmOperand(*arg);
+				if (!operand.has_value()) {
+					throw SelectionError(arg->sourcePos, fmt::format("Operand {} of {} is not a register, flag, number or address",
+						machine.operands.size() + 1, instr.opcode));
+				}
+				machine.operands.push_back(operand.value());
+			}
+			// the lexer reads the condition c as the register
+			bool conditional = machine.opcode == "jp" || machine.opcode == "jr" || machine.opcode == "call" || machine.opcode == "ret";
+			if (conditional && machine.operands.size() > (machine.opcode == "ret" ? 0u : 1u) &&
+				machine.operands.front() == Asm::Operand(Asm::Register("c"))) {
+				machine.operands.front() = Asm::Flag("c");
+			}
+			try {
+				Asm::getInstructionFormat(machine.opcode, machine.operands);
+			}
+			catch (Asm::UnknownOpcode const&) {
+				throw SelectionError(instr.sourcePos, fmt::format("{} is not a Z80 instruction", instr.opcode));
+			}
+			catch (Asm::InvalidOperands const&) {
+				throw SelectionError(instr.sourcePos, fmt::format("{} does not take these operands", instr.opcode));
+			}
+			Sequence out;
+			out.code.push_back(std::move(machine));
+			return out;
+		}
+
+		std::optional<Sequence> lowerAssignment(IL::Assignment const& copy, std::optional<Place> const& result)
+		{
+			if (!result.has_value()) return Sequence{};
+			Place src = placeOf(copy.src);
+			std::optional<Sequence> best;
+			if (isByte(copy.dest.type))
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!moveByte(out, result.value(), src)) return std::nullopt;
+					return out;
+				});
+				if (isRegister(result.value(), Register::A) && isImmediate(src, 0))
+				{
+					consider(best, [&]() -> std::optional<Sequence> {
+						Sequence out;
+						out.emit("xor", Register::A);
+						return out;
+					});
+				}
+			}
+			else
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!moveWord(out, result.value(), src)) return std::nullopt;
+					return out;
+				});
+			}
+			return best;
+		}
+
+		std::optional<Sequence> lowerBinary(IL::Binary const& expr, Goal goal, std::optional<Place> const& result)
+		{
+			if (isComparison(expr.operation)) return lowerComparison(expr, goal, result);
+			if (!result.has_value()) return Sequence{};
+			if (IL::isHelperCall(expr.operation)) return lowerHelperCall(expr, result.value());
+			if (expr.operation == Token::Type::SHIFT_LEFT || expr.operation == Token::Type::SHIFT_RIGHT) {
+				return lowerShift(expr, result.value());
+			}
+			if (isByte(expr.dest.type)) return lowerByteArithmetic(expr, result.value());
+			return lowerWordArithmetic(expr, result.value());
+		}
+
+		std::optional<Sequence> lowerByteArithmetic(IL::Binary const& expr, Place const& result)
+		{
+			auto opcode = arithmeticOpcode(expr.operation);
+			COMPILER_ASSERT("unknown 8-bit operator", opcode.has_value());
+			Place lhs = placeOf(expr.lhs), rhs = placeOf(expr.rhs);
+			std::optional<Sequence> best;
+
+			auto accumulate = [&](Place lhs, Place rhs) -> std::optional<Sequence> {
+				Sequence out;
+				if (!isRegister(lhs, Register::A) && !evacuate(out, rhs, Register::A)) return std::nullopt;
+				auto operand = arithmeticOperand(out, rhs);
+				if (!operand || !takeRegister(Register::A, unitsOf(lhs))) return std::nullopt;
+				moveByte(out, Register::A, lhs);
+				arithmetic(out, opcode.value(), operand.value());
+				if (!moveByte(out, result, Register::A)) return std::nullopt;
+				return out;
+			};
+			consider(best, [&] { return accumulate(lhs, rhs); });
+			if (IL::isCommutative(expr.operation)) consider(best, [&] { return accumulate(rhs, lhs); });
+
+			// INC and DEC work on the value in place, without A
+			auto constant = std::get_if<Immediate>(&rhs);
+			if (constant && (expr.operation == Token::Type::PLUS || expr.operation == Token::Type::MINUS) && isArithmeticOperand(result))
+			{
+				int delta = static_cast<int8_t>(expr.operation == Token::Type::PLUS ? constant->value : -constant->value);
+				consider(best, [&]() -> std::optional<Sequence> {
+					if (delta == 0 || std::abs(delta) > 3 || std::holds_alternative<Immediate>(result)) return std::nullopt;
+					Sequence out;
+					if (!moveByte(out, result, lhs)) return std::nullopt;
+					repeat(out, std::abs(delta), delta > 0 ? "inc" : "dec", result);
+					return out;
+				});
+			}
+			return best;
+		}
+
+		std::optional<Sequence> lowerWordArithmetic(IL::Binary const& expr, Place const& result)
+		{
+			Place lhs = placeOf(expr.lhs), rhs = placeOf(expr.rhs);
+			bool additive = expr.operation == Token::Type::PLUS || expr.operation == Token::Type::MINUS;
+			std::optional<Sequence> best;
+
+			if (additive)
+			{
+				// ADD HL,rr and SBC HL,rr
+				auto throughHL = [&](Place lhs, Place rhs) -> std::optional<Sequence> {
+					Sequence out;
+					bool subtract = expr.operation == Token::Type::MINUS;
+					if (!samePlace(lhs, rhs) && !evacuate(out, rhs, Register::HL)) return std::nullopt;
+					if (!isPair(rhs))
+					{
+						auto temp = takePair(z80::unitsOf(Register::HL));
+						if (!temp || !moveWord(out, *temp, rhs)) return std::nullopt;
+						rhs = *temp;
+					}
+					if (!takeRegister(Register::HL, unitsOf(lhs))) return std::nullopt;
+					moveWord(out, Register::HL, lhs);
+					if (subtract)
+					{
+						out.emit("or", Register::A);
+						out.emit("sbc", Register::HL, rhs);
+					}
+					else out.emit("add", Register::HL, rhs);
+					if (!moveWord(out, result, Register::HL)) return std::nullopt;
+					return out;
+				};
+				consider(best, [&] { return throughHL(lhs, rhs); });
+				if (expr.operation == Token::Type::PLUS) consider(best, [&] { return throughHL(rhs, lhs); });
+
+				auto constant = std::get_if<Immediate>(&rhs);
+				if (constant)
+				{
+					int delta = static_cast<int16_t>(expr.operation == Token::Type::PLUS ? constant->value : -constant->value);
+					// subtracting a constant is adding its negation, which needs no OR A
+					if (expr.operation == Token::Type::MINUS)
+					{
+						consider(best, [&]() -> std::optional<Sequence> {
+							Sequence out;
+							auto temp = takePair(z80::unitsOf(Register::HL));
+							if (!temp || !takeRegister(Register::HL, unitsOf(lhs))) return std::nullopt;
+							moveWord(out, *temp, Immediate{ delta & 0xFFFF });
+							moveWord(out, Register::HL, lhs);
+							out.emit("add", Register::HL, *temp);
+							if (!moveWord(out, result, Register::HL)) return std::nullopt;
+							return out;
+						});
+					}
+					// INC rr and DEC rr
+					consider(best, [&]() -> std::optional<Sequence> {
+						auto reg = std::get_if<Register>(&result);
+						if (!reg || delta == 0 || std::abs(delta) > 4) return std::nullopt;
+						Sequence out;
+						if (!moveWord(out, result, lhs)) return std::nullopt;
+						repeat(out, std::abs(delta), delta > 0 ? "inc" : "dec", result);
+						return out;
+					});
+				}
+			}
+
+			// byte by byte through A, with the carry between the halves
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				if (!isPair(result) && !std::holds_alternative<StackSlot>(result)) return std::nullopt;
+				auto left = splittable(out, lhs), right = splittable(out, rhs);
+				if (!left || !right || !takeRegister(Register::A)) return std::nullopt;
+				for (int byte = 0; byte < 2; ++byte)
+				{
+					auto operand = arithmeticOperand(out, byteOf(*right, byte));
+					if (!operand) return std::nullopt;
+					moveByte(out, Register::A, byteOf(*left, byte));
+					arithmetic(out, arithmeticOpcode(expr.operation, byte == 1).value(), operand.value());
+					moveByte(out, byteOf(result, byte), Register::A);
+				}
+				return out;
+			});
+			return best;
+		}
+
+		std::optional<Sequence> lowerShift(IL::Binary const& expr, Place const& result)
+		{
+			bool left = expr.operation == Token::Type::SHIFT_LEFT, isSigned = !IL::isIlTypeUnsigned(expr.dest.type);
+			Place lhs = placeOf(expr.lhs), rhs = placeOf(expr.rhs);
+			auto constant = std::get_if<Immediate>(&rhs);
+			std::optional<Sequence> best;
+
+			if (isByte(expr.dest.type))
+			{
+				std::string_view opcode = left ? "sla" : (isSigned ? "sra" : "srl");
+				if (constant)
+				{
+					size_t count = std::min(constant->value, 8);
+					consider(best, [&]() -> std::optional<Sequence> {
+						Sequence out;
+						if (!takeRegister(Register::A, unitsOf(lhs))) return std::nullopt;
+						moveByte(out, Register::A, lhs);
+						// ADD A,A is the cheaper SLA A
+						for (size_t i = 0; i < count; ++i)
+						{
+							if (left) out.emit("add", Register::A, Register::A);
+							else out.emit(opcode, Register::A);
+						}
+						if (!moveByte(out, result, Register::A)) return std::nullopt;
+						return out;
+					});
+					// in place when the result is in a register
+					consider(best, [&]() -> std::optional<Sequence> {
+						if (!isByteRegister(result)) return std::nullopt;
+						Sequence out;
+						if (!moveByte(out, result, lhs)) return std::nullopt;
+						repeat(out, count, opcode, result);
+						return out;
+					});
+				}
+				// a loop is smaller than a long unrolled shift, even for a constant count
+				std::optional<int> knownCount = constant ? std::optional(std::min(constant->value, 8)) : std::nullopt;
+				Place times = knownCount ? Place(Immediate{ knownCount.value() }) : rhs;
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!takeRegister(Register::A, unitsOf(lhs)) || !takeRegister(Register::B, unitsOf(lhs) | unitsOf(times)) ||
+						!parallelMove(out, { { Register::A, lhs }, { Register::B, times } })) return std::nullopt;
+					countedLoop(out, [&](Sequence& body) {
+						if (left) body.emit("add", Register::A, Register::A);
+						else body.emit(opcode, Register::A);
+					}, knownCount);
+					if (!moveByte(out, result, Register::A)) return std::nullopt;
+					return out;
+				});
+				return best;
+			}
+
+			auto shiftHL = [&](Sequence& out) {
+				if (left) out.emit("add", Register::HL, Register::HL);
+				else
+				{
+					out.emit(isSigned ? "sra" : "srl", Register::H);
+					out.emit("rr", Register::L);
+				}
+			};
+			if (constant)
+			{
+				int count = std::min(constant->value, 16);
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!takeRegister(Register::HL, unitsOf(lhs))) return std::nullopt;
+					moveWord(out, Register::HL, lhs);
+					for (int i = 0; i < count; ++i) shiftHL(out);
+					if (!moveWord(out, result, Register::HL)) return std::nullopt;
+					return out;
+				});
+				// by eight or more the bytes move first
+				if (count >= 8)
+				{
+					consider(best, [&]() -> std::optional<Sequence> {
+						Sequence out;
+						if (!takeRegister(Register::HL, unitsOf(lhs))) return std::nullopt;
+						moveWord(out, Register::HL, lhs);
+						if (left)
+						{
+							out.emit("ld", Register::H, Register::L);
+							out.emit("ld", Register::L, Immediate{ 0 });
+						}
+						else if (!isSigned)
+						{
+							out.emit("ld", Register::L, Register::H);
+							out.emit("ld", Register::H, Immediate{ 0 });
+						}
+						else
+						{
+							if (!takeRegister(Register::A)) return std::nullopt;
+							out.emit("ld", Register::L, Register::H);
+							out.emit("ld", Register::A, Register::H);
+							out.emit("rla");
+							out.emit("sbc", Register::A, Register::A);
+							out.emit("ld", Register::H, Register::A);
+						}
+						for (int i = 8; i < count; ++i) shiftHL(out);
+						if (!moveWord(out, result, Register::HL)) return std::nullopt;
+						return out;
+					});
+				}
+			}
+			std::optional<int> knownCount = constant ? std::optional(std::min(constant->value, 16)) : std::nullopt;
+			Place times = knownCount ? Place(Immediate{ knownCount.value() }) : rhs;
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				auto count = splittable(out, times);
+				if (!count || !takeRegister(Register::HL, unitsOf(lhs)) || !takeRegister(Register::B, unitsOf(lhs) | unitsOf(*count)) ||
+					!parallelMove(out, { { Register::HL, lhs }, { Register::B, byteOf(*count, 0) } })) return std::nullopt;
+				countedLoop(out, shiftHL, knownCount);
+				if (!moveWord(out, result, Register::HL)) return std::nullopt;
+				return out;
+			});
+			return best;
+		}
+
+		// runs the body B times, zero times when B is 0, a count not known here is priced as one pass
+		template<typename Body>
+		void countedLoop(Sequence& out, Body body, std::optional<int> knownCount)
+		{
+			Sequence loop;
+			body(loop);
+			int size = static_cast<int>(costOf(loop.code).bytes);
+			out.emit("inc", Register::B);
+			out.emit("jr", Immediate{ size });
+			out.append(loop);
+			out.emit("djnz", Immediate{ (-(size + 2)) & 0xFF });
+			if (knownCount.value_or(0) > 1) {
+				out.repeated.tStates += (knownCount.value() - 1) * (loop.cost().tStates + costOf(out.code.back()).tStates);
+			}
+		}
+
+		// the helpers take the left operand in A or HL and the right one in L or DE, returning in A or HL
+		std::optional<Sequence> lowerHelperCall(IL::Binary const& expr, Place const& result)
+		{
+			Place lhs = placeOf(expr.lhs), rhs = placeOf(expr.rhs);
+			bool word = !isByte(expr.dest.type);
+			Register accumulator = accumulatorFor(expr.dest.type), argument = word ? Register::DE : Register::L;
+			std::optional<Sequence> best;
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				RegisterUnits operands = unitsOf(lhs) | unitsOf(rhs);
+				if (!takeRegister(Register::A, operands) || !takeRegister(Register::HL, operands) ||
+					(word && !takeRegister(Register::DE, operands)) ||
+					!parallelMove(out, { { accumulator, lhs }, { argument, rhs } })) return std::nullopt;
+				out.emitReferencing(SymbolTarget{ helperName(expr.operation, expr.dest.type) }, "call", Asm::Number(0));
+				if (!move(out, accumulator, Place(accumulator)) || !(word ? moveWord(out, result, accumulator) : moveByte(out, result, accumulator))) return std::nullopt;
+				return out;
+			});
+			return best;
+		}
+
+		// sets the flags for lhs compared to rhs, returning the flag that holds when the comparison does
+		std::optional<std::string_view> compare(Sequence& out, Token::Type operation, Place lhs, Place rhs, IL::Type type)
+		{
+			// > and <= are < and >= with the operands swapped
+			if (operation == Token::Type::GREATER || operation == Token::Type::LESS_EQUAL)
+			{
+				std::swap(lhs, rhs);
+				operation = operation == Token::Type::GREATER ? Token::Type::LESS : Token::Type::GREATER_EQUAL;
+			}
+			bool ordered = operation == Token::Type::LESS || operation == Token::Type::GREATER_EQUAL;
+			// flipping the sign bits orders signed values like unsigned ones
+			bool biased = ordered && !IL::isIlTypeUnsigned(type) && type != IL::Type::i1;
+
+			if (isByte(type))
+			{
+				if (!isRegister(lhs, Register::A) && !evacuate(out, rhs, Register::A)) return std::nullopt;
+				if (biased)
+				{
+					if (auto constant = std::get_if<Immediate>(&rhs)) rhs = Immediate{ (constant->value ^ 0x80) & 0xFF };
+					else
+					{
+						if (!evacuate(out, lhs, Register::A)) return std::nullopt;
+						auto temp = takeScratch(RegisterClass::BYTE, unit::A);
+						if (!temp || !takeRegister(Register::A)) return std::nullopt;
+						moveByte(out, Register::A, rhs);
+						out.emit("xor", Immediate{ 0x80 });
+						out.emit("ld", *temp, Register::A);
+						rhs = *temp;
+					}
+				}
+				auto operand = arithmeticOperand(out, rhs);
+				if (!operand || !takeRegister(Register::A, unitsOf(lhs))) return std::nullopt;
+				moveByte(out, Register::A, lhs);
+				if (biased) out.emit("xor", Immediate{ 0x80 });
+				if (!ordered && isImmediate(*operand, 0)) out.emit("or", Register::A);
+				else out.emit("cp", *operand);
+			}
+			else
+			{
+				if (!samePlace(lhs, rhs) && !evacuate(out, rhs, Register::HL)) return std::nullopt;
+				if (!isPair(rhs) || biased)
+				{
+					auto temp = takePair(z80::unitsOf(Register::HL));
+					if (!temp || !moveWord(out, *temp, rhs)) return std::nullopt;
+					rhs = *temp;
+				}
+				if (!takeRegister(Register::HL, unitsOf(lhs))) return std::nullopt;
+				moveWord(out, Register::HL, lhs);
+				if (biased)
+				{
+					if (!takeRegister(Register::A)) return std::nullopt;
+					for (Register high : { Register::H, highByte(std::get<Register>(rhs)) })
+					{
+						out.emit("ld", Register::A, high);
+						out.emit("xor", Immediate{ 0x80 });
+						out.emit("ld", high, Register::A);
+					}
+				}
+				out.emit("or", Register::A);
+				out.emit("sbc", Register::HL, rhs);
+			}
+			switch (operation)
+			{
+			case Token::Type::EQUAL_EQUAL: return "z";
+			case Token::Type::NOT_EQUAL: return "nz";
+			case Token::Type::LESS: return "c";
+			default: return "nc";
+			}
+		}
+
+		IL::Type operandType(IL::Value const& lhs, IL::Value const& rhs) const
+		{
+			for (auto value : { &lhs, &rhs })
+			{
+				auto var = std::get_if<IL::Variable>(value);
+				if (var && !var->is_global) return typeOf(*var);
+			}
+			for (auto value : { &lhs, &rhs })
+			{
+				auto constant = std::get_if<int>(value);
+				if (constant && (*constant > 0xFF || *constant < -0x80)) return IL::Type::u16;
+			}
+			return IL::Type::u8;
+		}
+
+		std::optional<Sequence> lowerComparison(IL::Binary const& expr, Goal goal, std::optional<Place> const& result)
+		{
+			if (goal != Goal::FLAGS && !result.has_value()) return Sequence{};
+			Place lhs = placeOf(expr.lhs), rhs = placeOf(expr.rhs);
+			IL::Type type = operandType(expr.lhs, expr.rhs);
+			std::optional<Sequence> best;
+			auto both = [&](Sequence& out) { return compare(out, expr.operation, lhs, rhs, type); };
+			if (auto candidate = condition(goal, result, both)) best = std::move(candidate);
+
+			// INC and DEC set Z without A, for a register compared to zero
+			bool equality = expr.operation == Token::Type::EQUAL_EQUAL || expr.operation == Token::Type::NOT_EQUAL;
+			if (equality && isByte(type) && isImmediate(rhs, 0) && isByteRegister(lhs))
+			{
+				auto candidate = condition(goal, result, [&](Sequence& out) -> std::optional<std::string_view> {
+					out.emit("inc", lhs);
+					out.emit("dec", lhs);
+					return expr.operation == Token::Type::EQUAL_EQUAL ? "z" : "nz";
+				});
+				if (candidate && (!best || cheaper(candidate->cost(), best->cost(), model))) best = std::move(candidate);
+			}
+			return best;
+		}
+
+		std::optional<Sequence> lowerUnary(IL::Unary const& expr, std::optional<Place> const& result)
+		{
+			if (!result.has_value()) return Sequence{};
+			Place src = placeOf(expr.src);
+			std::optional<Sequence> best;
+			if (isByte(expr.dest.type))
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!takeRegister(Register::A, unitsOf(src))) return std::nullopt;
+					moveByte(out, Register::A, src);
+					switch (expr.operation)
+					{
+					case Token::Type::MINUS: out.emit("neg"); break;
+					case Token::Type::BIT_NOT: out.emit("cpl"); break;
+					default: out.emit("xor", Immediate{ 1 });
+					}
+					if (!moveByte(out, result.value(), Register::A)) return std::nullopt;
+					return out;
+				});
+				return best;
+			}
+
+			// into the result when it is a pair, else into a scratch pair
+			auto target = [&]() -> std::optional<Register> {
+				if (isPair(result.value())) return std::get<Register>(result.value());
+				return takePair();
+			};
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				auto value = splittable(out, src);
+				auto into = target();
+				if (!value || !into || !takeRegister(Register::A)) return std::nullopt;
+				for (int byte = 0; byte < 2; ++byte)
+				{
+					if (expr.operation == Token::Type::MINUS)
+					{
+						// 0 - value, the borrow of the low byte goes into the high one
+						if (byte == 0) out.emit("xor", Register::A);
+						else out.emit("sbc", Register::A, Register::A);
+						auto operand = arithmeticOperand(out, byteOf(*value, byte));
+						if (!operand) return std::nullopt;
+						out.emit("sub", *operand);
+					}
+					else
+					{
+						moveByte(out, Register::A, byteOf(*value, byte));
+						out.emit("cpl");
+					}
+					moveByte(out, byteOf(Place(*into), byte), Register::A);
+				}
+				if (!moveWord(out, result.value(), *into)) return std::nullopt;
+				return out;
+			});
+			if (expr.operation == Token::Type::MINUS && isPair(src) && !isRegister(src, Register::HL))
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!takeRegister(Register::HL)) return std::nullopt;
+					out.emit("ld", Register::HL, Immediate{ 0 });
+					out.emit("or", Register::A);
+					out.emit("sbc", Register::HL, src);
+					if (!moveWord(out, result.value(), Register::HL)) return std::nullopt;
+					return out;
+				});
+			}
+			return best;
+		}
+
+		std::optional<Sequence> lowerCast(IL::Cast const& cast, Goal goal, std::optional<Place> const& result)
+		{
+			if (goal != Goal::FLAGS && !result.has_value()) return Sequence{};
+			Place src = placeOf(cast.src);
+			IL::Type from = typeOf(cast.src), to = cast.cast;
+			std::optional<Sequence> best;
+
+			if (to == IL::Type::i1 && from != IL::Type::i1)
+			{
+				// != 0
+				return condition(goal, result, [&](Sequence& out) -> std::optional<std::string_view> {
+					if (isByte(from))
+					{
+						if (!takeRegister(Register::A, unitsOf(src))) return std::nullopt;
+						moveByte(out, Register::A, src);
+						out.emit("or", Register::A);
+						return "nz";
+					}
+					auto value = splittable(out, src);
+					if (!value || !takeRegister(Register::A, unitsOf(*value))) return std::nullopt;
+					auto high = arithmeticOperand(out, byteOf(*value, 1));
+					if (!high) return std::nullopt;
+					moveByte(out, Register::A, byteOf(*value, 0));
+					out.emit("or", *high);
+					return "nz";
+				});
+			}
+
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				if (isByte(to))
+				{
+					if (isByte(from)) return moveByte(out, result.value(), src) ? std::optional(out) : std::nullopt;
+					auto value = splittable(out, src);
+					if (!value || !moveByte(out, result.value(), byteOf(*value, 0))) return std::nullopt;
+					return out;
+				}
+				if (!isByte(from)) return moveWord(out, result.value(), src) ? std::optional(out) : std::nullopt;
+
+				Place into = result.value();
+				if (!isPair(into) && !std::holds_alternative<StackSlot>(into))
+				{
+					auto temp = takePair();
+					if (!temp) return std::nullopt;
+					into = *temp;
+				}
+				if (IL::isIlTypeUnsigned(from) || from == IL::Type::i1)
+				{
+					// the low byte first, the source may be the high one
+					if (!moveByte(out, byteOf(into, 0), src)) return std::nullopt;
+					out.emit("ld", byteOf(into, 1), Immediate{ 0 });
+				}
+				else
+				{
+					// the sign bit through the carry, SBC A,A spreads it over the high byte
+					if (!takeRegister(Register::A, unitsOf(src))) return std::nullopt;
+					moveByte(out, Register::A, src);
+					moveByte(out, byteOf(into, 0), Register::A);
+					out.emit("rla");
+					out.emit("sbc", Register::A, Register::A);
+					moveByte(out, byteOf(into, 1), Register::A);
+				}
+				if (!moveWord(out, result.value(), into)) return std::nullopt;
+				return out;
+			});
+			return best;
+		}
+
+		std::optional<Sequence> lowerTestBit(IL::TestBit const& test, Goal goal, std::optional<Place> const& result)
+		{
+			if (goal != Goal::FLAGS && !result.has_value()) return Sequence{};
+			Place src = placeOf(test.src);
+			bool word = !isByte(typeOf(test.src)) && !std::holds_alternative<Indirect>(src);
+			int bit = static_cast<int>(test.bit % 8);
+			auto byteToTest = [&](Sequence& out) -> std::optional<Place> {
+				if (!word) return src;
+				auto value = splittable(out, src);
+				if (!value) return std::nullopt;
+				return byteOf(*value, test.bit >= 8 ? 1 : 0);
+			};
+
+			// BIT n,r leaves Z clear when the bit is set
+			auto best = condition(goal, result, [&](Sequence& out) -> std::optional<std::string_view> {
+				auto tested = byteToTest(out);
+				if (!tested) return std::nullopt;
+				auto operand = arithmeticOperand(out, *tested);
+				if (!operand || std::holds_alternative<Immediate>(*operand)) return std::nullopt;
+				out.emit("bit", Immediate{ bit }, *operand);
+				return "nz";
+			});
+			if (goal == Goal::FLAGS) return best;
+
+			// rotating the bit down to bit 0 and masking it
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				auto tested = byteToTest(out);
+				if (!tested || !takeRegister(Register::A, unitsOf(*tested))) return std::nullopt;
+				moveByte(out, Register::A, *tested);
+				for (int i = 0; i < (bit <= 4 ? bit : 8 - bit); ++i) out.emit(bit <= 4 ? "rrca" : "rlca");
+				out.emit("and", Immediate{ 1 });
+				if (!moveByte(out, result.value(), Register::A)) return std::nullopt;
+				return out;
+			});
+			return best;
+		}
+
+		std::optional<Sequence> lowerDeref(IL::Deref const& deref, std::optional<Place> const& result)
+		{
+			if (!result.has_value()) return Sequence{};
+			Place ptr = placeOf(deref.ptr);
+			std::optional<Sequence> best;
+			// a pointer register the load can go through
+			auto pointer = [&](Sequence& out, bool viaA) -> std::optional<Register> {
+				if (isRegister(ptr, Register::HL) || isRegister(ptr, Register::IY)) return std::get<Register>(ptr);
+				if (viaA && (isRegister(ptr, Register::BC) || isRegister(ptr, Register::DE))) return std::get<Register>(ptr);
+				if (!takeRegister(Register::HL, unitsOf(ptr))) return std::nullopt;
+				if (!moveWord(out, Register::HL, ptr)) return std::nullopt;
+				return Register::HL;
+			};
+
+			if (isByte(deref.dest.type))
+			{
+				for (bool viaA : { false, true })
+				{
+					consider(best, [&]() -> std::optional<Sequence> {
+						Sequence out;
+						auto reg = pointer(out, viaA);
+						if (!reg) return std::nullopt;
+						if (canLoad(Register::A, Indirect{ *reg }) && !canLoad(Register::B, Indirect{ *reg }) && !isRegister(result.value(), Register::A))
+						{
+							if (!takeRegister(Register::A)) return std::nullopt;
+							out.emit("ld", Register::A, Indirect{ *reg });
+							if (!moveByte(out, result.value(), Register::A)) return std::nullopt;
+							return out;
+						}
+						if (!moveByte(out, result.value(), Indirect{ *reg })) return std::nullopt;
+						return out;
+					});
+				}
+				return best;
+			}
+
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				auto reg = pointer(out, false);
+				if (!reg) return std::nullopt;
+				if (*reg == Register::IY)
+				{
+					Place into = result.value();
+					if (!isPair(into))
+					{
+						auto temp = takePair();
+						if (!temp) return std::nullopt;
+						into = *temp;
+					}
+					out.emit("ld", byteOf(into, 0), Asm::Dereference(Asm::OffsetRegister("iy", 0)));
+					out.emit("ld", byteOf(into, 1), Asm::Dereference(Asm::OffsetRegister("iy", 1)));
+					return moveWord(out, result.value(), into) ? std::optional(out) : std::nullopt;
+				}
+				// HL steps over the word, and steps back when it lives on
+				bool restore = (liveAcross & z80::unitsOf(Register::HL)) && !(scratchUnits & z80::unitsOf(Register::HL));
+				if (isPair(result.value()) && !isRegister(result.value(), Register::HL))
+				{
+					out.emit("ld", byteOf(result.value(), 0), Indirect{ Register::HL });
+					out.emit("inc", Register::HL);
+					out.emit("ld", byteOf(result.value(), 1), Indirect{ Register::HL });
+					if (restore) out.emit("dec", Register::HL);
+					return out;
+				}
+				auto low = takeScratch(RegisterClass::BYTE, z80::unitsOf(Register::HL));
+				if (!low || (restore && !isRegister(result.value(), Register::HL))) return std::nullopt;
+				out.emit("ld", *low, Indirect{ Register::HL });
+				out.emit("inc", Register::HL);
+				out.emit("ld", Register::H, Indirect{ Register::HL });
+				out.emit("ld", Register::L, *low);
+				return moveWord(out, result.value(), Register::HL) ? std::optional(out) : std::nullopt;
+			});
+			return best;
+		}
+
+		std::optional<Sequence> lowerStore(IL::Store const& store)
+		{
+			Place ptr = placeOf(store.ptr), src = placeOf(store.src.variable);
+			bool word = !isByte(store.src.type);
+			std::optional<Sequence> best;
+			for (bool viaA : { false, true })
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					Register reg = Register::HL;
+					if (isRegister(ptr, Register::HL) || isRegister(ptr, Register::IY) ||
+						(viaA && !word && (isRegister(ptr, Register::BC) || isRegister(ptr, Register::DE))))
+					{
+						reg = std::get<Register>(ptr);
+					}
+					else
+					{
+						// the value must not be in HL when the pointer goes there
+						if (!evacuate(out, src, Register::HL) || !takeRegister(Register::HL, unitsOf(ptr)) || !moveWord(out, Register::HL, ptr)) return std::nullopt;
+					}
+					bool restore = reg == Register::HL && (liveAcross & z80::unitsOf(Register::HL)) && !(scratchUnits & z80::unitsOf(Register::HL));
+					if (!word)
+					{
+						if (!canStore(Indirect{ reg }, Register::B) && !isRegister(src, Register::A))
+						{
+							if (!takeRegister(Register::A, unitsOf(src))) return std::nullopt;
+							moveByte(out, Register::A, src);
+							src = Register::A;
+						}
+						return moveByte(out, Indirect{ reg }, src) ? std::optional(out) : std::nullopt;
+					}
+					auto value = splittable(out, src);
+					if (!value) return std::nullopt;
+					if (reg == Register::IY)
+					{
+						for (int byte = 0; byte < 2; ++byte)
+						{
+							auto operand = byteOf(*value, byte);
+							if (!isByteRegister(operand) && !std::holds_alternative<Immediate>(operand)) return std::nullopt;
+							out.emit("ld", Asm::Dereference(Asm::OffsetRegister("iy", static_cast<uint16_t>(byte))), operand);
+						}
+						return out;
+					}
+					// a value in HL would change under INC HL
+					if (unitsOf(*value) & z80::unitsOf(Register::HL)) return std::nullopt;
+					for (int byte = 0; byte < 2; ++byte)
+					{
+						if (byte == 1) out.emit("inc", Register::HL);
+						if (!moveByte(out, Indirect{ Register::HL }, byteOf(*value, byte))) return std::nullopt;
+					}
+					if (restore) out.emit("dec", Register::HL);
+					return out;
+				});
+			}
+			return best;
+		}
+
+		std::optional<Sequence> lowerReturn(IL::Return const& ret)
+		{
+			if (!ret.value.has_value() || returnType == IL::Type::void_) return Sequence{};
+			Place value = placeOf(ret.value.value());
+			Register accumulator = accumulatorFor(returnType);
+			resultUnits = z80::unitsOf(accumulator);
+			std::optional<Sequence> best;
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				if (!move(out, accumulator, value)) return std::nullopt;
+				return out;
+			});
+			return best;
+		}
+
+		// one argument comes in A or HL, more are pushed, the last one on top.
+		// A call through a pointer calls __call_iy with the pointer in IY, which jumps to it
+		std::optional<Sequence> lowerCall(IL::FunctionCall const& call, std::optional<Place> const& result)
+		{
+			auto pointer = std::get_if<IL::Variable>(&call.function);
+			std::optional<Place> target = pointer ? std::optional(placeOf(*pointer)) : std::nullopt;
+			std::optional<Sequence> best;
+			// the pointer is loaded before or after the arguments, whichever leaves it intact
+			for (bool pointerFirst : { false, true })
+			{
+				if (pointerFirst && (!pointer || call.args.size() < 2)) break;
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!takeRegister(Register::A, operandUnits) || !takeRegister(Register::HL, operandUnits)) return std::nullopt;
+					if (pointer && !takeRegister(Register::IY, operandUnits)) return std::nullopt;
+					if (call.args.size() == 1)
+					{
+						Place arg = placeOf(call.args.front());
+						auto var = std::get_if<IL::Variable>(&call.args.front());
+						Register into = var ? accumulatorFor(typeOf(*var)) : (std::get<int>(call.args.front()) > 0xFF ? Register::HL : Register::A);
+						if (pointer ? !parallelMove(out, { { into, arg }, { Register::IY, target.value() } }) : !move(out, into, arg)) return std::nullopt;
+					}
+					else
+					{
+						if (pointerFirst && !moveWord(out, Register::IY, target.value())) return std::nullopt;
+						bool usedHL = false;
+						for (auto& value : call.args)
+						{
+							Place arg = placeOf(value);
+							auto var = std::get_if<IL::Variable>(&value);
+							if (pointerFirst && (unitsOf(arg) & z80::unitsOf(Register::IY)) && !samePlace(arg, target.value())) return std::nullopt;
+							if (isPair(arg) || isRegister(arg, Register::IY)) out.emit("push", arg);
+							else
+							{
+								if (unitsOf(arg) & z80::unitsOf(Register::HL)) return std::nullopt;
+								if (var && isByte(typeOf(*var))) moveByte(out, Register::L, arg);
+								else if (!moveWord(out, Register::HL, arg)) return std::nullopt;
+								out.emit("push", Register::HL);
+								usedHL = true;
+							}
+						}
+						if (pointer && !pointerFirst)
+						{
+							if (usedHL && (unitsOf(target.value()) & z80::unitsOf(Register::HL))) return std::nullopt;
+							if (!moveWord(out, Register::IY, target.value())) return std::nullopt;
+						}
+					}
+					out.emitReferencing(SymbolTarget{ pointer ? std::string_view("__call_iy") : std::get<std::string_view>(call.function) },
+						"call", Asm::Number(0));
+					for (size_t arg = 1; call.args.size() > 1 && arg <= call.args.size(); ++arg)
+					{
+						out.emit("inc", Asm::Register("sp"));
+						out.emit("inc", Asm::Register("sp"));
+					}
+					if (result.has_value() && call.dest.type != IL::Type::void_) {
+						if (!move(out, accumulatorFor(call.dest.type), Place(accumulatorFor(call.dest.type)))) return std::nullopt;
+						bool moved = isByte(call.dest.type) ? moveByte(out, result.value(), Register::A) : moveWord(out, result.value(), Register::HL);
+						if (!moved) return std::nullopt;
+					}
+					return out;
+				});
+			}
+			return best;
+		}
+
+		std::optional<Sequence> lowerMemCopy(IL::MemCopy const& copy)
+		{
+			std::optional<Sequence> best;
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				Place dest = placeOf(copy.dest), src = placeOf(copy.src);
+				if (!takeRegister(Register::DE, operandUnits) || !takeRegister(Register::HL, operandUnits) ||
+					!takeRegister(Register::BC, operandUnits) ||
+					!parallelMove(out, { { Register::DE, dest }, { Register::HL, src }, { Register::BC, Immediate{ static_cast<int>(copy.length) } } })) return std::nullopt;
+				out.emit("ldir");
+				return out;
+			});
+			return best;
+		}
+
+		std::optional<Sequence> lowerAddressOf(IL::AddressOf const& addressOf, std::optional<Place> const& result)
+		{
+			if (!result.has_value()) return Sequence{};
+			std::optional<Sequence> best;
+			if (auto function = std::get_if<IL::AddressOf::Function>(&addressOf.target))
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					Place into = isRegister(result.value(), Register::IY) || isPair(result.value()) ? result.value() : Place(Register::HL);
+					if (!isRegister(into, Register::HL) || takeRegister(Register::HL)) {
+						out.emitReferencing(SymbolTarget{ function->name }, "ld", into, Asm::Number(0));
+						return moveWord(out, result.value(), into) ? std::optional(out) : std::nullopt;
+					}
+					return std::nullopt;
+				});
+				return best;
+			}
+			auto var = std::get<IL::Variable>(addressOf.target);
+			auto location = locationOf(var);
+			if (var.is_global)
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!takeRegister(Register::HL)) return std::nullopt;
+					out.emitReferencing(var, "ld", Register::HL, Asm::Number(0));
+					return moveWord(out, result.value(), Register::HL) ? std::optional(out) : std::nullopt;
+				});
+				return best;
+			}
+			auto slot = location.has_value() ? std::get_if<StackSlot>(&location.value()) : nullptr;
+			COMPILER_ASSERT("variables whose address is taken live in the frame", slot != nullptr);
+			int offset = slot->offset;
+			// IX plus the offset, counted down for small ones
+			for (bool add : { false, true })
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					if (!add && std::abs(offset) > 4) return std::nullopt;
+					if (!takeRegister(Register::HL)) return std::nullopt;
+					out.emit("push", Asm::Register("ix"));
+					out.emit("pop", Register::HL);
+					if (add)
+					{
+						auto temp = takePair(z80::unitsOf(Register::HL));
+						if (!temp) return std::nullopt;
+						out.emit("ld", *temp, Immediate{ offset & 0xFFFF });
+						out.emit("add", Register::HL, *temp);
+					}
+					else repeat(out, std::abs(offset), offset < 0 ? "dec" : "inc", Register::HL);
+					return moveWord(out, result.value(), Register::HL) ? std::optional(out) : std::nullopt;
+				});
+			}
+			return best;
+		}
+
+		// the stack grows down by the size, its new top is the memory
+		std::optional<Sequence> lowerAllocate(IL::Allocate const& allocate, std::optional<Place> const& result)
+		{
+			std::optional<Sequence> best;
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				if (!takeRegister(Register::HL)) return std::nullopt;
+				out.emit("ld", Register::HL, Immediate{ -static_cast<int>(allocate.size) & 0xFFFF });
+				out.emit("add", Register::HL, Asm::Register("sp"));
+				out.emit("ld", Asm::Register("sp"), Register::HL);
+				if (result.has_value() && !moveWord(out, result.value(), Register::HL)) return std::nullopt;
+				return out;
+			});
+			return best;
+		}
+
+		//Trees
+
+		std::optional<IL::Variable> singleDef(IL::UniquePtr const& instr) const
+		{
+			std::optional<IL::Variable> def;
+			size_t defs = 0;
+			IL::forEachDef(instr, [&](IL::Variable& var, IL::Type) { def = var; defs++; });
+			if (defs != 1) return std::nullopt;
+			return def;
+		}
+
+		static bool canBeChild(IL::UniquePtr const& instr)
+		{
+			if (auto expr = IL::getIf<IL::Binary>(instr)) return !IL::isHelperCall(expr->operation);
+			return IL::getIf<IL::Unary>(instr) || IL::getIf<IL::Cast>(instr) || IL::getIf<IL::Deref>(instr) || IL::getIf<IL::TestBit>(instr);
+		}
+
+		static bool canBeParent(IL::UniquePtr const& instr)
+		{
+			return IL::getIf<IL::Binary>(instr) || IL::getIf<IL::Unary>(instr) || IL::getIf<IL::Cast>(instr) ||
+				IL::getIf<IL::TestBit>(instr) || IL::getIf<IL::Store>(instr) || IL::getIf<IL::Assignment>(instr) || IL::getIf<IL::Return>(instr);
+		}
+
+		// the value the child defines is used once, by the parent right after it
+		std::optional<IL::Variable> foldedValue(ILBlock const& data, size_t child) const
+		{
+			if (child + 1 >= data.body.size() || !canBeChild(data.body[child]) || !canBeParent(data.body[child + 1])) return std::nullopt;
+			auto def = singleDef(data.body[child]);
+			if (!def || def->is_global || def->id >= useCounts.size() || useCounts[def->id] != 1) return std::nullopt;
+			bool used = false;
+			IL::forEachUse(data.body[child + 1], [&](IL::Variable& var) { used |= var == *def; });
+			return used ? def : std::nullopt;
+		}
+
+		// whether the accumulator can carry the child's value to the parent
+		bool accumulatorSurvives(size_t block, size_t child, Register accumulator) const
+		{
+			auto& data = graph.nodeData(block);
+			auto value = foldedValue(data, child);
+			RegisterUnits units = z80::unitsOf(accumulator);
+			if (units & liveAcrossAt(allocation.intervals().instructionPosition(block, child))) return false;
+			bool clash = false;
+			IL::forEachUse(data.body[child + 1], [&](IL::Variable& var) {
+				if (var == *value) return;
+				auto location = allocation.locationOf(var);
+				if (location.has_value()) {
+					if (auto reg = std::get_if<Register>(&location.value())) clash |= (z80::unitsOf(*reg) & units) != 0;
+				}
+			});
+			return !clash;
+		}
+
+		std::optional<Register> accumulatorOf(IL::UniquePtr const& instr) const
+		{
+			auto def = singleDef(instr);
+			if (!def) return std::nullopt;
+			return accumulatorFor(typeOf(*def));
+		}
+
+		// labels a tree, deepest node first, with the cheapest code for every goal of every node
+		Sequence selectTree(size_t block, std::span<const size_t> chain, bool feedsSplit)
+		{
+			auto& data = graph.nodeData(block);
+			std::vector<std::pair<Goal, Sequence>> below = { { Goal::LOCATION, Sequence{} } };
+			for (size_t depth = 0; depth < chain.size(); ++depth)
+			{
+				size_t index = chain[depth];
+				auto& instr = data.body[index];
+				bool isRoot = depth + 1 == chain.size();
+				auto def = singleDef(instr);
+
+				std::vector<std::pair<Goal, std::optional<Place>>> goals;
+				goals.emplace_back(Goal::LOCATION, def ? locationOf(*def) : std::nullopt);
+				if (!isRoot)
+				{
+					auto accumulator = accumulatorOf(instr);
+					if (accumulator && accumulatorSurvives(block, index, *accumulator)) goals.emplace_back(Goal::ACCUMULATOR, *accumulator);
+					auto deref = IL::getIf<IL::Deref>(instr);
+					if (deref && isByte(deref->dest.type)) goals.emplace_back(Goal::MEMORY, std::nullopt);
+				}
+				else if (feedsSplit) goals.emplace_back(Goal::FLAGS, std::nullopt);
+
+				std::vector<std::pair<Goal, Sequence>> labels;
+				for (auto& [goal, place] : goals)
+				{
+					std::optional<Sequence> best;
+					for (auto& [childGoal, childCode] : below)
+					{
+						folded.clear();
+						if (depth > 0 && childGoal != Goal::LOCATION) folded.emplace(foldedValue(data, chain[depth - 1])->id, childCode.place.value());
+						enter(allocation.intervals().instructionPosition(block, index), &instr);
+
+						std::optional<Sequence> code;
+						if (goal == Goal::MEMORY)
+						{
+							Place ptr = placeOf(IL::getIf<IL::Deref>(instr)->ptr);
+							if (isByteRegister(ptr) || !std::holds_alternative<Register>(ptr)) continue;
+							code = Sequence{};
+							code->place = Indirect{ std::get<Register>(ptr) };
+						}
+						else
+						{
+							code = lower(instr, goal, place);
+							if (!code) continue;
+							code->place = place;
+						}
+						Sequence total = childCode;
+						total.append(code.value());
+						total.place = code->place;
+						total.condition = code->condition;
+						if (goal == Goal::FLAGS && !total.condition) continue;
+						if (!best || cheaper(total.cost(), best->cost(), model)) best = std::move(total);
+					}
+					if (best) labels.emplace_back(goal, std::move(best.value()));
+				}
+				COMPILER_ASSERT("every instruction can be selected into its location", !labels.empty());
+				below = std::move(labels);
+			}
+			folded.clear();
+
+			// the flags are only kept when they beat storing the condition and testing it again
+			auto flags = std::find_if(below.begin(), below.end(), [](auto const& label) { return label.first == Goal::FLAGS; });
+			auto location = std::find_if(below.begin(), below.end(), [](auto const& label) { return label.first == Goal::LOCATION; });
+			if (flags != below.end() && (location == below.end() || !cheaper(location->second.cost(), flags->second.cost(), model))) {
+				return flags->second;
+			}
+			return location->second;
+		}
+
+		// sets the flags from the condition of the block in its location
+		Sequence testCondition(size_t block)
+		{
+			auto& data = graph.nodeData(block);
+			enter(allocation.intervals().conditionPosition(block), nullptr);
+			Place value = placeOf(data.splitsOn());
+			operandUnits = unitsOf(value);
+			resultUnits = 0;
+			std::optional<Sequence> best;
+			// conditions are 0 or 1, so bit 0 is the whole value
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				auto operand = arithmeticOperand(out, value);
+				if (!operand || std::holds_alternative<Immediate>(*operand)) return std::nullopt;
+				out.emit("bit", Immediate{ 0 }, *operand);
+				out.condition = "nz";
+				return out;
+			});
+			consider(best, [&]() -> std::optional<Sequence> {
+				Sequence out;
+				if (!takeRegister(Register::A, operandUnits)) return std::nullopt;
+				moveByte(out, Register::A, value);
+				out.emit("or", Register::A);
+				out.condition = "nz";
+				return out;
+			});
+			if (isByteRegister(value))
+			{
+				consider(best, [&]() -> std::optional<Sequence> {
+					Sequence out;
+					out.emit("inc", value);
+					out.emit("dec", value);
+					out.condition = "nz";
+					return out;
+				});
+			}
+			return best.value();
+		}
+
+		void jump(Sequence& out, std::optional<std::string_view> condition, size_t target)
+		{
+			if (condition) out.emitReferencing(BlockTarget{ target }, "jp", Asm::Flag(*condition), Asm::Number(0));
+			else out.emitReferencing(BlockTarget{ target }, "jp", Asm::Number(0));
+		}
+
+		Sequence selectBlock(size_t block, std::optional<size_t> next)
+		{
+			auto& data = graph.nodeData(block);
+			Sequence out;
+			std::optional<std::string_view> condition;
+			std::vector<size_t> chain;
+			for (size_t index = 0; index < data.body.size(); ++index)
+			{
+				chain.push_back(index);
+				if (foldedValue(data, index)) continue;
+
+				bool isLast = index + 1 == data.body.size();
+				auto def = singleDef(data.body[index]);
+				bool feedsSplit = isLast && data.splits() && def && *def == data.splitsOn() &&
+					!def->is_global && useCounts[def->id] == 1;
+				auto tree = selectTree(block, chain, feedsSplit);
+				out.append(tree);
+				if (feedsSplit) condition = tree.condition;
+				chain.clear();
+			}
+
+			if (data.splits())
+			{
+				if (!condition)
+				{
+					auto test = testCondition(block);
+					out.append(test);
+					condition = test.condition;
+				}
+				size_t onTrue = graph.getTrueSuccessor(block), onFalse = graph.getFalseSuccessor(block);
+				if (next == onFalse) jump(out, condition, onTrue);
+				else if (next == onTrue) jump(out, inverse(condition.value()), onFalse);
+				else
+				{
+					jump(out, condition, onTrue);
+					jump(out, std::nullopt, onFalse);
+				}
+			}
+			else if (graph.successorCount(block) == 1 && graph.out(block).front() != next) jump(out, std::nullopt, graph.out(block).front());
+			else if (graph.successorCount(block) == 0) out.emit("ret");
+			return out;
+		}
+	};
+
+	std::vector<MachineBlock> selectInstructions(ILCtrlFlowGraph const& graph, RegisterAllocation const& allocation,
+		IL::Type returnType, CostModel model)
+	{
+		return InstructionSelector(graph, allocation, returnType, model).run();
+	}
+
+	std::string toString(MachineInstruction const& instr)
+	{
+		auto operandString = [&](Asm::Operand const& operand) -> std::string {
+			auto address = [&](Asm::Number number) -> std::string {
+				return std::visit(util::OverloadVariant{
+					[&](std::monostate) { return std::to_string(number.val); },
+					[&](BlockTarget target) { return fmt::format(".B{}", target.block); },
+					[&](SymbolTarget target) { return std::string(target.name); },
+					[&](IL::Variable var) {
+						return number.val == 0 ? fmt::format("@{}", var.id) : fmt::format("@{}+{}", var.id, number.val);
+					}
+				}, instr.reference);
+			};
+			auto offsetRegister = [](Asm::OffsetRegister const& reg) {
+				int offset = static_cast<int8_t>(reg.offset);
+				return fmt::format("{}{}{}", reg.str, offset < 0 ? "-" : "+", std::abs(offset));
+			};
+			return std::visit(util::OverloadVariant{
+				[&](Asm::Register const& reg) { return std::string(reg.str); },
+				[&](Asm::OffsetRegister const& reg) { return offsetRegister(reg); },
+				[&](Asm::Flag const& flag) { return std::string(flag.str); },
+				[&](Asm::Number const& number) { return address(number); },
+				[&](Asm::Dereference const& deref) {
+					return "(" + std::visit(util::OverloadVariant{
+						[&](Asm::Register const& reg) { return std::string(reg.str); },
+						[&](Asm::OffsetRegister const& reg) { return offsetRegister(reg); },
+						[&](Asm::Number const& number) { return address(number); }
+					}, deref.address) + ")";
+				}
+			}, operand);
+		};
+
+		std::string text(instr.opcode);
+		for (size_t index = 0; index < instr.operands.size(); ++index) {
+			text += (index == 0 ? " " : ",") + operandString(instr.operands[index]);
+		}
+		return text;
+	}
+}
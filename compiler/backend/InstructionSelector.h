@@ -0,0 +1,99 @@
+#pragma once
+#include <span>
+#include <string>
+#include "Operand.h"
+#include "RegisterAllocator.h"
+#include "PassManager.h"
+#include "CompilerError.h"
+
+namespace z80
+{
+	// What the placeholder Number of a jump, call or absolute address stands for, until the code is laid out.
+	// For a global the Number holds the offset into it.
+	struct BlockTarget
+	{
+		size_t block;
+	};
+	struct SymbolTarget
+	{
+		std::string_view name;
+	};
+	using Reference = std::variant<std::monostate, BlockTarget, SymbolTarget, IL::Variable>;
+
+	struct MachineInstruction
+	{
+		std::string_view opcode;
+		std::vector<Asm::Operand> operands;
+		Reference reference;
+	};
+
+	struct MachineBlock
+	{
+		size_t block;
+		std::vector<MachineInstruction> code;
+	};
+
+	struct Cost
+	{
+		unsigned tStates = 0;
+		size_t bytes = 0;
+
+		Cost& operator+=(Cost const& other)
+		{
+			tStates += other.tStates;
+			bytes += other.bytes;
+			return *this;
+		}
+	};
+
+	enum class CostModel {
+		SPEED, SIZE
+	};
+	// SIZE for a pipeline that optimizes for size (-Os), SPEED for every other
+	CostModel costModelFor(opt::PassManager const& passes);
+
+	// code the selector cannot turn into machine instructions
+	class SelectionError : public CompilerError
+	{
+	public:
+		SelectionError(SourcePosition position, std::string msg)
+			: CompilerError(position), msg(std::move(msg)) {}
+
+		std::string msgToString() override { return msg; }
+	private:
+		std::string msg;
+	};
+
+	// from the format of the instruction in the assembler's table, a taken branch counts its longer time
+	Cost costOf(MachineInstruction const& instr);
+	Cost costOf(std::span<const MachineInstruction> code);
+	bool cheaper(Cost const& lhs, Cost const& rhs, CostModel model);
+
+	/* Instruction Selector:
+		Tree matching over the allocated, phi free graph. A value defined by the previous
+		instruction of its block and used once, by the current one, is not given its
+		location; its instruction becomes the child of the current one in a tree. Trees
+		are labelled bottom up with the cheapest code for every place a node can leave
+		its value (Fraser, Henry and Proebsting):
+		 - its allocated location,
+		 - the accumulator, A or HL, when nothing around needs it,
+		 - for an 8-bit Deref, the memory itself, read by the parent as (hl), (iy+0) and so on,
+		 - for the compare that ends a block, the flags its branch tests.
+		Every node tries all its rules (ADD HL,rr, INC and DEC for small constants,
+		BIT n,r, (IX+d) operands for spilled values, ...) and keeps the cheapest. Code that
+		needs a register nothing frees pushes and pops it around itself.
+
+		Inline assembly is copied as written. Its operands may be registers, flags, numbers
+		and dereferences of a register, a number or (ix+d); anything else, labels included,
+		is a SelectionError at the instruction.
+
+		Blocks are laid out in the allocation's order, falling through where they can,
+		and IX is expected to point at the frame already. A frame of more than 128 bytes
+		is out of reach of (IX+d) and a SelectionError.
+	*/
+	std::vector<MachineBlock> selectInstructions(ILCtrlFlowGraph const& graph, RegisterAllocation const& allocation,
+		IL::Type returnType, CostModel model = CostModel::SPEED);
+
+	// assembler syntax, with references written as labels
+	std::string toString(MachineInstruction const& instr);
+}
@@ -0,0 +1,153 @@
+#include "LiveIntervals.h"
+#include "Constraints.h"
+#include "ILOperands.h"
+#include <bit>
+#include <cmath>
+
+namespace z80
+{
+	bool LiveInterval::covers(size_t position) const
+	{
+		auto range = std::upper_bound(ranges.begin(), ranges.end(), position,
+			[](size_t position, LiveRange const& range) { return position < range.to; });
+		return range != ranges.end() && range->from <= position;
+	}
+
+	bool LiveInterval::intersects(LiveInterval const& other) const
+	{
+		auto lhs = ranges.begin(), rhs = other.ranges.begin();
+		while (lhs != ranges.end() && rhs != other.ranges.end())
+		{
+			if (lhs->from < rhs->to && rhs->from < lhs->to) return true;
+			if (lhs->to <= rhs->to) ++lhs;
+			else ++rhs;
+		}
+		return false;
+	}
+
+	bool LiveInterval::coversAny(std::span<const size_t> positions) const
+	{
+		auto position = positions.begin();
+		for (auto& range : ranges)
+		{
+			position = std::lower_bound(position, positions.end(), range.from);
+			if (position == positions.end()) return false;
+			if (*position < range.to) return true;
+		}
+		return false;
+	}
+
+	void LiveInterval::addRange(size_t from, size_t to)
+	{
+		auto first = std::lower_bound(ranges.begin(), ranges.end(), from,
+			[](LiveRange const& range, size_t from) { return range.to < from; });
+		auto last = first;
+		for (; last != ranges.end() && last->from <= to; ++last)
+		{
+			from = std::min(from, last->from);
+			to = std::max(to, last->to);
+		}
+		first = ranges.erase(first, last);
+		ranges.insert(first, LiveRange{ from, to });
+	}
+
+	// only valid while building backwards, where the first range starts at the current block
+	void LiveInterval::setFrom(size_t from)
+	{
+		ranges.front().from = from;
+	}
+
+	LiveIntervals::LiveIntervals(ILCtrlFlowGraph const& graph, std::span<const size_t> order,
+		opt::AnalysisManager& analyses, std::span<const IL::Decl> params)
+		: blockOrder(order.begin(), order.end()), blockStart(graph.nodeCount()), blockEnd(graph.nodeCount()),
+		  clobberPositions(std::bit_width(unsigned(unit::ALL)))
+	{
+		size_t position = 0;
+		for (size_t block : blockOrder)
+		{
+			COMPILER_ASSERT("live intervals need a graph without phis", graph.nodeData(block).body.empty() ||
+				!IL::getIf<IL::Phi>(graph.nodeData(block).body.front()));
+			blockStart[block] = position;
+			position += (graph.nodeData(block).body.size() + 1) * POSITIONS_PER_INSTRUCTION;
+			blockEnd[block] = position;
+		}
+
+		auto& assignments = analyses.assignments();
+		auto& liveness = analyses.liveness();
+		auto& loops = analyses.loops();
+		for (size_t id = 0; id < assignments.variableCount(); ++id)
+		{
+			auto& interval = intervalFor(IL::Variable(id));
+			interval.type = assignments.typeOf(id).value_or(IL::Type::u16);
+			interval.needsMemory = assignments.addressTaken().contains(id);
+		}
+		for (auto& param : params)
+		{
+			auto& interval = intervalFor(param.variable);
+			interval.type = param.type;
+			if (params.size() == 1) interval.hints.push_back(accumulatorFor(param.type));
+		}
+
+		for (auto block = blockOrder.rbegin(); block != blockOrder.rend(); ++block)
+		{
+			size_t from = blockStart[*block], to = blockEnd[*block];
+			double weight = std::pow(10.0, double(std::min<size_t>(loops.depth(*block), 4)));
+			auto& data = graph.nodeData(*block);
+
+			liveness.liveOut(*block).forEach([&](size_t id) { intervalFor(IL::Variable(id)).addRange(from, to); });
+			if (data.splits())
+			{
+				auto& interval = intervalFor(data.splitsOn());
+				interval.addRange(from, conditionPosition(*block) + 1);
+				interval.spillWeight += weight;
+			}
+			for (size_t index = data.body.size(); index-- > 0;)
+			{
+				auto& instr = data.body[index];
+				size_t at = instructionPosition(*block, index);
+				IL::forEachDef(instr, [&](IL::Variable& var, IL::Type) {
+					if (var.is_global) return;
+					auto& interval = intervalFor(var);
+					if (interval.covers(at + 2)) interval.setFrom(at + 2);
+					else interval.addRange(at + 2, at + 3); // never read
+					interval.spillWeight += weight;
+				});
+				IL::forEachUse(instr, [&](IL::Variable& var) {
+					if (var.is_global) return;
+					auto& interval = intervalFor(var);
+					interval.addRange(from, at + 1);
+					interval.spillWeight += weight;
+				});
+
+				auto constraints = constraintsOf(instr);
+				for (size_t unitIndex = 0; unitIndex < clobberPositions.size(); ++unitIndex) {
+					if ((constraints.clobbers >> unitIndex) & 1) clobberPositions[unitIndex].push_back(at + 1);
+				}
+				for (auto& hint : constraints.hints) intervalFor(hint.variable).hints.push_back(hint.reg);
+				if (auto copy = IL::getIf<IL::Assignment>(instr))
+				{
+					auto src = std::get_if<IL::Variable>(&copy->src);
+					if (src && !src->is_global && !copy->dest.variable.is_global) intervalFor(copy->dest.variable).copyOf = *src;
+				}
+			}
+		}
+		for (auto& positions : clobberPositions) std::sort(positions.begin(), positions.end());
+	}
+
+	LiveInterval const* LiveIntervals::intervalOf(IL::Variable const& var) const
+	{
+		if (var.is_global || var.id >= byVariable.size() || byVariable[var.id].empty()) return nullptr;
+		return &byVariable[var.id];
+	}
+
+	LiveInterval& LiveIntervals::intervalFor(IL::Variable const& var)
+	{
+		if (var.id >= byVariable.size())
+		{
+			size_t first = byVariable.size();
+			byVariable.resize(var.id + 1);
+			for (size_t id = first; id < byVariable.size(); ++id) byVariable[id].variable = IL::Variable(id);
+		}
+		return byVariable[var.id];
+	}
+}
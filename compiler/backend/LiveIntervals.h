@@ -0,0 +1,73 @@
+#pragma once
+#include <optional>
+#include <span>
+#include <vector>
+#include "Registers.h"
+#include "AnalysisManager.h"
+
+namespace z80
+{
+	// Positions [from, to)
+	struct LiveRange
+	{
+		size_t from, to;
+	};
+
+	struct LiveInterval
+	{
+		IL::Variable variable{ 0 };
+		IL::Type type = IL::Type::u16;
+		std::vector<LiveRange> ranges; // sorted and disjoint
+		std::vector<Register> hints;   // fixed registers the lowering would like, in order
+		std::optional<IL::Variable> copyOf; // prefers the register of this variable
+		double spillWeight = 0;
+		bool needsMemory = false; // its address is taken
+
+		bool empty() const { return ranges.empty(); }
+		size_t start() const { return ranges.front().from; }
+		size_t end() const { return ranges.back().to; }
+		bool covers(size_t position) const;
+		bool intersects(LiveInterval const& other) const;
+		// whether one of the sorted positions lies inside the interval
+		bool coversAny(std::span<const size_t> positions) const;
+
+		void addRange(size_t from, size_t to);
+		void setFrom(size_t from);
+	};
+
+	/* Live Intervals:
+		Numbers the instructions of a phi free graph in the given block order and
+		builds the interval of every local variable from block liveness, so an
+		interval has holes where the variable is dead (Wimmer and Franz).
+
+		Every instruction takes POSITIONS_PER_INSTRUCTION positions: its operands are
+		read at the first, the registers it clobbers are destroyed at the second and
+		its result is written at the third. A result can therefore share a register
+		with an operand that dies in the instruction, and a clobber only hits values
+		that live across. The condition of a block is read one instruction after its body.
+	*/
+	class LiveIntervals
+	{
+	public:
+		static constexpr size_t POSITIONS_PER_INSTRUCTION = 4;
+
+		LiveIntervals(ILCtrlFlowGraph const& graph, std::span<const size_t> blockOrder,
+			opt::AnalysisManager& analyses, std::span<const IL::Decl> params = {});
+
+		std::span<const LiveInterval> intervals() const { return byVariable; }
+		LiveInterval const* intervalOf(IL::Variable const& var) const;
+		// the sorted positions where a register unit is clobbered
+		std::span<const size_t> clobbers(size_t unitIndex) const { return clobberPositions[unitIndex]; }
+
+		size_t instructionPosition(size_t block, size_t index) const { return blockStart[block] + index * POSITIONS_PER_INSTRUCTION; }
+		size_t conditionPosition(size_t block) const { return blockEnd[block] - POSITIONS_PER_INSTRUCTION; }
+		std::span<const size_t> order() const { return blockOrder; }
+
+	private:
+		std::vector<size_t> blockOrder, blockStart, blockEnd;
+		std::vector<LiveInterval> byVariable;
+		std::vector<std::vector<size_t>> clobberPositions;
+
+		LiveInterval& intervalFor(IL::Variable const& var);
+	};
+}
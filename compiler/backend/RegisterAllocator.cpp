@@ -0,0 +1,195 @@
+#include "RegisterAllocator.h"
+
+namespace z80
+{
+	class LinearScan
+	{
+	public:
+		LinearScan(LiveIntervals const& intervals)
+			: intervals(intervals.intervals()), clobberSource(intervals),
+			  assigned(this->intervals.size()), spilled(this->intervals.size()) {}
+
+		std::vector<std::optional<Location>> allocate(size_t& frameSize)
+		{
+			std::vector<size_t> unhandled;
+			for (size_t id = 0; id < intervals.size(); ++id) {
+				if (!intervals[id].empty()) unhandled.push_back(id);
+			}
+			std::stable_sort(unhandled.begin(), unhandled.end(), [&](size_t lhs, size_t rhs) {
+				return intervals[lhs].start() < intervals[rhs].start();
+			});
+			for (size_t current : unhandled)
+			{
+				advanceTo(intervals[current].start());
+				if (intervals[current].needsMemory) spilled[current] = true;
+				else if (!tryAllocateFree(current)) allocateBlocked(current);
+			}
+			return assignLocations(frameSize);
+		}
+
+	private:
+		std::span<const LiveInterval> intervals;
+		LiveIntervals const& clobberSource;
+		std::vector<std::optional<Register>> assigned;
+		std::vector<bool> spilled;
+		std::vector<size_t> active, inactive;
+
+		void advanceTo(size_t position)
+		{
+			std::vector<size_t> stillActive, stillInactive;
+			for (size_t id : active)
+			{
+				if (intervals[id].end() <= position) continue;
+				(intervals[id].covers(position) ? stillActive : stillInactive).push_back(id);
+			}
+			for (size_t id : inactive)
+			{
+				if (intervals[id].end() <= position) continue;
+				(intervals[id].covers(position) ? stillActive : stillInactive).push_back(id);
+			}
+			active = std::move(stillActive);
+			inactive = std::move(stillInactive);
+		}
+
+		bool isClobbered(Register reg, LiveInterval const& interval) const
+		{
+			RegisterUnits units = unitsOf(reg);
+			for (size_t unitIndex = 0; units != 0; ++unitIndex, units >>= 1) {
+				if ((units & 1) && interval.coversAny(clobberSource.clobbers(unitIndex))) return true;
+			}
+			return false;
+		}
+
+		// calls onBlocker for every interval holding an aliasing register while current is live
+		template<typename Callable>
+		void forEachBlocker(Register reg, size_t current, Callable onBlocker) const
+		{
+			for (size_t id : active) {
+				if (aliases(assigned[id].value(), reg)) onBlocker(id);
+			}
+			for (size_t id : inactive) {
+				if (aliases(assigned[id].value(), reg) && intervals[id].intersects(intervals[current])) onBlocker(id);
+			}
+		}
+
+		bool isFree(Register reg, size_t current) const
+		{
+			if (isClobbered(reg, intervals[current])) return false;
+			bool blocked = false;
+			forEachBlocker(reg, current, [&](size_t) { blocked = true; });
+			return !blocked;
+		}
+
+		std::vector<Register> candidates(size_t current) const
+		{
+			auto& interval = intervals[current];
+			RegisterClass regClass = classOf(interval.type);
+			std::vector<Register> order;
+			auto prefer = [&](Register reg) {
+				if (classOf(reg) == regClass && std::find(order.begin(), order.end(), reg) == order.end()) order.push_back(reg);
+			};
+			if (interval.copyOf.has_value() && interval.copyOf->id < assigned.size() && assigned[interval.copyOf->id].has_value()) {
+				prefer(assigned[interval.copyOf->id].value());
+			}
+			for (Register reg : interval.hints) prefer(reg);
+			for (Register reg : allocationOrder(regClass)) prefer(reg);
+			return order;
+		}
+
+		bool tryAllocateFree(size_t current)
+		{
+			for (Register reg : candidates(current))
+			{
+				if (!isFree(reg, current)) continue;
+				assigned[current] = reg;
+				active.push_back(current);
+				return true;
+			}
+			return false;
+		}
+
+		void allocateBlocked(size_t current)
+		{
+			std::optional<Register> best;
+			double bestCost = intervals[current].spillWeight;
+			for (Register reg : allocationOrder(classOf(intervals[current].type)))
+			{
+				if (isClobbered(reg, intervals[current])) continue;
+				double cost = 0;
+				forEachBlocker(reg, current, [&](size_t id) { cost += intervals[id].spillWeight; });
+				if (cost < bestCost) {
+					best = reg;
+					bestCost = cost;
+				}
+			}
+			if (!best.has_value())
+			{
+				spilled[current] = true;
+				return;
+			}
+			std::vector<size_t> evicted;
+			forEachBlocker(best.value(), current, [&](size_t id) { evicted.push_back(id); });
+			for (size_t id : evicted)
+			{
+				spilled[id] = true;
+				assigned[id].reset();
+				std::erase(active, id);
+				std::erase(inactive, id);
+			}
+			assigned[current] = best;
+			active.push_back(current);
+		}
+
+		std::vector<std::optional<Location>> assignLocations(size_t& frameSize)
+		{
+			struct Slot
+			{
+				int offset;
+				size_t size;
+				std::vector<size_t> occupants;
+			};
+			std::vector<Slot> slots;
+			std::vector<std::optional<Location>> locations(intervals.size());
+			frameSize = 0;
+			for (size_t id = 0; id < intervals.size(); ++id)
+			{
+				if (assigned[id].has_value()) {
+					locations[id] = assigned[id].value();
+					continue;
+				}
+				if (!spilled[id]) continue;
+				size_t size = (std::max<size_t>(IL::ilTypeBitSize(intervals[id].type), 1) + 7) / 8;
+				//a pointer can reach the slot of an address-taken variable outside its interval
+				if (intervals[id].needsMemory)
+				{
+					frameSize += size;
+					locations[id] = StackSlot{ -int(frameSize) };
+					continue;
+				}
+				auto slot = std::find_if(slots.begin(), slots.end(), [&](Slot const& slot) {
+					return slot.size == size && std::none_of(slot.occupants.begin(), slot.occupants.end(), [&](size_t other) {
+						return intervals[other].intersects(intervals[id]);
+					});
+				});
+				if (slot == slots.end())
+				{
+					frameSize += size;
+					slots.push_back(Slot{ -int(frameSize), size });
+					slot = slots.end() - 1;
+				}
+				slot->occupants.push_back(id);
+				locations[id] = StackSlot{ slot->offset };
+			}
+			return locations;
+		}
+	};
+
+	RegisterAllocation allocateRegisters(ILCtrlFlowGraph const& graph, opt::AnalysisManager& analyses,
+		std::span<const IL::Decl> params)
+	{
+		LiveIntervals intervals(graph, analyses.dominators().reversePostorder(), analyses, params);
+		size_t frameSize = 0;
+		auto locations = LinearScan(intervals).allocate(frameSize);
+		return RegisterAllocation(std::move(intervals), std::move(locations), frameSize);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <variant>
+#include "LiveIntervals.h"
+
+namespace z80
+{
+	// A spilled value lives at (IX + offset), the frame grows down from IX
+	struct StackSlot
+	{
+		int offset;
+	};
+	using Location = std::variant<Register, StackSlot>;
+
+	class RegisterAllocation
+	{
+	public:
+		RegisterAllocation(LiveIntervals intervals, std::vector<std::optional<Location>> locations, size_t frameSize)
+			: liveIntervals(std::move(intervals)), locations(std::move(locations)), frameBytes(frameSize) {}
+
+		// nullopt for globals and variables that are never live
+		std::optional<Location> locationOf(IL::Variable const& var) const {
+			return var.is_global || var.id >= locations.size() ? std::nullopt : locations[var.id];
+		}
+		// bytes below IX taken by stack slots
+		size_t frameSize() const { return frameBytes; }
+		LiveIntervals const& intervals() const { return liveIntervals; }
+
+	private:
+		LiveIntervals liveIntervals;
+		std::vector<std::optional<Location>> locations;
+		size_t frameBytes;
+	};
+
+	/* Register Allocator:
+		Linear scan (Poletto and Sarkar) over lifetime intervals with holes. An interval
+		gets a register of its class for its whole lifetime, first trying the register of
+		the variable it was copied from, then its hints, then the allocation order. A
+		register is unavailable while an aliasing register is in use or when the interval
+		lives across a clobber of it. When nothing is free, the intervals blocking the
+		cheapest register are spilled if together they weigh less than the current one,
+		otherwise the current one is. Spilled values are used from their (IX+d) slot
+		directly, which most 8-bit Z80 instructions can do, so intervals are never split.
+		Slots are shared between spilled intervals that do not overlap, except the slots of
+		address-taken variables, which are theirs for the whole function.
+
+		The graph must be out of SSA, params are the function parameters defined before it.
+	*/
+	RegisterAllocation allocateRegisters(ILCtrlFlowGraph const& graph, opt::AnalysisManager& analyses,
+		std::span<const IL::Decl> params = {});
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <span>
+#include <string_view>
+#include <cstdint>
+#include "IL.h"
+
+namespace z80
+{
+	/* Registers:
+		The registers values can be allocated to. A pair is made of two 8-bit registers,
+		so B and C can not hold values while BC does. IX is the frame pointer and SP the
+		stack pointer, neither is ever allocated.
+	*/
+	enum class Register : unsigned char {
+		A, B, C, D, E, H, L, BC, DE, HL, IY
+	};
+
+	enum class RegisterClass : unsigned char {
+		BYTE, WORD
+	};
+
+	// every register is a set of units, two registers alias when their units overlap
+	using RegisterUnits = std::uint16_t;
+	namespace unit
+	{
+		constexpr RegisterUnits A = 1 << 0, B = 1 << 1, C = 1 << 2, D = 1 << 3, E = 1 << 4,
+			H = 1 << 5, L = 1 << 6, IY = 1 << 7;
+		constexpr RegisterUnits ALL = A | B | C | D | E | H | L | IY;
+	}
+
+	constexpr RegisterUnits unitsOf(Register reg)
+	{
+		switch (reg)
+		{
+		case Register::A: return unit::A;
+		case Register::B: return unit::B;
+		case Register::C: return unit::C;
+		case Register::D: return unit::D;
+		case Register::E: return unit::E;
+		case Register::H: return unit::H;
+		case Register::L: return unit::L;
+		case Register::BC: return unit::B | unit::C;
+		case Register::DE: return unit::D | unit::E;
+		case Register::HL: return unit::H | unit::L;
+		case Register::IY: return unit::IY;
+		}
+		return 0;
+	}
+
+	constexpr bool aliases(Register lhs, Register rhs) { return (unitsOf(lhs) & unitsOf(rhs)) != 0; }
+
+	constexpr RegisterClass classOf(Register reg)
+	{
+		return reg >= Register::BC ? RegisterClass::WORD : RegisterClass::BYTE;
+	}
+
+	inline RegisterClass classOf(IL::Type type)
+	{
+		return IL::ilTypeBitSize(type) <= 8 ? RegisterClass::BYTE : RegisterClass::WORD;
+	}
+
+	// the registers of a class, in the order the allocator tries them
+	inline std::span<const Register> allocationOrder(RegisterClass regClass)
+	{
+		// A and HL are the accumulators, so they come last and are mostly used through hints
+		static constexpr std::array bytes = { Register::B, Register::C, Register::D, Register::E, Register::H, Register::L, Register::A };
+		static constexpr std::array words = { Register::DE, Register::BC, Register::HL, Register::IY };
+		if (regClass == RegisterClass::BYTE) return bytes;
+		return words;
+	}
+
+	// the name the assembler knows the register by
+	constexpr std::string_view registerName(Register reg)
+	{
+		switch (reg)
+		{
+		case Register::A: return "a";
+		case Register::B: return "b";
+		case Register::C: return "c";
+		case Register::D: return "d";
+		case Register::E: return "e";
+		case Register::H: return "h";
+		case Register::L: return "l";
+		case Register::BC: return "bc";
+		case Register::DE: return "de";
+		case Register::HL: return "hl";
+		case Register::IY: return "iy";
+		}
+		return "";
+	}
+}
@@ -1,7 +1,7 @@
 #pragma once
 #include <stdexcept>
 #include <cassert>
-#include "SourcePosition.h"
+#include "SourceManager.h"
 #include "spdlog/fmt/fmt.h"
 
 #define COMPILER_NOT_SUPPORTED assert(false);
@@ -26,7 +26,7 @@ public:
 		: sourcePos(sourcePos) {}
 
 	std::string toString() {
-		return fmt::format("[Line: {}] ", sourcePos.line) + msgToString();
+		return fmt::format("[Line: {}] ", SourceManager::instance().line(sourcePos)) + msgToString();
 	}
 private:
 	SourcePosition sourcePos;
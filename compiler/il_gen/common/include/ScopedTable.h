@@ -0,0 +1,70 @@
+#pragma once
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CompilerError.h"
+
+/* Scoped Table:
+	Names bound in nested scopes, looked up innermost first. One hash map points every
+	name at its innermost binding, and each binding remembers the one it shadows. The
+	bindings are kept in order, so they are also the undo log: destroying a scope walks
+	back over the bindings made in it, pointing their names at what they shadowed.
+	Lookup and binding are O(1), destroying a scope is O(1) per name bound in it.
+*/
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class ScopedTable
+{
+public:
+	void newScope() { scopeStarts.push_back(bindings.size()); }
+	void destroyScope()
+	{
+		COMPILER_ASSERT("Destroyed a scope that was never made", !scopeStarts.empty());
+		while (bindings.size() > scopeStarts.back())
+		{
+			Binding& binding = bindings.back();
+			if (binding.shadowed == NONE) innermost.erase(binding.key);
+			else innermost[binding.key] = binding.shadowed;
+			bindings.pop_back();
+		}
+		scopeStarts.pop_back();
+	}
+
+	// false when the name is already bound in the current scope, the first binding stays
+	bool insert(Key const& key, Value value)
+	{
+		COMPILER_ASSERT("Bound a name outside of any scope", !scopeStarts.empty());
+		auto [it, inserted] = innermost.try_emplace(key, bindings.size());
+		size_t shadowed = NONE;
+		if (!inserted)
+		{
+			if (it->second >= scopeStarts.back()) return false;
+			shadowed = std::exchange(it->second, bindings.size());
+		}
+		bindings.push_back(Binding{ key, std::move(value), shadowed });
+		return true;
+	}
+
+	Value* find(Key const& key)
+	{
+		auto it = innermost.find(key);
+		return it != innermost.end() ? &bindings[it->second].value : nullptr;
+	}
+	Value const* find(Key const& key) const { return const_cast<ScopedTable*>(this)->find(key); }
+	bool contains(Key const& key) const { return innermost.contains(key); }
+
+private:
+	static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+	struct Binding
+	{
+		Key key;
+		Value value;
+		size_t shadowed; //the binding of the same name in an outer scope
+	};
+
+	std::unordered_map<Key, size_t, Hash> innermost;
+	std::deque<Binding> bindings; //a deque, so values found stay put while more are bound
+	std::vector<size_t> scopeStarts;
+};
@@ -0,0 +1,131 @@
+#include "BlockAssignments.h"
+#include "ILOperands.h"
+#include <queue>
+#include <algorithm>
+
+bool VariableSet::unionWith(VariableSet const& other)
+{
+	grow(other.words.size() * 64);
+	bool changed = false;
+	for (size_t i = 0; i < other.words.size(); ++i) {
+		auto merged = words[i] | other.words[i];
+		changed |= merged != words[i];
+		words[i] = merged;
+	}
+	return changed;
+}
+
+void VariableSet::subtract(VariableSet const& other)
+{
+	for (size_t i = 0; i < std::min(words.size(), other.words.size()); ++i) {
+		words[i] &= ~other.words[i];
+	}
+}
+
+size_t VariableSet::size() const
+{
+	size_t count = 0;
+	for (auto word : words) count += std::popcount(word);
+	return count;
+}
+
+bool VariableSet::operator==(VariableSet const& other) const
+{
+	size_t common = std::min(words.size(), other.words.size());
+	auto isZero = [](std::uint64_t word) { return word == 0; };
+	return std::equal(words.begin(), words.begin() + common, other.words.begin())
+		&& std::all_of(words.begin() + common, words.end(), isZero)
+		&& std::all_of(other.words.begin() + common, other.words.end(), isZero);
+}
+
+BlockAssignments::BlockAssignments(ILCtrlFlowGraph const& graph)
+{
+	size_t const blocks = graph.nodeCount();
+	size_t variables = 0;
+	auto countVariable = [&](IL::Variable const& var) {
+		if (!var.is_global) variables = std::max(variables, var.id + 1);
+	};
+	for (size_t block = 0; block < blocks; ++block)
+	{
+		for (auto& instr : graph.nodeData(block).body) {
+			IL::forEachOperand(instr,
+				[&](IL::Variable const& var, IL::Type) { countVariable(var); }, countVariable, countVariable);
+		}
+		if (graph.nodeData(block).splits()) countVariable(graph.nodeData(block).splitsOn());
+	}
+
+	defs.assign(blocks, VariableSet(variables));
+	uses.assign(blocks, VariableSet(variables));
+	phiUses.assign(blocks, VariableSet(variables));
+	addressTakenVariables = VariableSet(variables);
+	defBlocks.resize(variables);
+	types.resize(variables);
+
+	for (size_t block = 0; block < blocks; ++block)
+	{
+		auto& blockDefs = defs[block];
+		auto& blockUses = uses[block];
+		auto use = [&](IL::Variable const& var) {
+			if (!var.is_global && !blockDefs.contains(var.id)) blockUses.insert(var.id);
+		};
+		auto addressTaken = [&](IL::Variable const& var) {
+			if (var.is_global) return;
+			addressTakenVariables.insert(var.id);
+			use(var);
+		};
+		auto def = [&](IL::Variable const& var, IL::Type type) {
+			if (var.is_global) return;
+			if (!blockDefs.contains(var.id)) defBlocks[var.id].push_back(block);
+			blockDefs.insert(var.id);
+			types[var.id] = type;
+		};
+		auto preds = graph.in(block);
+		for (auto& instr : graph.nodeData(block).body)
+		{
+			if (auto phi = IL::getIf<IL::Phi>(instr)) {
+				for (size_t i = 0; i < phi->sources.size() && i < preds.size(); ++i) {
+					if (auto source = std::get_if<IL::Variable>(&phi->sources[i]); source && !source->is_global)
+						phiUses[preds[i]].insert(source->id);
+				}
+				def(phi->dest.variable, phi->dest.type);
+				continue;
+			}
+			IL::forEachOperand(instr, def, use, addressTaken);
+		}
+		if (graph.nodeData(block).splits()) use(graph.nodeData(block).splitsOn());
+	}
+}
+
+Liveness::Liveness(ILCtrlFlowGraph const& graph, BlockAssignments const& assignments)
+	: in(graph.nodeCount(), VariableSet(assignments.variableCount())),
+	  out(graph.nodeCount(), VariableSet(assignments.variableCount()))
+{
+	// seed in reverse so most blocks are visited after their successors
+	std::queue<size_t> worklist;
+	std::vector<bool> queued(graph.nodeCount(), true);
+	for (size_t block = graph.nodeCount(); block-- > 0;) worklist.push(block);
+
+	while (!worklist.empty())
+	{
+		size_t block = worklist.front(); worklist.pop();
+		queued[block] = false;
+
+		auto& blockOut = out[block];
+		blockOut.unionWith(assignments.usedByPhisOut(block));
+		for (size_t succ : graph.out(block)) {
+			blockOut.unionWith(in[succ]);
+		}
+		VariableSet blockIn = blockOut;
+		blockIn.subtract(assignments.defines(block));
+		blockIn.unionWith(assignments.upwardExposed(block));
+		if (blockIn == in[block]) continue;
+
+		in[block] = std::move(blockIn);
+		for (size_t pred : graph.in(block)) {
+			if (!queued[pred]) {
+				queued[pred] = true;
+				worklist.push(pred);
+			}
+		}
+	}
+}
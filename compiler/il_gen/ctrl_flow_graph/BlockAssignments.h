@@ -0,0 +1,82 @@
+#pragma once
+#include <span>
+#include <vector>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include "CtrlFlowGraph.h"
+
+// Dense set of function local IL variables, indexed by variable id.
+// Global variables live in memory and are never members.
+class VariableSet
+{
+public:
+	VariableSet(size_t variableCount = 0)
+		: words((variableCount + 63) / 64, 0) {}
+
+	bool contains(size_t id) const { return id / 64 < words.size() && (words[id / 64] >> (id % 64)) & 1; }
+	void insert(size_t id) { grow(id + 1); words[id / 64] |= std::uint64_t(1) << (id % 64); }
+	void erase(size_t id) { if (id / 64 < words.size()) words[id / 64] &= ~(std::uint64_t(1) << (id % 64)); }
+	bool contains(IL::Variable var) const { return !var.is_global && contains(var.id); }
+
+	// returns whether any variable was added
+	bool unionWith(VariableSet const& other);
+	void subtract(VariableSet const& other);
+	size_t size() const;
+	bool operator==(VariableSet const& other) const;
+
+	template<typename Callable>
+	void forEach(Callable callable) const {
+		for (size_t word = 0; word < words.size(); ++word) {
+			for (auto bits = words[word]; bits != 0; bits &= bits - 1) {
+				callable(word * 64 + std::countr_zero(bits));
+			}
+		}
+	}
+private:
+	void grow(size_t variableCount) {
+		if (words.size() * 64 < variableCount) words.resize((variableCount + 63) / 64, 0);
+	}
+	std::vector<std::uint64_t> words;
+};
+
+/* Block Assignments:
+	Per block def and upward exposed use sets of the local variables in a graph.
+	Phi operands are not upward exposed uses of the phi's block, they are read
+	at the end of the matching predecessor, see usedByPhisOut.
+	Variables whose address is taken are still tracked, but must be left out of SSA.
+*/
+class BlockAssignments
+{
+public:
+	explicit BlockAssignments(ILCtrlFlowGraph const& graph);
+
+	// one past the largest local variable id in the graph
+	size_t variableCount() const { return types.size(); }
+	VariableSet const& defines(size_t block) const { return defs[block]; }
+	VariableSet const& upwardExposed(size_t block) const { return uses[block]; }
+	VariableSet const& usedByPhisOut(size_t block) const { return phiUses[block]; }
+	VariableSet const& addressTaken() const { return addressTakenVariables; }
+	std::span<const size_t> definingBlocks(size_t id) const { return defBlocks[id]; }
+	// nullopt when the variable is only defined outside of the graph
+	std::optional<IL::Type> typeOf(size_t id) const { return types[id]; }
+
+private:
+	std::vector<VariableSet> defs, uses, phiUses;
+	VariableSet addressTakenVariables;
+	std::vector<std::vector<size_t>> defBlocks;
+	std::vector<std::optional<IL::Type>> types;
+};
+
+// Live in and live out sets, by iterating the backwards dataflow equations to a fixed point.
+class Liveness
+{
+public:
+	Liveness(ILCtrlFlowGraph const& graph, BlockAssignments const& assignments);
+
+	VariableSet const& liveIn(size_t block) const { return in[block]; }
+	VariableSet const& liveOut(size_t block) const { return out[block]; }
+
+private:
+	std::vector<VariableSet> in, out;
+};
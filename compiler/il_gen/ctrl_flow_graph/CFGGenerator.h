@@ -4,7 +4,7 @@
 #include "Stmt.h"
 #include "SemanticError.h"
 #include "CtrlFlowGraph.h"
-#include "ExprCloner.h"
+#include "ExprInterner.h"
 
 
 class CtrlFlowGraphGenerator :
@@ -72,20 +72,21 @@ private:
 			Expr::makeExpr<Expr::Literal>(loop.sourcePos, Token::Literal(u16{ 0 })),
 			Expr::makeExpr<Expr::Identifier>(loop.sourcePos, "u16")
 		);
-		Expr::UniquePtr condition = Expr::makeExpr<Expr::Binary>(loop.sourcePos, 
+		//the condition is checked before and after the body, both blocks hold the one shared tree
+		Expr::Shared condition = Expr::Interner::current().share(Expr::makeExpr<Expr::Binary>(loop.sourcePos, 
 			Expr::makeExpr<Expr::Identifier>(loop.sourcePos, loop.counter), 
 			Token::Type::EQUAL_EQUAL, 
 			std::move(zero)
-		);
+		));
 		addStmtToCurrentBlock(std::move(varInitializer));
-		currentBlock().splitWith(Expr::Cloner{}.clone(condition));
+		currentBlock().splitWith(condition);
 		auto [trueBranch, falseBranch] = createChildren();
 
 		auto bodyNode = createTrueChild();
 		auto lastLoopNode = visitStmts(bodyNode, loop.body);
 		cfg.addEdge(lastLoopNode, bodyNode);
 		updateCurrentEntry(lastLoopNode);
-		currentBlock().splitWith(std::move(condition));
+		currentBlock().splitWith(condition);
 		updateCurrentEntry(createFalseChild());
 		updateCurrentEntry(trueBranch);
 		/*
@@ -99,7 +100,7 @@ private:
 
 	size_t visitConditionals(Stmt::Conditional& trueBlock, std::span<Stmt::Conditional> conditionals, Stmt::StmtBody& elseBranch)
 	{
-		currentBlock().splitWith(std::move(trueBlock.expr));
+		currentBlock().splitWith(Expr::Interner::current().share(std::move(trueBlock.expr)));
 		auto [trueBranch, falseBranch] = createChildren();
 		auto trueLastNode = visitStmts(trueBranch, trueBlock.body);
 		size_t falseLastNode;
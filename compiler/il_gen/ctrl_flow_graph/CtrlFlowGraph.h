@@ -2,7 +2,9 @@
 #pragma once
 #include <string>
 #include <set>
+#include <functional>
 #include "Graph.h"
+#include "DominatorTree.h"
 #include "Stmt.h"
 #include "IL.h"
 #include "CompilerError.h"
@@ -28,6 +30,7 @@ public:
     void name(std::string_view name) { label = name; }
     std::string_view getName() const { return label; }
     void splitWith(ConditionType expr) { splitExpr = std::move(expr); }
+    void removeSplit() { splitExpr.reset(); }
     ConditionType const& splitsOn() const { return splitExpr.value(); }
     ConditionType& splitsOn() { return splitExpr.value(); }
 
@@ -89,12 +92,37 @@ public:
     }
 };
 
-using Block = GenericBlock<Stmt::StmtBody, Expr::UniquePtr>;
+using Block = GenericBlock<Stmt::StmtBody, Expr::Shared>;
 using ILBlock = GenericBlock<IL::ILBody, IL::Variable>;
 
 using CtrlFlowGraph = GenericCtrlFlowGraph<Block>;
 using ILCtrlFlowGraph = GenericCtrlFlowGraph<ILBlock>;
 
+// def and use counts of every local variable, indexed by variable id
+struct VariableUseCounts
+{
+    size_t defCount(IL::Variable var) const { return var.id < defs.size() ? defs[var.id] : 0; }
+    size_t useCount(IL::Variable var) const { return var.id < uses.size() ? uses[var.id] : 0; }
+
+    std::vector<size_t> defs, uses;
+};
+// creates a fresh variable of the given type for each new SSA version
+using VersionCreator = std::function<IL::Variable(IL::Type)>;
+
+class BlockAssignments;
+class Liveness;
+
 IL::Program flattenILCtrlFlowGraph(ILCtrlFlowGraph graph);
-std::set<size_t> renameILGraph(ILCtrlFlowGraph& graph, size_t startId);
-//void placePhiNodes(ILCtrlFlowGraph& graph);
\ No newline at end of file
+// placePhiNodes must run first, both take the analyses of the graph before phis were placed
+VariableUseCounts renameILGraph(ILCtrlFlowGraph& graph, DominatorTree const& tree,
+    BlockAssignments const& assignments, Liveness const& liveness, VersionCreator createVersion);
+void placePhiNodes(ILCtrlFlowGraph& graph, DominatorTree const& tree,
+    BlockAssignments const& assignments, Liveness const& liveness);
+// takes the graph out of SSA, temporaries for cycles of copies come from createVariable
+void removePhiNodes(ILCtrlFlowGraph& graph, VersionCreator createVariable);
+// removes the edge along with the source each phi of dst has for it
+void removeILEdge(ILCtrlFlowGraph& graph, size_t src, size_t dst);
+// makes newPred a predecessor of block in place of oldPred, moving the phi sources along
+void replaceILPredecessor(ILCtrlFlowGraph& graph, size_t block, size_t oldPred, size_t newPred);
+// drops blocks the entry does not reach (the exit is always kept) and renumbers the rest
+bool removeUnreachableILBlocks(ILCtrlFlowGraph& graph);
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "CtrlFlowGraph.h"
+
+void removeILEdge(ILCtrlFlowGraph& graph, size_t src, size_t dst)
+{
+	auto preds = graph.in(dst);
+	auto pred = std::lower_bound(preds.begin(), preds.end(), src);
+	if (pred == preds.end() || *pred != src) return;
+	size_t predIndex = pred - preds.begin();
+	for (auto& instr : graph.nodeData(dst).body)
+	{
+		auto phi = IL::getIf<IL::Phi>(instr);
+		if (!phi) break; // phis always lead the block
+		phi->sources.erase(phi->sources.begin() + predIndex);
+	}
+	graph.removeEdge(src, dst);
+}
+
+void replaceILPredecessor(ILCtrlFlowGraph& graph, size_t block, size_t oldPred, size_t newPred)
+{
+	auto predIndex = [&](size_t pred) {
+		auto preds = graph.in(block);
+		return size_t(std::lower_bound(preds.begin(), preds.end(), pred) - preds.begin());
+	};
+	size_t oldIndex = predIndex(oldPred);
+	graph.removeEdge(oldPred, block);
+	graph.addEdge(newPred, block);
+	size_t newIndex = predIndex(newPred);
+	for (auto& instr : graph.nodeData(block).body)
+	{
+		auto phi = IL::getIf<IL::Phi>(instr);
+		if (!phi) break;
+		IL::Value source = std::move(phi->sources[oldIndex]);
+		phi->sources.erase(phi->sources.begin() + oldIndex);
+		phi->sources.insert(phi->sources.begin() + newIndex, std::move(source));
+	}
+}
+
+bool removeUnreachableILBlocks(ILCtrlFlowGraph& graph)
+{
+	std::vector<bool> reachable(graph.nodeCount());
+	graph.dfs(graph.getEntryNode(), [&](size_t node) { reachable[node] = true; });
+	reachable[graph.getExitNode()] = true;
+	if (std::all_of(reachable.begin(), reachable.end(), [](bool kept) { return kept; })) return false;
+
+	// blocks keep their relative order, so the sorted predecessors and the phi sources stay aligned
+	std::vector<size_t> newIndex(graph.nodeCount());
+	size_t kept = 0;
+	for (size_t node = 0; node < graph.nodeCount(); ++node)
+	{
+		if (!reachable[node]) {
+			while (graph.successorCount(node) != 0) removeILEdge(graph, node, graph.out(node).front());
+			continue;
+		}
+		newIndex[node] = kept++;
+	}
+	PureGraph shape = PureGraph::trivialGraph(kept);
+	for (size_t node = 0; node < graph.nodeCount(); ++node)
+	{
+		if (!reachable[node]) continue;
+		for (size_t succ : graph.out(node)) shape.addEdge(newIndex[node], newIndex[succ]);
+	}
+	ILCtrlFlowGraph compacted(CtrlFlowGraphShape{ shape });
+	for (size_t node = 0; node < graph.nodeCount(); ++node)
+	{
+		if (reachable[node]) compacted.nodeData(newIndex[node]) = std::move(graph.nodeData(node));
+	}
+	graph = std::move(compacted);
+	return true;
+}
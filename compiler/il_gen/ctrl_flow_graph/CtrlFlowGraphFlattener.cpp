@@ -1,60 +1,119 @@
-
 #include "CtrlFlowGraph.h"
 #include <set>
 
+/* Control Flow Graph Flattener:
+    Lays blocks out so that a block is followed by its false successor (or its only
+    successor) whenever possible, then emits the bodies in that order. A jump is only
+    emitted when the next block is not the fallthrough, and only blocks that are
+    jumped to get a label. The exit block always comes last, unreachable blocks are dropped.
+*/
 class CtrlFlowGraphFlattener
 {
 public:
     IL::Program flatten(ILCtrlFlowGraph graph)&&;
 
 private:
-    void addBlock(ILCtrlFlowGraph& graph, size_t node);
+    void layout(ILCtrlFlowGraph const& graph);
+    void assignLabels(ILCtrlFlowGraph const& graph);
+    void addBlock(ILCtrlFlowGraph& graph, size_t position);
+    std::optional<size_t> fallthrough(ILCtrlFlowGraph const& graph, size_t node) const;
+    bool endsInReturn(ILBlock const& block) const;
 
     IL::Program program;
+    std::vector<size_t> order;
     std::unordered_map<size_t, IL::Label> currentLabels;
-    std::set<size_t> visited;
     size_t labelCounter = 0;
 };
 
 IL::Program CtrlFlowGraphFlattener::flatten(ILCtrlFlowGraph graph) &&
 {
-    graph.bfs(graph.getEntryNode(), [&](size_t node) {
-        auto& block = graph.nodeData(node);
-        if (block.isTrueBranch()) {
-            currentLabels.emplace(node, IL::Label(labelCounter++));
-        }
-    });
-    addBlock(graph, graph.getEntryNode());
+    layout(graph);
+    assignLabels(graph);
+    for (size_t position = 0; position < order.size(); ++position) {
+        addBlock(graph, position);
+    }
     return std::move(program);
 }
 
-void CtrlFlowGraphFlattener::addBlock(ILCtrlFlowGraph& graph, size_t node)
+std::optional<size_t> CtrlFlowGraphFlattener::fallthrough(ILCtrlFlowGraph const& graph, size_t node) const
 {
-    if (node == graph.getExitNode()) return;
-    if (visited.count(node) != 0) return;
-    else visited.insert(node);
+    if (node == graph.getExitNode() || graph.successorCount(node) == 0) return std::nullopt;
+    if (graph.nodeData(node).splits()) return graph.getFalseSuccessor(node);
+    return graph.getSuccessor(node);
+}
 
+bool CtrlFlowGraphFlattener::endsInReturn(ILBlock const& block) const
+{
+    return !block.body.empty() && IL::getIf<IL::Return>(block.body.back()) != nullptr;
+}
+
+void CtrlFlowGraphFlattener::layout(ILCtrlFlowGraph const& graph)
+{
+    std::vector<bool> placed(graph.nodeCount());
+    std::vector<size_t> worklist = { graph.getEntryNode() };
+    placed[graph.getExitNode()] = true;
+    while (!worklist.empty())
+    {
+        size_t node = worklist.back(); worklist.pop_back();
+        // follow the chain of fallthroughs, deferring every other successor
+        while (!placed[node])
+        {
+            placed[node] = true;
+            order.push_back(node);
+            auto next = fallthrough(graph, node);
+            if (!next.has_value()) break;
+            for (auto it = graph.out(node).rbegin(); it != graph.out(node).rend(); ++it) {
+                if (*it != next.value() && !placed[*it]) worklist.push_back(*it);
+            }
+            node = next.value();
+        }
+    }
+    order.push_back(graph.getExitNode());
+}
+
+void CtrlFlowGraphFlattener::assignLabels(ILCtrlFlowGraph const& graph)
+{
+    std::set<size_t> targets;
+    for (size_t position = 0; position < order.size(); ++position)
+    {
+        size_t node = order[position];
+        auto next = fallthrough(graph, node);
+        bool fallsThrough = next.has_value() && position + 1 < order.size() && order[position + 1] == next.value();
+        if (graph.nodeData(node).splits()) {
+            targets.insert(graph.getTrueSuccessor(node));
+        }
+        if (next.has_value() && !fallsThrough && !endsInReturn(graph.nodeData(node))) {
+            targets.insert(next.value());
+        }
+    }
+    // number labels in program order
+    for (size_t node : order) {
+        if (targets.count(node) != 0) {
+            currentLabels.emplace(node, IL::Label(labelCounter++));
+        }
+    }
+}
+
+void CtrlFlowGraphFlattener::addBlock(ILCtrlFlowGraph& graph, size_t position)
+{
+    size_t node = order[position];
     ILBlock& block = graph.nodeData(node);
     if (currentLabels.count(node) != 0) {
         program.push_back(IL::makeIL<IL::Label>(currentLabels.at(node).name));
     }
+    bool returns = endsInReturn(block);
     util::vector_append(program, std::move(block.body));
 
     if (block.splits())
     {
-        auto trueSuccessor  = graph.getTrueSuccessor(node);
-        auto falseSuccessor = graph.getFalseSuccessor(node);
         program.push_back(IL::makeIL<IL::Test>(
-            block.splitsOn(), currentLabels.at(trueSuccessor))
+            block.splitsOn(), currentLabels.at(graph.getTrueSuccessor(node)))
         );
-        auto endLabel = IL::Label(labelCounter++);
-        addBlock(graph, falseSuccessor);
-        program.push_back(IL::makeIL<IL::Jump>(endLabel));
-        addBlock(graph, trueSuccessor);
-        program.push_back(IL::makeIL<IL::Label>(endLabel.name));
     }
-    else {
-        addBlock(graph, graph.getSuccessor(node));
+    auto next = fallthrough(graph, node);
+    bool fallsThrough = position + 1 < order.size() && next == order[position + 1];
+    if (next.has_value() && !fallsThrough && !returns) {
+        program.push_back(IL::makeIL<IL::Jump>(currentLabels.at(next.value())));
     }
 }
 
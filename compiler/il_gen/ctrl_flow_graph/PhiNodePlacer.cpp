@@ -1,57 +1,78 @@
-
 #include "CtrlFlowGraph.h"
+#include "BlockAssignments.h"
 
-
-class PhiNodePlacer 
+/* Phi Node Placer:
+	Pruned SSA placement (Cytron et al.) over the iterated dominance frontier of
+	every variable's definitions, skipping blocks where the variable is not live in.
+	Phis are placed at the start of their block, with every source set to the
+	variable itself, ordered like the block's predecessors. Renaming fills them in.
+	Variables whose address is taken stay in memory and get no phis.
+*/
+class PhiNodePlacer
 {
 public:
-	void edit(ILCtrlFlowGraph& graph)
+	PhiNodePlacer(ILCtrlFlowGraph& graph, DominatorTree const& tree, BlockAssignments const& assignments, Liveness const& liveness)
+		: graph(graph), assignments(assignments), liveness(liveness),
+		  frontiers(dominanceFrontier(tree, graph)),
+		  hasAlready(graph.nodeCount(), 0), worked(graph.nodeCount(), 0),
+		  phisForBlock(graph.nodeCount()) {}
+
+	void edit()
 	{
-		frontiers = dominanceFrontier(graph.getEntryNode(), graph.getExitNode(), graph);
-		for (size_t s = 0; s < graph.nodeCount(); ++s) 
+		for (size_t variable = 0; variable < assignments.variableCount(); ++variable)
 		{
-			hasAlready[s] = 0;
-			worked[s] = 0;
+			if (assignments.addressTaken().contains(variable)) continue;
+			if (assignments.definingBlocks(variable).empty()) continue;
+			iterCount++;
+			placeForVariable(variable);
 		}
-		iter = 0;
-		worklist.clear();
-		std::set<size_t> variables = renameILGraph(graph, 1);
-		for (size_t i = *variables.begin(); i <= *variables.end(); ++i) 
+		for (size_t block = 0; block < graph.nodeCount(); ++block)
 		{
-			iter++;
-			placeForVariable(graph, i);
+			if (phisForBlock[block].empty()) continue;
+			auto& body = graph.nodeData(block).body;
+			IL::ILBody phis;
+			for (size_t variable : phisForBlock[block])
+			{
+				std::vector<IL::Value> sources(graph.predecessorCount(block), IL::Variable{ variable });
+				phis.push_back(IL::makeIL<IL::Phi>(IL::Variable{ variable }, assignments.typeOf(variable).value(), std::move(sources)));
+			}
+			body.insert(body.begin(), std::make_move_iterator(phis.begin()), std::make_move_iterator(phis.end()));
 		}
 	}
 private:
+	ILCtrlFlowGraph& graph;
+	BlockAssignments const& assignments;
+	Liveness const& liveness;
 	DominanceFrontiers frontiers;
-	std::unordered_map<size_t, size_t> hasAlready, worked;
-	std::unordered_set<size_t> worklist;
-	size_t iter;
+	// iteration a block last got a phi / was added to the worklist in
+	std::vector<size_t> hasAlready, worked;
+	std::vector<size_t> worklist;
+	std::vector<std::vector<size_t>> phisForBlock;
+	size_t iterCount = 0;
 
-	void placeForVariable(ILCtrlFlowGraph& graph, size_t variableId)
+	void placeForVariable(size_t variable)
 	{
-		for () 
+		for (size_t block : assignments.definingBlocks(variable))
 		{
-			// add each block that has assignment to workblock
+			worked[block] = iterCount;
+			worklist.push_back(block);
 		}
 		while (!worklist.empty())
 		{
-			size_t node = *worklist.begin();
-			worklist.erase(node);
+			size_t node = worklist.back();
+			worklist.pop_back();
 			for (size_t undominated : frontiers[node])
 			{
-				if (hasAlready[undominated] < iterCount)
+				if (hasAlready[undominated] >= iterCount) continue;
+				hasAlready[undominated] = iterCount;
+				// the frontier is still iterated through dead blocks, only the phi is pruned
+				if (liveness.liveIn(undominated).contains(variable)) {
+					phisForBlock[undominated].push_back(variable);
+				}
+				if (worked[undominated] < iterCount)
 				{
-					auto& body = graph.nodeData(undominated).body;
-					std::vector<IL::Value> sources(graph.predecessorCount(undominated));
-					std::fill(sources.begin(), sources.end(), IL::Variable{variableId});
-					body.insert(body.begin(), IL::makeIL<IL::Phi>(IL::Variable{variableId}, std::move(sources)));
-					hasAlready[undominated] = iterCount;
-					if (worked[undominated < iterCount])
-					{
-						worked[undominated] = iterCount;
-						worklist.insert(undominated);
-					}
+					worked[undominated] = iterCount;
+					worklist.push_back(undominated);
 				}
 			}
 		}
@@ -59,7 +80,7 @@ private:
 };
 
 
-void placePhiNodes(ILCtrlFlowGraph& graph)
+void placePhiNodes(ILCtrlFlowGraph& graph, DominatorTree const& tree, BlockAssignments const& assignments, Liveness const& liveness)
 {
-	PhiNodePlacer{}.edit(graph);
-}
\ No newline at end of file
+	PhiNodePlacer{ graph, tree, assignments, liveness }.edit();
+}
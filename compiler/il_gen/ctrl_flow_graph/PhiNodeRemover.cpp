@@ -0,0 +1,112 @@
+#include "CtrlFlowGraph.h"
+
+/* Phi Node Remover:
+	Takes the graph out of SSA by turning every phi into copies at the end of
+	its predecessors. Critical edges into blocks with phis get a new block, so
+	the copies only run on that edge. The copies of one edge happen in parallel,
+	so they are ordered to never overwrite a source that is still needed, and a
+	cycle of copies is broken with a temporary.
+*/
+class PhiNodeRemover
+{
+	struct Copy
+	{
+		IL::Decl dest;
+		IL::Value src;
+	};
+public:
+	PhiNodeRemover(ILCtrlFlowGraph& graph, VersionCreator createVariable)
+		: graph(graph), createVariable(std::move(createVariable)) {}
+
+	void edit()
+	{
+		size_t const originalNodes = graph.nodeCount();
+		for (size_t block = 0; block < originalNodes; ++block)
+		{
+			auto phis = takePhis(block);
+			if (phis.empty()) continue;
+
+			std::vector<size_t> preds(graph.in(block).begin(), graph.in(block).end());
+			for (size_t predIndex = 0; predIndex < preds.size(); ++predIndex)
+			{
+				std::vector<Copy> copies;
+				for (auto& phi : phis) {
+					copies.push_back(Copy{ phi.dest, phi.sources[predIndex] });
+				}
+				size_t target = preds[predIndex];
+				if (graph.successorCount(target) > 1) {
+					target = splitEdge(target, block);
+				}
+				sequentialize(graph.nodeData(target).body, std::move(copies));
+			}
+		}
+	}
+private:
+	ILCtrlFlowGraph& graph;
+	VersionCreator createVariable;
+
+	std::vector<IL::Phi> takePhis(size_t block)
+	{
+		std::vector<IL::Phi> phis;
+		auto& body = graph.nodeData(block).body;
+		auto firstNonPhi = body.begin();
+		for (; firstNonPhi != body.end(); ++firstNonPhi)
+		{
+			auto phi = IL::getIf<IL::Phi>(*firstNonPhi);
+			if (!phi) break;
+			phis.push_back(std::move(*phi));
+		}
+		body.erase(body.begin(), firstNonPhi);
+		return phis;
+	}
+
+	size_t splitEdge(size_t src, size_t dst)
+	{
+		auto& dstBlock = graph.nodeData(dst);
+		auto edgeBlock = dstBlock.isTrueBranch() ? ILBlock::trueBlock() :
+						 dstBlock.isFalseBranch() ? ILBlock::falseBlock() : ILBlock::defaultBlock();
+		size_t node = graph.createNode(std::move(edgeBlock));
+		graph.removeEdge(src, dst);
+		graph.addEdge(src, node);
+		graph.addEdge(node, dst);
+		return node;
+	}
+
+	static bool reads(Copy const& copy, IL::Variable var)
+	{
+		auto src = std::get_if<IL::Variable>(&copy.src);
+		return src && *src == var;
+	}
+
+	void sequentialize(IL::ILBody& body, std::vector<Copy> pending)
+	{
+		std::erase_if(pending, [](Copy const& copy) { return reads(copy, copy.dest.variable); });
+		while (!pending.empty())
+		{
+			// a copy is safe once no other pending copy reads its destination
+			auto safe = std::find_if(pending.begin(), pending.end(), [&](Copy const& copy) {
+				return std::none_of(pending.begin(), pending.end(), [&](Copy const& other) {
+					return &other != &copy && reads(other, copy.dest.variable);
+				});
+			});
+			if (safe == pending.end())
+			{
+				// every destination is still read, so all remaining copies form cycles
+				IL::Decl saved = pending.front().dest;
+				IL::Variable temp = createVariable(saved.type);
+				body.push_back(IL::makeIL<IL::Assignment>(temp, saved.type, saved.variable));
+				for (auto& copy : pending) {
+					if (reads(copy, saved.variable)) copy.src = temp;
+				}
+				continue;
+			}
+			body.push_back(IL::makeIL<IL::Assignment>(safe->dest.variable, safe->dest.type, safe->src));
+			pending.erase(safe);
+		}
+	}
+};
+
+void removePhiNodes(ILCtrlFlowGraph& graph, VersionCreator createVariable)
+{
+	PhiNodeRemover{ graph, std::move(createVariable) }.edit();
+}
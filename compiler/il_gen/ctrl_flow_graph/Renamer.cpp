@@ -1,169 +1,154 @@
 #include "CtrlFlowGraph.h"
-#include <set>
+#include "BlockAssignments.h"
+#include "ILOperands.h"
 
+/* IL Renamer:
+	Classic SSA renaming (Cytron et al.) with a stack of versions per variable,
+	walking the dominator tree in preorder. Phi sources are filled in from the end
+	of each predecessor. Stacks and counts are dense arrays indexed by variable id.
+
+	A variable that is not live into the entry keeps its name for its first
+	definition, every other definition gets a new variable. Uses that no definition
+	in the graph reaches keep the original name, which is defined before the graph.
+	Variables whose address is taken are left alone.
+*/
 class ILRenamer
-	: public ::IL::Visitor
 {
-	using RenameTable = std::unordered_map<IL::Variable, IL::Variable>;
 public:
-	ILRenamer(size_t startId) : startId(startId) {}
-
-	void rename(IL::UniquePtr& expr) 
-	{
-		this->::IL::Visitor::visitChild(expr);
-	}
-
-	void rename(IL::Variable& var)
-	{
-		if (renameTable.count(var) == 0)
-		{
-			renameTable.emplace(var, IL::Variable(startId++));
+	ILRenamer(ILCtrlFlowGraph& graph, DominatorTree const& tree, BlockAssignments const& assignments,
+		Liveness const& liveness, VersionCreator createVersion)
+		: graph(graph), assignments(assignments), tree(tree),
+		  createVersion(std::move(createVersion)),
+		  stacks(assignments.variableCount()), keepsName(assignments.variableCount())
+	{
+		for (size_t id = 0; id < assignments.variableCount(); ++id) {
+			keepsName[id] = !liveness.liveIn(graph.getEntryNode()).contains(id);
 		}
-		var = renameTable.at(var);
 	}
 
-	std::set<size_t> variables()
-	{
-		std::set<size_t> vars;
-		for (auto& [old, updated] : renameTable)
+	VariableUseCounts rename()
+	{
+		// iterative preorder walk, a block is popped once all its children are renamed
+		std::vector<std::pair<size_t, size_t>> walk; // block, next child index
+		std::vector<std::vector<size_t>> pushed(graph.nodeCount());
+		walk.emplace_back(tree.root(), 0);
+		renameBlock(tree.root(), pushed[tree.root()]);
+		while (!walk.empty())
 		{
-			vars.insert(updated.id);
+			auto& [block, childIndex] = walk.back();
+			auto children = tree.children(block);
+			if (childIndex == children.size())
+			{
+				for (size_t id : pushed[block]) stacks[id].pop_back();
+				walk.pop_back();
+				continue;
+			}
+			size_t child = children[childIndex++];
+			renameBlock(child, pushed[child]);
+			walk.emplace_back(child, 0);
 		}
-		return vars;
+		return countVariables();
 	}
 
-	virtual void visit(IL::Binary& expr) override 
-	{
-		rename(expr.dest.variable);
-		rename(expr.lhs);
-		rename(expr.rhs);
+private:
+	ILCtrlFlowGraph& graph;
+	BlockAssignments const& assignments;
+	DominatorTree const& tree;
+	VersionCreator createVersion;
+	std::vector<std::vector<IL::Variable>> stacks;
+	std::vector<bool> keepsName;
+
+	bool isRenamed(IL::Variable const& var) const {
+		return !var.is_global && var.id < stacks.size() && !assignments.addressTaken().contains(var.id);
 	}
-	virtual void visit(IL::Unary& expr) override
+
+	void renameUse(IL::Variable& var)
 	{
-		rename(expr.dest.variable);
-		rename(expr.src);
+		if (isRenamed(var) && !stacks[var.id].empty()) {
+			var = stacks[var.id].back();
+		}
 	}
-	//Primary expressions
-	virtual void visit(IL::Function& func) override 
+
+	void renameDef(IL::Variable& var, IL::Type type, std::vector<size_t>& pushed)
 	{
-		for (auto& param : func.signature.params) 
-		{
-			rename(param.variable);
+		if (!isRenamed(var)) return;
+		size_t original = var.id;
+		if (keepsName[original]) {
+			keepsName[original] = false;
 		}
-		for (auto& line : func.body) 
-		{
-			rename(line);
+		else {
+			var = createVersion(type);
 		}
+		stacks[original].push_back(var);
+		pushed.push_back(original);
 	}
-	virtual void visit(IL::TestBit& expr) override 
-	{
-		rename(expr.dest);
-		rename(expr.src);
-	}
-	virtual void visit(IL::Test& expr) override 
-	{
-		rename(expr.var);
-	}
-	virtual void visit(IL::Phi& expr) override 
+
+	void renameBlock(size_t block, std::vector<size_t>& pushed)
 	{
-		rename(expr.dest);
-		for (auto& source : expr.sources)
+		auto& data = graph.nodeData(block);
+		for (auto& instr : data.body)
 		{
-			rename(source);
+			if (auto phi = IL::getIf<IL::Phi>(instr)) {
+				renameDef(phi->dest.variable, phi->dest.type, pushed);
+				continue;
+			}
+			IL::forEachOperand(instr,
+				[&](IL::Variable& var, IL::Type type) { renameDef(var, type, pushed); },
+				[&](IL::Variable& var) { renameUse(var); },
+				[](IL::Variable&) {}
+			);
 		}
-	}
-	virtual void visit(IL::Return& expr) override 
-	{
-		if(expr.value.has_value())
-			rename(expr.value.value());
-	}
-	virtual void visit(IL::Assignment& expr) override 
-	{
-		rename(expr.dest.variable);
-		rename(expr.src);
-	}
-	virtual void visit(IL::FunctionCall& call) override
-	{
-		rename(call.dest);
-		rename(call.args);
-		if (std::holds_alternative<IL::Variable>(call.function)) 
-		{
-			rename(std::get<IL::Variable>(call.function));
+		if (data.splits()) {
+			renameUse(data.splitsOn());
 		}
-	}
-	virtual void visit(IL::Cast& cast) override 
-	{
-		rename(cast.dest);
-		rename(cast.src);
-	}
-	virtual void visit(IL::Allocate& allocation) override 
-	{
-		rename(allocation.dest);
-	}
-	virtual void visit(IL::AddressOf& addressOf) override
-	{
-		rename(addressOf.ptr);
-		if (std::holds_alternative<IL::Variable>(addressOf.target))
+		for (size_t succ : graph.out(block))
 		{
-			rename(std::get<IL::Variable>(addressOf.target));
+			auto preds = graph.in(succ);
+			size_t predIndex = std::lower_bound(preds.begin(), preds.end(), block) - preds.begin();
+			for (auto& instr : graph.nodeData(succ).body)
+			{
+				auto phi = IL::getIf<IL::Phi>(instr);
+				if (!phi) break; // phis always lead the block
+				if (auto source = std::get_if<IL::Variable>(&phi->sources[predIndex])) {
+					renameUse(*source);
+				}
+			}
 		}
 	}
-	virtual void visit(IL::Deref& deref) override 
-	{
-		rename(deref.ptr);
-		rename(deref.dest.variable);
-		rename(deref.ptr);
-	}
-	virtual void visit(IL::Store& store) override 
-	{
-		rename(store.src.variable);
-		rename(store.ptr);
-	}
-	virtual void visit(IL::MemCopy& copy) override 
-	{
-		rename(copy.dest);
-		rename(copy.src);
-	}
-	virtual void visit(IL::Instruction& expr) override {}
-	virtual void visit(IL::Jump& jump) override {}
-	virtual void visit(IL::Label& label) override {}
-private:
-	RenameTable renameTable;
-	size_t startId;
 
-	void rename(IL::Value& value) 
-	{
-		if (std::holds_alternative<IL::Variable>(value)) 
+	VariableUseCounts countVariables()
+	{
+		VariableUseCounts counts;
+		auto grow = [&](IL::Variable const& var) {
+			if (var.id >= counts.defs.size()) {
+				counts.defs.resize(var.id + 1);
+				counts.uses.resize(var.id + 1);
+			}
+		};
+		auto use = [&](IL::Variable& var) {
+			if (var.is_global) return;
+			grow(var);
+			counts.uses[var.id]++;
+		};
+		for (size_t block = 0; block < graph.nodeCount(); ++block)
 		{
-			rename(std::get<IL::Variable>(value));
+			auto& data = graph.nodeData(block);
+			for (auto& instr : data.body)
+			{
+				IL::forEachOperand(instr, [&](IL::Variable& var, IL::Type) {
+					if (var.is_global) return;
+					grow(var);
+					counts.defs[var.id]++;
+				}, use, use);
+			}
+			if (data.splits()) use(data.splitsOn());
 		}
-	}
-	void rename(IL::Decl& decl) 
-	{
-		rename(decl.variable);
-	}
-	template<typename T>
-	void rename(std::vector<T>& list) 
-	{
-		for (auto& elem : list) rename(elem);
+		return counts;
 	}
 };
 
-std::set<size_t> renameILGraph(ILCtrlFlowGraph& graph, size_t startId) 
+VariableUseCounts renameILGraph(ILCtrlFlowGraph& graph, DominatorTree const& tree,
+	BlockAssignments const& assignments, Liveness const& liveness, VersionCreator createVersion)
 {
-	ILRenamer renamer{ startId };
-	graph.bfs(graph.getEntryNode(), [&](size_t node) 
-	{
-		auto& nodeData = graph.nodeData(node);
-		for (IL::UniquePtr& data : nodeData.body) 
-		{
-			renamer.rename(data);
-		}
-		if (nodeData.splits()) {
-			IL::Variable oldSplit = nodeData.splitsOn();
-			renamer.rename(oldSplit);
-			nodeData.splitWith(oldSplit);
-		}
-	});
-	return renamer.variables();
-}
\ No newline at end of file
+	return ILRenamer{ graph, tree, assignments, liveness, std::move(createVersion) }.rename();
+}
@@ -26,36 +26,32 @@ void Enviroment::destroyScope()
 IL::Variable Enviroment::createAnonymousVariable(IL::Type ilType)
 {
 	auto temp = variableCreator.createVariable();
-	ilVariableTypes.currentScope().emplace(temp, std::move(ilType));
+	ilVariableTypes.insert(temp, std::move(ilType));
 	return temp;
 }
 
 bool Enviroment::isValidVariable(std::string_view targetName) const
 {
-	return variables.find_if([&](auto& pair) {
-		return pair.first == targetName;
-	}) != variables.end();
+	return variables.contains(targetName);
 }
 
 void Enviroment::registerVariableName(std::string_view name, gen::Variable variable)
 {
-	COMPILER_ASSERT("IL variable must already exist", ilVariableTypes.find_if([&](auto& pair) {
-		return pair.first == variable.ilName;
-	}) != ilVariableTypes.end());
+	COMPILER_ASSERT("IL variable must already exist", ilVariableTypes.contains(variable.ilName));
 
-	variables.currentScope().emplace(name, variable);
+	variables.insert(name, variable);
 }
 
 gen::Variable const& Enviroment::getVariable(std::string_view name) const
 {
-	return variables.find_if([&](auto& pair) {
-		return pair.first == name;
-	})->second;
+	auto variable = variables.find(name);
+	COMPILER_ASSERT("Variable must already exist", variable);
+	return *variable;
 }
 
 IL::Type Enviroment::getILVariableType(IL::Variable variable) const
 {
-	return ilVariableTypes.find_if([&](auto& pair) {
-		return pair.first == variable;
-	})->second;
+	auto type = ilVariableTypes.find(variable);
+	COMPILER_ASSERT("IL variable must already exist", type);
+	return *type;
 }
@@ -6,7 +6,7 @@
 #include "Variable.h"
 #include "ArrayMap.h"
 #include "VariableCreator.h"
-#include "ScopedContainer.h"
+#include "ScopedTable.h"
 #include "TypeSystem.h"
 #include "IL.h"
 
@@ -32,6 +32,6 @@ public:
 private:
 
 	VariableCreator variableCreator;
-	ScopedContainer<std::unordered_map<std::string_view, gen::Variable>> variables;
-	ScopedContainer<std::unordered_map<IL::Variable, IL::Type>> ilVariableTypes;
+	ScopedTable<std::string_view, gen::Variable> variables;
+	ScopedTable<IL::Variable, IL::Type> ilVariableTypes;
 };
\ No newline at end of file
@@ -23,8 +23,13 @@ ExprGenerator ExprGenerator::typedContext(Enviroment& env, TypePtr type)
 
 ILExprResult ExprGenerator::generateWithCast(Expr::UniquePtr const& expr, TypeInstance outputType)
 {
-	ILExprResult result = visitChild(expr);
-	assertIsCastableType(expr->sourcePos, result.output.type, outputType);
+	return generateWithCast(*expr, outputType);
+}
+
+ILExprResult ExprGenerator::generateWithCast(Expr::Expr const& expr, TypeInstance outputType)
+{
+	ILExprResult result = visit::dispatch(expr, [&]<typename T>(T const& node) { return visitChild<T>(node); });
+	assertIsCastableType(expr.sourcePos, result.output.type, outputType);
 	if (result.output.type != outputType)
 		result.output = castVariable(result.instructions, result.output, outputType);
 	return result;
@@ -87,7 +92,7 @@ ListType const* ExprGenerator::determineListLiteralType(SourcePosition const& po
 	size_t elementCount = elements.size();
 	if (elementCount == 0) {
 		// deduce based on context
-		if (auto listType = typeContext->getExactType<ListType>()) {
+		if (auto listType = typesys::dyn_cast<ListType>(typeContext)) {
 			return listType;
 		}
 		throw SemanticError(pos, "Unable to determine the type of empty list.");
@@ -98,10 +103,10 @@ ListType const* ExprGenerator::determineListLiteralType(SourcePosition const& po
 		{
 			throw SemanticError(pos, fmt::format("Not all types in the list literal are the same. "
 												 "Found a {} and {}, which are contradictory.",
-												 elementType->name, element.output.type.type->name));
+												 elementType->name(), element.output.type.type->name()));
 		}
 	}
-	return env.types.addArray(TypeInstance(elementType), elementCount)->getExactType<ListType>();
+	return &typesys::cast<ListType>(env.types.addArray(TypeInstance(elementType), elementCount));
 }
 
 std::vector<ILExprResult> ExprGenerator::visitChild(std::vector<Expr::UniquePtr> const& args)
@@ -238,10 +243,10 @@ void ExprGenerator::visit(Expr::Literal const& expr)
 	{
 		IL::ILBody instructions;
 		gen::Variable out = allocateVariable(instructions, typeContext);
-		if (!typeContext->getExactType<PrimitiveType>()) {
+		if (!typesys::isa<PrimitiveType>(typeContext)) {
 			throw SemanticError(expr.sourcePos, 
 				fmt::format("Found an integer literal, when the following type was expected: {}", 
-							typeContext->name));
+							typeContext->name()));
 		}
 		IL::Type ilReturnType = env.getILVariableType(out.ilName);
 
@@ -349,7 +354,7 @@ void ExprGenerator::visit(Expr::ListLiteral const& expr)
 	IL::Program instructions;
 	auto elements = util::transform_vector(expr.elements, [&](auto& element)
 		{
-			auto listType = typeContext->getExactType<ListType>();
+			auto listType = typesys::dyn_cast<ListType>(typeContext);
 			auto result = listType ? ExprGenerator::typedContext(env, listType->elementType.type).generate(element)
 									: ExprGenerator::defaultContext(env).generate(element);
 			util::vector_append(instructions, std::move(result.instructions));
@@ -380,7 +385,7 @@ void ExprGenerator::visit(Expr::ListLiteral const& expr)
 void ExprGenerator::visit(Expr::StructLiteral const& expr)
 {
 	IL::Program instructions;
-	auto binType = typeContext->getExactType<BinType>();
+	auto binType = typesys::dyn_cast<BinType>(typeContext);
 	if (!binType) {
 		throw SemanticError(expr.sourcePos, "Unable to deduce the type of struct literal.");
 	}
@@ -15,6 +15,7 @@ public:
 	static ExprGenerator typedContext(Enviroment& env, TypePtr type);
 	ILExprResult generate(Expr::UniquePtr const& expr);
 	ILExprResult generateWithCast(Expr::UniquePtr const& expr, TypeInstance outputType);
+	ILExprResult generateWithCast(Expr::Expr const& expr, TypeInstance outputType);
 
 private:
 	ExprGenerator(Enviroment& env, TypePtr arithmeticType);
@@ -4,10 +4,9 @@
 #include "VectorUtil.h"
 #include "VariantUtil.h"
 #include "ExprGenerator.h"
-#include <iostream>
 
-FunctionGenerator::FunctionGenerator(Enviroment& env, IL::Program& moduleInstructions)
-	: gen::GeneratorToolKit(env), env(env), moduleInstructions(moduleInstructions)
+FunctionGenerator::FunctionGenerator(Enviroment& env, IL::Program& moduleInstructions, opt::PassManager& passManager)
+	: gen::GeneratorToolKit(env), env(env), moduleInstructions(moduleInstructions), passManager(passManager)
 {
 }
 
@@ -15,7 +14,7 @@ IL::Function FunctionGenerator::generate(Stmt::Function function)
 {
 	auto [ilFunction, paramTypes] = generate_(std::move(function));
 	TypePtr funcType = env.types.addFunction(paramTypes, returnVariable.value().type);
-	gen::Variable address = getPointerTo(moduleInstructions, IL::AddressOf::Function{function.name}, funcType->getExactType<FunctionType>());
+	gen::Variable address = getPointerTo(moduleInstructions, IL::AddressOf::Function{function.name}, &typesys::cast<FunctionType>(funcType));
 	env.registerVariableName(function.name, address);
 	return std::move(ilFunction);
 }
@@ -45,7 +44,7 @@ ILCtrlFlowGraph FunctionGenerator::transformGraph(CtrlFlowGraph graph)
 		}
 		if (uncompiledNode.splits()) {
 			TypeInstance boolType = env.types.getPrimitiveType(PrimitiveType::SubType::bool_);
-			auto exprResult = ExprGenerator::defaultContext(env).generateWithCast(uncompiledNode.splitsOn(), boolType);
+			auto exprResult = ExprGenerator::defaultContext(env).generateWithCast(*uncompiledNode.splitsOn(), boolType);
 			util::vector_append(outBody, std::move(exprResult.instructions));
 			out.nodeData(node).splitWith(exprResult.output.ilName);
 		}
@@ -69,26 +68,11 @@ std::pair<IL::Function, std::vector<TypeInstance>> FunctionGenerator::generate_(
 			returnVariable = allocateVariable(instructions, returnType);
 		}
 	}
-	// DOMINANCE FRONTIER STUFF
 	ILCtrlFlowGraph ilCfg = transformGraph(CtrlFlowGraphGenerator{ function.body }.generate());
-	//renameILGraph(ilCfg, 1);
-	auto dominance = dominanceFrontier(ilCfg.getEntryNode(), ilCfg.getExitNode(), ilCfg);
-	std::cout << "Function: " << function.name << std::endl;
-	std::cout << ilCfg << std::endl;
-	for (auto [dominator, dominated] : dominance) 
-	{
-		std::cout << "State " << dominator << " dominance frontier: { ";
-		bool first = true;
-		for (size_t s : dominated)
-		{
-			if (!first) std::cout << ", ";
-			std::cout << s;
-			if (first) first = false;
-		}
-		std::cout << " }\n" << std::endl;
-	}
-	
-	//END DOMINANCE
+	opt::FunctionContext context{ function.name, ilCfg, [&](IL::Type type) {
+		return env.createAnonymousVariable(type);
+	}};
+	passManager.runOnFunction(context);
 	util::vector_append(instructions, flattenILCtrlFlowGraph(std::move(ilCfg)));
 
 	return std::make_pair(IL::Function{
@@ -12,6 +12,7 @@
 #include "GeneratorToolKit.h"
 #include "GeneratorErrors.h"
 #include "FunctionHelpers.h"
+#include "PassManager.h"
 
 /*Will eventually support lang features*/
 /* Error Handling:
@@ -24,6 +25,8 @@
 
 struct BlockStmtResult 
 {
+	BlockStmtResult(IL::Program instructions) 
+		: instructions(std::move(instructions)) {}
 	BlockStmtResult(IL::Program allocations, IL::Program instructions) 
 		: instructions(std::move(instructions)),
 		  allocations(std::move(allocations)) {}
@@ -36,12 +39,13 @@ class FunctionGenerator :
 	public gen::GeneratorErrors
 {
 public:
-	FunctionGenerator(Enviroment& env, IL::Program& moduleInstructions);
+	FunctionGenerator(Enviroment& env, IL::Program& moduleInstructions, opt::PassManager& passManager);
 	IL::Function generate(Stmt::Function function);
 
 private:
 	Enviroment& env;
 	IL::Program& moduleInstructions;
+	opt::PassManager& passManager;
 	std::optional<gen::Variable> returnVariable;
 
 	ILCtrlFlowGraph transformGraph(CtrlFlowGraph graph);
@@ -8,7 +8,8 @@
 #include "CFGGenerator.h"
 
 
-ILGenerator::ILGenerator()
+ILGenerator::ILGenerator(opt::PassManager passManager)
+	: passManager(std::move(passManager))
 {
 }
 
@@ -19,6 +20,9 @@ std::optional<IL::Program> ILGenerator::generate(Stmt::Program input)
 	{
 		tryToCompile(stmt, ilProgram);
 	}
+	if (!isErroneous) {
+		passManager.runOnModule(ilProgram);
+	}
 	return isErroneous ? std::nullopt : std::make_optional(std::move(ilProgram));
 }
 
@@ -47,7 +51,7 @@ void ILGenerator::visit(Stmt::Function& func)
 		returnForStmt();
 	}
 	else {
-		auto body = FunctionGenerator{ env, moduleInstructions }.generate(std::move(func));
+		auto body = FunctionGenerator{ env, moduleInstructions, passManager }.generate(std::move(func));
 		std::vector<IL::UniquePtr> stmts;
 		stmts.push_back(IL::makeIL<IL::Function>(std::move(body)));
 		returnForStmt(std::move(stmts));
@@ -75,7 +79,11 @@ void ILGenerator::visit(Expr::CurrentPC& expr) {}
 void ILGenerator::visit(Expr::Register& expr) {}
 void ILGenerator::visit(Expr::Flag& expr) {}
 void ILGenerator::visit(Stmt::Module& mod) {}
-void ILGenerator::visit(Stmt::Import& imp) {}
+//the imported file is parsed into the same program, the statement itself generates nothing
+void ILGenerator::visit(Stmt::Import& imp) 
+{
+	returnForStmt({});
+}
 void ILGenerator::visit(Expr::FunctionCall& expr) {}
 void ILGenerator::visit(Expr::TemplateCall& expr) {}
 void ILGenerator::visit(Expr::Indexing& expr) {}
\ No newline at end of file
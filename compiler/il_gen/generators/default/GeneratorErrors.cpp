@@ -12,13 +12,13 @@ namespace gen
 		{
 			throw SemanticError(pos, "Expected a primitive type, but found a maybe type instead.");
 		}
-		auto primitiveType = type.type->getExactType<PrimitiveType>();
+		auto primitiveType = typesys::dyn_cast<PrimitiveType>(type.type);
 		if (!primitiveType)
 		{
 			throw SemanticError(pos, fmt::format(
 				"Expected a primitive type, "
 				"but found the following instead: {}",
-				type.type->name));
+				type.type->name()));
 		}
 		return primitiveType;
 	}
@@ -29,28 +29,28 @@ namespace gen
 		{
 			throw SemanticError(pos, "Expected a callable type, but found a maybe type instead.");
 		}
-		auto functionType = type.type->getExactType<FunctionType>();
+		auto functionType = typesys::dyn_cast<FunctionType>(type.type);
 		if (!functionType)
 		{
 			throw SemanticError(pos, fmt::format(
 				"Expected a callable type, "
 				"but found the following instead: {}",
-				type.type->name));
+				type.type->name()));
 		}
 		return functionType;
 	}
 
 	BinType::Field const& GeneratorErrors::expectMember(SourcePosition const& pos, TypeInstance const& type, std::string_view member)
 	{
-		auto* bin = type.type->getExactType<BinType>();
+		auto* bin = typesys::dyn_cast<BinType>(type.type);
 		if (!bin) {
-			throw SemanticError(pos, fmt::format("Cannot perform member access on the following type: {}", type.type->name));
+			throw SemanticError(pos, fmt::format("Cannot perform member access on the following type: {}", type.type->name()));
 		}
 		auto it = std::find_if(bin->members.begin(), bin->members.end(), [member](auto& field) {
 			return member == field.name;
 			});
 		if (it == bin->members.end()) {
-			throw SemanticError(pos, fmt::format("No member \"{}\" exists in the type: {}", member, bin->name));
+			throw SemanticError(pos, fmt::format("No member \"{}\" exists in the type: {}", member, bin->name()));
 		}
 		return *it;
 	}
@@ -71,7 +71,7 @@ namespace gen
 		if (param.type != arg.type) {
 			throw SemanticError(pos, fmt::format("Passed in an argument of: {}, however, "
 				"the function expected an argument of type: {}",
-				param.type->name, arg.type->name));
+				param.type->name(), arg.type->name()));
 		}
 		if (param.isRef && !arg.isRef) {
 			throw SemanticError(pos, "Argument passed is not a reference type");
@@ -85,35 +85,35 @@ namespace gen
 			throw SemanticError(pos, 
 				fmt::format("Cannot assign a variable of mutable "
 							"type. Occured when assigning: {}, to {}", 
-							dest.type->name, src.type->name));
+							dest.type->name(), src.type->name()));
 		}
 		if (dest.type != src.type)
 		{
 			throw SemanticError(pos, fmt::format("Cannot initialize an expression of type: {}, when "
 				"an argument of type: {}, is expected.",
-				dest.type->name, src.type->name));
+				dest.type->name(), src.type->name()));
 		}
 	}
 
 	void GeneratorErrors::assertIsCastableType(SourcePosition pos, TypeInstance src, TypeInstance cast) const
 	{
-		auto srcPrimitive = src.type->getExactType<PrimitiveType>();
-		auto castPrimitive = src.type->getExactType<PrimitiveType>();
+		auto srcPrimitive = typesys::dyn_cast<PrimitiveType>(src.type);
+		auto castPrimitive = typesys::dyn_cast<PrimitiveType>(src.type);
 		// You can only cast primitive types to one another
 		//if (!srcPrimitive || !castPrimitive)
 		{
 			//throw SemanticError(pos, fmt::format("Cannot cast an expression of type: {}, to {}.",
-				//src.type->name, cast.type->name));
+				//src.type->name(), cast.type->name()));
 		}
 	}
 
 	ListType const* GeneratorErrors::expectListType(SourcePosition const& pos, TypeInstance const& type)
 	{
-		if (auto arrayType = type.type->getExactType<ListType>()) {
+		if (auto arrayType = typesys::dyn_cast<ListType>(type.type)) {
 			return arrayType;
 		}
 		throw SemanticError(pos, 
-			fmt::format("Expected a list type, however, it recieved {} instead.", type.type->name));
+			fmt::format("Expected a list type, however, it recieved {} instead.", type.type->name()));
 	}
 
 	void GeneratorErrors::assertCorrectFunctionCall(SourcePosition pos, std::vector<TypeInstance> const& params, std::vector<TypeInstance> const& args)
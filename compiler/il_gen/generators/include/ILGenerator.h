@@ -8,6 +8,7 @@
 #include "Enviroment.h"
 #include "VectorUtil.h"
 #include "ExprStmtVisitor.h"
+#include "PassManager.h"
 
 /*Will eventually support lang features*/
 /* Error Handling:
@@ -23,12 +24,14 @@ class ILGenerator final :
 	public ExprStmtVisitor<std::vector<IL::UniquePtr>>
 {
 public:
-	ILGenerator();
+	ILGenerator(opt::PassManager passManager = {});
 	std::optional<IL::Program> generate(Stmt::Program program);
+	opt::PassManager const& passes() const { return passManager; }
 private:
 	void tryToCompile(Stmt::UniquePtr& stmt, IL::Program& out);
 
 	Enviroment env;
+	opt::PassManager passManager;
 	bool isErroneous = false;
 
 	virtual void visit(Stmt::Bin& bin) override;
@@ -66,6 +66,12 @@ namespace IL
 		return std::make_unique<T>(T{ std::forward<Args>(args)... });
 	}
 
+	// nullptr if instr is not a T
+	template<typename T>
+	T* getIf(UniquePtr const& instr) {
+		return instr->is<T>() ? static_cast<T*>(instr.get()) : nullptr;
+	}
+
 	struct Label : IL::Visitable<Label> 
 	{
 		Label(size_t name)
@@ -76,10 +82,11 @@ namespace IL
 
 	struct Phi : IL::Visitable<Phi> 
 	{
-		Phi(Variable dest, std::vector<Value> sources)
-			: dest(dest), sources(std::move(sources)) {}
+		// sources are ordered like the predecessors of the block the phi is in
+		Phi(Variable dest, Type type, std::vector<Value> sources)
+			: dest(dest, type), sources(std::move(sources)) {}
 
-		Variable dest;
+		Decl dest;
 		std::vector<Value> sources;
 	};
 
@@ -0,0 +1,116 @@
+#pragma once
+#include "IL.h"
+
+namespace IL
+{
+	/* Operand Visitor:
+		Reports every variable an instruction defines (with its type) and every variable
+		it reads. The target of an AddressOf is reported separately, since taking the
+		address of a variable lets it be read and written through memory.
+		Operands are passed by reference, so passes can rename them in place.
+		Every pass walks operands, so instructions are dispatched on their kind tag.
+	*/
+	template<typename DefCallable, typename UseCallable, typename AddressTakenCallable>
+	class OperandVisitor
+	{
+	public:
+		OperandVisitor(DefCallable onDef, UseCallable onUse, AddressTakenCallable onAddressTaken)
+			: onDef(std::move(onDef)), onUse(std::move(onUse)), onAddressTaken(std::move(onAddressTaken)) {}
+
+		void visitOperands(UniquePtr const& instr) {
+			visit::dispatch(*instr, [this](auto& concrete) { visit(concrete); });
+		}
+
+	private:
+		DefCallable onDef;
+		UseCallable onUse;
+		AddressTakenCallable onAddressTaken;
+
+		void use(Value& value) {
+			if (std::holds_alternative<Variable>(value)) onUse(std::get<Variable>(value));
+		}
+
+		void visit(Binary& expr) {
+			use(expr.lhs);
+			use(expr.rhs);
+			onDef(expr.dest.variable, expr.dest.type);
+		}
+		void visit(Unary& expr) {
+			use(expr.src);
+			onDef(expr.dest.variable, expr.dest.type);
+		}
+		void visit(Function& func) {}
+		void visit(TestBit& expr) {
+			onUse(expr.src);
+			onDef(expr.dest, Type::i1);
+		}
+		void visit(Test& expr) {
+			onUse(expr.var);
+		}
+		void visit(Phi& expr) {
+			for (auto& source : expr.sources) use(source);
+			onDef(expr.dest.variable, expr.dest.type);
+		}
+		void visit(Return& expr) {
+			if (expr.value.has_value()) use(expr.value.value());
+		}
+		void visit(Assignment& expr) {
+			use(expr.src);
+			onDef(expr.dest.variable, expr.dest.type);
+		}
+		void visit(FunctionCall& call) {
+			if (std::holds_alternative<Variable>(call.function)) onUse(std::get<Variable>(call.function));
+			for (auto& arg : call.args) use(arg);
+			onDef(call.dest.variable, call.dest.type);
+		}
+		void visit(Cast& cast) {
+			onUse(cast.src);
+			onDef(cast.dest, cast.cast);
+		}
+		void visit(Allocate& allocation) {
+			onDef(allocation.dest, Type::u8_ptr);
+		}
+		void visit(AddressOf& addressOf) {
+			if (std::holds_alternative<Variable>(addressOf.target)) onAddressTaken(std::get<Variable>(addressOf.target));
+			onDef(addressOf.ptr, Type::u8_ptr);
+		}
+		void visit(Deref& deref) {
+			onUse(deref.ptr);
+			onDef(deref.dest.variable, deref.dest.type);
+		}
+		void visit(Store& store) {
+			onUse(store.ptr);
+			onUse(store.src.variable);
+		}
+		void visit(MemCopy& copy) {
+			onUse(copy.dest);
+			onUse(copy.src);
+		}
+		void visit(Instruction& expr) {}
+		void visit(Jump& jump) {}
+		void visit(Label& label) {}
+	};
+
+	// Calls onDef(Variable&, Type), onUse(Variable&) and onAddressTaken(Variable&) for the operands of instr.
+	// Uses are always reported before the definition.
+	template<typename DefCallable, typename UseCallable, typename AddressTakenCallable>
+	void forEachOperand(UniquePtr const& instr, DefCallable onDef, UseCallable onUse, AddressTakenCallable onAddressTaken)
+	{
+		OperandVisitor<DefCallable, UseCallable, AddressTakenCallable>{
+			std::move(onDef), std::move(onUse), std::move(onAddressTaken)
+		}.visitOperands(instr);
+	}
+
+	// Address taken variables count as uses, since they may be read through memory
+	template<typename UseCallable>
+	void forEachUse(UniquePtr const& instr, UseCallable onUse)
+	{
+		forEachOperand(instr, [](Variable&, Type) {}, onUse, onUse);
+	}
+
+	template<typename DefCallable>
+	void forEachDef(UniquePtr const& instr, DefCallable onDef)
+	{
+		forEachOperand(instr, onDef, [](Variable&) {}, [](Variable&) {});
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Token.h"
+
+namespace IL
+{
+	/* Operators:
+		What passes and the backend need to know about the operator of a Binary.
+	*/
+	inline bool isCommutative(Token::Type operation)
+	{
+		switch (operation)
+		{
+		case Token::Type::PLUS: case Token::Type::STAR:
+		case Token::Type::EQUAL_EQUAL: case Token::Type::NOT_EQUAL:
+		case Token::Type::AND: case Token::Type::OR:
+		case Token::Type::BIT_AND: case Token::Type::BIT_OR: case Token::Type::BIT_XOR:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// the Z80 has no instruction to multiply or divide, these are calls of runtime helpers
+	inline bool isHelperCall(Token::Type operation)
+	{
+		return operation == Token::Type::STAR || operation == Token::Type::SLASH || operation == Token::Type::MODULO;
+	}
+}
@@ -63,7 +63,7 @@ namespace IL
 				sources += valueToString(source);
 				if (first) first = false;
 			}
-			prettyPrint("{} = phi [{}]", variableToString(expr.dest), sources);
+			prettyPrint("{} {} = phi [{}]", variableToString(expr.dest.variable), ilTypeToString(expr.dest.type), sources);
 		}
 		virtual void visit(Return& expr) override {
 			if (expr.value.has_value()) {
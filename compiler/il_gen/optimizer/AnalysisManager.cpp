@@ -0,0 +1,47 @@
+#include "AnalysisManager.h"
+
+namespace opt
+{
+	DominatorTree const& AnalysisManager::dominators()
+	{
+		if (!dominatorTree.has_value()) {
+			dominatorTree.emplace(graph.getEntryNode(), graph);
+		}
+		return dominatorTree.value();
+	}
+
+	LoopInfo const& AnalysisManager::loops()
+	{
+		if (!loopInfo.has_value()) {
+			loopInfo.emplace(graph, dominators());
+		}
+		return loopInfo.value();
+	}
+
+	BlockAssignments const& AnalysisManager::assignments()
+	{
+		if (!blockAssignments.has_value()) {
+			blockAssignments.emplace(graph);
+		}
+		return blockAssignments.value();
+	}
+
+	Liveness const& AnalysisManager::liveness()
+	{
+		if (!blockLiveness.has_value()) {
+			blockLiveness.emplace(graph, assignments());
+		}
+		return blockLiveness.value();
+	}
+
+	void AnalysisManager::invalidate(PreservedAnalyses preserved)
+	{
+		// loops are found from the dominator tree
+		if (!preserved.dominators || !preserved.loops) loopInfo.reset();
+		if (!preserved.dominators) dominatorTree.reset();
+		if (!preserved.liveness) {
+			blockLiveness.reset();
+			blockAssignments.reset();
+		}
+	}
+}
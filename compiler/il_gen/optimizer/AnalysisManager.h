@@ -0,0 +1,33 @@
+#pragma once
+#include <optional>
+#include "Pass.h"
+#include "DominatorTree.h"
+#include "LoopInfo.h"
+#include "BlockAssignments.h"
+
+namespace opt
+{
+	/* Analysis Manager:
+		Computes the analyses of one function on first use and caches them until a
+		pass reports a change that does not preserve them.
+	*/
+	class AnalysisManager
+	{
+	public:
+		AnalysisManager(ILCtrlFlowGraph const& graph)
+			: graph(graph) {}
+
+		DominatorTree const& dominators();
+		LoopInfo const& loops();
+		BlockAssignments const& assignments();
+		Liveness const& liveness();
+
+		void invalidate(PreservedAnalyses preserved);
+	private:
+		ILCtrlFlowGraph const& graph;
+		std::optional<DominatorTree> dominatorTree;
+		std::optional<LoopInfo> loopInfo;
+		std::optional<BlockAssignments> blockAssignments;
+		std::optional<Liveness> blockLiveness;
+	};
+}
@@ -0,0 +1,138 @@
+#include "Passes.h"
+#include "AnalysisManager.h"
+#include "ILOperands.h"
+
+namespace opt
+{
+	namespace
+	{
+		bool hasSideEffects(IL::UniquePtr const& instr)
+		{
+			return IL::getIf<IL::Store>(instr) || IL::getIf<IL::FunctionCall>(instr) ||
+				   IL::getIf<IL::MemCopy>(instr) || IL::getIf<IL::Return>(instr) ||
+				   IL::getIf<IL::Instruction>(instr) || IL::getIf<IL::Label>(instr) ||
+				   IL::getIf<IL::Jump>(instr) || IL::getIf<IL::Test>(instr);
+		}
+	}
+
+	/* Dead Code Elimination:
+		Mark and sweep over the instructions. Instructions with side effects, block
+		conditions, and definitions of globals or of variables whose address is taken
+		are live from the start. Every definition of a variable that a live instruction
+		reads is live as well, the rest is removed.
+		Branches are never removed, only the instructions inside blocks.
+	*/
+	class DeadCodeEliminator
+	{
+		struct Location
+		{
+			size_t block, index;
+		};
+	public:
+		DeadCodeEliminator(ILCtrlFlowGraph& graph, BlockAssignments const& assignments)
+			: graph(graph), assignments(assignments), live(graph.nodeCount())
+		{
+			for (size_t block = 0; block < graph.nodeCount(); ++block) {
+				live[block].resize(graph.nodeData(block).body.size());
+			}
+		}
+
+		bool run()
+		{
+			collectDefinitions();
+			markRoots();
+			while (!worklist.empty())
+			{
+				auto [block, index] = worklist.back(); worklist.pop_back();
+				IL::forEachUse(graph.nodeData(block).body[index], [&](IL::Variable& var) { markDefinitions(var); });
+			}
+			return sweep();
+		}
+
+	private:
+		ILCtrlFlowGraph& graph;
+		BlockAssignments const& assignments;
+		std::vector<std::vector<bool>> live;
+		std::vector<std::vector<Location>> definitions;
+		std::vector<bool> markedVariables;
+		std::vector<Location> worklist;
+
+		void collectDefinitions()
+		{
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& body = graph.nodeData(block).body;
+				for (size_t index = 0; index < body.size(); ++index)
+				{
+					IL::forEachDef(body[index], [&](IL::Variable& var, IL::Type) {
+						if (var.is_global) return;
+						if (var.id >= definitions.size()) definitions.resize(var.id + 1);
+						definitions[var.id].push_back(Location{ block, index });
+					});
+				}
+			}
+			markedVariables.resize(definitions.size());
+		}
+
+		void markLive(Location location)
+		{
+			if (live[location.block][location.index]) return;
+			live[location.block][location.index] = true;
+			worklist.push_back(location);
+		}
+
+		void markDefinitions(IL::Variable const& var)
+		{
+			if (var.is_global || var.id >= definitions.size() || markedVariables[var.id]) return;
+			markedVariables[var.id] = true;
+			for (auto location : definitions[var.id]) markLive(location);
+		}
+
+		void markRoots()
+		{
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& data = graph.nodeData(block);
+				for (size_t index = 0; index < data.body.size(); ++index)
+				{
+					bool observable = hasSideEffects(data.body[index]);
+					IL::forEachDef(data.body[index], [&](IL::Variable& var, IL::Type) {
+						observable |= var.is_global || assignments.addressTaken().contains(var.id);
+					});
+					if (observable) markLive(Location{ block, index });
+				}
+				if (data.splits()) markDefinitions(data.splitsOn());
+			}
+		}
+
+		bool sweep()
+		{
+			bool changed = false;
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& body = graph.nodeData(block).body;
+				size_t kept = 0;
+				for (size_t index = 0; index < body.size(); ++index) {
+					if (live[block][index]) body[kept++] = std::move(body[index]);
+				}
+				changed |= kept != body.size();
+				body.resize(kept);
+			}
+			return changed;
+		}
+	};
+
+	class DCEPass : public FunctionPass
+	{
+	public:
+		virtual std::string_view name() const override { return "dce"; }
+		virtual PreservedAnalyses preserved() const override { return PreservedAnalyses::controlFlow(); }
+
+		virtual bool run(FunctionContext& function, AnalysisManager& analyses) override
+		{
+			return DeadCodeEliminator{ function.graph, analyses.assignments() }.run();
+		}
+	};
+
+	std::unique_ptr<FunctionPass> createDCEPass() { return std::make_unique<DCEPass>(); }
+}
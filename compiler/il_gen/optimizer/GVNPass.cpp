@@ -0,0 +1,344 @@
+#include "Passes.h"
+#include "AnalysisManager.h"
+#include "ILOperands.h"
+#include "ILOperators.h"
+#include <unordered_map>
+
+namespace opt
+{
+	namespace
+	{
+		// a PC operand is stored as monostate, every PC is the same operand
+		using Operand = std::variant<IL::Variable, std::string, int, std::monostate>;
+
+		struct ExpressionKey
+		{
+			enum class Kind : unsigned char {
+				BINARY, UNARY, CAST, TEST_BIT, ADDRESS_OF, DEREF, PHI
+			};
+
+			Kind kind = Kind::BINARY;
+			Token::Type operation = Token::Type::NONE; // only for binary and unary
+			IL::Type type = IL::Type::void_;
+			size_t extra = 0; // the tested bit, the memory version of a deref or the block of a phi
+			std::vector<Operand> operands;
+
+			bool operator==(ExpressionKey const& other) const = default;
+		};
+
+		struct ExpressionKeyHash
+		{
+			size_t operator()(ExpressionKey const& key) const
+			{
+				size_t hash = size_t(key.kind);
+				auto combine = [&](size_t value) { hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2); };
+				combine(size_t(key.operation));
+				combine(size_t(key.type));
+				combine(key.extra);
+				for (auto& operand : key.operands) combine(std::hash<Operand>{}(operand));
+				return hash;
+			}
+		};
+
+		// any fixed order will do, it only has to put the operands of a commutative operator in one order
+		bool operandLess(Operand const& lhs, Operand const& rhs)
+		{
+			if (lhs.index() != rhs.index()) return lhs.index() < rhs.index();
+			if (auto var = std::get_if<IL::Variable>(&lhs)) {
+				auto other = std::get<IL::Variable>(rhs);
+				return std::pair(var->is_global, var->id) < std::pair(other.is_global, other.id);
+			}
+			if (auto name = std::get_if<std::string>(&lhs)) return *name < std::get<std::string>(rhs);
+			if (auto value = std::get_if<int>(&lhs)) return *value < std::get<int>(rhs);
+			return false;
+		}
+
+	}
+
+	/* Global Value Numbering:
+		Dominator based value numbering (Briggs, Cooper and Simpson). The dominator tree is
+		walked in preorder with a scoped table from (opcode, operand value numbers, type) to
+		the variable that first computed it, so a hit is always defined on every path to
+		the redundant instruction, which then becomes a copy of it. Afterwards every use is
+		rewritten to the leader of its value, leaving the copies to dead code elimination.
+
+		A deref is only redundant while memory has not changed. The memory version carries
+		into a block when its only predecessor is its immediate dominator, any join starts
+		a new one. Variables with several definitions or whose address is taken keep their
+		own value number and expressions using them are never hashed.
+	*/
+	class ValueNumberer
+	{
+	public:
+		ValueNumberer(ILCtrlFlowGraph& graph, DominatorTree const& tree, BlockAssignments const& assignments)
+			: graph(graph), tree(tree), assignments(assignments), endMemoryVersion(graph.nodeCount())
+		{
+			collectSSAVariables();
+		}
+
+		bool run()
+		{
+			std::vector<std::pair<size_t, size_t>> walk; // block, next child index
+			std::vector<std::vector<ExpressionKey>> inserted(graph.nodeCount());
+			walk.emplace_back(tree.root(), 0);
+			numberBlock(tree.root(), inserted[tree.root()]);
+			while (!walk.empty())
+			{
+				auto& [block, childIndex] = walk.back();
+				auto children = tree.children(block);
+				if (childIndex == children.size())
+				{
+					for (auto& key : inserted[block]) table.erase(key);
+					walk.pop_back();
+					continue;
+				}
+				size_t child = children[childIndex++];
+				numberBlock(child, inserted[child]);
+				walk.emplace_back(child, 0);
+			}
+			return replaceUses() || changed;
+		}
+
+	private:
+		ILCtrlFlowGraph& graph;
+		DominatorTree const& tree;
+		BlockAssignments const& assignments;
+		std::vector<IL::Variable> leaders;
+		std::vector<bool> isSSA;
+		std::unordered_map<ExpressionKey, IL::Variable, ExpressionKeyHash> table;
+		std::vector<size_t> endMemoryVersion;
+		size_t memoryVersions = 0;
+		bool changed = false;
+
+		void collectSSAVariables()
+		{
+			std::vector<size_t> defCounts;
+			auto grow = [&](IL::Variable const& var) {
+				if (var.id >= defCounts.size()) defCounts.resize(var.id + 1);
+			};
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& data = graph.nodeData(block);
+				for (auto& instr : data.body)
+				{
+					IL::forEachOperand(instr,
+						[&](IL::Variable& var, IL::Type) { grow(var); defCounts[var.id]++; },
+						[&](IL::Variable& var) { grow(var); },
+						[&](IL::Variable& var) { grow(var); }
+					);
+				}
+				if (data.splits()) grow(data.splitsOn());
+			}
+			isSSA.resize(defCounts.size());
+			for (size_t id = 0; id < defCounts.size(); ++id)
+			{
+				leaders.emplace_back(id);
+				isSSA[id] = defCounts[id] <= 1 && !assignments.addressTaken().contains(id);
+			}
+		}
+
+		bool isNumbered(IL::Variable const& var) const
+		{
+			return !var.is_global && var.id < isSSA.size() && isSSA[var.id];
+		}
+
+		IL::Variable leaderOf(IL::Variable const& var) const
+		{
+			return isNumbered(var) ? leaders[var.id] : var;
+		}
+
+		std::optional<Operand> operandOf(IL::Value const& value) const
+		{
+			return std::visit([&](auto const& value) -> std::optional<Operand> {
+				using T = std::decay_t<decltype(value)>;
+				if constexpr (std::is_same_v<T, IL::Variable>) {
+					if (!isNumbered(value)) return std::nullopt;
+					return Operand(leaderOf(value));
+				}
+				else if constexpr (std::is_same_v<T, IL::PC>) return Operand(std::monostate{});
+				else return Operand(value);
+			}, value);
+		}
+
+		std::optional<ExpressionKey> keyOf(IL::UniquePtr const& instr, size_t block, size_t memoryVersion) const
+		{
+			using Kind = ExpressionKey::Kind;
+			std::vector<IL::Value> operands;
+			ExpressionKey key;
+			if (auto binary = IL::getIf<IL::Binary>(instr)) {
+				key = { .kind = Kind::BINARY, .operation = binary->operation, .type = binary->dest.type };
+				operands = { binary->lhs, binary->rhs };
+			}
+			else if (auto unary = IL::getIf<IL::Unary>(instr)) {
+				key = { .kind = Kind::UNARY, .operation = unary->operation, .type = unary->dest.type };
+				operands = { unary->src };
+			}
+			else if (auto cast = IL::getIf<IL::Cast>(instr)) {
+				key = { .kind = Kind::CAST, .type = cast->cast };
+				operands = { cast->src };
+			}
+			else if (auto testBit = IL::getIf<IL::TestBit>(instr)) {
+				key = { .kind = Kind::TEST_BIT, .type = IL::Type::i1, .extra = testBit->bit };
+				operands = { testBit->src };
+			}
+			else if (auto deref = IL::getIf<IL::Deref>(instr)) {
+				key = { .kind = Kind::DEREF, .type = deref->dest.type, .extra = memoryVersion };
+				operands = { deref->ptr };
+			}
+			else if (auto phi = IL::getIf<IL::Phi>(instr)) {
+				key = { .kind = Kind::PHI, .type = phi->dest.type, .extra = block };
+				operands = phi->sources;
+			}
+			else if (auto addressOf = IL::getIf<IL::AddressOf>(instr)) {
+				// the address of a variable never changes, even though its value might
+				key = { .kind = Kind::ADDRESS_OF, .type = IL::Type::u8_ptr };
+				if (auto function = std::get_if<IL::AddressOf::Function>(&addressOf->target)) {
+					key.operands.emplace_back(std::string(function->name));
+				}
+				else {
+					key.operands.emplace_back(std::get<IL::Variable>(addressOf->target));
+				}
+				return key;
+			}
+			else return std::nullopt;
+
+			for (auto& value : operands)
+			{
+				auto operand = operandOf(value);
+				if (!operand.has_value()) return std::nullopt;
+				key.operands.push_back(std::move(operand.value()));
+			}
+			if (key.kind == Kind::BINARY && IL::isCommutative(key.operation) && operandLess(key.operands[1], key.operands[0])) {
+				std::swap(key.operands[0], key.operands[1]);
+			}
+			return key;
+		}
+
+		// a phi whose sources all share one value (ignoring itself) is that value
+		std::optional<IL::Variable> trivialPhiValue(IL::Phi const& phi) const
+		{
+			std::optional<IL::Variable> same;
+			for (auto& source : phi.sources)
+			{
+				auto var = std::get_if<IL::Variable>(&source);
+				if (!var || !isNumbered(*var)) return std::nullopt;
+				IL::Variable leader = leaderOf(*var);
+				if (leader == phi.dest.variable) continue;
+				if (same.has_value() && !(same.value() == leader)) return std::nullopt;
+				same = leader;
+			}
+			return same;
+		}
+
+		// anything that may write memory starts a new memory version, that includes defining
+		// a variable a pointer may point at, which DCE keeps as observable for the same reason
+		bool writesMemory(IL::UniquePtr const& instr) const
+		{
+			if (IL::getIf<IL::Store>(instr) || IL::getIf<IL::MemCopy>(instr) ||
+				IL::getIf<IL::FunctionCall>(instr) || IL::getIf<IL::Instruction>(instr)) return true;
+			bool inMemory = false;
+			IL::forEachDef(instr, [&](IL::Variable& var, IL::Type) {
+				inMemory |= var.is_global || assignments.addressTaken().contains(var.id);
+			});
+			return inMemory;
+		}
+
+		size_t startMemoryVersion(size_t block)
+		{
+			auto preds = graph.in(block);
+			size_t idom = tree.immediateDominator(block);
+			if (preds.size() == 1 && preds.front() == idom) return endMemoryVersion[idom];
+			return ++memoryVersions;
+		}
+
+		void numberBlock(size_t block, std::vector<ExpressionKey>& inserted)
+		{
+			size_t memoryVersion = startMemoryVersion(block);
+			for (auto& instr : graph.nodeData(block).body)
+			{
+				if (writesMemory(instr))
+				{
+					memoryVersion = ++memoryVersions;
+					continue;
+				}
+				std::optional<IL::Decl> dest = destinationOf(instr);
+				if (!dest.has_value() || !isNumbered(dest->variable)) continue;
+
+				if (auto copy = IL::getIf<IL::Assignment>(instr))
+				{
+					// a copy between variables of the same type shares the value of its source
+					auto src = std::get_if<IL::Variable>(&copy->src);
+					if (src && isNumbered(*src) && assignments.typeOf(src->id) == dest->type) {
+						leaders[dest->variable.id] = leaderOf(*src);
+					}
+					continue;
+				}
+				if (auto phi = IL::getIf<IL::Phi>(instr))
+				{
+					if (auto value = trivialPhiValue(*phi)) {
+						leaders[dest->variable.id] = value.value();
+						continue;
+					}
+				}
+
+				auto key = keyOf(instr, block, memoryVersion);
+				if (!key.has_value()) continue;
+				auto found = table.find(key.value());
+				if (found == table.end())
+				{
+					table.emplace(key.value(), dest->variable);
+					inserted.push_back(std::move(key.value()));
+					continue;
+				}
+				leaders[dest->variable.id] = found->second;
+				// phis have to stay at the start of the block, so a redundant phi is only renamed away
+				if (!IL::getIf<IL::Phi>(instr)) {
+					instr = IL::makeIL<IL::Assignment>(dest->variable, dest->type, found->second);
+				}
+				changed = true;
+			}
+			endMemoryVersion[block] = memoryVersion;
+		}
+
+		static std::optional<IL::Decl> destinationOf(IL::UniquePtr const& instr)
+		{
+			std::optional<IL::Decl> dest;
+			IL::forEachDef(instr, [&](IL::Variable& var, IL::Type type) { dest = IL::Decl(var, type); });
+			return dest;
+		}
+
+		bool replaceUses()
+		{
+			bool replaced = false;
+			auto replace = [&](IL::Variable& var) {
+				IL::Variable leader = leaderOf(var);
+				if (leader == var) return;
+				var = leader;
+				replaced = true;
+			};
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& data = graph.nodeData(block);
+				for (auto& instr : data.body) {
+					IL::forEachOperand(instr, [](IL::Variable&, IL::Type) {}, replace, [](IL::Variable&) {});
+				}
+				if (data.splits()) replace(data.splitsOn());
+			}
+			return replaced;
+		}
+	};
+
+	class GVNPass : public FunctionPass
+	{
+	public:
+		virtual std::string_view name() const override { return "gvn"; }
+		virtual PreservedAnalyses preserved() const override { return PreservedAnalyses::controlFlow(); }
+
+		virtual bool run(FunctionContext& function, AnalysisManager& analyses) override
+		{
+			return ValueNumberer{ function.graph, analyses.dominators(), analyses.assignments() }.run();
+		}
+	};
+
+	std::unique_ptr<FunctionPass> createGVNPass() { return std::make_unique<GVNPass>(); }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string_view>
+#include "CtrlFlowGraph.h"
+
+namespace opt
+{
+	class AnalysisManager;
+
+	// What a function pass works on
+	struct FunctionContext
+	{
+		std::string_view name;
+		ILCtrlFlowGraph& graph;
+		// new variables have to be registered with the enviroment, so passes create them through here
+		VersionCreator createVariable;
+	};
+
+	// Analyses that are still valid after a pass changed the function
+	struct PreservedAnalyses
+	{
+		static PreservedAnalyses none() { return {}; }
+		static PreservedAnalyses all() { return { true, true, true }; }
+		// only instructions were changed, not the shape of the graph
+		static PreservedAnalyses controlFlow() { return { true, false, true }; }
+
+		bool dominators = false, liveness = false, loops = false;
+	};
+
+	class FunctionPass
+	{
+	public:
+		virtual ~FunctionPass() = default;
+
+		virtual std::string_view name() const = 0;
+		// returns whether the function was changed
+		virtual bool run(FunctionContext& function, AnalysisManager& analyses) = 0;
+		virtual PreservedAnalyses preserved() const { return PreservedAnalyses::none(); }
+	};
+
+	class ModulePass
+	{
+	public:
+		virtual ~ModulePass() = default;
+
+		virtual std::string_view name() const = 0;
+		// returns whether the module was changed
+		virtual bool run(IL::Program& module) = 0;
+	};
+}
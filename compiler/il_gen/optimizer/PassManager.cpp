@@ -0,0 +1,80 @@
+#include "PassManager.h"
+#include "AnalysisManager.h"
+
+namespace opt
+{
+	std::optional<PassManager> PassManager::fromPipeline(std::string_view pipeline, PassRegistry const& registry)
+	{
+		auto passNames = namedPipeline(pipeline);
+		if (!passNames.has_value()) return std::nullopt;
+
+		PassManager manager;
+		manager.forSize = opt::optimizesForSize(pipeline);
+		for (std::string_view passName : passNames.value())
+		{
+			if (auto functionPass = registry.createFunctionPass(passName)) {
+				manager.addFunctionPass(std::move(functionPass));
+			}
+			else if (auto modulePass = registry.createModulePass(passName)) {
+				manager.addModulePass(std::move(modulePass));
+			}
+			else {
+				COMPILER_ASSERT("Pipelines must only name registered passes", false);
+			}
+		}
+		return std::make_optional(std::move(manager));
+	}
+
+	void PassManager::addFunctionPass(std::unique_ptr<FunctionPass> pass)
+	{
+		functionTimings.push_back(PassTiming{ pass->name() });
+		functionPasses.push_back(std::move(pass));
+	}
+
+	void PassManager::addModulePass(std::unique_ptr<ModulePass> pass)
+	{
+		moduleTimings.push_back(PassTiming{ pass->name() });
+		modulePasses.push_back(std::move(pass));
+	}
+
+	template<typename Callable>
+	bool PassManager::timePass(PassTiming& timing, Callable runPass)
+	{
+		auto start = std::chrono::steady_clock::now();
+		bool changed = runPass();
+		timing.total += std::chrono::steady_clock::now() - start;
+		timing.runs++;
+		if (changed) timing.changes++;
+		return changed;
+	}
+
+	void PassManager::runOnFunction(FunctionContext& function)
+	{
+		AnalysisManager analyses{ function.graph };
+		for (size_t i = 0; i < functionPasses.size(); ++i)
+		{
+			auto& pass = functionPasses[i];
+			bool changed = timePass(functionTimings[i], [&]() {
+				return pass->run(function, analyses);
+			});
+			if (changed) analyses.invalidate(pass->preserved());
+		}
+	}
+
+	void PassManager::runOnModule(IL::Program& module)
+	{
+		for (size_t i = 0; i < modulePasses.size(); ++i)
+		{
+			timePass(moduleTimings[i], [&]() {
+				return modulePasses[i]->run(module);
+			});
+		}
+	}
+
+	std::vector<PassTiming> PassManager::timings() const
+	{
+		std::vector<PassTiming> all = functionTimings;
+		all.insert(all.end(), moduleTimings.begin(), moduleTimings.end());
+		return all;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <memory>
+#include <chrono>
+#include <vector>
+#include <optional>
+#include "Pass.h"
+#include "PassRegistry.h"
+
+namespace opt
+{
+	struct PassTiming
+	{
+		std::string_view name;
+		std::chrono::nanoseconds total{ 0 };
+		size_t runs = 0, changes = 0;
+	};
+
+	/* Pass Manager:
+		Runs function passes over every function, in the order they were added,
+		sharing one AnalysisManager per function. Module passes run once over the
+		whole program after all functions were generated. An empty manager is -O0.
+	*/
+	class PassManager
+	{
+	public:
+		PassManager() = default;
+		// nullopt when there is no pipeline with that name
+		static std::optional<PassManager> fromPipeline(std::string_view pipeline, PassRegistry const& registry = PassRegistry::builtin());
+
+		void addFunctionPass(std::unique_ptr<FunctionPass> pass);
+		void addModulePass(std::unique_ptr<ModulePass> pass);
+
+		void runOnFunction(FunctionContext& function);
+		void runOnModule(IL::Program& module);
+
+		// function passes first, then module passes, each in the order they run
+		std::vector<PassTiming> timings() const;
+		// set by the pipeline, the backend selects instructions by size instead of speed
+		bool optimizesForSize() const { return forSize; }
+	private:
+		template<typename Callable>
+		bool timePass(PassTiming& timing, Callable runPass);
+
+		std::vector<std::unique_ptr<FunctionPass>> functionPasses;
+		std::vector<std::unique_ptr<ModulePass>> modulePasses;
+		std::vector<PassTiming> functionTimings, moduleTimings;
+		bool forSize = false;
+	};
+}
@@ -0,0 +1,60 @@
+#include "PassRegistry.h"
+#include "Passes.h"
+
+namespace opt
+{
+	PassRegistry const& PassRegistry::builtin()
+	{
+		static PassRegistry const registry = []() {
+			PassRegistry registry;
+			registry.registerFunctionPass("build-ssa", createBuildSSAPass);
+			registry.registerFunctionPass("destroy-ssa", createDestroySSAPass);
+			registry.registerFunctionPass("sccp", createSCCPPass);
+			registry.registerFunctionPass("gvn", createGVNPass);
+			registry.registerFunctionPass("dce", createDCEPass);
+			registry.registerFunctionPass("simplify-cfg", createSimplifyCFGPass);
+			return registry;
+		}();
+		return registry;
+	}
+
+	void PassRegistry::registerFunctionPass(std::string_view name, FunctionPassFactory factory)
+	{
+		functionPasses.insert_or_assign(name, std::move(factory));
+	}
+
+	void PassRegistry::registerModulePass(std::string_view name, ModulePassFactory factory)
+	{
+		modulePasses.insert_or_assign(name, std::move(factory));
+	}
+
+	std::unique_ptr<FunctionPass> PassRegistry::createFunctionPass(std::string_view name) const
+	{
+		auto it = functionPasses.find(name);
+		return it == functionPasses.end() ? nullptr : it->second();
+	}
+
+	std::unique_ptr<ModulePass> PassRegistry::createModulePass(std::string_view name) const
+	{
+		auto it = modulePasses.find(name);
+		return it == modulePasses.end() ? nullptr : it->second();
+	}
+
+	std::optional<std::vector<std::string_view>> namedPipeline(std::string_view name)
+	{
+		if (name == "-O0") return std::vector<std::string_view>{};
+		// one round of the cheap passes
+		if (name == "-O1") return std::vector<std::string_view>{ "build-ssa", "sccp", "dce", "simplify-cfg", "destroy-ssa" };
+		// merged blocks and removed edges can make more constants, so the cleanup runs again
+		if (name == "-O2") return std::vector<std::string_view>{ "build-ssa", "sccp", "gvn", "dce", "simplify-cfg", "sccp", "gvn", "dce", "simplify-cfg", "destroy-ssa" };
+		// -O2 without GVN, a reused value stays live up to its last use and with the Z80's few
+		// registers that costs more bytes in spills and pushes than the recomputation it saves
+		if (name == "-Os") return std::vector<std::string_view>{ "build-ssa", "sccp", "dce", "simplify-cfg", "sccp", "dce", "simplify-cfg", "destroy-ssa" };
+		return std::nullopt;
+	}
+
+	bool optimizesForSize(std::string_view name)
+	{
+		return name == "-Os";
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include "Pass.h"
+
+namespace opt
+{
+	using FunctionPassFactory = std::function<std::unique_ptr<FunctionPass>()>;
+	using ModulePassFactory = std::function<std::unique_ptr<ModulePass>()>;
+
+	// Passes by name, so pipelines can be described as lists of names
+	class PassRegistry
+	{
+	public:
+		// every pass that ships with the compiler
+		static PassRegistry const& builtin();
+
+		void registerFunctionPass(std::string_view name, FunctionPassFactory factory);
+		void registerModulePass(std::string_view name, ModulePassFactory factory);
+
+		// nullptr when no pass of that kind has the name
+		std::unique_ptr<FunctionPass> createFunctionPass(std::string_view name) const;
+		std::unique_ptr<ModulePass> createModulePass(std::string_view name) const;
+	private:
+		std::unordered_map<std::string_view, FunctionPassFactory> functionPasses;
+		std::unordered_map<std::string_view, ModulePassFactory> modulePasses;
+	};
+
+	// pass names of -O0, -O1, -O2 and -Os, nullopt for any other name
+	std::optional<std::vector<std::string_view>> namedPipeline(std::string_view name);
+	// whether the named pipeline wants the smallest code rather than the fastest, only -Os does
+	bool optimizesForSize(std::string_view name);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <memory>
+#include "Pass.h"
+
+// Builtin passes, see PassRegistry.cpp for their names
+namespace opt
+{
+	std::unique_ptr<FunctionPass> createBuildSSAPass();
+	std::unique_ptr<FunctionPass> createDestroySSAPass();
+	std::unique_ptr<FunctionPass> createSCCPPass();
+	std::unique_ptr<FunctionPass> createGVNPass();
+	std::unique_ptr<FunctionPass> createDCEPass();
+	std::unique_ptr<FunctionPass> createSimplifyCFGPass();
+}
@@ -0,0 +1,440 @@
+#include "Passes.h"
+#include "AnalysisManager.h"
+#include "ILOperands.h"
+#include <algorithm>
+
+namespace opt
+{
+	namespace
+	{
+		struct LatticeValue
+		{
+			enum class State { TOP, CONSTANT, BOTTOM };
+
+			static LatticeValue top() { return { State::TOP }; }
+			static LatticeValue constant(int value) { return { State::CONSTANT, value }; }
+			static LatticeValue bottom() { return { State::BOTTOM }; }
+
+			bool isTop() const { return state == State::TOP; }
+			bool isConstant() const { return state == State::CONSTANT; }
+			bool isBottom() const { return state == State::BOTTOM; }
+			bool operator==(LatticeValue const& other) const {
+				return state == other.state && (state != State::CONSTANT || value == other.value);
+			}
+
+			State state;
+			int value = 0;
+		};
+
+		LatticeValue meet(LatticeValue lhs, LatticeValue rhs)
+		{
+			if (lhs.isTop()) return rhs;
+			if (rhs.isTop() || lhs == rhs) return lhs;
+			return LatticeValue::bottom();
+		}
+
+		// the value as it is stored in a variable of the type, signed types are sign extended
+		std::optional<int> wrapToType(long long value, IL::Type type)
+		{
+			size_t bits = IL::ilTypeBitSize(type);
+			if (bits == 0) return std::nullopt;
+			long long wrapped = value & ((1LL << bits) - 1);
+			if (bits > 1 && !IL::isIlTypeUnsigned(type) && (wrapped >> (bits - 1)) != 0) {
+				wrapped -= 1LL << bits;
+			}
+			return int(wrapped);
+		}
+
+		std::optional<long long> foldBinary(Token::Type operation, long long lhs, long long rhs)
+		{
+			switch (operation)
+			{
+			case Token::Type::PLUS: return lhs + rhs;
+			case Token::Type::MINUS: return lhs - rhs;
+			case Token::Type::STAR: return lhs * rhs;
+			case Token::Type::SLASH: return rhs == 0 ? std::nullopt : std::optional(lhs / rhs);
+			case Token::Type::MODULO: return rhs == 0 ? std::nullopt : std::optional(lhs % rhs);
+			case Token::Type::EQUAL_EQUAL: return lhs == rhs;
+			case Token::Type::NOT_EQUAL: return lhs != rhs;
+			case Token::Type::LESS: return lhs < rhs;
+			case Token::Type::LESS_EQUAL: return lhs <= rhs;
+			case Token::Type::GREATER: return lhs > rhs;
+			case Token::Type::GREATER_EQUAL: return lhs >= rhs;
+			case Token::Type::AND: return lhs != 0 && rhs != 0;
+			case Token::Type::OR: return lhs != 0 || rhs != 0;
+			case Token::Type::BIT_AND: return lhs & rhs;
+			case Token::Type::BIT_OR: return lhs | rhs;
+			case Token::Type::BIT_XOR: return lhs ^ rhs;
+			case Token::Type::SHIFT_LEFT: return rhs < 0 || rhs > 31 ? std::nullopt : std::optional(lhs << rhs);
+			case Token::Type::SHIFT_RIGHT: return rhs < 0 || rhs > 31 ? std::nullopt : std::optional(lhs >> rhs);
+			default: return std::nullopt;
+			}
+		}
+
+		std::optional<long long> foldUnary(Token::Type operation, long long src)
+		{
+			switch (operation)
+			{
+			case Token::Type::PLUS: return src;
+			case Token::Type::MINUS: return -src;
+			case Token::Type::BANG: return src == 0;
+			case Token::Type::BIT_NOT: return ~src;
+			default: return std::nullopt;
+			}
+		}
+	}
+
+	/* Sparse Conditional Constant Propagation:
+		Wegman and Zadeck's algorithm. Every SSA variable starts out unknown and is
+		lowered to a constant or to overdefined, values only flow along edges found to be
+		executable, so a branch that is never taken does not spoil the phis it feeds.
+		Variables with more than one definition or whose address is taken are overdefined.
+
+		Afterwards constant definitions become assignments of the constant, constant uses
+		are replaced where an operand can hold an int, tests of a constant lose the untaken
+		edge, and blocks that never execute are emptied and cut out of the graph.
+	*/
+	class ConstantPropagator
+	{
+		static constexpr size_t SPLIT = std::numeric_limits<size_t>::max();
+		struct Use
+		{
+			size_t block, index; // index is SPLIT for the condition of the block
+		};
+	public:
+		ConstantPropagator(ILCtrlFlowGraph& graph)
+			: graph(graph), executableBlocks(graph.nodeCount()), executableEdges(graph.nodeCount())
+		{
+			for (size_t block = 0; block < graph.nodeCount(); ++block) {
+				executableEdges[block].resize(graph.successorCount(block));
+			}
+			collectDefsAndUses();
+		}
+
+		void propagate()
+		{
+			executableBlocks[graph.getEntryNode()] = true;
+			visitBlock(graph.getEntryNode());
+			while (!edgeWorklist.empty() || !variableWorklist.empty())
+			{
+				while (!edgeWorklist.empty())
+				{
+					auto [src, dst] = edgeWorklist.back(); edgeWorklist.pop_back();
+					if (!executableBlocks[dst]) {
+						executableBlocks[dst] = true;
+						visitBlock(dst);
+					}
+					else {
+						visitPhis(dst);
+					}
+				}
+				while (!variableWorklist.empty())
+				{
+					size_t id = variableWorklist.back(); variableWorklist.pop_back();
+					for (auto [block, index] : uses[id])
+					{
+						if (!executableBlocks[block]) continue;
+						if (index == SPLIT) visitSplit(block);
+						else visitInstruction(block, index);
+					}
+				}
+			}
+		}
+
+		bool rewrite()
+		{
+			bool changed = false;
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				if (!executableBlocks[block]) continue;
+				auto& body = graph.nodeData(block).body;
+				//a constant phi becomes a copy after the last phi, the phis have to lead the block
+				IL::Program copies;
+				std::erase_if(body, [&](IL::UniquePtr const& instr) {
+					auto phi = IL::getIf<IL::Phi>(instr);
+					if (!phi || !valueOf(phi->dest.variable).isConstant()) return false;
+					copies.push_back(IL::makeIL<IL::Assignment>(phi->dest.variable, phi->dest.type, valueOf(phi->dest.variable).value));
+					return true;
+				});
+				for (auto& instr : body) {
+					changed |= rewriteInstruction(instr);
+				}
+				auto firstNonPhi = std::find_if(body.begin(), body.end(), [](IL::UniquePtr const& instr) { return !instr->is<IL::Phi>(); });
+				body.insert(firstNonPhi, std::make_move_iterator(copies.begin()), std::make_move_iterator(copies.end()));
+				changed |= !copies.empty();
+			}
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& data = graph.nodeData(block);
+				if (!executableBlocks[block])
+				{
+					if (block == graph.getExitNode()) continue;
+					changed |= !data.body.empty() || graph.successorCount(block) != 0;
+					while (graph.successorCount(block) != 0) {
+						removeILEdge(graph, block, graph.out(block).front());
+					}
+					data.body.clear();
+					data.removeSplit();
+				}
+				else if (data.splits() && valueOf(data.splitsOn()).isConstant())
+				{
+					size_t untaken = valueOf(data.splitsOn()).value != 0 ?
+						graph.getFalseSuccessor(block) : graph.getTrueSuccessor(block);
+					removeILEdge(graph, block, untaken);
+					data.removeSplit();
+					changed = true;
+				}
+			}
+			return changed;
+		}
+
+	private:
+		ILCtrlFlowGraph& graph;
+		std::vector<LatticeValue> values;
+		std::vector<std::vector<Use>> uses;
+		std::vector<bool> executableBlocks;
+		std::vector<std::vector<bool>> executableEdges; // parallel to graph.out(block)
+		std::vector<std::pair<size_t, size_t>> edgeWorklist;
+		std::vector<size_t> variableWorklist;
+
+		void collectDefsAndUses()
+		{
+			std::vector<size_t> defCounts;
+			std::vector<bool> addressTaken;
+			auto grow = [&](IL::Variable const& var) {
+				if (var.id >= defCounts.size()) {
+					defCounts.resize(var.id + 1);
+					addressTaken.resize(var.id + 1);
+					uses.resize(var.id + 1);
+				}
+			};
+			auto addUse = [&](IL::Variable const& var, size_t block, size_t index) {
+				if (var.is_global) return;
+				grow(var);
+				uses[var.id].push_back(Use{ block, index });
+			};
+			for (size_t block = 0; block < graph.nodeCount(); ++block)
+			{
+				auto& data = graph.nodeData(block);
+				for (size_t index = 0; index < data.body.size(); ++index)
+				{
+					IL::forEachOperand(data.body[index],
+						[&](IL::Variable& var, IL::Type) {
+							if (var.is_global) return;
+							grow(var);
+							defCounts[var.id]++;
+						},
+						[&](IL::Variable& var) { addUse(var, block, index); },
+						[&](IL::Variable& var) {
+							if (var.is_global) return;
+							grow(var);
+							addressTaken[var.id] = true;
+						}
+					);
+				}
+				if (data.splits()) addUse(data.splitsOn(), block, SPLIT);
+			}
+			// variables defined before the graph (parameters) are overdefined as well
+			values.resize(defCounts.size(), LatticeValue::bottom());
+			for (size_t id = 0; id < values.size(); ++id) {
+				if (defCounts[id] == 1 && !addressTaken[id]) values[id] = LatticeValue::top();
+			}
+		}
+
+		LatticeValue valueOf(IL::Variable const& var) const
+		{
+			if (var.is_global || var.id >= values.size()) return LatticeValue::bottom();
+			return values[var.id];
+		}
+
+		LatticeValue valueOf(IL::Value const& value) const
+		{
+			if (auto var = std::get_if<IL::Variable>(&value)) return valueOf(*var);
+			if (auto constant = std::get_if<int>(&value)) return LatticeValue::constant(*constant);
+			return LatticeValue::bottom();
+		}
+
+		void lower(IL::Variable const& var, LatticeValue value)
+		{
+			if (var.is_global || var.id >= values.size()) return;
+			LatticeValue lowered = meet(values[var.id], value);
+			if (lowered == values[var.id]) return;
+			values[var.id] = lowered;
+			variableWorklist.push_back(var.id);
+		}
+
+		void markEdge(size_t src, size_t successorIndex)
+		{
+			if (executableEdges[src][successorIndex]) return;
+			executableEdges[src][successorIndex] = true;
+			edgeWorklist.emplace_back(src, graph.out(src)[successorIndex]);
+		}
+
+		bool isExecutable(size_t src, size_t dst) const
+		{
+			auto succs = graph.out(src);
+			size_t successorIndex = std::lower_bound(succs.begin(), succs.end(), dst) - succs.begin();
+			return executableEdges[src][successorIndex];
+		}
+
+		void visitBlock(size_t block)
+		{
+			for (size_t index = 0; index < graph.nodeData(block).body.size(); ++index) {
+				visitInstruction(block, index);
+			}
+			visitSplit(block);
+		}
+
+		void visitPhis(size_t block)
+		{
+			auto& body = graph.nodeData(block).body;
+			for (size_t index = 0; index < body.size() && IL::getIf<IL::Phi>(body[index]); ++index) {
+				visitInstruction(block, index);
+			}
+		}
+
+		void visitSplit(size_t block)
+		{
+			auto succs = graph.out(block);
+			auto& data = graph.nodeData(block);
+			LatticeValue condition = data.splits() ? valueOf(data.splitsOn()) : LatticeValue::bottom();
+			for (size_t successorIndex = 0; successorIndex < succs.size(); ++successorIndex)
+			{
+				// a condition that is still unknown has no reaching definition, keep both sides
+				bool taken = !condition.isConstant() ||
+					(condition.value != 0) == graph.nodeData(succs[successorIndex]).isTrueBranch();
+				if (taken) markEdge(block, successorIndex);
+			}
+		}
+
+		void visitInstruction(size_t block, size_t index)
+		{
+			auto& instr = graph.nodeData(block).body[index];
+			if (auto phi = IL::getIf<IL::Phi>(instr))
+			{
+				auto preds = graph.in(block);
+				LatticeValue result = LatticeValue::top();
+				for (size_t predIndex = 0; predIndex < preds.size(); ++predIndex) {
+					if (isExecutable(preds[predIndex], block)) result = meet(result, valueOf(phi->sources[predIndex]));
+				}
+				lower(phi->dest.variable, result);
+			}
+			else if (auto assignment = IL::getIf<IL::Assignment>(instr))
+			{
+				LatticeValue src = valueOf(assignment->src);
+				lower(assignment->dest.variable, src.isConstant() ? wrap(src.value, assignment->dest.type) : src);
+			}
+			else if (auto binary = IL::getIf<IL::Binary>(instr))
+			{
+				lower(binary->dest.variable, evaluate(*binary));
+			}
+			else if (auto unary = IL::getIf<IL::Unary>(instr))
+			{
+				LatticeValue src = valueOf(unary->src);
+				if (!src.isConstant()) {
+					lower(unary->dest.variable, src);
+					return;
+				}
+				auto folded = foldUnary(unary->operation, src.value);
+				lower(unary->dest.variable, folded.has_value() ? wrap(folded.value(), unary->dest.type) : LatticeValue::bottom());
+			}
+			else if (auto cast = IL::getIf<IL::Cast>(instr))
+			{
+				LatticeValue src = valueOf(cast->src);
+				if (src.isConstant() && cast->cast == IL::Type::i1) src.value = src.value != 0;
+				lower(cast->dest, src.isConstant() ? wrap(src.value, cast->cast) : src);
+			}
+			else if (auto testBit = IL::getIf<IL::TestBit>(instr))
+			{
+				LatticeValue src = valueOf(testBit->src);
+				if (src.isConstant()) src.value = testBit->bit < 32 && ((src.value >> testBit->bit) & 1);
+				lower(testBit->dest, src);
+			}
+			else
+			{
+				IL::forEachDef(instr, [&](IL::Variable& var, IL::Type) { lower(var, LatticeValue::bottom()); });
+			}
+		}
+
+		LatticeValue evaluate(IL::Binary const& binary) const
+		{
+			LatticeValue lhs = valueOf(binary.lhs), rhs = valueOf(binary.rhs);
+			// a constant can decide a logical operator on its own
+			for (auto known : { lhs, rhs })
+			{
+				if (!known.isConstant()) continue;
+				if (binary.operation == Token::Type::AND && known.value == 0) return LatticeValue::constant(0);
+				if (binary.operation == Token::Type::OR && known.value != 0) return LatticeValue::constant(1);
+			}
+			if (lhs.isBottom() || rhs.isBottom()) return LatticeValue::bottom();
+			if (lhs.isTop() || rhs.isTop()) return LatticeValue::top();
+			auto folded = foldBinary(binary.operation, lhs.value, rhs.value);
+			return folded.has_value() ? wrap(folded.value(), binary.dest.type) : LatticeValue::bottom();
+		}
+
+		static LatticeValue wrap(long long value, IL::Type type)
+		{
+			auto wrapped = wrapToType(value, type);
+			return wrapped.has_value() ? LatticeValue::constant(wrapped.value()) : LatticeValue::bottom();
+		}
+
+		bool replaceUse(IL::Value& value) const
+		{
+			auto var = std::get_if<IL::Variable>(&value);
+			if (!var || !valueOf(*var).isConstant()) return false;
+			value = valueOf(*var).value;
+			return true;
+		}
+
+		bool rewriteInstruction(IL::UniquePtr& instr)
+		{
+			std::optional<IL::Decl> folded;
+			if (auto binary = IL::getIf<IL::Binary>(instr)) folded = binary->dest;
+			else if (auto unary = IL::getIf<IL::Unary>(instr)) folded = unary->dest;
+			else if (auto cast = IL::getIf<IL::Cast>(instr)) folded = IL::Decl(cast->dest, cast->cast);
+			else if (auto testBit = IL::getIf<IL::TestBit>(instr)) folded = IL::Decl(testBit->dest, IL::Type::i1);
+			if (folded.has_value() && valueOf(folded->variable).isConstant())
+			{
+				instr = IL::makeIL<IL::Assignment>(folded->variable, folded->type, valueOf(folded->variable).value);
+				return true;
+			}
+
+			bool changed = false;
+			if (auto phi = IL::getIf<IL::Phi>(instr)) {
+				for (auto& source : phi->sources) changed |= replaceUse(source);
+			}
+			else if (auto binary = IL::getIf<IL::Binary>(instr)) {
+				changed |= replaceUse(binary->lhs);
+				changed |= replaceUse(binary->rhs);
+			}
+			else if (auto unary = IL::getIf<IL::Unary>(instr)) {
+				changed |= replaceUse(unary->src);
+			}
+			else if (auto assignment = IL::getIf<IL::Assignment>(instr)) {
+				changed |= replaceUse(assignment->src);
+			}
+			else if (auto ret = IL::getIf<IL::Return>(instr); ret && ret->value.has_value()) {
+				changed |= replaceUse(ret->value.value());
+			}
+			else if (auto call = IL::getIf<IL::FunctionCall>(instr)) {
+				for (auto& arg : call->args) changed |= replaceUse(arg);
+			}
+			return changed;
+		}
+	};
+
+	class SCCPPass : public FunctionPass
+	{
+	public:
+		virtual std::string_view name() const override { return "sccp"; }
+
+		virtual bool run(FunctionContext& function, AnalysisManager&) override
+		{
+			ConstantPropagator propagator(function.graph);
+			propagator.propagate();
+			return propagator.rewrite();
+		}
+	};
+
+	std::unique_ptr<FunctionPass> createSCCPPass() { return std::make_unique<SCCPPass>(); }
+}
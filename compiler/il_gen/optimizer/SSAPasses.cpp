@@ -0,0 +1,43 @@
+#include "Passes.h"
+#include "AnalysisManager.h"
+
+namespace opt
+{
+	// Every later pass can rely on a single definition per variable. Renaming only walks
+	// the dominator tree, so blocks the entry cannot reach are dropped first.
+	class BuildSSAPass : public FunctionPass
+	{
+	public:
+		virtual std::string_view name() const override { return "build-ssa"; }
+		// the shape only changes before the analyses the pass leaves behind are computed
+		virtual PreservedAnalyses preserved() const override { return PreservedAnalyses::controlFlow(); }
+
+		virtual bool run(FunctionContext& function, AnalysisManager& analyses) override
+		{
+			if (removeUnreachableILBlocks(function.graph)) analyses.invalidate(PreservedAnalyses::none());
+			//placing phis does not change what the analyses say, so renaming shares them
+			auto& tree = analyses.dominators();
+			auto& assignments = analyses.assignments();
+			auto& liveness = analyses.liveness();
+			placePhiNodes(function.graph, tree, assignments, liveness);
+			renameILGraph(function.graph, tree, assignments, liveness, function.createVariable);
+			return true;
+		}
+	};
+
+	// Must be the last function pass, the flattener does not understand phis
+	class DestroySSAPass : public FunctionPass
+	{
+	public:
+		virtual std::string_view name() const override { return "destroy-ssa"; }
+
+		virtual bool run(FunctionContext& function, AnalysisManager&) override
+		{
+			removePhiNodes(function.graph, function.createVariable);
+			return true;
+		}
+	};
+
+	std::unique_ptr<FunctionPass> createBuildSSAPass() { return std::make_unique<BuildSSAPass>(); }
+	std::unique_ptr<FunctionPass> createDestroySSAPass() { return std::make_unique<DestroySSAPass>(); }
+}
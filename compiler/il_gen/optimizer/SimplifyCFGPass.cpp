@@ -0,0 +1,134 @@
+#include "Passes.h"
+#include "AnalysisManager.h"
+
+namespace opt
+{
+	/* CFG Simplification:
+		Removes blocks the entry cannot reach, then repeatedly
+		 - merges a block into its only predecessor when that predecessor has no other successor,
+		 - sends the predecessors of an empty block straight to its only successor,
+		 - drops a branch whose sides are both empty and lead to the same block.
+		A merged block's phis have a single source, so they become copies.
+		Branch targets are marked on the target block, so a block that one of its
+		predecessors branches to is never bypassed.
+	*/
+	class CFGSimplifier
+	{
+	public:
+		CFGSimplifier(ILCtrlFlowGraph& graph)
+			: graph(graph) {}
+
+		bool run()
+		{
+			bool changed = removeUnreachableILBlocks(graph);
+			for (bool progress = true; progress;)
+			{
+				progress = false;
+				for (size_t block = 0; block < graph.nodeCount(); ++block)
+				{
+					if (tryMergeIntoPredecessor(block) || tryBypass(block) || tryRemoveEmptyBranch(block)) progress = true;
+				}
+				changed |= progress;
+			}
+			return removeUnreachableILBlocks(graph) || changed;
+		}
+
+	private:
+		ILCtrlFlowGraph& graph;
+
+		bool isFixed(size_t block) const
+		{
+			return block == graph.getEntryNode() || block == graph.getExitNode();
+		}
+
+		static bool hasPhis(ILBlock const& block)
+		{
+			return !block.body.empty() && IL::getIf<IL::Phi>(block.body.front()) != nullptr;
+		}
+
+		bool tryMergeIntoPredecessor(size_t block)
+		{
+			if (isFixed(block) || graph.predecessorCount(block) != 1) return false;
+			size_t pred = graph.in(block).front();
+			if (pred == block || graph.successorCount(pred) != 1 || graph.nodeData(pred).splits()) return false;
+
+			auto& from = graph.nodeData(block);
+			auto& into = graph.nodeData(pred);
+			for (auto& instr : from.body)
+			{
+				auto phi = IL::getIf<IL::Phi>(instr);
+				if (!phi) break;
+				instr = IL::makeIL<IL::Assignment>(phi->dest.variable, phi->dest.type, phi->sources.front());
+			}
+			util::vector_append(into.body, std::move(from.body));
+			from.body.clear();
+			if (from.splits())
+			{
+				into.splitWith(from.splitsOn());
+				from.removeSplit();
+			}
+			graph.removeEdge(pred, block);
+			std::vector<size_t> succs(graph.out(block).begin(), graph.out(block).end());
+			for (size_t succ : succs) replaceILPredecessor(graph, succ, block, pred);
+			return true;
+		}
+
+		bool tryBypass(size_t block)
+		{
+			auto& data = graph.nodeData(block);
+			if (isFixed(block) || !data.body.empty() || data.splits() || graph.successorCount(block) != 1) return false;
+			size_t succ = graph.out(block).front();
+			if (succ == block || hasPhis(graph.nodeData(succ)) || graph.predecessorCount(block) == 0) return false;
+			for (size_t pred : graph.in(block))
+			{
+				if (graph.nodeData(pred).splits() || graph.hasEdge(pred, succ)) return false;
+			}
+			std::vector<size_t> preds(graph.in(block).begin(), graph.in(block).end());
+			for (size_t pred : preds)
+			{
+				graph.removeEdge(pred, block);
+				graph.addEdge(pred, succ);
+			}
+			graph.removeEdge(block, succ);
+			return true;
+		}
+
+		// a branch whose two sides are empty and meet again does nothing
+		bool tryRemoveEmptyBranch(size_t block)
+		{
+			if (!graph.nodeData(block).splits()) return false;
+			size_t sides[] = { graph.getTrueSuccessor(block), graph.getFalseSuccessor(block) };
+			std::optional<size_t> join;
+			for (size_t side : sides)
+			{
+				auto& data = graph.nodeData(side);
+				if (isFixed(side) || !data.body.empty() || data.splits() ||
+					graph.predecessorCount(side) != 1 || graph.successorCount(side) != 1) return false;
+				if (join.has_value() && join != graph.out(side).front()) return false;
+				join = graph.out(side).front();
+			}
+			if (hasPhis(graph.nodeData(join.value())) || graph.hasEdge(block, join.value())) return false;
+			for (size_t side : sides)
+			{
+				graph.removeEdge(block, side);
+				graph.removeEdge(side, join.value());
+			}
+			graph.addEdge(block, join.value());
+			graph.nodeData(block).removeSplit();
+			return true;
+		}
+	};
+
+	class SimplifyCFGPass : public FunctionPass
+	{
+	public:
+		virtual std::string_view name() const override { return "simplify-cfg"; }
+
+		virtual bool run(FunctionContext& function, AnalysisManager&) override
+		{
+			return CFGSimplifier{ function.graph }.run();
+		}
+	};
+
+	std::unique_ptr<FunctionPass> createSimplifyCFGPass() { return std::make_unique<SimplifyCFGPass>(); }
+}
@@ -2,6 +2,32 @@
 #include "ComputedExpr.h"
 #include "StringUtil.h"
 
+//function and list types have no name to look up, they are spelled out the way they were written
+static Expr::UniquePtr typeToExpr(SourcePosition sourcePos, TypePtr type)
+{
+	return typesys::visitType(*type, [&]<typename T>(T const& concrete) -> Expr::UniquePtr {
+		if constexpr (std::is_same_v<T, ListType>)
+		{
+			auto expr = typeToExpr(sourcePos, concrete.elementType.type);
+			for (size_t dimension : concrete.dimensions)
+			{
+				expr = Expr::makeExpr<Expr::Indexing>(sourcePos, std::move(expr), Expr::makeExpr<Expr::Literal>(sourcePos, static_cast<u16>(dimension)));
+			}
+			return expr;
+		}
+		else if constexpr (std::is_same_v<T, FunctionType>)
+		{
+			std::vector<Expr::UniquePtr> paramTypes;
+			for (auto& param : concrete.params) paramTypes.push_back(typeToExpr(sourcePos, param.type));
+			return Expr::makeExpr<Expr::FunctionType>(sourcePos, std::move(paramTypes), typeToExpr(sourcePos, concrete.returnType.type));
+		}
+		else 
+		{
+			return Expr::makeExpr<Expr::Identifier>(sourcePos, concrete.name());
+		}
+	});
+}
+
 ComputedExpr::ComputedExpr(SourcePosition sourcePos, VarType const& value) : sourcePos(sourcePos), value(value) {}
 ComputedExpr::ComputedExpr(SourcePosition sourcePos, VarType&& value) : sourcePos(sourcePos), value(std::move(value)) {}
 
@@ -32,7 +58,7 @@ std::string ComputedExpr::toString() const
 			return util::strBuilder('\"', arg, '\"');
 		}
 		else {
-			return arg.type->name;
+			return std::string{ arg.type->name() };
 		}
 	}, value);
 }
@@ -45,7 +71,20 @@ Expr::UniquePtr ComputedExpr::toExpr() const
 			return Expr::makeExpr<Expr::Literal>(sourcePos, std::move(arg));
 		}
 		else {
-			return Expr::makeExpr<Expr::Identifier>(sourcePos, arg.type->name);
+			return typeToExpr(sourcePos, arg.type);
+		}
+	}, value);
+}
+
+TemplateBin::Argument ComputedExpr::toTemplateArgument() const
+{
+	return std::visit([&](auto&& arg) -> TemplateBin::Argument {
+		using U = std::remove_cvref_t<decltype(arg)>;
+		if constexpr (std::is_same_v<U, TypeInstance>) {
+			return arg.type;
+		}
+		else {
+			return arg;
 		}
 	}, value);
 }
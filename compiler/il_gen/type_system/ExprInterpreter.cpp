@@ -14,19 +14,21 @@ using enum Token::Type;
 ExprInterpreter::ExprInterpreter(TypeSystem& types)
 	: types(types) {}
 
-ComputedExpr ExprInterpreter::interpret(Expr::UniquePtr const& expr)
+Evaluation ExprInterpreter::interpret(Expr::UniquePtr const& expr)
 {
 	return visitChild(expr);
 }
 
-void ExprInterpreter::visit(Expr::Binary& expr)
+void ExprInterpreter::visit(Expr::Binary const& expr)
 {
 	auto lhs_result = visitChild(expr.lhs);
+	if (!lhs_result) return returnValue(std::move(lhs_result));
 	auto rhs_result = visitChild(expr.rhs);
-	if (!lhs_result.isInt() || !rhs_result.isInt()) {
-		throw NotConstEvaluable(expr.sourcePos, expr.oper);
+	if (!rhs_result) return returnValue(std::move(rhs_result));
+	if (!lhs_result.value().isInt() || !rhs_result.value().isInt()) {
+		return notConstant(expr.sourcePos, "Only integers can be operated on at compile-time");
 	}
-	int retval, lhs = lhs_result.getInt(), rhs = rhs_result.getInt();
+	int retval, lhs = lhs_result.value().getInt(), rhs = rhs_result.value().getInt();
 	switch (expr.oper) {
 	case PLUS:			retval = lhs + rhs;	break;
 	case MINUS:			retval = lhs - rhs;	break;
@@ -50,11 +52,13 @@ void ExprInterpreter::visit(Expr::Binary& expr)
 	returnValue(ComputedExpr{ expr.sourcePos, static_cast<u16>(retval) });
 }
 
-void ExprInterpreter::visit(Expr::Unary& expr)
+void ExprInterpreter::visit(Expr::Unary const& expr)
 {
-	auto rhs_result = visitChild(expr.expr);
+	auto evaluated = visitChild(expr.expr);
+	if (!evaluated) return returnValue(std::move(evaluated));
+	auto& rhs_result = evaluated.value();
 	if (!rhs_result.isInt() && !rhs_result.isTypeInstance()) {
-		throw NotConstEvaluable(expr.sourcePos, expr.oper);
+		return notConstant(expr.sourcePos, "Only integers and types can be operated on at compile-time");
 	}
 	if(rhs_result.isInt()){
 		int retval, rhs = rhs_result.getInt();
@@ -86,7 +90,7 @@ void ExprInterpreter::visit(Expr::Unary& expr)
 	}
 }
 
-void ExprInterpreter::visit(Expr::KeyworkFunctionCall& expr)
+void ExprInterpreter::visit(Expr::KeyworkFunctionCall const& expr)
 {
 	switch (expr.function) 
 	{
@@ -94,42 +98,54 @@ void ExprInterpreter::visit(Expr::KeyworkFunctionCall& expr)
 		if (expr.args.size() != 1) {
 			throw SemanticError(expr.sourcePos, "Sizeof operator expects exactly 1 argument.");
 		}
-		returnValue(ComputedExpr{ expr.sourcePos, u16(TargetInfo::calculateTypeSizeBytes(types.instantiateType(expr.args[0]))) });
+	{
+		auto type = evaluateType(expr.args[0]);
+		if (!type) return returnValue(std::move(type));
+		return returnValue(ComputedExpr{ expr.sourcePos, u16(TargetInfo::calculateTypeSizeBytes(type.value().getTypeInstance())) });
+	}
 	case Token::Type::REF:
-		throw NotConstEvaluable(expr.sourcePos, "Cannot perform a reference at compile-time.");
+		return notConstant(expr.sourcePos, "Cannot perform a reference at compile-time.");
 	default:
 		COMPILER_NOT_REACHABLE;
 	}
 }
 
-void ExprInterpreter::visit(Expr::FunctionType& expr)
+void ExprInterpreter::visit(Expr::FunctionType const& expr)
 {
-	auto params = util::transform_vector(expr.paramTypes, [&](Expr::UniquePtr const& param) {
-		return types.instantiateType(param);
-	});
-	auto returnType = types.instantiateType(expr.returnType);
-	auto returnTypeInstantiated = types.addFunction(std::move(params), std::move(returnType));
+	std::vector<TypeInstance> params;
+	params.reserve(expr.paramTypes.size());
+	for (auto& param : expr.paramTypes) 
+	{
+		auto paramType = evaluateType(param);
+		if (!paramType) return returnValue(std::move(paramType));
+		params.push_back(paramType.value().getTypeInstance());
+	}
+	auto returnType = evaluateType(expr.returnType);
+	if (!returnType) return returnValue(std::move(returnType));
+	auto returnTypeInstantiated = types.addFunction(std::move(params), returnType.value().getTypeInstance());
 	returnValue(ComputedExpr{ expr.sourcePos, TypeInstance(returnTypeInstantiated) });
 }
 
-void ExprInterpreter::visit(Expr::Cast& expr)
+void ExprInterpreter::visit(Expr::Cast const& expr)
 {
-	auto type = types.instantiateType(expr.type);
+	auto type = evaluateType(expr.type);
+	if (!type) return returnValue(std::move(type));
 	auto result = visitChild(expr.expr);
-	if (result.isInt()) {
+	if (!result) return returnValue(std::move(result));
+	if (result.value().isInt()) {
 		COMPILER_NOT_SUPPORTED;
 	}
 	else {
-		throw SemanticError(expr.sourcePos, fmt::format("Unable to cast expression to: {}", type.type->name));
+		throw SemanticError(expr.sourcePos, fmt::format("Unable to cast expression to: {}", type.value().getTypeInstance().type->name()));
 	}
 }
 
-void ExprInterpreter::visit(Expr::Parenthesis& expr)
+void ExprInterpreter::visit(Expr::Parenthesis const& expr)
 {
 	returnValue(visitChild(expr.expr));
 }
 
-void ExprInterpreter::visit(Expr::Identifier& expr)
+void ExprInterpreter::visit(Expr::Identifier const& expr)
 {
 	if (types.isType(expr.ident)) 
 	{
@@ -140,41 +156,52 @@ void ExprInterpreter::visit(Expr::Identifier& expr)
 		returnValue(ComputedExpr{ expr.sourcePos, types.getTypeAlias(expr.ident) });
 	}
 	else {
-		throw NotConstEvaluable(expr.sourcePos, "Variable lookup cannot be performed at compile-time");
+		return notConstant(expr.sourcePos, "Variable lookup cannot be performed at compile-time");
 	}
 }
 
-void ExprInterpreter::visit(Expr::FunctionCall& expr)
+void ExprInterpreter::visit(Expr::FunctionCall const& expr)
 {
-	throw NotConstEvaluable(expr.sourcePos, "Function calls cannot be performed at compile-time");
+	return notConstant(expr.sourcePos, "Function calls cannot be performed at compile-time");
 }
 
-void ExprInterpreter::visit(Expr::TemplateCall& expr)
+void ExprInterpreter::visit(Expr::TemplateCall const& expr)
 {
-	TypeInstance lhs = types.instantiateType(expr.lhs);
-	TemplateBin const* templateType = lhs.type->getExactType<TemplateBin>();
+	auto evaluated = evaluateType(expr.lhs);
+	if (!evaluated) return returnValue(std::move(evaluated));
+	TypeInstance lhs = evaluated.value().getTypeInstance();
+	TemplateBin const* templateType = typesys::dyn_cast<TemplateBin>(lhs.type);
 	if (!templateType) {
 		throw SemanticError(expr.sourcePos,
-			fmt::format("Tried to pass template arguments to an invalid expression. {} is not a template", lhs.type->name)
+			fmt::format("Tried to pass template arguments to an invalid expression. {} is not a template", lhs.type->name())
 		);
 	}
-	auto computedArgs = util::transform_vector(expr.templateArgs, [&](Expr::UniquePtr const& expr) { return interpret(expr); });
-	std::string_view name = compileTemplate(expr.sourcePos, templateType, std::move(computedArgs));
-	returnValue(ComputedExpr{ expr.sourcePos, TypeInstance(types.getType(name)) });
+	std::vector<ComputedExpr> computedArgs;
+	computedArgs.reserve(expr.templateArgs.size());
+	for (auto& arg : expr.templateArgs) 
+	{
+		auto evaluated = visitChild(arg);
+		if (!evaluated) return returnValue(std::move(evaluated));
+		computedArgs.push_back(std::move(evaluated.value()));
+	}
+	returnValue(ComputedExpr{ expr.sourcePos, TypeInstance(compileTemplate(expr.sourcePos, templateType, std::move(computedArgs))) });
 }
 
-void ExprInterpreter::visit(Expr::Indexing& expr)
+void ExprInterpreter::visit(Expr::Indexing const& expr)
 {
 	auto lhs = visitChild(expr.lhs);
-	if (lhs.isTypeInstance())
+	if (!lhs) return returnValue(std::move(lhs));
+	if (lhs.value().isTypeInstance())
 	{
 		TypePtr newArray;
-		TypeInstance type = lhs.getTypeInstance();
-		auto innerExpr = visitChild(expr.innerExpr);
+		TypeInstance type = lhs.value().getTypeInstance();
+		auto evaluated = visitChild(expr.innerExpr);
+		if (!evaluated) return returnValue(std::move(evaluated));
+		auto& innerExpr = evaluated.value();
 		if (!innerExpr.isInt()) {
 			throw SemanticError(expr.innerExpr->sourcePos, "Array type expression must have a compile-time number of elements.");
 		}
-		if (auto arrayType = type.type->getExactType<ListType>()) 
+		if (auto arrayType = typesys::dyn_cast<ListType>(type.type)) 
 		{
 			if (type.isMut || type.isOpt || type.isRef) {
 				throw SemanticError(expr.lhs->sourcePos, "Cannot create an array of reference/mutable/maybe arrays.");
@@ -189,18 +216,20 @@ void ExprInterpreter::visit(Expr::Indexing& expr)
 	}
 	else
 	{
-		throw NotConstEvaluable(expr.sourcePos, "Cannot perform index operation of left hand side at compile-time.");
+		return notConstant(expr.sourcePos, "Cannot perform index operation of left hand side at compile-time.");
 	}
 }
 
-void ExprInterpreter::visit(Expr::MemberAccess& expr)
+void ExprInterpreter::visit(Expr::MemberAccess const& expr)
 {
-	throw NotConstEvaluable(expr.sourcePos, "Member access is not a compile-time operation");
+	return notConstant(expr.sourcePos, "Member access is not a compile-time operation");
 }
 
-void ExprInterpreter::visit(Expr::Questionable& expr)
+void ExprInterpreter::visit(Expr::Questionable const& expr)
 {
-	auto lhs = types.instantiateType(expr.expr);
+	auto evaluated = evaluateType(expr.expr);
+	if (!evaluated) return returnValue(std::move(evaluated));
+	TypeInstance lhs = evaluated.value().getTypeInstance();
 	if (lhs.isOpt) {
 		throw SemanticError(expr.sourcePos, "Cannot have an optional of an optional value.");
 	}
@@ -208,9 +237,11 @@ void ExprInterpreter::visit(Expr::Questionable& expr)
 	returnValue(ComputedExpr{ expr.sourcePos, lhs });
 }
 
-void ExprInterpreter::visit(Expr::Reference& expr)
+void ExprInterpreter::visit(Expr::Reference const& expr)
 {
-	auto lhs = types.instantiateType(expr.expr);
+	auto evaluated = evaluateType(expr.expr);
+	if (!evaluated) return returnValue(std::move(evaluated));
+	TypeInstance lhs = evaluated.value().getTypeInstance();
 	if (lhs.isRef) {
 		throw SemanticError(expr.sourcePos, "Multiple levels of referencing is not allowed.");
 	}
@@ -221,7 +252,7 @@ void ExprInterpreter::visit(Expr::Reference& expr)
 	returnValue(ComputedExpr{expr.sourcePos, lhs});
 }
 
-void ExprInterpreter::visit(Expr::Literal& expr)
+void ExprInterpreter::visit(Expr::Literal const& expr)
 {
 	std::visit([&](auto&& arg) {
 		using U = std::remove_cvref_t<decltype(arg)>;
@@ -235,40 +266,56 @@ void ExprInterpreter::visit(Expr::Literal& expr)
 	}, expr.literal);
 }
 
-void ExprInterpreter::visit(Expr::Register& expr)
+void ExprInterpreter::visit(Expr::Register const& expr)
 {
-	throw NotConstEvaluable(expr.sourcePos, "Registers are not compile-time constants");
+	return notConstant(expr.sourcePos, "Registers are not compile-time constants");
 }
 
-void ExprInterpreter::visit(Expr::Flag& expr)
+void ExprInterpreter::visit(Expr::Flag const& expr)
 {
-	throw NotConstEvaluable(expr.sourcePos, "Flags are not compile-time constants");
+	return notConstant(expr.sourcePos, "Flags are not compile-time constants");
 }
 
-void ExprInterpreter::visit(Expr::CurrentPC& expr)
+void ExprInterpreter::visit(Expr::CurrentPC const& expr)
 {
-	throw NotConstEvaluable(expr.sourcePos, "The Program Counter is not a compile-time constant");
+	return notConstant(expr.sourcePos, "The Program Counter is not a compile-time constant");
 }
 
-void ExprInterpreter::visit(Expr::ListLiteral& expr) 
+void ExprInterpreter::visit(Expr::ListLiteral const& expr) 
 {
-	throw NotConstEvaluable(expr.sourcePos, "A List Literal is not a compile-time constant");
+	return notConstant(expr.sourcePos, "A List Literal is not a compile-time constant");
 }
 
-void ExprInterpreter::visit(Expr::StructLiteral& expr) 
+void ExprInterpreter::visit(Expr::StructLiteral const& expr) 
 {
-	throw NotConstEvaluable(expr.sourcePos, "A Struct Literal is not a compile-time constant");
+	return notConstant(expr.sourcePos, "A Struct Literal is not a compile-time constant");
+}
+
+Evaluation ExprInterpreter::evaluateType(Expr::UniquePtr const& expr)
+{
+	Evaluation result = visitChild(expr);
+	if (result && !result.value().isTypeInstance()) {
+		throw SemanticError(
+			expr->sourcePos,
+			fmt::format("Expected a type, but found a {} instead", result.value().typeToString())
+		);
+	}
+	return result;
 }
 
-std::string_view ExprInterpreter::compileTemplate(SourcePosition pos, TemplateBin const* type, std::vector<ComputedExpr> args)
+TypePtr ExprInterpreter::compileTemplate(SourcePosition pos, TemplateBin const* type, std::vector<ComputedExpr> args)
 {
-	std::string name = createTemplateName(type->name, args);
-	if (types.isType(name)) 
+	auto arguments = util::transform_vector(args, [](ComputedExpr const& arg) { return arg.toTemplateArgument(); });
+	if (TypePtr instance = types.getTemplateInstance(type, arguments)) 
 	{
-		return types.getType(name)->name;
+		return instance;
 	}
 	assertCorrectTemplateArgs(pos, type->templateParams, args);
-	return types.addBin(name, newBinBody(type->body, type->templateParams, args))->name;
+	//the name is still registered, an instance passed on as a template argument is found by it
+	std::string name = createTemplateName(type->name(), args);
+	TypePtr instance = types.addBin(name, newBinBody(type->body, type->templateParams, args));
+	types.addTemplateInstance(type, std::move(arguments), instance);
+	return instance;
 }
 
 std::string ExprInterpreter::createTemplateName(std::string_view templateID, std::vector<ComputedExpr> const& args)
@@ -277,7 +324,8 @@ std::string ExprInterpreter::createTemplateName(std::string_view templateID, std
 	templateName += '<';
 	bool first = true;
 	for (auto& arg : args) {
-		if (!first) { templateName += ','; first = false; }
+		if (!first) templateName += ',';
+		first = false;
 		templateName += arg.toString();
 	}
 	templateName += '>';
@@ -306,7 +354,7 @@ void ExprInterpreter::assertCorrectTemplateArgs
 			if (!args[i].isInt()) {
 				throw SemanticError(args[i].sourcePos,
 					fmt::format("Unable to assign a {} to the {} template argument expecting a {}",
-						args[i].typeToString(), util::toStringWithOrdinalSuffix(i), type.type->name)
+						args[i].typeToString(), util::toStringWithOrdinalSuffix(i), type.type->name())
 				);
 			}
 		},
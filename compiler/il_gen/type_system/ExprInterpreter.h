@@ -7,30 +7,13 @@
 #include "CompilerError.h"
 #include "ComputedExpr.h"
 
+//evaluates an expression at compile time, an expression that is not constant evaluates to the reason why
 class ExprInterpreter :
-	public Expr::VisitorReturner<ComputedExpr>
+	public Expr::ConstVisitorReturner<Evaluation>
 {
 public:
 	ExprInterpreter(TypeSystem& env);
-	ComputedExpr interpret(Expr::UniquePtr const& expr);
-
-	class NotConstEvaluable : public CompilerError {
-	public:
-		NotConstEvaluable(SourcePosition const& pos, Token::Type const& operation)
-			: CompilerError(pos), operation(operation) {}
-
-		NotConstEvaluable(SourcePosition const& pos, std::string what)
-			: CompilerError(pos), what(what) {}
-
-		std::string msgToString() {
-			return fmt::format("Expression cannot be evaluated at compile-time: {}", 
-				what.empty() ? tokenTypeToStr(operation) : what
-			);
-		}
-	private:
-		std::string what;
-		Token::Type operation;
-	};
+	Evaluation interpret(Expr::UniquePtr const& expr);
 
 	class InvalidOperation : public CompilerError {
 	public:
@@ -49,29 +32,33 @@ public:
 private:
 	TypeSystem& types;
 
-	virtual void visit(Expr::Binary& expr);
-	virtual void visit(Expr::Unary& expr);
+	void notConstant(SourcePosition pos, std::string_view reason) { returnValue(Evaluation::NotConstant{ pos, reason }); }
+	//a type or why it is not constant, a constant that is not a type is an error
+	Evaluation evaluateType(Expr::UniquePtr const& expr);
+
+	virtual void visit(Expr::Binary const& expr);
+	virtual void visit(Expr::Unary const& expr);
 	//Primary expressions
 
-	virtual void visit(Expr::KeyworkFunctionCall& expr);
-	virtual void visit(Expr::FunctionType& expr);
-	virtual void visit(Expr::Cast& expr);
-	virtual void visit(Expr::ListLiteral& expr);
-	virtual void visit(Expr::StructLiteral& expr);
-	virtual void visit(Expr::Reference& expr);
-	virtual void visit(Expr::Questionable& expr);
-	virtual void visit(Expr::Parenthesis& expr);
-	virtual void visit(Expr::Identifier& expr);
-	virtual void visit(Expr::FunctionCall& expr);
-	virtual void visit(Expr::TemplateCall& expr);
-	virtual void visit(Expr::Indexing& expr);
-	virtual void visit(Expr::MemberAccess& expr);
-	virtual void visit(Expr::Literal& expr);
-	virtual void visit(Expr::Register& expr);
-	virtual void visit(Expr::Flag& expr);
-	virtual void visit(Expr::CurrentPC& expr);
+	virtual void visit(Expr::KeyworkFunctionCall const& expr);
+	virtual void visit(Expr::FunctionType const& expr);
+	virtual void visit(Expr::Cast const& expr);
+	virtual void visit(Expr::ListLiteral const& expr);
+	virtual void visit(Expr::StructLiteral const& expr);
+	virtual void visit(Expr::Reference const& expr);
+	virtual void visit(Expr::Questionable const& expr);
+	virtual void visit(Expr::Parenthesis const& expr);
+	virtual void visit(Expr::Identifier const& expr);
+	virtual void visit(Expr::FunctionCall const& expr);
+	virtual void visit(Expr::TemplateCall const& expr);
+	virtual void visit(Expr::Indexing const& expr);
+	virtual void visit(Expr::MemberAccess const& expr);
+	virtual void visit(Expr::Literal const& expr);
+	virtual void visit(Expr::Register const& expr);
+	virtual void visit(Expr::Flag const& expr);
+	virtual void visit(Expr::CurrentPC const& expr);
 
-	std::string_view compileTemplate(SourcePosition pos, TemplateBin const* type, std::vector<ComputedExpr> args);
+	TypePtr compileTemplate(SourcePosition pos, TemplateBin const* type, std::vector<ComputedExpr> args);
 	std::string createTemplateName(std::string_view templateID, std::vector<ComputedExpr> const& args);
 	void assertCorrectTemplateArgs(SourcePosition pos, std::vector<TemplateBin::Parameter> const& params, std::vector<ComputedExpr> const& args);
 	std::vector<Stmt::VarDecl> newBinBody(std::vector<Stmt::VarDecl> const& oldBody, std::vector<TemplateBin::Parameter> const& params, std::vector<ComputedExpr> const& args);
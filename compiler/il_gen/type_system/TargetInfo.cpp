@@ -9,7 +9,7 @@ size_t TargetInfo::calculateTypeSizeBytes(TypeInstance type)
 
 size_t TargetInfo::calculateTypeSizeBits(TypeInstance type)
 {
-	if (auto primitiveType = type.type->getExactType<PrimitiveType>())
+	if (auto primitiveType = typesys::dyn_cast<PrimitiveType>(type.type))
 	{
 		if (primitiveType->subtype == PrimitiveType::SubType::bool_
 			&& !type.isRef && !type.isOpt)
@@ -37,7 +37,7 @@ bool TargetInfo::fitsInRegister(TypeInstance type)
 bool TargetInfo::isUnsignedType(TypeInstance type)
 {
 	if (type.isOpt || type.isOpt) return true;
-	if (auto primitiveType = type.type->getExactType<PrimitiveType>())
+	if (auto primitiveType = typesys::dyn_cast<PrimitiveType>(type.type))
 	{
 		return primitiveType->isUnsigned();
 	}
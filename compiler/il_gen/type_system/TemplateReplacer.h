@@ -1,6 +1,7 @@
 #pragma once
 #include "Stmt.h"
 #include "StmtCloner.h"
+#include "ExprInterner.h"
 #include "ExprInterpreter.h"
 #include "MetaUtil.h"
 
@@ -10,7 +11,7 @@ public:
 	void setupReplacement(std::string_view targetIdent, Expr::UniquePtr&& fillerExpr)
 	{
 		this->targetIdent = targetIdent;
-		this->fillerExpr = std::move(fillerExpr);
+		this->fillerExpr = Expr::Interner::adopt(Expr::Interner::current().share(std::move(fillerExpr)));
 	}
 	Expr::UniquePtr newExpr() const { return Expr::Cloner{}.clone(fillerExpr); }
 
@@ -39,7 +40,20 @@ public:
 private:
 	Expr::UniquePtr& templatedExpr;
 	Expr::UniquePtr* lastExpr = nullptr;
-	void visitExpr(Expr::UniquePtr& ptr) { lastExpr = &ptr; visitChild(ptr); }
+	void visitExpr(Expr::UniquePtr& ptr) 
+	{
+		if (ptr->isShared()) {
+			//a shared tree cannot change in place, it is rebuilt around the replaced identifiers
+			auto replace = [&](Expr::Expr const& expr) -> Expr::UniquePtr {
+				bool isTarget = expr.is<Expr::Identifier>() && static_cast<Expr::Identifier const&>(expr).ident == targetIdent;
+				return isTarget ? newExpr() : nullptr;
+			};
+			if (auto rebuilt = Expr::Interner::current().rewrite(ptr.get(), replace)) ptr = Expr::Interner::adopt(rebuilt);
+			return;
+		}
+		lastExpr = &ptr; 
+		visitChild(ptr);
+	}
 
 	virtual void visit(Expr::Binary& expr) override {
 		visitExpr(expr.lhs);
@@ -169,7 +183,7 @@ private:
 	}
 	virtual void visit(Stmt::CountLoop& loop) override {
 		visitExpr(loop.initializer);
-		for (auto& stmt : loop.body) visitStmt(stmt);
+		for (auto& stmt : loop.body) this->visitStmt(stmt);
 	}
 	virtual void visit(Stmt::Assign& assign) override {
 		visitExpr(assign.lhs);
@@ -178,11 +192,11 @@ private:
 	virtual void visit(Stmt::If& ifStmt) override {
 		visitConditional(ifStmt.ifBranch);
 		for (auto& branch : ifStmt.elseIfBranch) visitConditional(branch);
-		for (auto& stmt : ifStmt.elseBranch) visitStmt(stmt);
+		for (auto& stmt : ifStmt.elseBranch) this->visitStmt(stmt);
 	}
 	void visitConditional(Stmt::Conditional& conditional) {
 		visitExpr(conditional.expr);
-		for (auto& stmt : conditional.body) visitStmt(stmt);
+		for (auto& stmt : conditional.body) this->visitStmt(stmt);
 	}
 	virtual void visit(Stmt::ExprStmt& exprStmt) override {
 		visitExpr(exprStmt.expr);
@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <array>
 #include "TypeSystem.h"
 #include "SemanticError.h"
@@ -37,6 +38,11 @@ TypePtr TypeSystem::addBin(Stmt::Bin bin)
 	{
 		TemplateBin newType(std::string{ bin.name });
 		newType.body = std::move(bin.body);
+		//every instantiation starts from these types, sharing them makes its copies pointers
+		for (Stmt::VarDecl& field : newType.body) 
+		{
+			field.type = Expr::Interner::adopt(Expr::Interner::current().share(std::move(field.type)));
+		}
 
 		for (Stmt::GenericDecl& param : bin.templateInfo.params) 
 		{
@@ -63,31 +69,84 @@ TypePtr TypeSystem::addBin(std::string name, std::vector<Stmt::VarDecl> decls)
 
 TypePtr TypeSystem::addFunction(std::vector<TypeInstance> paramTypes, TypeInstance returnType)
 {
-	std::string name = createFunctionName(paramTypes, returnType);
-	return addType(FunctionType{
-		std::move(name), TargetInfo::getPointerSizeBytes(),
-		std::move(paramTypes), std::move(returnType)
+	paramTypes.push_back(returnType);
+	return internType(StructuralKey{ StructuralKey::Kind::Function, std::move(paramTypes), {} }, 
+	[](StructuralKey const& key) 
+	{
+		std::vector<TypeInstance> params(key.parts.begin(), key.parts.end() - 1);
+		return std::make_unique<FunctionType>(TargetInfo::getPointerSizeBytes(), std::move(params), key.parts.back());
 	});
 }
 
 TypePtr TypeSystem::addArray(TypeInstance elementType, size_t elements)
 {
-	std::string name = fmt::format("{}[{}]", elementType.type->name, std::to_string(elements));
-	return addType(ListType{ name, TargetInfo::calculateTypeSizeBytes(elementType) * elements, elementType, std::vector<size_t>({elements}) });
+	return internType(StructuralKey{ StructuralKey::Kind::List, { elementType }, { elements } }, 
+	[](StructuralKey const& key) 
+	{
+		size_t size = TargetInfo::calculateTypeSizeBytes(key.parts.front()) * key.dimensions.front();
+		return std::make_unique<ListType>(size, key.parts.front(), key.dimensions);
+	});
 }
 
 TypePtr TypeSystem::modifyAndAddArray(ListType const* arrayType, size_t elements)
 {
-	ListType newType = *arrayType;
-	newType.dimensions.push_back(elements);
-	newType.size *= elements;
-	newType.name.append(fmt::format("[{}]", std::to_string(elements)));
-	return addType(std::move(newType));
+	std::vector<size_t> dimensions = arrayType->dimensions;
+	dimensions.push_back(elements);
+	return internType(StructuralKey{ StructuralKey::Kind::List, { arrayType->elementType }, std::move(dimensions) }, 
+	[&](StructuralKey const& key) 
+	{
+		return std::make_unique<ListType>(arrayType->size * elements, key.parts.front(), key.dimensions);
+	});
+}
+
+bool TypeSystem::StructuralKey::operator==(StructuralKey const& other) const
+{
+	//unlike TypeInstance::operator==, mutability makes a different type here
+	return kind == other.kind && dimensions == other.dimensions 
+		&& std::ranges::equal(parts, other.parts, [](TypeInstance const& lhs, TypeInstance const& rhs) {
+			return lhs == rhs && lhs.isMut == rhs.isMut;
+		});
+}
+
+static void hashCombine(size_t& seed, size_t value)
+{
+	seed ^= value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+}
+
+size_t TypeSystem::StructuralKey::Hash::operator()(StructuralKey const& key) const
+{
+	size_t seed = static_cast<size_t>(key.kind);
+	for (auto& part : key.parts) 
+	{
+		hashCombine(seed, std::hash<TypePtr>{}(part.type));
+		hashCombine(seed, part.isMut | part.isRef << 1 | part.isOpt << 2);
+	}
+	for (size_t dimension : key.dimensions) hashCombine(seed, dimension);
+	return seed;
+}
+
+TypePtr TypeSystem::getTemplateInstance(TemplateBin const* bin, std::vector<TemplateBin::Argument> const& args) const
+{
+	//the key owns its arguments, looking up copies them but saves rewriting the body
+	auto it = templateInstances.find(InstanceKey{ bin, args });
+	return it != templateInstances.end() ? it->second : nullptr;
+}
+
+void TypeSystem::addTemplateInstance(TemplateBin const* bin, std::vector<TemplateBin::Argument> args, TypePtr instance)
+{
+	templateInstances.emplace(InstanceKey{ bin, std::move(args) }, instance);
+}
+
+size_t TypeSystem::InstanceKey::Hash::operator()(InstanceKey const& key) const
+{
+	size_t seed = std::hash<TemplateBin const*>{}(key.bin);
+	for (auto& arg : key.args) hashCombine(seed, std::hash<TemplateBin::Argument>{}(arg));
+	return seed;
 }
 
 void TypeSystem::addAlias(std::string_view name, TypeInstance actualType)
 {
-	auto result = aliases.currentScope().emplace(name, actualType);
+	aliases.insert(name, actualType);
 }
 
 TemplateBin::Parameter TypeSystem::compileTemplateDecl(Stmt::GenericDecl const& decl)
@@ -97,7 +156,7 @@ TemplateBin::Parameter TypeSystem::compileTemplateDecl(Stmt::GenericDecl const&
 		[&](Stmt::VarDecl const& varDecl)
 		{
 			TypeInstance declType = instantiateType(varDecl.type);
-			if (!declType.type->getExactType<PrimitiveType>())
+			if (!typesys::isa<PrimitiveType>(declType.type))
 			{
 				throw SemanticError(varDecl.type->sourcePos, "Only primitive types are allowed as template value parameters");
 			}
@@ -118,32 +177,15 @@ BinType::Field TypeSystem::compileBinDecl(Stmt::VarDecl const& decl, size_t offs
 
 Type const* TypeSystem::searchTypes(std::string_view name) const 
 {
-	auto it = std::find_if(types.begin(), types.end(), 
-	[&](auto const& type) 
-	{ 
-		return type->name == name; 
-	});
-	return it != types.end() ? &(**it) : nullptr;
-}
-
-std::string TypeSystem::createFunctionName(std::vector<TypeInstance> const& paramTypes, TypeInstance const& returnType) const
-{
-	std::string name = "(";
-	for (auto& paramType : paramTypes) {
-		name += paramType.type->name;
-		name.push_back(',');
-	}
-	if (name.back() == ',') name.pop_back();
-	name += ")->";
-	name += returnType.type->name;
-	return name;
+	auto it = typesByName.find(name);
+	return it != typesByName.end() ? it->second : nullptr;
 }
 
 PrimitiveType const* TypeSystem::getPrimitiveType(PrimitiveType::SubType subtype) const
 {
 	for (auto& type : types) 
 	{
-		if (auto primitiveType = type->getExactType<PrimitiveType>())
+		if (auto primitiveType = typesys::dyn_cast<PrimitiveType>(type.get()))
 		{
 			if (primitiveType->subtype == subtype)
 			{
@@ -154,35 +196,36 @@ PrimitiveType const* TypeSystem::getPrimitiveType(PrimitiveType::SubType subtype
 	COMPILER_NOT_REACHABLE;
 }
 
+Evaluation TypeSystem::evaluate(Expr::UniquePtr const& expr)
+{
+	return ExprInterpreter{ *this }.interpret(expr);
+}
+
 TypeInstance TypeSystem::instantiateType(Expr::UniquePtr const& expr) 
 {
-	try {
-		ComputedExpr result = ExprInterpreter{ *this }.interpret(expr);
-		if (!result.isTypeInstance()) {
-			throw SemanticError(
-				expr->sourcePos,
-				fmt::format("Expected a type, but found a {} instead", result.typeToString())
-			);
-		}
-		return result.getTypeInstance();
-	}
-	catch (ExprInterpreter::NotConstEvaluable const&) {
+	Evaluation result = evaluate(expr);
+	if (!result) {
 		throw SemanticError(expr->sourcePos, "Expected a type, but was unable to determine the expression at compile time");
 	}
+	if (!result.value().isTypeInstance()) {
+		throw SemanticError(
+			expr->sourcePos,
+			fmt::format("Expected a type, but found a {} instead", result.value().typeToString())
+		);
+	}
+	return result.value().getTypeInstance();
 }
 
 TypeInstance TypeSystem::getTypeAlias(std::string_view targetName) const
 {
-	return aliases.find_if([&](auto& pair) {
-		return pair.first == targetName;
-	})->second;
+	auto alias = aliases.find(targetName);
+	COMPILER_ASSERT("Type alias must already exist", alias);
+	return *alias;
 }
 
 bool TypeSystem::isTypeAlias(std::string_view name) const
 {
-	return aliases.find_if([&](auto& pair) {
-		return pair.first == name;
-	}) != aliases.end();
+	return aliases.contains(name);
 }
 
 TypePtr TypeSystem::getType(std::string_view name) const
@@ -0,0 +1,59 @@
+#pragma once
+#include <variant>
+#include <string>
+#include "Expr.h"
+#include "IntTypes.h"
+#include "Types.h"
+
+class ComputedExpr 
+{
+	using VarType = std::variant<std::string, u16, TypeInstance>;
+public:
+	ComputedExpr(SourcePosition sourcePos, VarType const& value);
+	ComputedExpr(SourcePosition sourcePos, VarType&& value);
+
+	std::string_view typeToString() const;
+	std::string toString() const;
+	Expr::UniquePtr toExpr() const;
+	TemplateBin::Argument toTemplateArgument() const;
+
+	bool isTypeInstance() const;
+	bool isInt() const;
+	bool isString() const;
+
+	TypeInstance const& getTypeInstance() const;
+	std::string const& getString() const;
+	u16 getInt() const;
+
+	SourcePosition sourcePos;
+private:
+	VarType value;
+};
+
+/* Evaluation:
+	What evaluating an expression at compile time gives, its value or why it has none.
+	An expression not being constant is an ordinary answer, so it is returned instead of
+	thrown and evaluating can be tried anywhere. Errors in the expression still throw.
+*/
+class Evaluation
+{
+public:
+	struct NotConstant
+	{
+		SourcePosition sourcePos;
+		std::string_view reason;
+	};
+
+	Evaluation(ComputedExpr value) : result(std::move(value)) {}
+	Evaluation(NotConstant notConstant) : result(notConstant) {}
+
+	bool hasValue() const { return std::holds_alternative<ComputedExpr>(result); }
+	explicit operator bool() const { return hasValue(); }
+
+	ComputedExpr& value() { return std::get<ComputedExpr>(result); }
+	ComputedExpr const& value() const { return std::get<ComputedExpr>(result); }
+	NotConstant const& error() const { return std::get<NotConstant>(result); }
+
+private:
+	std::variant<ComputedExpr, NotConstant> result;
+};
@@ -5,7 +5,8 @@
 #include "Stmt.h"
 #include "Expr.h"
 #include "Types.h"
-#include "ScopedContainer.h"
+#include "ComputedExpr.h"
+#include "ScopedTable.h"
 #include "IL.h"
 
 class TypeSystem
@@ -22,7 +23,12 @@ public:
 	TypePtr addArray(TypeInstance elementType, size_t elements);
 	TypePtr modifyAndAddArray(ListType const* arrayType, size_t elements);
 	void addAlias(std::string_view name, TypeInstance actualType);
+	// instances of a template are made once per set of arguments for the whole compilation
+	TypePtr getTemplateInstance(TemplateBin const* bin, std::vector<TemplateBin::Argument> const& args) const;
+	void addTemplateInstance(TemplateBin const* bin, std::vector<TemplateBin::Argument> args, TypePtr instance);
 
+	Evaluation evaluate(Expr::UniquePtr const& expr);
+	// throws when the expression is not a compile-time type
 	TypeInstance instantiateType(Expr::UniquePtr const& expr);
 	
 	TypeInstance getTypeAlias(std::string_view name) const;
@@ -42,15 +48,50 @@ private:
 		using DerivedType = std::remove_cvref_t<T>;
 		static_assert(std::is_base_of_v<Type, DerivedType>, "Must add type that derives from Type");
 		types.emplace_back(std::make_unique<DerivedType>(std::forward<T>(type)));
+		//the first type of a name is the one found by it
+		typesByName.emplace(types.back()->name(), types.back().get());
 		return types.back().get();
 	}
 
+	/* Structural Key:
+		What a function or list type is made of. Equal keys are the same type, so each
+		one is made once and comparing them is comparing pointers.
+	*/
+	struct StructuralKey
+	{
+		enum class Kind : u8 { Function, List } kind;
+		std::vector<TypeInstance> parts; //the parameters then the return type, or the element type
+		std::vector<size_t> dimensions;
+
+		bool operator==(StructuralKey const& other) const;
+		struct Hash { size_t operator()(StructuralKey const& key) const; };
+	};
+	TypePtr internType(StructuralKey key, auto makeType) 
+	{
+		auto [it, inserted] = structuralTypes.try_emplace(std::move(key), nullptr);
+		if (inserted) 
+		{
+			types.push_back(makeType(it->first));
+			it->second = types.back().get();
+		}
+		return it->second;
+	}
+
+	struct InstanceKey
+	{
+		TemplateBin const* bin;
+		std::vector<TemplateBin::Argument> args;
+
+		bool operator==(InstanceKey const& other) const = default;
+		struct Hash { size_t operator()(InstanceKey const& key) const; };
+	};
+
 	TemplateBin::Parameter compileTemplateDecl(Stmt::GenericDecl const& decl);
 	BinType::Field compileBinDecl(Stmt::VarDecl const& decl, size_t offset);
-	// Naming
-	std::string createFunctionName(std::vector<TypeInstance> const& paramTypes, TypeInstance const& returnType) const;
-
 	std::vector<std::unique_ptr<Type>> types;
-	ScopedContainer<std::unordered_map<std::string_view, TypeInstance>> aliases;
+	std::unordered_map<std::string_view, Type const*> typesByName; //views of the names the types own
+	std::unordered_map<StructuralKey, TypePtr, StructuralKey::Hash> structuralTypes;
+	std::unordered_map<InstanceKey, TypePtr, InstanceKey::Hash> templateInstances;
+	ScopedTable<std::string_view, TypeInstance> aliases;
 };
 
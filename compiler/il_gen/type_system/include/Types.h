@@ -3,34 +3,42 @@
 #include "Stmt.h"
 #include "CompilerError.h"
 
+/* Type Kind:
+	Every type stores which of the concrete types it is, so asking is a byte compare.
+	typesys::isa, dyn_cast and cast test and convert a TypePtr by it, visitType switches on it.
+*/
+enum class TypeKind : u8 { Bin, Function, Primitive, List, None, Template };
+
 class Type 
 {
 public:
-	Type(std::string name, size_t size)
-		: name(std::move(name)), size(size) {}
+	Type(TypeKind kind, std::string name, size_t size)
+		: size(size), kindTag(kind), cachedName(std::move(name)) {}
 	virtual ~Type() = default;
 
-	template<typename T>
-	T const* getExactType() const 
+	TypeKind kind() const { return kindTag; }
+
+	//structural types are made without a name, it is only spelled out once something prints it
+	std::string_view name() const 
 	{
-		return this->id() == typeid(T).hash_code() ? static_cast<T const*>(this) : nullptr;
+		if (cachedName.empty()) cachedName = spellName();
+		return cachedName;
 	}
 
-	std::string name;
 	size_t size;
 private:
-	virtual size_t id() const = 0;
+	virtual std::string spellName() const { return {}; }
+
+	TypeKind kindTag;
+	mutable std::string cachedName;
 };
 
 template<typename T>
-class TypeWithId : public Type
+class TypeWithKind : public Type
 {
 public:
-	using Type::Type;
-private:
-	virtual size_t id() const override {
-		return typeid(T).hash_code(); 
-	}
+	TypeWithKind(std::string name, size_t size)
+		: Type(T::KIND, std::move(name), size) {}
 };
 
 using TypePtr = Type const*;
@@ -47,8 +55,9 @@ struct TypeInstance
 	bool isMut, isRef, isOpt;
 };
 
-struct BinType final : TypeWithId<BinType>
+struct BinType final : TypeWithKind<BinType>
 {
+	static constexpr TypeKind KIND = TypeKind::Bin;
 	struct Field 
 	{
 		TypeInstance type;
@@ -56,25 +65,40 @@ struct BinType final : TypeWithId<BinType>
 		size_t offset;
 	};
 
-	using TypeWithId<BinType>::TypeWithId;
+	using TypeWithKind<BinType>::TypeWithKind;
 	std::vector<Field> members;
 };
 
-struct FunctionType final : TypeWithId<FunctionType>
+struct FunctionType final : TypeWithKind<FunctionType>
 {
-	FunctionType(std::string name, size_t size, std::vector<TypeInstance> paramTypes, TypeInstance returnType)
-		: TypeWithId<FunctionType>(std::move(name), size), params(std::move(paramTypes)), returnType(returnType) {}
+	static constexpr TypeKind KIND = TypeKind::Function;
+	FunctionType(size_t size, std::vector<TypeInstance> paramTypes, TypeInstance returnType)
+		: TypeWithKind<FunctionType>({}, size), params(std::move(paramTypes)), returnType(returnType) {}
 
 	std::vector<TypeInstance> params;
 	TypeInstance returnType;
+private:
+	virtual std::string spellName() const override 
+	{
+		std::string name = "(";
+		for (auto& param : params) 
+		{
+			if (name.size() > 1) name.push_back(',');
+			name += param.type->name();
+		}
+		name += ")->";
+		name += returnType.type->name();
+		return name;
+	}
 };
 
 
-struct PrimitiveType final : TypeWithId<PrimitiveType> 
+struct PrimitiveType final : TypeWithKind<PrimitiveType> 
 {
+	static constexpr TypeKind KIND = TypeKind::Primitive;
 	enum class SubType { void_, bool_, u8, i8, u16, i16 } subtype;
 	PrimitiveType(SubType subtype, std::string name, size_t size)
-		: TypeWithId<PrimitiveType>(std::move(name), size), subtype(subtype) {}
+		: TypeWithKind<PrimitiveType>(std::move(name), size), subtype(subtype) {}
 
 	bool isUnsigned() const 
 	{
@@ -109,10 +133,11 @@ struct PrimitiveType final : TypeWithId<PrimitiveType>
 	}
 };
 
-struct ListType final : TypeWithId<ListType>
+struct ListType final : TypeWithKind<ListType>
 {
-	ListType(std::string name, size_t size, TypeInstance elementType, std::vector<size_t> dimensions)
-		: TypeWithId<ListType>(std::move(name), size), elementType(std::move(elementType)), dimensions(std::move(dimensions)) {}
+	static constexpr TypeKind KIND = TypeKind::List;
+	ListType(size_t size, TypeInstance elementType, std::vector<size_t> dimensions)
+		: TypeWithKind<ListType>({}, size), elementType(std::move(elementType)), dimensions(std::move(dimensions)) {}
 
 	TypeInstance elementType;
 	std::vector<size_t> dimensions;
@@ -127,27 +152,72 @@ struct ListType final : TypeWithId<ListType>
 		}
 		return elements;
 	}
+private:
+	virtual std::string spellName() const override 
+	{
+		std::string name{ elementType.type->name() };
+		for (size_t dimension : dimensions) 
+		{
+			name += fmt::format("[{}]", dimension);
+		}
+		return name;
+	}
 };
 
-struct NoneType final : TypeWithId<NoneType>
+struct NoneType final : TypeWithKind<NoneType>
 {
-	using TypeWithId<NoneType>::TypeWithId;
+	static constexpr TypeKind KIND = TypeKind::None;
+	using TypeWithKind<NoneType>::TypeWithKind;
 };
 
 //templates 
-struct TemplateBin final : TypeWithId<TemplateBin> 
+struct TemplateBin final : TypeWithKind<TemplateBin> 
 {
+	static constexpr TypeKind KIND = TypeKind::Template;
 	struct TypeParameter {};
 	struct Parameter 
 	{
 		std::string_view name;
 		std::variant<TypeParameter, TypeInstance> type;
 	};
+	//an argument as the body sees it once it is substituted, a type without its qualifiers
+	using Argument = std::variant<std::string, u16, TypePtr>;
 
 	TemplateBin(std::string name)
-		: TypeWithId<TemplateBin>(std::move(name), 0) {}
+		: TypeWithKind<TemplateBin>(std::move(name), 0) {}
 	
 	std::vector<Parameter> templateParams;
 	std::vector<Stmt::VarDecl> body;
 };
 
+namespace typesys
+{
+	template<typename T>
+	bool isa(TypePtr type) { return type->kind() == T::KIND; }
+
+	template<typename T>
+	T const* dyn_cast(TypePtr type) { return isa<T>(type) ? static_cast<T const*>(type) : nullptr; }
+
+	template<typename T>
+	T const& cast(TypePtr type) 
+	{
+		COMPILER_ASSERT("Type is not of the kind it was cast to", isa<T>(type));
+		return static_cast<T const&>(*type);
+	}
+
+	// calls the callable with the concrete type
+	template<typename Callable>
+	decltype(auto) visitType(Type const& type, Callable&& callable)
+	{
+		switch (type.kind()) 
+		{
+		case TypeKind::Bin: return callable(static_cast<BinType const&>(type));
+		case TypeKind::Function: return callable(static_cast<FunctionType const&>(type));
+		case TypeKind::Primitive: return callable(static_cast<PrimitiveType const&>(type));
+		case TypeKind::List: return callable(static_cast<ListType const&>(type));
+		case TypeKind::None: return callable(static_cast<NoneType const&>(type));
+		case TypeKind::Template: return callable(static_cast<TemplateBin const&>(type));
+		}
+		COMPILER_NOT_REACHABLE;
+	}
+}
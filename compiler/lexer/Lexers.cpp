@@ -1,5 +1,6 @@
 #include "Lexer.h"
 #include "CharacterUtil.h"
+#include "CharacterScan.h"
 #include "StringUtil.h"
 #include "AsciiTable.h"
 #include "ReservedIdentifiers.h"
@@ -8,15 +9,39 @@
 
 using enum Token::Type;
 
-auto Lexer::generateTokens() -> std::vector<Token> {
+auto Lexer::generateTokens() -> TokenBuffer {
 	reset();
-	tokens.clear();
+	tokens = TokenBuffer(source, file);
+	//roughly one token every four characters, so the arrays rarely grow
+	tokens.reserve(source.size() / 4 + 1);
 	while (!atEnd()) {
 		tryToToken();
 	}
+	finish();
+	return std::move(tokens);
+}
+
+void Lexer::startStream()
+{
+	reset();
+	tokens = TokenBuffer(source, file);
+	finished = false;
+}
+
+auto Lexer::pull() -> TokenBuffer const& {
+	tokens.discardTokens();
+	while (tokens.empty() && !finished) {
+		if (atEnd()) finish();
+		else tryToToken();
+	}
+	return tokens;
+}
+
+void Lexer::finish()
+{
 	emptyIndentStackUntil(0);
 	addToken(EOF_);
-	return tokens;
+	finished = true;
 }
 
 auto Lexer::currentStringView() -> std::string_view {
@@ -49,36 +74,41 @@ void Lexer::emptyIndentStackUntil(size_t value)
 
 auto Lexer::calcSourcePos() -> SourcePosition
 {
-	return SourcePosition{line, currentPos()};
+	return SourcePosition(file, currentPos());
 }
 
 void Lexer::addNewline()
 {
 	if (nesting.empty()) {
-		if (!tokens.empty() && tokens.back().type != NEWLINE) {
+		if (auto last = tokens.lastType(); last && *last != NEWLINE) {
 			addWhitespaceToken(NEWLINE);
 		}
 		atStart = true;
 		currentSpaces = 0;
 	}
 	readjustStart();
-	line++;
 }
 
-void Lexer::addToken(Token::Type type, Token::Literal literal) 
+void Lexer::addToken(Token::Type type, u32 literal) 
 {
 	COMPILER_DEBUG {
 		if (type == NEWLINE || type == INDENT || type == DEDENT) { throw "Use addWhiteSpaceToken() instead"; }
 	}
 	if(nesting.empty()) checkIndentation();
-	tokens.push_back(Token(type, currentStringView(), literal, calcSourcePos()));
+	tokens.push(type, static_cast<u32>(currentPos()), static_cast<u32>(currentView().size), literal);
 	readjustStart();
 }
 
-void Lexer::addWhitespaceToken(Token::Type type, Token::Literal literal)
+void Lexer::addWhitespaceToken(Token::Type type)
+{
+	//a newline's lexeme is the line break, indents and dedents have none
+	u32 length = type == NEWLINE ? static_cast<u32>(currentView().size) : 0;
+	tokens.push(type, static_cast<u32>(currentPos()), length);
+}
+
+static size_t lineOf(SourcePosition position)
 {
-	std::string_view lexeme = type == NEWLINE ? "\n" : "";
-	tokens.push_back(Token(type, lexeme, literal, calcSourcePos()));
+	return SourceManager::instance().line(position);
 }
 
 void Lexer::tryToToken()
@@ -87,27 +117,27 @@ void Lexer::tryToToken()
 		token();
 	}
 	catch (UnexpectedCharacter const& err) {
-		spdlog::error("[Line: {}] Unknown character encountered: \'{}\'.", err.line, err.unexpected);
+		spdlog::error("[Line: {}] Unknown character encountered: \'{}\'.", lineOf(err.position), err.unexpected);
 	}
 	catch (UnmatchedNester const& err) {
-		spdlog::error("[Line: {}] Closing nester \'{}\' does not match opening nester: \'{}\' on line {}.", err.line, err.foundNester, err.prevNester, err.prevNesterLine);
+		spdlog::error("[Line: {}] Closing nester \'{}\' does not match opening nester: \'{}\' on line {}.", lineOf(err.position), err.foundNester, err.prevNester, lineOf(err.prevNesterPosition));
 	}
 	catch (ExpectedCharacter const& err) {
 		if (err.found.has_value()) {
-			spdlog::error("[Line: {}] Expected character: \'{}\', but found: \'{}\'.", err.line, err.expected, err.found.value());
+			spdlog::error("[Line: {}] Expected character: \'{}\', but found: \'{}\'.", lineOf(err.position), err.expected, err.found.value());
 		}
 		else {
-			spdlog::error("[Line: {}] Expected character: \'{}\', but reached the end of the file.", err.line, err.expected);
+			spdlog::error("[Line: {}] Expected character: \'{}\', but reached the end of the file.", lineOf(err.position), err.expected);
 		}
 	}
 	catch (ShortEllipses const& err) {
-		spdlog::error("[Line: {}] Ellipses consist of 3 consecutive periods, but only found 2.", err.line);
+		spdlog::error("[Line: {}] Ellipses consist of 3 consecutive periods, but only found 2.", lineOf(err.position));
 	}
 	catch (UnterminatedCharacterLiteral const& err) {
-		spdlog::error("[Line: {}] Unterminated Character Literal.", err.line);
+		spdlog::error("[Line: {}] Unterminated Character Literal.", lineOf(err.position));
 	}
 	catch (util::IntegralTypeTooSmall const&) {
-		spdlog::error("[Line: {}] Integral type is too large to fit in a 16 bit number.", line);
+		spdlog::error("[Line: {}] Integral type is too large to fit in a 16 bit number.", lineOf(calcSourcePos()));
 	}
 }
 
@@ -168,15 +198,15 @@ void Lexer::token() {
 
 void Lexer::identifier()
 {
-	consumeWhile(util::isIdentifier);
-	auto ident = currentStringView();
-	if (isOpcode(ident)) addToken(OPCODE);
+	skipRun(util::identifierRun);
+	auto reservedWord = reserved::find(currentStringView());
+	if (!reservedWord) {
+		addToken(IDENT);
+		return;
+	}
 	/*Very Special Case: af' is the only identifier that can end with "\'" */
-	else if (isRegisterAF(ident) && match('\'')) addToken(REGISTER);
-	else if (isRegister(ident)) addToken(REGISTER);
-	else if (isFlag(ident)) addToken(FLAG);
-	else if (auto [found, tokenType] = getKeyword(ident); found) addToken(tokenType);
-	else addToken(IDENT);
+	if (reservedWord->word == "af") match('\'');
+	addToken(reservedWord->type);
 }
 
 //needs to check for the end
@@ -199,7 +229,7 @@ void Lexer::character()
 
 void Lexer::string()
 {
-	std::string literal;
+	stringLiteral.clear();
 	bool escaped = false;
 	consumeWhile([&](char l) {
 		if (l == '\"') {
@@ -210,24 +240,24 @@ void Lexer::string()
 			return true;
 		}
 		else if (escaped) {
-			literal.push_back(util::toEscapedChar(l));
+			stringLiteral.push_back(util::toEscapedChar(l));
 			escaped = false;
 			return true;
 		}
 		else {
-			literal.push_back(l);
+			stringLiteral.push_back(l);
 			return true;
 		}
 	});
 	if (!match('\"')) {
 		expectedCharacter('\"');
 	}
-	addToken(STRING, literal);
+	addToken(STRING, tokens.intern(stringLiteral));
 }
 
 void Lexer::decimal()
 {
-	consumeWhile(util::isDigit);
+	skipRun(util::digitRun);
 	auto literal = util::decToIntegral<uint16_t>(currentStringView());
 	addToken(NUMBER, literal);
 }
@@ -261,7 +291,7 @@ void Lexer::removeNestingLevel(char current)
 	default: COMPILER_NOT_REACHABLE;
 	}
 	if (expects != nesting.top().first) {
-		throw UnmatchedNester(line, currentPos(), current, nesting.top().second.line, nesting.top().first);
+		throw UnmatchedNester(calcSourcePos(), current, nesting.top().second, nesting.top().first);
 	}
 	else {
 		nesting.pop();
@@ -269,34 +299,33 @@ void Lexer::removeNestingLevel(char current)
 }
 
 void Lexer::unexpectedCharacter(char letter) {
-	throw UnexpectedCharacter(letter, line, currentPos());
+	throw UnexpectedCharacter(letter, calcSourcePos());
 }
 
 void Lexer::shortEllipses() {
-	throw ShortEllipses(line, currentPos());
+	throw ShortEllipses(calcSourcePos());
 }
 
 void Lexer::expectedCharacter(char expect) {
 	std::optional<char> found = std::nullopt;
 	if (!atEnd()) found = peek();
-	throw ExpectedCharacter(expect, found, line, currentPos());
+	throw ExpectedCharacter(expect, found, calcSourcePos());
 }
 
 void Lexer::unterminatedCharacterLiteral()
 {
-	throw UnterminatedCharacterLiteral(line, currentPos());
+	throw UnterminatedCharacterLiteral(calcSourcePos());
 }
 
 void Lexer::whitespace() {
-	consumeWhile([&](char l) {
-		if (l == ' ') currentSpaces += 1;
-		else if (l == '\t') currentSpaces += 4;
-		return l == ' ' || l == '\t';
-	});
+	auto rest = remainingView();
+	auto run = util::blankRun(rest.data, rest.size);
+	currentSpaces += run.spaces + 4 * run.tabs;
+	skip(run.length);
 	readjustStart();
 }
 
 void Lexer::comment() {
-	consumeWhile(util::isNotNewline);
+	skipRun(util::lineRun);
 	readjustStart();
 }
\ No newline at end of file
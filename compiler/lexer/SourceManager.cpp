@@ -0,0 +1,76 @@
+#include "SourceManager.h"
+#include <algorithm>
+#include "CharacterScan.h"
+#include "CompilerError.h"
+
+SourceManager& SourceManager::instance()
+{
+	static SourceManager manager;
+	return manager;
+}
+
+SourceManager::SourceManager()
+	: sources(1) //file 0 is no file
+{
+}
+
+void SourceManager::checkSize(std::string_view name, std::string_view text)
+{
+	if (text.size() > SourcePosition::MAX_OFFSET) {
+		throw SourceLimitError(fmt::format("'{}' is {} bytes, a source can be at most {} bytes",
+			name.empty() ? "<source>" : name, text.size(), SourcePosition::MAX_OFFSET));
+	}
+}
+
+u32 SourceManager::add(std::string name, std::string_view text)
+{
+	if (sources.size() > SourcePosition::MAX_FILE) {
+		throw SourceLimitError(fmt::format("Cannot add '{}', a compilation can have at most {} sources",
+			name, SourcePosition::MAX_FILE));
+	}
+	checkSize(name, text);
+	sources.push_back(Source{ std::move(name), text, {} });
+	return static_cast<u32>(sources.size() - 1);
+}
+
+std::optional<u32> SourceManager::load(std::filesystem::path const& path)
+{
+	std::error_code error;
+	auto canonical = std::filesystem::canonical(path, error);
+	if (error) return std::nullopt;
+	auto loaded = std::find_if(sources.begin(), sources.end(), [&](Source const& source) { return source.path == canonical; });
+	if (loaded != sources.end()) return static_cast<u32>(loaded - sources.begin());
+
+	auto mapping = util::MappedFile::open(canonical);
+	if (!mapping.has_value()) return std::nullopt;
+	u32 file = add(path.generic_string(), mapping->text());
+	sources[file].path = std::move(canonical);
+	sources[file].mapping = std::move(mapping);
+	return file;
+}
+
+std::optional<u32> SourceManager::import(u32 from, std::string_view path)
+{
+	std::filesystem::path imported{ path };
+	if (imported.is_relative() && !sources[from].path.empty()) {
+		imported = sources[from].path.parent_path() / imported;
+	}
+	return load(imported);
+}
+
+LineColumn SourceManager::resolve(SourcePosition position)
+{
+	if (position.file() == 0) return LineColumn{ 0, position.offset() + 1 };
+	auto& source = sources[position.file()];
+	if (source.lineStarts.empty()) {
+		source.lineStarts.push_back(0);
+		for (size_t start = 0; start < source.text.size();) {
+			start += util::lineRun(source.text.data() + start, source.text.size() - start);
+			if (start < source.text.size()) source.lineStarts.push_back(static_cast<u32>(++start));
+		}
+	}
+	//the first start after the offset belongs to the next line
+	auto next = std::upper_bound(source.lineStarts.begin(), source.lineStarts.end(), position.offset());
+	size_t line = static_cast<size_t>(next - source.lineStarts.begin());
+	return LineColumn{ line, position.offset() - source.lineStarts[line - 1] + 1 };
+}
@@ -0,0 +1,51 @@
+#include "TokenBuffer.h"
+
+u32 LiteralPool::intern(std::string_view literal)
+{
+	if (auto found = indices.find(literal); found != indices.end()) {
+		return found->second;
+	}
+	u32 index = static_cast<u32>(literals.size());
+	auto& stored = literals.emplace_back(literal);
+	indices.emplace(stored, index);
+	return index;
+}
+
+void TokenBuffer::reserve(size_t count)
+{
+	types.reserve(count);
+	offsets.reserve(count);
+	lengths.reserve(count);
+	literals.reserve(count);
+}
+
+Token::Literal makeLiteral(Token::Type type, u32 literal, LiteralPool const& pool)
+{
+	switch (type) {
+	case Token::Type::NUMBER: return static_cast<u16>(literal);
+	case Token::Type::STRING: return std::string(pool.get(literal));
+	default: return std::monostate{};
+	}
+}
+
+void TokenBuffer::push(Token::Type type, u32 offset, u32 length, u32 literal)
+{
+	last = type;
+	types.push_back(type);
+	offsets.push_back(offset);
+	lengths.push_back(length);
+	literals.push_back(literal);
+}
+
+void TokenBuffer::discardTokens()
+{
+	types.clear();
+	offsets.clear();
+	lengths.clear();
+	literals.clear();
+}
+
+Token::Literal TokenBuffer::literal(size_t index) const
+{
+	return makeLiteral(types[index], literals[index], pool);
+}
@@ -0,0 +1,61 @@
+#include "TokenStream.h"
+#include <algorithm>
+#include "CompilerError.h"
+
+TokenStream::TokenStream(u32 file)
+	: source(SourceManager::instance().text(file)), lexer(file), ring(16)
+{
+	lexer.startStream();
+}
+
+TokenStream::TokenStream(std::string_view source)
+	: source(source), lexer(source), ring(16)
+{
+	lexer.startStream();
+}
+
+TokenRef TokenStream::operator[](size_t index)
+{
+	auto& entry = at(index);
+	return TokenRef{ entry.type, source.substr(entry.offset, entry.length), SourcePosition(lexer.fileId(), entry.offset), entry.literal, pool };
+}
+
+void TokenStream::release(size_t index)
+{
+	if (index < LOOKBEHIND || end == 0) return;
+	//the last token is kept, it is the EOF_ read past the end
+	first = std::max(first, std::min(index - LOOKBEHIND, end - 1));
+}
+
+auto TokenStream::at(size_t index) -> Entry const&
+{
+	while (index >= end && !finished) {
+		pull();
+	}
+	index = std::min(index, end - 1);
+	COMPILER_ASSERT("Token was released before it was read", index >= first);
+	return ring[index & (ring.size() - 1)];
+}
+
+void TokenStream::pull()
+{
+	auto& tokens = lexer.pull();
+	pool = &tokens.literalPool();
+	finished = tokens.empty();
+	for (size_t i = 0; i < tokens.size(); i++) {
+		if (end - first == ring.size()) grow();
+		ring[end & (ring.size() - 1)] = Entry{ tokens.type(i), tokens.sourcePos(i).offset(),
+			static_cast<u32>(tokens.lexeme(i).size()), tokens.value(i) };
+		end++;
+		finished |= tokens.type(i) == Token::Type::EOF_;
+	}
+}
+
+void TokenStream::grow()
+{
+	std::vector<Entry> larger(ring.size() * 2);
+	for (size_t i = first; i < end; i++) {
+		larger[i & (larger.size() - 1)] = ring[i & (ring.size() - 1)];
+	}
+	ring = std::move(larger);
+}
@@ -3,7 +3,8 @@
 #include <vector>
 #include <stdexcept>
 #include <stack>
-#include "Token.h"
+#include "TokenBuffer.h"
+#include "SourceManager.h"
 #include "StreamViewer.h"
 #include "ExpectationErrors.h"
 
@@ -13,41 +14,40 @@ public:
 	class LexicalError
 		: public std::exception {
 	public:
-		LexicalError(size_t line, size_t position)
-			: line(line), position(position) {}
+		LexicalError(SourcePosition position)
+			: position(position) {}
 
-		size_t line, position;
+		SourcePosition position;
 	};
 
 	class UnmatchedNester 
 		: public LexicalError {
 	public:
-		UnmatchedNester(size_t line, size_t position, char foundNester, size_t prevNesterLine, char prevNester)
-			: LexicalError(line, position), prevNesterLine(prevNesterLine), prevNester(prevNester), foundNester(foundNester) {}
+		UnmatchedNester(SourcePosition position, char foundNester, SourcePosition prevNesterPosition, char prevNester)
+			: LexicalError(position), prevNesterPosition(prevNesterPosition), prevNester(prevNester), foundNester(foundNester) {}
 
-		size_t prevNesterLine;
+		SourcePosition prevNesterPosition;
 		char prevNester, foundNester;
 	};
 
 	class ShortEllipses
 		: public LexicalError {
 	public:
-		ShortEllipses(size_t line, size_t pos)
-			: LexicalError(line, pos) {}
+		using LexicalError::LexicalError;
 	};
 
 	class UnexpectedCharacter
 		: public LexicalError, public UnexpectedError<char> {
 	public:
-		UnexpectedCharacter(char l, size_t line, size_t pos)
-			: LexicalError(line, pos), UnexpectedError<char>(l) {}
+		UnexpectedCharacter(char l, SourcePosition position)
+			: LexicalError(position), UnexpectedError<char>(l) {}
 	};
 
 	class ExpectedCharacter
 		: public LexicalError, public ExpectedError<char> {
 	public:
-		ExpectedCharacter(char e, std::optional<char> f, size_t line, size_t pos) 
-			: LexicalError(line, pos), ExpectedError<char>(e, f) {}
+		ExpectedCharacter(char e, std::optional<char> f, SourcePosition position) 
+			: LexicalError(position), ExpectedError<char>(e, f) {}
 	};
 
 	class UnterminatedCharacterLiteral
@@ -56,17 +56,32 @@ public:
 		using LexicalError::LexicalError;
 	};
 
+	// lexes a file of the SourceManager, the tokens point into its text
+	Lexer(u32 file)
+		: Lexer(SourceManager::instance().text(file), file) {}
+	// lexes text that is in no file, so its positions have no lines in diagnostics
 	Lexer(std::string_view source)
-		: StreamViewer<char>(source.data(), source.size()) {
-		indentStack.push(0);
+		: Lexer(source, 0) {
+		SourceManager::checkSize({}, source);
 	}
 
-	auto generateTokens()->std::vector<Token>;
+	u32 fileId() const { return file; }
+
+	auto generateTokens()->TokenBuffer;
+	//pull mode: every call discards the tokens of the last one and lexes until there are new ones, empty after EOF_
+	void startStream();
+	auto pull()->TokenBuffer const&;
 private:
+	Lexer(std::string_view source, u32 file)
+		: StreamViewer<char>(source.data(), source.size()), source(source), file(file) {
+		indentStack.push(0);
+	}
+
+	void finish();
 	auto currentStringView()->std::string_view;
 
-	void addToken(Token::Type type, Token::Literal literal = Token::Literal());
-	void addWhitespaceToken(Token::Type type, Token::Literal literal = Token::Literal());
+	void addToken(Token::Type type, u32 literal = 0);
+	void addWhitespaceToken(Token::Type type);
 	void checkIndentation();
 	void emptyIndentStackUntil(size_t value);
 	void addNestingLevel(char current);
@@ -86,14 +101,23 @@ private:
 	void hexidecimal();
 	void binary();
 
+	//skips the characters the scanner says belong to the current run
+	void skipRun(auto scanner) {
+		auto rest = remainingView();
+		skip(scanner(rest.data, rest.size));
+	}
+
 	void unexpectedCharacter(char letter);
 	void expectedCharacter(char letter);
 	void shortEllipses();
 	void unterminatedCharacterLiteral();
 
-	std::vector<Token> tokens;
+	std::string_view source;
+	u32 file;
+	TokenBuffer tokens;
+	std::string stringLiteral; //reused by every string literal before it is interned
 	std::stack<size_t> indentStack;
-	size_t line = 1, currentSpaces = 0;
+	size_t currentSpaces = 0;
 	std::stack<std::pair<char, SourcePosition>> nesting;
-	bool atStart = true;
+	bool atStart = true, finished = false;
 };
\ No newline at end of file
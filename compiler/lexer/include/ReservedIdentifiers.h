@@ -0,0 +1,136 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include "Token.h"
+
+// Every Z80 mnemonic, the assembler indexes its formats by these
+enum class Opcode : u8 {
+	ADC, ADD, AND, BIT, CALL, CCF, CP, CPD, CPDR, CPI, CPIR, CPL, DAA, DEC, DI, DJNZ, EI, EX, EXX, HALT,
+	IM, IN, INC, IND, INDR, INI, INIR, JP, JR, LD, LDD, LDDR, LDI, LDIR, NEG, NOP, OR, OTDR, OTIR, OUT, OUTD, OUTI,
+	POP, PUSH, RES, RET, RETI, RETN, RL, RLA, RLC, RLCA, RLD, RR, RRA, RRC, RRCA, RRD, RST,
+	SBC, SCF, SET, SLA, SRA, SRL, SUB, XOR,
+	NONE
+};
+
+struct ReservedWord
+{
+	std::string_view word;
+	Token::Type type;
+	Opcode opcode = Opcode::NONE;
+};
+
+/* Reserved Identifiers:
+	The words the lexer does not give back as identifiers. Opcodes, registers and flags
+	are matched in any case, keywords only in lower case. A word that is more than one
+	of them takes the first of opcode, register, flag and keyword, so "and" is an
+	opcode and "c" a register.
+	The words are found through a perfect hash built at compile time: one hash of the
+	lower cased word picks the only entry it can be, and one compare confirms it.
+*/
+namespace reserved
+{
+	using enum Token::Type;
+	inline constexpr auto words = std::to_array<ReservedWord>({
+		{"adc", OPCODE, Opcode::ADC}, {"add", OPCODE, Opcode::ADD}, {"and", OPCODE, Opcode::AND}, {"bit", OPCODE, Opcode::BIT},
+		{"call", OPCODE, Opcode::CALL}, {"ccf", OPCODE, Opcode::CCF}, {"cp", OPCODE, Opcode::CP}, {"cpd", OPCODE, Opcode::CPD},
+		{"cpdr", OPCODE, Opcode::CPDR}, {"cpi", OPCODE, Opcode::CPI}, {"cpir", OPCODE, Opcode::CPIR}, {"cpl", OPCODE, Opcode::CPL},
+		{"daa", OPCODE, Opcode::DAA}, {"dec", OPCODE, Opcode::DEC}, {"di", OPCODE, Opcode::DI}, {"djnz", OPCODE, Opcode::DJNZ},
+		{"ei", OPCODE, Opcode::EI}, {"ex", OPCODE, Opcode::EX}, {"exx", OPCODE, Opcode::EXX}, {"halt", OPCODE, Opcode::HALT},
+		{"im", OPCODE, Opcode::IM}, {"in", OPCODE, Opcode::IN}, {"inc", OPCODE, Opcode::INC}, {"ind", OPCODE, Opcode::IND},
+		{"indr", OPCODE, Opcode::INDR}, {"ini", OPCODE, Opcode::INI}, {"inir", OPCODE, Opcode::INIR}, {"jp", OPCODE, Opcode::JP},
+		{"jr", OPCODE, Opcode::JR}, {"ld", OPCODE, Opcode::LD}, {"ldd", OPCODE, Opcode::LDD}, {"lddr", OPCODE, Opcode::LDDR},
+		{"ldi", OPCODE, Opcode::LDI}, {"ldir", OPCODE, Opcode::LDIR}, {"neg", OPCODE, Opcode::NEG}, {"nop", OPCODE, Opcode::NOP},
+		{"or", OPCODE, Opcode::OR}, {"otdr", OPCODE, Opcode::OTDR}, {"otir", OPCODE, Opcode::OTIR}, {"out", OPCODE, Opcode::OUT},
+		{"outd", OPCODE, Opcode::OUTD}, {"outi", OPCODE, Opcode::OUTI}, {"pop", OPCODE, Opcode::POP}, {"push", OPCODE, Opcode::PUSH},
+		{"res", OPCODE, Opcode::RES}, {"ret", OPCODE, Opcode::RET}, {"reti", OPCODE, Opcode::RETI}, {"retn", OPCODE, Opcode::RETN},
+		{"rl", OPCODE, Opcode::RL}, {"rla", OPCODE, Opcode::RLA}, {"rlc", OPCODE, Opcode::RLC}, {"rlca", OPCODE, Opcode::RLCA},
+		{"rld", OPCODE, Opcode::RLD}, {"rr", OPCODE, Opcode::RR}, {"rra", OPCODE, Opcode::RRA}, {"rrc", OPCODE, Opcode::RRC},
+		{"rrca", OPCODE, Opcode::RRCA}, {"rrd", OPCODE, Opcode::RRD}, {"rst", OPCODE, Opcode::RST}, {"sbc", OPCODE, Opcode::SBC},
+		{"scf", OPCODE, Opcode::SCF}, {"set", OPCODE, Opcode::SET}, {"sla", OPCODE, Opcode::SLA}, {"sra", OPCODE, Opcode::SRA},
+		{"srl", OPCODE, Opcode::SRL}, {"sub", OPCODE, Opcode::SUB}, {"xor", OPCODE, Opcode::XOR},
+
+		{"a", REGISTER}, {"b", REGISTER}, {"c", REGISTER}, {"d", REGISTER}, {"e", REGISTER}, {"h", REGISTER}, {"l", REGISTER},
+		{"ix", REGISTER}, {"iy", REGISTER}, {"sp", REGISTER}, {"pc", REGISTER}, {"af", REGISTER}, {"bc", REGISTER},
+		{"de", REGISTER}, {"hl", REGISTER}, {"i", REGISTER}, {"r", REGISTER},
+
+		{"p", FLAG}, {"m", FLAG}, {"z", FLAG}, {"nz", FLAG}, {"nc", FLAG}, {"po", FLAG}, {"pe", FLAG},
+
+		{"fn", FN}, {"bin", BIN}, {"let", LET}, {"if", IF}, {"else", ELSE}, {"type", TYPE}, {"as", AS}, {"sizeof", SIZEOF},
+		{"ref", REF}, {"count", COUNT}, {"with", WITH}, {"from", FROM}, {"mut", MUT}, {"true", TRUE}, {"false", FALSE},
+		{"none", NONE}, {"return", RETURN}, {"module", MODULE}, {"import", IMPORT}, {"export", EXPORT}
+	});
+
+	namespace detail
+	{
+		constexpr size_t TABLE_SIZE = 1024;
+		constexpr u8 EMPTY = 0xFF;
+		static_assert(words.size() < EMPTY);
+
+		constexpr char lower(char l) {
+			return 'A' <= l && l <= 'Z' ? static_cast<char>(l - 'A' + 'a') : l;
+		}
+		constexpr bool ignoresCase(Token::Type type) {
+			return type == OPCODE || type == REGISTER || type == FLAG;
+		}
+		//FNV-1a over the lower cased word
+		constexpr u32 hash(std::string_view word, u32 seed) {
+			u32 hash = seed;
+			for (char l : word) hash = (hash ^ static_cast<u8>(lower(l))) * 16777619u;
+			return hash;
+		}
+
+		constexpr size_t longestWord() {
+			size_t longest = 0;
+			for (auto& entry : words) longest = std::max(longest, entry.word.size());
+			return longest;
+		}
+
+		constexpr bool isPerfect(u32 seed) {
+			std::array<bool, TABLE_SIZE> taken{};
+			for (auto& entry : words) {
+				auto slot = hash(entry.word, seed) % TABLE_SIZE;
+				if (taken[slot]) return false;
+				taken[slot] = true;
+			}
+			return true;
+		}
+		//searching starts from a seed known to work for the words above, so it ends at once unless they change
+		constexpr u32 findSeed(u32 seed) {
+			while (!isPerfect(seed)) seed++;
+			return seed;
+		}
+		constexpr u32 SEED = findSeed(2166136497u);
+
+		constexpr auto makeSlots() {
+			std::array<u8, TABLE_SIZE> slots{};
+			for (auto& slot : slots) slot = EMPTY;
+			for (size_t index = 0; index < words.size(); ++index) {
+				slots[hash(words[index].word, SEED) % TABLE_SIZE] = static_cast<u8>(index);
+			}
+			return slots;
+		}
+		inline constexpr auto slots = makeSlots();
+		constexpr size_t LONGEST_WORD = longestWord();
+	}
+
+	//nullptr when the word is an identifier
+	constexpr ReservedWord const* find(std::string_view word) {
+		using namespace detail;
+		if (word.empty() || word.size() > LONGEST_WORD) return nullptr;
+		auto index = slots[hash(word, SEED) % TABLE_SIZE];
+		if (index == EMPTY) return nullptr;
+		auto& entry = words[index];
+		if (entry.word.size() != word.size()) return nullptr;
+		if (!ignoresCase(entry.type)) return entry.word == word ? &entry : nullptr;
+		for (size_t i = 0; i < word.size(); ++i) {
+			if (lower(word[i]) != entry.word[i]) return nullptr;
+		}
+		return &entry;
+	}
+
+	constexpr Opcode findOpcode(std::string_view word) {
+		auto entry = find(word);
+		return entry ? entry->opcode : Opcode::NONE;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+#include "SourcePosition.h"
+#include "MappedFile.h"
+
+struct LineColumn
+{
+	size_t line, column;
+};
+
+// a source is larger than a position can point into, or there are more than it can tell apart
+class SourceLimitError
+	: public std::runtime_error {
+public:
+	using std::runtime_error::runtime_error;
+};
+
+/* Source Manager:
+	Hands out the file ids of the sources in a compilation and turns positions in them
+	back into lines and columns. Files are mapped read-only and stay mapped for the whole
+	compilation, so tokens and names can point straight into them. Loading a file twice,
+	like two imports of it, gives the same id; ids are handed out in load order, so files
+	found while compiling come after the ones that imported them.
+	A source's line starts are only found the first time one of its positions is
+	resolved, so nothing tracks lines while lexing.
+*/
+class SourceManager
+{
+public:
+	static SourceManager& instance();
+
+	// the text has to outlive the manager, throws SourceLimitError when it does not fit
+	u32 add(std::string name, std::string_view text);
+	// nothing when the file cannot be read, throws SourceLimitError when it does not fit
+	std::optional<u32> load(std::filesystem::path const& path);
+	// throws SourceLimitError when a position cannot point into all of the text
+	static void checkSize(std::string_view name, std::string_view text);
+	// imports are found relative to the directory of the file importing them
+	std::optional<u32> import(u32 from, std::string_view path);
+	u32 count() const { return static_cast<u32>(sources.size()); }
+	std::string_view name(u32 file) const { return sources[file].name; }
+	std::string_view text(u32 file) const { return sources[file].text; }
+
+	// lines and columns count from 1, a position in no file is line 0
+	LineColumn resolve(SourcePosition position);
+	size_t line(SourcePosition position) { return resolve(position).line; }
+
+private:
+	SourceManager();
+
+	struct Source
+	{
+		std::string name;
+		std::string_view text;
+		std::vector<u32> lineStarts; //empty until a position in the source is resolved
+		std::filesystem::path path; //empty for sources that were added from memory
+		std::optional<util::MappedFile> mapping;
+	};
+	std::deque<Source> sources; //names and lines are handed out as views, so sources never move
+};
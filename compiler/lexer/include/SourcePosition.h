@@ -1,6 +1,29 @@
-
 #pragma once
+#include <cassert>
+#include "IntTypes.h"
 
+/* Source Position:
+	A file id and a byte offset into that file, packed into 32 bits. Lines and columns
+	are only needed by diagnostics, the SourceManager works them out from the offset.
+	File id 0 is no file, it is what a default constructed position points to, and
+	where text lexed on its own is. The SourceManager and Lexer refuse sources that
+	do not fit, so a position that does not fit is a bug in the compiler.
+*/
 struct SourcePosition {
-	size_t line, pos;
+	static constexpr u32 FILE_BITS = 10, OFFSET_BITS = 32 - FILE_BITS;
+	static constexpr u32 MAX_FILE = (1u << FILE_BITS) - 1, MAX_OFFSET = (1u << OFFSET_BITS) - 1;
+
+	SourcePosition() = default;
+	SourcePosition(u32 file, size_t offset)
+		: handle((file << OFFSET_BITS) | static_cast<u32>(offset)) {
+		assert(file <= MAX_FILE && offset <= MAX_OFFSET && "Source position does not fit in 32 bits.");
+	}
+
+	u32 file() const { return handle >> OFFSET_BITS; }
+	u32 offset() const { return handle & MAX_OFFSET; }
+	SourcePosition advancedBy(u32 count) const { return SourcePosition(file(), offset() + count); }
+
+	bool operator==(SourcePosition const&) const = default;
+
+	u32 handle = 0;
 };
@@ -0,0 +1,98 @@
+#pragma once
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Token.h"
+
+// Every distinct string literal is stored once, its index stays valid for the life of the pool
+class LiteralPool
+{
+public:
+	LiteralPool() = default;
+	// the keys point into this pool's strings, a copy's would point into the original
+	LiteralPool(LiteralPool const&) = delete;
+	LiteralPool& operator=(LiteralPool const&) = delete;
+	// moving a deque takes its strings along, so the keys move with them
+	LiteralPool(LiteralPool&&) = default;
+	LiteralPool& operator=(LiteralPool&&) = default;
+
+	u32 intern(std::string_view literal);
+	std::string_view get(u32 index) const { return literals[index]; }
+	size_t size() const { return literals.size(); }
+
+private:
+	std::deque<std::string> literals; //a deque never moves its strings, so the keys stay valid
+	std::unordered_map<std::string_view, u32> indices;
+};
+
+// the owning literal of a token, from the value a buffer stores for it
+Token::Literal makeLiteral(Token::Type type, u32 literal, LiteralPool const& pool);
+
+struct TokenRef;
+
+/* Token Buffer:
+	The tokens of a source as parallel arrays: the type, the offset and length of the lexeme
+	in the source, and a literal. The literal of a NUMBER is its value and the literal of a
+	STRING its index in the pool, other tokens have none. A token's position is its
+	offset, the SourceManager finds its line when a diagnostic needs it.
+	The lexemes point into the source, so it has to outlive the buffer.
+	A streaming lexer reuses one buffer, discarding the tokens that were read while the
+	pool keeps growing.
+*/
+class TokenBuffer
+{
+public:
+	TokenBuffer(std::string_view source = {}, u32 file = 0)
+		: source(source), file(file) {}
+
+	void reserve(size_t count);
+	void push(Token::Type type, u32 offset, u32 length, u32 literal = 0);
+	u32 intern(std::string_view literal) { return pool.intern(literal); }
+	void discardTokens();
+
+	size_t size() const { return types.size(); }
+	bool empty() const { return types.empty(); }
+	// the type of the last token pushed, even when it was discarded since
+	std::optional<Token::Type> lastType() const { return last; }
+	LiteralPool const& literalPool() const { return pool; }
+
+	Token::Type type(size_t index) const { return types[index]; }
+	std::string_view lexeme(size_t index) const { return source.substr(offsets[index], lengths[index]); }
+	u32 value(size_t index) const { return literals[index]; }
+	u16 number(size_t index) const { return static_cast<u16>(literals[index]); }
+	std::string_view string(size_t index) const { return pool.get(literals[index]); }
+	// owning, only for the tokens the AST keeps
+	Token::Literal literal(size_t index) const;
+	SourcePosition sourcePos(size_t index) const { return SourcePosition(file, offsets[index]); }
+
+	TokenRef operator[](size_t index) const;
+
+private:
+	std::string_view source;
+	u32 file;
+	std::vector<Token::Type> types;
+	std::vector<u32> offsets, lengths, literals;
+	std::optional<Token::Type> last;
+	LiteralPool pool;
+};
+
+// A token read from a buffer or a stream, cheap to copy. It stays valid as long as the source and the pool.
+struct TokenRef
+{
+	Token::Type type;
+	std::string_view lexeme;
+	SourcePosition position;
+	u32 value;
+	LiteralPool const* pool;
+
+	Token::Literal literal() const { return makeLiteral(type, value, *pool); }
+	SourcePosition sourcePos() const { return position; }
+};
+
+inline TokenRef TokenBuffer::operator[](size_t index) const
+{
+	return TokenRef{ types[index], lexeme(index), sourcePos(index), literals[index], &pool };
+}
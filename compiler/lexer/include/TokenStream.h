@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "Lexer.h"
+
+/* Token Stream:
+	Lexes on demand while the parser reads, so a source is lexed and parsed in one pass.
+	The tokens live in a ring that only holds the ones the reader can still look at, from
+	the one behind its position up to the furthest it looked ahead. A burst that does not
+	fit, like the dedents closing a deep block, doubles the ring, so its size follows the
+	nesting of the source and not its length.
+*/
+class TokenStream
+{
+public:
+	static constexpr size_t LOOKBEHIND = 1;
+
+	TokenStream(u32 file);
+	// streams text that is in no file, like Lexer(std::string_view)
+	TokenStream(std::string_view source);
+	TokenStream(TokenStream const&) = delete;
+	TokenStream& operator=(TokenStream const&) = delete;
+
+	// past the end every index reads EOF_
+	Token::Type type(size_t index) { return at(index).type; }
+	TokenRef operator[](size_t index);
+	// the reader moved to index, the tokens more than LOOKBEHIND before it can be overwritten
+	void release(size_t index);
+	size_t capacity() const { return ring.size(); }
+
+private:
+	struct Entry
+	{
+		Token::Type type;
+		u32 offset, length, literal;
+	};
+
+	Entry const& at(size_t index);
+	void pull();
+	void grow();
+
+	std::string_view source;
+	Lexer lexer;
+	LiteralPool const* pool = nullptr;
+	std::vector<Entry> ring; //the size is a power of two
+	size_t first = 0, end = 0; //absolute indices of the tokens held
+	bool finished = false;
+};
@@ -18,122 +18,88 @@ Expr::UniquePtr ExprParser::typeExpr() {
 
 Expr::UniquePtr ExprParser::nestedExpr()
 {
-	return logical();
+	return binary(1);
 }
 
-Expr::UniquePtr ExprParser::logical()
+/* Binding Powers:
+	How tightly each binary operator holds its operands, from || up to as. Tokens
+	that are not a binary operator have none. A >> is lexed as > >> > and only
+	becomes a SHIFT_RIGHT once peekBinary() sees the whole of it.
+*/
+namespace
 {
-	auto lhs = bitwise();
-	while (matchType(OR) || (!context.isInTypeMode() && matchType(AND))) {
-		Token::Type oper = previousType(); //order of function eval unspecified
-		SourcePosition sourcePos = previousSourcePos();
-		auto rhs = bitwise();
-		lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), oper, std::move(rhs));
-	}
-	return lhs;
-}
-
-Expr::UniquePtr ExprParser::bitwise()
-{
-	auto lhs = comparison();
-	while (matchType(BIT_XOR, BIT_OR)
-		|| (!context.isInTypeMode() && matchType(BIT_AND))) {
-		Token::Type oper = previousType();
-		SourcePosition sourcePos = previousSourcePos();
-		auto rhs = comparison();
-		lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), oper, std::move(rhs));
-	}
-	return lhs;
-}
-
-Expr::UniquePtr ExprParser::comparison()
-{
-	auto lhs = equality();
+	constexpr auto BINDING_POWERS = [] {
+		std::array<u8, static_cast<size_t>(EOF_) + 1> powers{};
+		auto set = [&](u8 power, auto...types) { ((powers[static_cast<size_t>(types)] = power), ...); };
+		set(1, OR, AND);
+		set(2, BIT_XOR, BIT_OR, BIT_AND);
+		set(3, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL);
+		set(4, EQUAL_EQUAL, NOT_EQUAL);
+		set(5, SHIFT_LEFT, SHIFT_RIGHT);
+		set(6, PLUS, MINUS);
+		set(7, STAR, SLASH, MODULO);
+		set(8, AS);
+		return powers;
+	}();
 
-	while (matchType(LESS_EQUAL, GREATER_EQUAL) 
-		|| (context.isNested() && matchType(GREATER))
-		|| (!context.isInTemplateMode() && matchType(GREATER))
-		|| (!shouldMatchTemplate() && matchType(LESS))
-	) 
-	{
-		Token::Type oper = previousType();
-		SourcePosition sourcePos = previousSourcePos();
-		auto rhs = equality();
-		lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), oper, std::move(rhs));
+	u8 bindingPower(Token::Type type) {
+		return BINDING_POWERS[static_cast<size_t>(type)];
 	}
-	return lhs;
 }
 
-Expr::UniquePtr ExprParser::equality()
+Expr::UniquePtr ExprParser::binary(u8 minPower)
 {
-	auto lhs = bitshift();
-	while (matchType(EQUAL_EQUAL, NOT_EQUAL)) {
-		Token::Type oper = previousType();
+	auto lhs = unary();
+	while (auto oper = peekBinary()) {
+		u8 power = bindingPower(*oper);
+		if (power < minPower) break;
+		consumeBinary(*oper);
 		SourcePosition sourcePos = previousSourcePos();
-		auto rhs = bitshift();
-		lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), oper, std::move(rhs));
-	}
-	return lhs;
-}
-
-Expr::UniquePtr ExprParser::bitshift()
-{
-	auto lhs = term();
-	auto matchShiftRight = [&]() { 
-		if (peekNext().type == GREATER_CONCATENATOR) { 
-			expect(GREATER);
-			matchType(GREATER_CONCATENATOR);
-			expect(GREATER);
-			return true;
-		} 
-		return false;
-	};
-	while (matchType(SHIFT_LEFT)
-		|| (context.isNested() && matchShiftRight())
-		|| (!context.isInTemplateMode() && matchShiftRight())
-		) 
-	{
-		Token::Type oper = previousType() == GREATER ? SHIFT_RIGHT : SHIFT_LEFT;
-		SourcePosition sourcePos = previousSourcePos();
-		auto rhs = term();
-		lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), oper, std::move(rhs));
+		//every operator is left associative, so the right side only takes tighter ones
+		auto rhs = binary(power + 1);
+		if (*oper == AS) {
+			lhs = Expr::makeExpr<Expr::Cast>(sourcePos, std::move(lhs), std::move(rhs));
+		}
+		else {
+			lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), *oper, std::move(rhs));
+		}
 	}
 	return lhs;
 }
 
-Expr::UniquePtr ExprParser::term()
+std::optional<Token::Type> ExprParser::peekBinary() const
 {
-	auto lhs = factor();
-	while (matchType(PLUS, MINUS)) {
-		Token::Type oper = previousType();
-		SourcePosition sourcePos = previousSourcePos();
-		auto rhs = factor();
-		lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), oper, std::move(rhs));
+	auto type = peekType();
+	switch (type) {
+	case AND: case BIT_AND:
+		//in a type they make references
+		if (context.isInTypeMode()) return std::nullopt;
+		break;
+	case LESS:
+		if (shouldMatchTemplate()) return std::nullopt;
+		break;
+	case GREATER:
+		//unless nested, a > in a template argument list closes it
+		if (!context.isNested() && context.isInTemplateMode()) return std::nullopt;
+		if (peekNext().type == GREATER_CONCATENATOR) return SHIFT_RIGHT;
+		break;
+	default:
+		break;
 	}
-	return lhs;
+	if (bindingPower(type) == 0) return std::nullopt;
+	return type;
 }
 
-Expr::UniquePtr ExprParser::factor()
+void ExprParser::consumeBinary(Token::Type oper)
 {
-	auto lhs = cast();
-	while (matchType(STAR, SLASH, MODULO)) {
-		Token::Type oper = previousType();
-		SourcePosition sourcePos = previousSourcePos();
-		auto rhs = cast();
-		lhs = Expr::makeExpr<Expr::Binary>(sourcePos, std::move(lhs), oper, std::move(rhs));
+	if (oper == SHIFT_RIGHT) {
+		expect(GREATER);
+		matchType(GREATER_CONCATENATOR);
+		expect(GREATER);
 	}
-	return lhs;
-}
-
-Expr::UniquePtr ExprParser::cast()
-{
-	auto expr = unary();
-	while (matchType(AS)) {
-		SourcePosition sourcePos = previousSourcePos();
-		auto type = unary();
-		expr = Expr::makeExpr<Expr::Cast>(sourcePos, std::move(expr), std::move(type));
+	else {
+		advance();
 	}
-	return expr;
 }
 
 Expr::UniquePtr ExprParser::unary()
@@ -147,7 +113,7 @@ Expr::UniquePtr ExprParser::unary()
 		{
 			type = BIT_AND;
 			rhs = Expr::makeExpr<Expr::Unary>(sourcePos, type, std::move(rhs));
-			sourcePos.pos++;
+			sourcePos = sourcePos.advancedBy(1);
 		}
 		return Expr::makeExpr<Expr::Unary>(sourcePos, type, std::move(rhs));
 	}
@@ -244,7 +210,7 @@ Expr::UniquePtr ExprParser::primary()
 		return Expr::makeExpr<Expr::Flag>(previousSourcePos(), peekPrevious().lexeme);
 	}
 	else if (matchType(NUMBER, STRING)) {
-		return Expr::makeExpr<Expr::Literal>(previousSourcePos(), peekPrevious().literal);
+		return Expr::makeExpr<Expr::Literal>(previousSourcePos(), peekPrevious().literal());
 	}
 	else if (matchType(SIZEOF, REF)) {
 		auto pos = previousSourcePos();
@@ -297,7 +263,7 @@ Expr::UniquePtr ExprParser::primary()
 
 bool ExprParser::shouldMatchTemplate() const
 {
-	auto& prev = peekPrevious();
+	auto prev = peekPrevious();
 	return prev.type == IDENT && context.isTemplate(prev.lexeme);
 }
 
@@ -334,5 +300,5 @@ Token::Type ExprParser::previousType() const
 
 SourcePosition ExprParser::previousSourcePos() const
 {
-	return peekPrevious().sourcePos;
+	return peekPrevious().sourcePos();
 }
@@ -42,9 +42,13 @@ auto StmtParser::importStmt(bool shouldExport) -> Stmt::UniquePtr
 	if (shouldExport) TokenErrorMessage(peek(), "Import Statement cannot be exported.");
 	auto sourcePos = previousSourcePos();
 	if (matchType(STRING)) {
-		auto file = peekPrevious().lexeme;
+		//the path between the quotes, it points into the importing file and lives as long as it
+		auto token = peekPrevious();
+		auto file = token.lexeme.substr(1, token.lexeme.size() - 2);
+		auto fileId = SourceManager::instance().import(sourcePos.file(), file);
+		if (!fileId.has_value()) throw TokenErrorMessage(token, fmt::format("Cannot open imported file \"{}\".", file));
 		expect(NEWLINE);
-		return Stmt::makeStmt<Stmt::Import>(sourcePos, file);
+		return Stmt::makeStmt<Stmt::Import>(sourcePos, file, fileId.value());
 	}
 	else {
 		throw TokenErrorMessage(peek(), "Import statement expects a string.");
@@ -5,6 +5,7 @@
 #include <optional>
 #include "Token.h"
 #include "Visitors.h"
+#include "Arena.h"
 
 namespace Expr 
 {
@@ -17,9 +18,25 @@ namespace Expr
 		struct KeyworkFunctionCall
 	> {
 	public:
+		// destroys an unshared node, shared ones belong to the Interner
+		struct Release
+		{
+			void operator()(Expr* expr) const;
+		};
+		using Owner = std::unique_ptr<Expr, Release>;
 		SourcePosition sourcePos;
+
+		bool isShared() const { return shared; }
+	private:
+		friend class Interner;
+		bool shared = false;
 	};
 
+	inline void Expr::Release::operator()(Expr* expr) const
+	{
+		if (!expr->shared) expr->~Expr();
+	}
+
 	template<typename Derived>
 	class CloneVisitor : public Expr::CloneVisitor<Derived> {};
 	
@@ -31,13 +48,16 @@ namespace Expr
 	template<typename T>
 	class ConstVisitorReturner : public Expr::ConstVisitorReturnerType<T> {};
 
-	using UniquePtr = std::unique_ptr<Expr>;
+	//nodes live in the current arena, a UniquePtr only destroys its node, and only when it is not shared
+	using UniquePtr = Expr::Owner;
+	//a node shared through the Interner, every holder sees the same node, so it is only read
+	using Shared = Expr const*;
 
 	template<typename T, typename...Args>
 	UniquePtr makeExpr(SourcePosition sourcePos, Args&&...args) {
-		auto expr = std::make_unique<T>(T{ std::forward<Args>(args)... });
+		T* expr = util::Arena::current().make<T>(T{ std::forward<Args>(args)... });
 		expr->sourcePos = sourcePos;
-		return expr;
+		return UniquePtr(expr);
 	}
 
 	struct Binary : Expr::Visitable<Binary> 
@@ -11,6 +11,13 @@ namespace Expr
 	{
 	public:
 		Cloner() = default;
+
+		using Expr::CloneVisitor<Cloner>::clone;
+		//a shared tree never changes, so its clone is the same tree
+		UniquePtr clone(UniquePtr const& expr) {
+			if (expr->isShared()) return UniquePtr(expr.get());
+			return Expr::CloneVisitor<Cloner>::clone(expr);
+		}
 		
 		virtual void visit(Binary const& expr) override {
 			returnCloned(expr, clone(expr.lhs), expr.oper, clone(expr.rhs));
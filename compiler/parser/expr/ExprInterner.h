@@ -0,0 +1,178 @@
+#pragma once
+#include <algorithm>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Expr.h"
+#include "Arena.h"
+
+namespace Expr
+{
+	namespace detail
+	{
+		// the members of a node in the order its constructor takes them
+		template<typename Node>
+		auto fieldsOf(Node& node) {
+			using T = std::remove_const_t<Node>;
+			if constexpr (std::is_same_v<T, Binary>) return std::tie(node.lhs, node.oper, node.rhs);
+			else if constexpr (std::is_same_v<T, Unary>) return std::tie(node.oper, node.expr);
+			else if constexpr (std::is_same_v<T, Parenthesis>) return std::tie(node.expr);
+			else if constexpr (std::is_same_v<T, FunctionCall>) return std::tie(node.lhs, node.arguments);
+			else if constexpr (std::is_same_v<T, KeyworkFunctionCall>) return std::tie(node.function, node.args);
+			else if constexpr (std::is_same_v<T, TemplateCall>) return std::tie(node.lhs, node.templateArgs);
+			else if constexpr (std::is_same_v<T, Indexing>) return std::tie(node.lhs, node.innerExpr);
+			else if constexpr (std::is_same_v<T, MemberAccess>) return std::tie(node.lhs, node.member);
+			else if constexpr (std::is_same_v<T, ListLiteral>) return std::tie(node.elements);
+			else if constexpr (std::is_same_v<T, StructLiteral>) return std::tie(node.initializers, node.names);
+			else if constexpr (std::is_same_v<T, FunctionType>) return std::tie(node.paramTypes, node.returnType);
+			else if constexpr (std::is_same_v<T, Cast>) return std::tie(node.expr, node.type);
+			else if constexpr (std::is_same_v<T, Questionable>) return std::tie(node.expr);
+			else if constexpr (std::is_same_v<T, Reference>) return std::tie(node.expr);
+			else if constexpr (std::is_same_v<T, Identifier>) return std::tie(node.ident);
+			else if constexpr (std::is_same_v<T, Register>) return std::tie(node.reg);
+			else if constexpr (std::is_same_v<T, Flag>) return std::tie(node.flag);
+			else if constexpr (std::is_same_v<T, Literal>) return std::tie(node.literal);
+			else if constexpr (std::is_same_v<T, CurrentPC>) return std::tie();
+		}
+
+		inline void combine(size_t& seed, size_t value) {
+			seed ^= value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+		}
+
+		//children are already shared when their parent is hashed, so their address is their structure
+		inline void hashField(size_t& seed, UniquePtr const& child) { combine(seed, std::hash<Expr*>{}(child.get())); }
+		inline void hashField(size_t& seed, Token::Type type) { combine(seed, static_cast<size_t>(type)); }
+		inline void hashField(size_t& seed, std::string_view view) { combine(seed, std::hash<std::string_view>{}(view)); }
+		inline void hashField(size_t& seed, Token::Literal const& literal) { combine(seed, std::hash<Token::Literal>{}(literal)); }
+		template<typename T>
+		void hashField(size_t& seed, std::vector<T> const& list) {
+			combine(seed, list.size());
+			for (auto& element : list) hashField(seed, element);
+		}
+		template<typename T>
+		void hashField(size_t& seed, std::optional<T> const& optional) {
+			combine(seed, optional.has_value());
+			if (optional.has_value()) hashField(seed, optional.value());
+		}
+	}
+
+	/* Interner:
+		Hash conses expressions. share() returns the one shared node for every structurally
+		equal tree, wherever it was written, so equal subexpressions are stored once and
+		cloning a shared tree copies a pointer. A shared node keeps the position of the tree
+		it was first shared from, positionsOf() maps it to every position it stands for.
+		Shared nodes are handed out const and live as long as the arena; rewrite() builds a
+		changed copy, and adopt() hangs one under an unshared tree, whose visitors that change
+		nodes must leave it alone.
+	*/
+	class Interner
+	{
+	public:
+		static Interner& current() { return util::Arena::current().attached<Interner>(); }
+
+		Interner() = default;
+		Interner(Interner const&) = delete;
+		Interner& operator=(Interner const&) = delete;
+		~Interner() {
+			for (auto& [hash, bucket] : buckets) {
+				for (Expr* node : bucket) node->~Expr();
+			}
+		}
+
+		Shared share(UniquePtr expr) {
+			if (expr->shared) return expr.get();
+			return visit::dispatch(*expr, [&]<typename T>(T& node) -> Shared {
+				std::apply([&](auto&...field) { (shareField(field), ...); }, detail::fieldsOf(node));
+				auto& bucket = buckets[hashOf(node)];
+				for (Expr* candidate : bucket) {
+					if (candidate->is<T>() && equal(static_cast<T const&>(*candidate), node)) {
+						addPosition(candidate, node.sourcePos);
+						//the duplicate is destroyed with expr
+						return candidate;
+					}
+				}
+				node.shared = true;
+				bucket.push_back(&node);
+				addPosition(&node, node.sourcePos);
+				return expr.release();
+			});
+		}
+
+		// a handle to a shared tree, for a child of an unshared one; it owns nothing
+		static UniquePtr adopt(Shared shared) {
+			return UniquePtr(const_cast<Expr*>(shared));
+		}
+
+		// rebuilds a shared tree with the subtrees replace() returns a new tree for, leaving the rest shared.
+		// replace returns nullptr to look inside a node instead, rewrite returns nullptr when nothing was replaced
+		template<typename Replace>
+		Shared rewrite(Shared expr, Replace& replace) {
+			if (auto replaced = replace(*expr)) return share(std::move(replaced));
+			return visit::dispatch(*expr, [&]<typename T>(T const& node) -> Shared {
+				bool changed = false;
+				auto fields = std::apply([&](auto const&...field) {
+					return std::make_tuple(rewriteField(field, replace, changed)...);
+				}, detail::fieldsOf(node));
+				if (!changed) return nullptr;
+				return share(std::apply([&](auto&&...field) {
+					return makeExpr<T>(node.sourcePos, std::move(field)...);
+				}, std::move(fields)));
+			});
+		}
+
+		// every position a tree equal to the shared node was shared from, the first is its own
+		std::span<const SourcePosition> positionsOf(Shared shared) const {
+			auto found = positions.find(shared);
+			if (found == positions.end()) return {};
+			return found->second;
+		}
+
+	private:
+		std::unordered_map<size_t, std::vector<Expr*>> buckets;
+		std::unordered_map<Shared, std::vector<SourcePosition>> positions;
+
+		void addPosition(Shared shared, SourcePosition position) {
+			auto& known = positions[shared];
+			if (std::find(known.begin(), known.end(), position) == known.end()) known.push_back(position);
+		}
+
+		void shareField(UniquePtr& child) { child = adopt(share(std::move(child))); }
+		void shareField(std::vector<UniquePtr>& children) {
+			for (auto& child : children) shareField(child);
+		}
+		void shareField(auto&) {}
+
+		template<typename Replace>
+		UniquePtr rewriteField(UniquePtr const& child, Replace& replace, bool& changed) {
+			if (auto rewritten = rewrite(child.get(), replace)) {
+				changed = true;
+				return adopt(rewritten);
+			}
+			return UniquePtr(child.get());
+		}
+		template<typename Replace>
+		std::vector<UniquePtr> rewriteField(std::vector<UniquePtr> const& children, Replace& replace, bool& changed) {
+			std::vector<UniquePtr> rewritten;
+			rewritten.reserve(children.size());
+			for (auto& child : children) rewritten.push_back(rewriteField(child, replace, changed));
+			return rewritten;
+		}
+		template<typename T, typename Replace>
+		T rewriteField(T const& field, Replace&, bool&) { return field; }
+
+		// the position is left out, equal trees written in different places are one node
+		template<typename T>
+		static size_t hashOf(T const& node) {
+			size_t seed = node.kind();
+			std::apply([&](auto const&...field) { (detail::hashField(seed, field), ...); }, detail::fieldsOf(node));
+			return seed;
+		}
+
+		template<typename T>
+		static bool equal(T const& lhs, T const& rhs) {
+			return detail::fieldsOf(lhs) == detail::fieldsOf(rhs);
+		}
+	};
+}
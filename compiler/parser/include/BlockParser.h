@@ -6,7 +6,7 @@ class BlockParser
 	: public ExprParser
 {
 public:
-	BlockParser(std::span<const Token> tokens, ParserContext& context)
+	BlockParser(TokenStream& tokens, ParserContext& context)
 		: ExprParser(tokens, context) {}
 
 	Stmt::UniquePtr funcStmt();
@@ -69,10 +69,10 @@ protected:
 		: public ParseError
 	{
 	public:
-		InvalidFnStmt(Token token) 
-			: ParseError(token.sourcePos, createMessage(token)) {}
+		InvalidFnStmt(TokenRef token) 
+			: ParseError(token.sourcePos(), createMessage(token)) {}
 	private:
-		static std::string createMessage(Token token) {
+		static std::string createMessage(TokenRef token) {
 			return fmt::format("No statement starts with token of type: {}", tokenTypeToStr(token.type));
 		}
 	};
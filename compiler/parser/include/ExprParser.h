@@ -14,22 +14,15 @@ class ExprParser
 	: public TokenViewer
 {
 public:
-	ExprParser(std::span<const Token> tokens, ParserContext& context)
-		: TokenViewer(tokens.data(), tokens.size()), context(context) {
+	ExprParser(TokenStream& tokens, ParserContext& context)
+		: TokenViewer(tokens), context(context) {
 	}
 
 	Expr::UniquePtr expr();
 	Expr::UniquePtr typeExpr();
 private:
 	Expr::UniquePtr nestedExpr();
-	Expr::UniquePtr logical();
-	Expr::UniquePtr bitwise();
-	Expr::UniquePtr comparison();
-	Expr::UniquePtr equality();
-	Expr::UniquePtr bitshift();
-	Expr::UniquePtr term();
-	Expr::UniquePtr factor();
-	Expr::UniquePtr cast();
+	Expr::UniquePtr binary(u8 minPower);
 	Expr::UniquePtr unary();
 	Expr::UniquePtr scripts();
 	Expr::UniquePtr primary();
@@ -38,6 +31,10 @@ protected:
 	ParserContext& context;
 	bool shouldMatchTemplate() const;
 
+	// the binary operator the current token starts, if it can be one here
+	std::optional<Token::Type> peekBinary() const;
+	void consumeBinary(Token::Type oper);
+
 	Token::Type previousType() const;
 	SourcePosition previousSourcePos() const;
 
@@ -58,11 +55,11 @@ protected:
 
 	class ExpectedTokenType : public ParseError {
 	public:
-		ExpectedTokenType(Token::Type const& expectedType, Token const& found)
-			: ParseError(found.sourcePos, createMessage(expectedType, found)) {}
+		ExpectedTokenType(Token::Type const& expectedType, TokenRef found)
+			: ParseError(found.sourcePos(), createMessage(expectedType, found)) {}
 
 	private:
-		static std::string createMessage(Token::Type const& expectedType, Token const& found) {
+		static std::string createMessage(Token::Type const& expectedType, TokenRef found) {
 			if (found.type == Token::Type::EOF_) {
 				return fmt::format("Expected a token of type: {}, but reached the end of the file.",
 					tokenTypeToStr(expectedType));
@@ -77,11 +74,11 @@ protected:
 	class UnexpectedToken : public ParseError 
 	{
 	public:
-		UnexpectedToken(Token const& unexpected)
-			: ParseError(unexpected.sourcePos, createMessage(unexpected)) {}
+		UnexpectedToken(TokenRef unexpected)
+			: ParseError(unexpected.sourcePos(), createMessage(unexpected)) {}
 		
 	private:
-		static std::string createMessage(Token const& unexpected) {
+		static std::string createMessage(TokenRef unexpected) {
 			return fmt::format("Unexpected Token. Cannot start with token of type: {}.",
 				tokenTypeToStr(unexpected.type));
 		}
@@ -89,10 +86,10 @@ protected:
 	
 	class TokenErrorMessage : public ParseError {
 	public:
-		TokenErrorMessage(Token const& extraInfo, std::string msg)
-			: ParseError(extraInfo.sourcePos, std::move(msg)), extraInfo(extraInfo) {}
+		TokenErrorMessage(TokenRef extraInfo, std::string msg)
+			: ParseError(extraInfo.sourcePos(), std::move(msg)), extraInfo(extraInfo) {}
 	private:
-		Token extraInfo;
+		TokenRef extraInfo;
 	};
 
 };
@@ -5,7 +5,7 @@ class Parser
 	: public StmtParser
 {
 public:
-	Parser(std::span<const Token> tokens)
+	Parser(TokenStream& tokens)
 		: StmtParser(tokens, context) {}
 
 	Stmt::Program program();
@@ -6,7 +6,7 @@ class StmtParser
 {
 public:
 
-	StmtParser(std::span<const Token> tokens, ParserContext& context)
+	StmtParser(TokenStream& tokens, ParserContext& context)
 		: BlockParser(tokens, context), context(context) {}
 
 	Stmt::UniquePtr stmt();
@@ -24,21 +24,21 @@ private:
 
 	class InvalidModuleStmt : public ParseError {
 	public:
-		InvalidModuleStmt(Token const& start)
-			: ParseError(start.sourcePos, createMessage(start)) {}
+		InvalidModuleStmt(TokenRef start)
+			: ParseError(start.sourcePos(), createMessage(start)) {}
 		
 	private:
-		static std::string createMessage(Token const& start) {
+		static std::string createMessage(TokenRef start) {
 			return fmt::format("Statement cannot start with a token of type: {}", tokenTypeToStr(start.type));
 		}
 	};
 	class InvalidBinDecl : public ParseError {
 	public:
-		InvalidBinDecl(Token const& start)
-			: ParseError(start.sourcePos, createMessage(start)) {}
+		InvalidBinDecl(TokenRef start)
+			: ParseError(start.sourcePos(), createMessage(start)) {}
 
 	private:
-		static std::string createMessage(Token const& start) {
+		static std::string createMessage(TokenRef start) {
 			return fmt::format("Invalid Bin Decleration starting with: '{}'", tokenTypeToStr(start.type));
 		}
 	};
@@ -1,21 +1,42 @@
 #pragma once
-#include "StreamViewer.h"
-#include "Token.h"
+#include "TokenStream.h"
 
-class TokenViewer 
-	: public StreamViewer<Token> {
+//Reads the tokens as they are lexed, they are handed out as TokenRefs and probed by type only.
+//The stream keeps one token behind the current one and lexes ahead as far as the parser peeks.
+class TokenViewer {
 public:
-	using StreamViewer<Token>::StreamViewer;
+	TokenViewer(TokenStream& tokens) : tokens(tokens) {}
 
-	bool atEnd() const override {
-		return peek().type == Token::Type::EOF_;
+	bool atEnd() const {
+		return tokens.type(current) == Token::Type::EOF_;
 	}
 	bool matchType(std::same_as<Token::Type> auto...targets) {
-		if (auto l = peek(); ((l.type == targets) || ...)) {
+		if (auto type = tokens.type(current); ((type == targets) || ...)) {
 			advance();
 			return true;
 		}
 		return false;
 	}
 	virtual ~TokenViewer() = default;
-};
\ No newline at end of file
+
+protected:
+	TokenRef advance() {
+		auto token = tokens[current];
+		tokens.release(++current);
+		return token;
+	}
+	TokenRef peek() const { return tokens[current]; }
+	Token::Type peekType() const { return tokens.type(current); }
+	TokenRef peekNext() const { return tokens[current + 1]; }
+	TokenRef peekPrevious() const { return tokens[current - 1]; }
+
+	void consumeWhile(auto callback) {
+		while (!atEnd() && callback(peek())) {
+			advance();
+		}
+	}
+
+private:
+	TokenStream& tokens;
+	size_t current = 0;
+};
@@ -5,6 +5,7 @@
 #include <optional>
 #include "Expr.h"
 #include "Visitors.h"
+#include "Arena.h"
 
 namespace Stmt 
 {
@@ -13,6 +14,7 @@ namespace Stmt
 		struct Function, struct Bin, struct Module, struct Module, struct Import, struct VarDef, 
 		struct CountLoop, struct Assign, struct If, struct Return, struct ExprStmt> {
 		public:
+			using Owner = util::ArenaPtr<Stmt>;
 			SourcePosition sourcePos;
 	};
 
@@ -23,16 +25,17 @@ namespace Stmt
 	class VisitorReturner : public Stmt::VisitorReturnerType<T> {};
 	class Visitor : public Stmt::VisitorType {};
 
-	using UniquePtr = std::unique_ptr<Stmt>;
+	//nodes live in the current arena, a UniquePtr only destroys its node
+	using UniquePtr = Stmt::Owner;
 	using ArgList = std::vector<Expr::UniquePtr>;
 	using StmtBody = std::vector<::Stmt::UniquePtr>;
 	using Program = std::vector<::Stmt::UniquePtr>;
 
 	template<typename T, typename...Args>
 	UniquePtr makeStmt(SourcePosition sourcePos, Args&&...args) {
-		auto stmt = std::make_unique<T>(T{ std::forward<Args>(args)... });
+		T* stmt = util::Arena::current().make<T>(T{ std::forward<Args>(args)... });
 		stmt->sourcePos = sourcePos;
-		return stmt;
+		return UniquePtr(stmt);
 	}
 
 // Bad practice....Whatever! 
@@ -86,10 +89,11 @@ namespace Stmt
 		std::string_view title; 
 	};
 	struct Import : Stmt::Visitable<Import> {
-		Import(std::string_view file)
-			: file(file) {}
+		Import(std::string_view file, u32 fileId)
+			: file(file), fileId(fileId) {}
 
 		std::string_view file;
+		u32 fileId; //the imported file in the SourceManager
 	};
 
 	struct VarDef : Stmt::Visitable<VarDef> {
@@ -42,7 +42,7 @@ namespace Stmt
             returnCloned(mod, mod.title);
         }
         virtual void visit(Import const& imp) override {
-            returnCloned(imp, imp.file);
+            returnCloned(imp, imp.file, imp.fileId);
         }
         virtual void visit(VarDef const& varDef) override {
             returnCloned(varDef, 
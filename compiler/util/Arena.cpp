@@ -0,0 +1,43 @@
+#include "Arena.h"
+
+namespace util
+{
+	Arena& Arena::current()
+	{
+		//made on first use and destroyed, with everything in it, when the thread exits
+		thread_local Arena fallback;
+		return active ? *active : fallback;
+	}
+
+	Arena::~Arena()
+	{
+		reset();
+	}
+
+	void Arena::reset()
+	{
+		//the blocks are still there while the attachments are destroyed, newest first
+		for (auto attachment = attachments.rbegin(); attachment != attachments.rend(); ++attachment) {
+			attachment->destroy(attachment->object);
+		}
+		attachments.clear();
+		blocks.clear();
+		next = limit = nullptr;
+	}
+
+	void* Arena::allocateSlow(size_t size, size_t alignment)
+	{
+		//large objects get a block of their own so the current block keeps filling,
+		//blocks are left uninitialized since every object is constructed in place
+		size_t needed = size + alignment - 1;
+		if (needed > BLOCK_SIZE / 4) {
+			auto& block = blocks.emplace_back(new std::byte[needed]);
+			auto address = (reinterpret_cast<uintptr_t>(block.get()) + alignment - 1) & ~(alignment - 1);
+			return reinterpret_cast<void*>(address);
+		}
+		auto& block = blocks.emplace_back(new std::byte[BLOCK_SIZE]);
+		next = block.get();
+		limit = next + BLOCK_SIZE;
+		return allocate(size, alignment);
+	}
+}
@@ -1,101 +1,173 @@
-#include "Graph.h"
-#include <set>
-#include <iterator>
+#include "DominatorTree.h"
 #include <algorithm>
-#include <unordered_map>
-#include <unordered_set>
-#include <queue>
-#include <iostream>
 
-using DominatorSet = std::vector<std::pair<size_t, std::set<size_t>>>;
+namespace {
+    template<typename Callable>
+    void forEachSuccessor(FrozenGraph const& graph, size_t node, size_t entry, size_t exit, Callable callable)
+    {
+        for (auto succ : graph.out(node)) callable(succ);
+        if (node == entry && exit != DominatorTree::npos && !graph.hasEdge(entry, exit)) callable(exit);
+    }
 
-DominatorSet calculateDominatorSets(size_t entry, PureGraph const& graph)
-{
-    DominatorSet dominatorSets;
-    for (size_t avoid_node = 0; avoid_node < graph.nodeCount(); avoid_node++) 
+    template<typename Callable>
+    void forEachPredecessor(FrozenGraph const& graph, size_t node, size_t entry, size_t exit, Callable callable)
     {
-        std::stack<size_t> worklist;
-        worklist.push(entry);
-        std::set<size_t> unreachable, visited;
-        for (size_t i = 0; i < graph.nodeCount(); ++i) {
-            if(i != avoid_node) unreachable.insert(i);
-        }
-        while (!worklist.empty()) 
-        {
-            auto current = worklist.top(); worklist.pop();
-            if (current == avoid_node || visited.count(current) != 0) continue;
-            visited.insert(current);
-            unreachable.erase(current);
-            for (auto succ : graph.out(current)) {
-                worklist.push(succ);
-            }
-        }
-        dominatorSets.emplace_back(avoid_node, std::move(unreachable));
+        for (auto pred : graph.in(node)) callable(pred);
+        if (node == exit && exit != DominatorTree::npos && !graph.hasEdge(entry, exit)) callable(entry);
     }
-    return dominatorSets;
 }
 
-PureGraph calculateIdom(size_t entry, PureGraph const& graph)
+DominatorTree::DominatorTree(size_t entry, PureGraph const& graph)
+    : entry(entry)
 {
-    auto idom = PureGraph::trivialGraph(graph.nodeCount());
-    auto dominatorSets = calculateDominatorSets(entry, graph);
-    std::sort(dominatorSets.begin(), dominatorSets.end(), [](auto& lhs, auto& rhs) 
+    build(graph);
+}
+
+DominatorTree::DominatorTree(size_t entry, size_t exit, PureGraph const& graph)
+    : entry(entry), exit(exit)
+{
+    build(graph);
+}
+
+void DominatorTree::build(PureGraph const& shape)
+{
+    FrozenGraph graph = shape.freeze();
+    size_t const nodes = graph.nodeCount();
+    idoms.assign(nodes, npos);
+    childLists.assign(nodes, {});
+    preNumbers.assign(nodes, npos);
+    postNumbers.assign(nodes, npos);
+
+    // cfg postorder, iteratively so deep graphs can't overflow the stack
+    std::vector<size_t> cfgPostNumbers(nodes, npos);
+    std::vector<bool> visited(nodes);
+    std::vector<std::pair<size_t, std::vector<size_t>>> stack;
+    auto successors = [&](size_t node) {
+        std::vector<size_t> succs;
+        forEachSuccessor(graph, node, entry, exit, [&](size_t succ) { succs.push_back(succ); });
+        return succs;
+    };
+    visited[entry] = true;
+    stack.emplace_back(entry, successors(entry));
+    while (!stack.empty())
     {
-        return lhs.second.size() < rhs.second.size();
-    });
+        auto& [node, pending] = stack.back();
+        if (pending.empty()) {
+            cfgPostNumbers[node] = rpo.size();
+            rpo.push_back(node);
+            stack.pop_back();
+            continue;
+        }
+        size_t succ = pending.back(); pending.pop_back();
+        if (!visited[succ]) {
+            visited[succ] = true;
+            stack.emplace_back(succ, successors(succ));
+        }
+    }
+    std::reverse(rpo.begin(), rpo.end());
 
-    std::unordered_set<size_t> leaves = {};
-    for (auto& [node, dominees] : dominatorSets) 
+    auto intersect = [&](size_t lhs, size_t rhs) {
+        while (lhs != rhs) {
+            while (cfgPostNumbers[lhs] < cfgPostNumbers[rhs]) lhs = idoms[lhs];
+            while (cfgPostNumbers[rhs] < cfgPostNumbers[lhs]) rhs = idoms[rhs];
+        }
+        return lhs;
+    };
+    idoms[entry] = entry;
+    bool changed = true;
+    while (changed)
     {
-        for (auto& dominee : dominees)
+        changed = false;
+        for (size_t node : std::span(rpo).subspan(1))
         {
-            if (leaves.count(dominee) != 0) {
-                leaves.erase(dominee);
-                idom.addEdge(node, dominee);
+            size_t newIdom = npos;
+            forEachPredecessor(graph, node, entry, exit, [&](size_t pred) {
+                if (idoms[pred] == npos) return;
+                newIdom = (newIdom == npos ? pred : intersect(pred, newIdom));
+            });
+            if (idoms[node] != newIdom) {
+                idoms[node] = newIdom;
+                changed = true;
             }
         }
-        leaves.insert(node);
     }
-    return idom;
+
+    for (size_t node = 0; node < nodes; ++node) {
+        if (node != entry && idoms[node] != npos) {
+            childLists[idoms[node]].push_back(node);
+        }
+    }
+    numberTree();
 }
 
-std::vector<size_t> dominanceFrontierForNode(
-    PureGraph const& graph,
-    PureGraph const& idom, 
-    size_t node,
-    std::unordered_map<size_t, std::vector<size_t>> const& frontiers
-) 
+void DominatorTree::numberTree()
 {
-    std::vector<size_t> frontier;
-    for (auto succ : graph.out(node)) 
+    size_t preCount = 0, postCount = 0;
+    std::vector<std::pair<size_t, size_t>> stack; // node, next child index
+    stack.emplace_back(entry, 0);
+    preNumbers[entry] = preCount++;
+    preorderList.push_back(entry);
+    while (!stack.empty())
     {
-        if (!idom.hasEdge(node, succ)) {
-            frontier.push_back(succ);
+        auto& [node, childIndex] = stack.back();
+        if (childIndex == childLists[node].size()) {
+            postNumbers[node] = postCount++;
+            stack.pop_back();
+            continue;
         }
+        size_t child = childLists[node][childIndex++];
+        preNumbers[child] = preCount++;
+        preorderList.push_back(child);
+        stack.emplace_back(child, 0);
     }
-    for (auto child : idom.out(node)) {
-        if (frontiers.find(child) == frontiers.end()) continue;
-        for (auto distant_succ : frontiers.at(child)) {
-            if (!idom.hasEdge(node, distant_succ)) {
-                frontier.push_back(distant_succ);
-            }
+}
+
+PureGraph DominatorTree::toGraph() const
+{
+    auto tree = PureGraph::trivialGraph(nodeCount());
+    for (size_t node = 0; node < nodeCount(); ++node) {
+        for (size_t child : children(node)) {
+            tree.addEdge(node, child);
         }
     }
-    return frontier;
+    return tree;
 }
 
-std::unordered_map<size_t, std::vector<size_t>> dominanceFrontier(size_t entry, size_t exit, PureGraph const& graph)
+DominanceFrontiers dominanceFrontier(DominatorTree const& tree, PureGraph const& shape)
 {
-    PureGraph modifiedGraph = graph;
-    modifiedGraph.addEdge(entry, exit);
-    std::unordered_map<size_t, std::vector<size_t>> frontiers;
-    PureGraph idom = calculateIdom(entry, modifiedGraph);
-    std::cout << "IDOM: " << std::endl;
-    std::cout << idom;
-    std::cout << "VISITING:\n";
-    idom.dfs(entry, [&](size_t visiting) {
-        std::cout << visiting << '\n';
-        frontiers.emplace(visiting, dominanceFrontierForNode(modifiedGraph, idom, visiting, frontiers));
-    });
+    FrozenGraph graph = shape.freeze();
+    DominanceFrontiers frontiers(graph.nodeCount());
+    // last node whose frontier each node was added to, avoids duplicates
+    std::vector<size_t> addedTo(graph.nodeCount(), DominatorTree::npos);
+    auto preorder = tree.preorderNodes();
+    // reverse preorder visits every child before its parent
+    for (auto it = preorder.rbegin(); it != preorder.rend(); ++it)
+    {
+        size_t node = *it;
+        auto& frontier = frontiers[node];
+        auto add = [&](size_t member) {
+            if (tree.immediateDominator(member) != node && addedTo[member] != node) {
+                addedTo[member] = node;
+                frontier.push_back(member);
+            }
+        };
+        // DF local
+        forEachSuccessor(graph, node, tree.root(), tree.virtualExit(), add);
+        // DF up
+        for (size_t child : tree.children(node)) {
+            for (size_t member : frontiers[child]) add(member);
+        }
+        std::sort(frontier.begin(), frontier.end());
+    }
     return frontiers;
 }
+
+PureGraph calculateIdom(size_t entry, PureGraph const& graph)
+{
+    return DominatorTree(entry, graph).toGraph();
+}
+
+DominanceFrontiers dominanceFrontier(size_t entry, size_t exit, PureGraph const& graph)
+{
+    return dominanceFrontier(DominatorTree(entry, exit, graph), graph);
+}
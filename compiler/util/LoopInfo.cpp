@@ -0,0 +1,45 @@
+#include "LoopInfo.h"
+#include <algorithm>
+
+bool LoopInfo::Loop::contains(size_t block) const
+{
+    return std::binary_search(blocks.begin(), blocks.end(), block);
+}
+
+LoopInfo::LoopInfo(PureGraph const& graph, DominatorTree const& tree)
+    : innermost(graph.nodeCount(), npos)
+{
+    // headers in dominator tree preorder, so outer loops are found first
+    std::vector<bool> inLoop(graph.nodeCount());
+    for (size_t header : tree.preorderNodes())
+    {
+        Loop loop{ header };
+        for (size_t pred : graph.in(header)) {
+            if (tree.dominates(header, pred)) loop.latches.push_back(pred);
+        }
+        if (loop.latches.empty()) continue;
+
+        // walk backwards from the latches, the header stops the walk
+        std::fill(inLoop.begin(), inLoop.end(), false);
+        std::vector<size_t> worklist(loop.latches.begin(), loop.latches.end());
+        inLoop[header] = true;
+        loop.blocks.push_back(header);
+        while (!worklist.empty())
+        {
+            size_t block = worklist.back(); worklist.pop_back();
+            if (inLoop[block]) continue;
+            inLoop[block] = true;
+            loop.blocks.push_back(block);
+            for (size_t pred : graph.in(block)) {
+                if (!inLoop[pred] && tree.isReachable(pred)) worklist.push_back(pred);
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+
+        // the enclosing loop is the innermost loop of the header found so far
+        loop.parent = innermost[header];
+        if (loop.parent != npos) loop.depth = allLoops[loop.parent].depth + 1;
+        for (size_t block : loop.blocks) innermost[block] = allLoops.size();
+        allLoops.push_back(std::move(loop));
+    }
+}
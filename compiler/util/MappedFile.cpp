@@ -0,0 +1,71 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util
+{
+#ifdef _WIN32
+	std::optional<MappedFile> MappedFile::open(std::filesystem::path const& path)
+	{
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return std::nullopt;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) {
+			CloseHandle(file);
+			return std::nullopt;
+		}
+		if (size.QuadPart == 0) {
+			CloseHandle(file);
+			return MappedFile(nullptr, 0);
+		}
+		//the view keeps the file open, the handles are not needed after it is made
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping) return std::nullopt;
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!view) return std::nullopt;
+		return MappedFile(static_cast<const char*>(view), static_cast<size_t>(size.QuadPart));
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (data) UnmapViewOfFile(data);
+	}
+#else
+	std::optional<MappedFile> MappedFile::open(std::filesystem::path const& path)
+	{
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0) return std::nullopt;
+		struct stat status;
+		if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode)) {
+			close(file);
+			return std::nullopt;
+		}
+		size_t size = static_cast<size_t>(status.st_size);
+		if (size == 0) {
+			close(file);
+			return MappedFile(nullptr, 0);
+		}
+		//the mapping keeps the file open, the descriptor is not needed after it is made
+		void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (view == MAP_FAILED) return std::nullopt;
+		return MappedFile(static_cast<const char*>(view), size);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (data) munmap(const_cast<char*>(data), size);
+	}
+#endif
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace util
+{
+	/* Arena:
+		A bump allocator, objects are placed one after another in large blocks and
+		the blocks are freed together when the arena is destroyed. Nothing is freed
+		on its own, ArenaPtr only runs the destructor of the object it owns.
+		An Arena::Scope makes an arena the current one for the thread, without one
+		the current arena is a fallback of the thread's own, destroyed when the thread
+		exits. reset() frees an arena early, once nothing in it is used anymore.
+		attached<T>() is one T per arena, for state that has to live exactly as long
+		as the objects in it, like a table of them.
+	*/
+	class Arena
+	{
+	public:
+		static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+		class Scope
+		{
+		public:
+			Scope(Arena& arena) : previous(std::exchange(active, &arena)) {}
+			~Scope() { active = previous; }
+			Scope(Scope const&) = delete;
+			Scope& operator=(Scope const&) = delete;
+		private:
+			Arena* previous;
+		};
+
+		Arena() = default;
+		Arena(Arena const&) = delete;
+		Arena& operator=(Arena const&) = delete;
+		~Arena();
+
+		static Arena& current();
+
+		void* allocate(size_t size, size_t alignment) {
+			auto address = (reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(alignment - 1);
+			if (next == nullptr || address + size > reinterpret_cast<uintptr_t>(limit)) {
+				return allocateSlow(size, alignment);
+			}
+			next = reinterpret_cast<std::byte*>(address + size);
+			return reinterpret_cast<void*>(address);
+		}
+
+		template<typename T, typename...Args>
+		T* make(Args&&...args) {
+			return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		template<typename T>
+		T& attached() {
+			for (auto& attachment : attachments) {
+				if (attachment.key == &attachmentKey<T>) return *static_cast<T*>(attachment.object);
+			}
+			T* object = make<T>();
+			attachments.push_back(Attachment{ &attachmentKey<T>, object, [](void* erased) { static_cast<T*>(erased)->~T(); } });
+			return *object;
+		}
+
+		// destroys the attachments and frees every block, the arena can be used again after
+		void reset();
+
+		size_t blockCount() const { return blocks.size(); }
+
+	private:
+		struct Attachment
+		{
+			const void* key;
+			void* object;
+			void (*destroy)(void*);
+		};
+		template<typename T>
+		static constexpr char attachmentKey = 0;
+
+		void* allocateSlow(size_t size, size_t alignment);
+
+		std::vector<Attachment> attachments;
+		std::vector<std::unique_ptr<std::byte[]>> blocks;
+		std::byte* next = nullptr, * limit = nullptr;
+		static inline thread_local Arena* active = nullptr;
+	};
+
+	// owns an object in an arena, the arena keeps the memory
+	template<typename T>
+	struct ArenaDelete
+	{
+		void operator()(T* object) const { object->~T(); }
+	};
+
+	template<typename T>
+	using ArenaPtr = std::unique_ptr<T, ArenaDelete<T>>;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include "CharacterUtil.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define UTIL_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTIL_SCAN_SSE2
+#endif
+
+/* Character Scanning:
+	Bulk versions of the CharacterUtil predicates, returning how many characters
+	from the start of a buffer belong to a run. Whole blocks of 32 (AVX2) or 16
+	(SSE2) characters are classified at once and the tail is done a character
+	at a time, so nothing is read past the end. Builds without either instruction
+	set only use the scalar loop.
+*/
+namespace util
+{
+	namespace detail
+	{
+		template<typename Predicate>
+		size_t scalarRun(const char* data, size_t size, size_t from, Predicate predicate) {
+			while (from < size && predicate(data[from])) from++;
+			return from;
+		}
+
+#if defined(UTIL_SCAN_AVX2)
+		using Block = __m256i;
+		constexpr size_t BLOCK_SIZE = 32;
+		inline Block load(const char* data) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); }
+		inline Block splat(char l) { return _mm256_set1_epi8(l); }
+		inline Block equal(Block lhs, Block rhs) { return _mm256_cmpeq_epi8(lhs, rhs); }
+		inline Block greater(Block lhs, Block rhs) { return _mm256_cmpgt_epi8(lhs, rhs); }
+		inline Block both(Block lhs, Block rhs) { return _mm256_and_si256(lhs, rhs); }
+		inline Block either(Block lhs, Block rhs) { return _mm256_or_si256(lhs, rhs); }
+		inline uint32_t maskOf(Block block) { return static_cast<uint32_t>(_mm256_movemask_epi8(block)); }
+#elif defined(UTIL_SCAN_SSE2)
+		using Block = __m128i;
+		constexpr size_t BLOCK_SIZE = 16;
+		inline Block load(const char* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+		inline Block splat(char l) { return _mm_set1_epi8(l); }
+		inline Block equal(Block lhs, Block rhs) { return _mm_cmpeq_epi8(lhs, rhs); }
+		inline Block greater(Block lhs, Block rhs) { return _mm_cmpgt_epi8(lhs, rhs); }
+		inline Block both(Block lhs, Block rhs) { return _mm_and_si128(lhs, rhs); }
+		inline Block either(Block lhs, Block rhs) { return _mm_or_si128(lhs, rhs); }
+		inline uint32_t maskOf(Block block) { return static_cast<uint32_t>(_mm_movemask_epi8(block)); }
+#endif
+
+#if defined(UTIL_SCAN_AVX2) || defined(UTIL_SCAN_SSE2)
+		constexpr uint32_t FULL_MASK = BLOCK_SIZE == 32 ? 0xFFFFFFFFu : 0xFFFFu;
+
+		//the comparisons are signed, which is fine for ASCII bounds: bytes above 0x7F are negative and never inside
+		inline Block between(Block block, char low, char high) {
+			return both(greater(block, splat(low - 1)), greater(splat(high + 1), block));
+		}
+
+		// runs blocks through a classifier that sets a bit for every character in the run
+		template<typename Classifier, typename Predicate>
+		size_t blockRun(const char* data, size_t size, Classifier classify, Predicate predicate) {
+			size_t from = 0;
+			for (; from + BLOCK_SIZE <= size; from += BLOCK_SIZE) {
+				uint32_t outside = ~classify(load(data + from)) & FULL_MASK;
+				if (outside != 0) return from + std::countr_zero(outside);
+			}
+			return scalarRun(data, size, from, predicate);
+		}
+#endif
+	}
+
+	//[A-Za-z0-9_]*
+	inline size_t identifierRun(const char* data, size_t size) {
+#if defined(UTIL_SCAN_AVX2) || defined(UTIL_SCAN_SSE2)
+		using namespace detail;
+		return blockRun(data, size, [](Block block) {
+			//setting bit 5 folds upper case onto lower case and leaves digits and underscores alone
+			Block folded = either(block, splat(0x20));
+			return maskOf(either(either(between(folded, 'a', 'z'), between(block, '0', '9')), equal(block, splat('_'))));
+		}, isIdentifier);
+#else
+		return detail::scalarRun(data, size, 0, isIdentifier);
+#endif
+	}
+
+	//[0-9]*
+	inline size_t digitRun(const char* data, size_t size) {
+#if defined(UTIL_SCAN_AVX2) || defined(UTIL_SCAN_SSE2)
+		using namespace detail;
+		return blockRun(data, size, [](Block block) { return maskOf(between(block, '0', '9')); }, isDigit);
+#else
+		return detail::scalarRun(data, size, 0, isDigit);
+#endif
+	}
+
+	//everything up to the next newline
+	inline size_t lineRun(const char* data, size_t size) {
+#if defined(UTIL_SCAN_AVX2) || defined(UTIL_SCAN_SSE2)
+		using namespace detail;
+		return blockRun(data, size, [](Block block) { return ~maskOf(equal(block, splat('\n'))); }, isNotNewline);
+#else
+		return detail::scalarRun(data, size, 0, isNotNewline);
+#endif
+	}
+
+	struct BlankRun
+	{
+		size_t length = 0, spaces = 0, tabs = 0;
+	};
+
+	//[ \t]*, counting both kinds, since indentation weighs them differently
+	inline BlankRun blankRun(const char* data, size_t size) {
+		BlankRun run;
+		size_t from = 0;
+#if defined(UTIL_SCAN_AVX2) || defined(UTIL_SCAN_SSE2)
+		using namespace detail;
+		for (; from + BLOCK_SIZE <= size; from += BLOCK_SIZE) {
+			Block block = load(data + from);
+			uint32_t spaces = maskOf(equal(block, splat(' '))), tabs = maskOf(equal(block, splat('\t')));
+			uint32_t outside = ~(spaces | tabs) & FULL_MASK;
+			uint32_t inside = outside == 0 ? FULL_MASK : (1u << std::countr_zero(outside)) - 1;
+			run.spaces += std::popcount(spaces & inside);
+			run.tabs += std::popcount(tabs & inside);
+			if (outside != 0) {
+				run.length = from + std::countr_zero(outside);
+				return run;
+			}
+		}
+#endif
+		for (; from < size && (data[from] == ' ' || data[from] == '\t'); from++) {
+			if (data[from] == ' ') run.spaces++;
+			else run.tabs++;
+		}
+		run.length = from;
+		return run;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "Graph.h"
+
+/*
+    Dominator tree built with the Cooper-Harvey-Kennedy iterative algorithm
+    over the reverse postorder of the graph. Nodes that can not be reached 
+    from the entry have no immediate dominator and dominate nothing.
+
+    An optional exit node adds a virtual entry -> exit edge, which is what SSA 
+    construction wants, without having to copy the graph.
+*/
+class DominatorTree
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    DominatorTree(size_t entry, PureGraph const& graph);
+    DominatorTree(size_t entry, size_t exit, PureGraph const& graph);
+
+    size_t root() const { return entry; }
+    // npos if the tree was built without a virtual exit edge
+    size_t virtualExit() const { return exit; }
+    size_t nodeCount() const { return idoms.size(); }
+    bool isReachable(size_t node) const { return idoms[node] != npos; }
+    // npos for the root and for unreachable nodes
+    size_t immediateDominator(size_t node) const { return node == entry ? npos : idoms[node]; }
+    std::span<const size_t> children(size_t node) const { return childLists[node]; }
+
+    // numbering of the dominator tree itself, not the cfg
+    size_t preorder(size_t node) const { return preNumbers[node]; }
+    size_t postorder(size_t node) const { return postNumbers[node]; }
+    // reachable nodes of the dominator tree in preorder, starting with the root
+    std::span<const size_t> preorderNodes() const { return preorderList; }
+    // reachable nodes of the graph in reverse postorder
+    std::span<const size_t> reversePostorder() const { return rpo; }
+
+    bool dominates(size_t dominator, size_t node) const {
+        return isReachable(dominator) && isReachable(node)
+            && preNumbers[dominator] <= preNumbers[node]
+            && postNumbers[node] <= postNumbers[dominator];
+    }
+    bool strictlyDominates(size_t dominator, size_t node) const {
+        return dominator != node && dominates(dominator, node);
+    }
+
+    // the tree as a graph with an edge from every idom to its children
+    PureGraph toGraph() const;
+
+private:
+    void build(PureGraph const& graph);
+    void numberTree();
+    
+    size_t entry, exit = npos;
+    std::vector<size_t> idoms, rpo, preorderList, preNumbers, postNumbers;
+    std::vector<std::vector<size_t>> childLists;
+};
+
+// indexed by node, each frontier is sorted
+using DominanceFrontiers = std::vector<std::vector<size_t>>;
+
+// Cytron et al. bottom up frontier computation. Must be given the graph the tree was built from.
+DominanceFrontiers dominanceFrontier(DominatorTree const& tree, PureGraph const& graph);
+
+PureGraph calculateIdom(size_t entry, PureGraph const& graph);
+DominanceFrontiers dominanceFrontier(size_t entry, size_t exit, PureGraph const& graph);
@@ -1,113 +1,127 @@
-
 #pragma once
 #include <stack>
 #include <queue>
+#include <span>
+#include <vector>
 #include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <ostream>
 
-struct PureGraph 
+/*
+    Graphs are stored as sorted successor/predecessor adjacency lists, so
+    iterating the edges of a node is O(degree) and creating a node is O(1) amortized.
+    Edge ranges are always in ascending node order.
+*/
+
+// Read-only compressed sparse row form of a PureGraph, for analyses
+// that walk the graph many times without changing its shape.
+struct FrozenGraph
 {
-    template<bool DoPred>
-    struct EdgeIterator 
-    {
-        using ThisType = EdgeIterator<DoPred>;
-    public:
-        EdgeIterator(PureGraph const& graph, size_t state, bool isEndIterator) 
-            : graph(graph), state(state), out(0) {
-                if(isEndIterator) out = graph.nodeCount();
-                else {
-                    out = (hasConnection(0) ? 0 : findNextOut());
-                }
-        }
+    using EdgeRange = std::span<const size_t>;
+
+    size_t edgeCount() const { return succTargets.size(); }
+    size_t nodeCount() const { return succOffsets.size() - 1; }
+    size_t predecessorCount(size_t node) const { return predOffsets[node + 1] - predOffsets[node]; }
+    size_t successorCount(size_t node) const { return succOffsets[node + 1] - succOffsets[node]; }
+    bool hasEdge(size_t src, size_t dst) const {
+        auto succs = out(src);
+        return std::binary_search(succs.begin(), succs.end(), dst);
+    }
+    EdgeRange out(size_t node) const { return row(succOffsets, succTargets, node); }
+    EdgeRange in(size_t node) const { return row(predOffsets, predTargets, node); }
 
-        bool operator==(ThisType const& other) const { return other.state == state && other.out == out; }
-        ThisType operator++(int) { auto temp = *this; out = findNextOut(); return temp; }
-        ThisType& operator++() { out = findNextOut(); return *this;}
-        size_t operator*() const { return out; }
-    private:
-        bool hasConnection(size_t other) const {
-            if constexpr (DoPred) return graph.hasEdge(other, state);
-            else return graph.hasEdge(state, other);
-        }
-        size_t findNextOut() const {
-            for(size_t i = out + 1; i < graph.nodeCount(); i++) {
-                if(hasConnection(i)) return i;
-            }
-            return graph.nodeCount();
+private:
+    friend struct PureGraph;
+    FrozenGraph(std::vector<std::vector<size_t>> const& succs, std::vector<std::vector<size_t>> const& preds) {
+        compress(succs, succOffsets, succTargets);
+        compress(preds, predOffsets, predTargets);
+    }
+
+    static void compress(std::vector<std::vector<size_t>> const& lists, std::vector<size_t>& offsets, std::vector<size_t>& targets) {
+        offsets.reserve(lists.size() + 1);
+        offsets.push_back(0);
+        for (auto& list : lists) {
+            targets.insert(targets.end(), list.begin(), list.end());
+            offsets.push_back(targets.size());
         }
-        PureGraph const& graph;
-        size_t state, out;
-    };
-    template<bool DoPred>
-    struct EdgeProxy {
-        EdgeProxy(PureGraph const& graph, size_t state) 
-            : graph(graph), state(state){}
-
-        auto begin() const { return EdgeIterator<DoPred>(graph, state, false);}
-        auto end() const { return EdgeIterator<DoPred>(graph, state, true);}
-    private:
-        PureGraph const& graph;
-        size_t state;
-    };
-
-    using PredProxy = EdgeProxy<true>;
-    using SuccProxy = EdgeProxy<false>;
+    }
+    static EdgeRange row(std::vector<size_t> const& offsets, std::vector<size_t> const& targets, size_t node) {
+        return EdgeRange(targets.data() + offsets[node], offsets[node + 1] - offsets[node]);
+    }
+
+    std::vector<size_t> succOffsets, succTargets, predOffsets, predTargets;
+};
+
+struct PureGraph 
+{
+    using EdgeRange = std::span<const size_t>;
+    using PredProxy = EdgeRange;
+    using SuccProxy = EdgeRange;
 
     static PureGraph trivialGraph(size_t totalNodes) {
         return PureGraph(totalNodes);
     }
     static PureGraph fullyConnected(size_t totalNodes) {
         auto temp = PureGraph(totalNodes);
-        for(auto& row : temp.edges) {
-            for (auto edge : row) {
-                ++temp.totalEdges;
-                edge = true;
+        for (size_t src = 0; src < totalNodes; ++src) {
+            for (size_t dst = 0; dst < totalNodes; ++dst) {
+                temp.succs[src].push_back(dst);
+                temp.preds[dst].push_back(src);
             }
-        } 
+        }
+        temp.totalEdges = totalNodes * totalNodes;
         return temp;
     }
 
     size_t createNode() {
-        totalNodes++;
-        //increase table size
-        for(auto& src : edges) {src.push_back(false);}
-        edges.emplace_back(std::vector<bool>(edges.size() + 1));
-        return totalNodes - 1;
+        succs.emplace_back();
+        preds.emplace_back();
+        return succs.size() - 1;
     }
-    size_t predecessorCount(size_t node) const { 
-        size_t count = 0; 
-        for (size_t i = 0; i < nodeCount(); ++i)
-            if (hasEdge(i, node)) count++;
-        return count;
+    size_t predecessorCount(size_t node) const { return preds.at(node).size(); }
+    size_t successorCount(size_t node) const { return succs.at(node).size(); }
+    size_t edgeCount() const { return totalEdges; }
+    size_t nodeCount() const { return succs.size(); }
+    void removeAllEdges(size_t src) { 
+        for (auto succ : succs[src]) erase(preds[succ], src);
+        totalEdges -= succs[src].size();
+        succs[src].clear();
     }
-    size_t successorCount(size_t node) const {
-        return std::count(edges.at(node).begin(), edges.at(node).end(), true);
+    void removeEdge(size_t src, size_t dst) { 
+        if (erase(succs[src], dst)) {
+            erase(preds[dst], src);
+            totalEdges--;
+        }
     }
-    size_t edgeCount() const { return totalEdges; }
-    size_t nodeCount() const { return totalNodes; }
-    void removeAllEdges(size_t src) { for (auto succ : out(src)) removeEdge(src, succ); }
-    void removeEdge(size_t src, size_t dst) { if (hasEdge(src, dst)) totalEdges--; edges[src][dst] = false; }
-    void addEdge(size_t src, size_t dst) { if (!hasEdge(src, dst)) totalEdges++; edges[src][dst] = true; }
-    bool hasEdge(size_t src, size_t dst) const { return edges[src][dst]; }
-    SuccProxy out(size_t state) const { return SuccProxy{*this, state}; }
-    PredProxy in(size_t state) const { return PredProxy{*this, state}; }
+    void addEdge(size_t src, size_t dst) { 
+        if (insert(succs[src], dst)) {
+            insert(preds[dst], src);
+            totalEdges++;
+        }
+    }
+    bool hasEdge(size_t src, size_t dst) const { 
+        return std::binary_search(succs[src].begin(), succs[src].end(), dst); 
+    }
+    SuccProxy out(size_t state) const { return succs[state]; }
+    PredProxy in(size_t state) const { return preds[state]; }
     bool operator==(PureGraph const& other) const {
-        return other.totalNodes == totalNodes && other.edges == edges;
+        return other.succs == succs;
     }
 
+    FrozenGraph freeze() const { return FrozenGraph(succs, preds); }
+
     template<typename Callable>
     void bfs(size_t startNode, Callable callable) const {
         std::queue<size_t> worklist; worklist.push(startNode);
-        std::unordered_set<size_t> visited; visited.insert(startNode);
+        std::vector<bool> visited(nodeCount()); visited[startNode] = true;
         while(!worklist.empty()){
             auto n = worklist.front();
             callable(n);
             worklist.pop();
             for(auto succ : out(n)){
-                if(visited.count(succ) == 0){
-                    visited.insert(succ);
+                if(!visited[succ]){
+                    visited[succ] = true;
                     worklist.push(succ);
                 }
             }
@@ -117,13 +131,13 @@ struct PureGraph
     template<typename Callable>
     void dfs(size_t startNode, Callable callable) const {
         std::stack<size_t> worklist, order; worklist.push(startNode);
-        std::unordered_set<size_t> visited; visited.insert(startNode);
+        std::vector<bool> visited(nodeCount()); visited[startNode] = true;
         while (!worklist.empty()) {
             auto n = worklist.top();
             worklist.pop();
             for (auto succ : out(n)) {
-                if (visited.count(succ) == 0) {
-                    visited.insert(succ);
+                if (!visited[succ]) {
+                    visited[succ] = true;
                     worklist.push(succ);
                 }
             }
@@ -136,14 +150,25 @@ struct PureGraph
     }
 
 private:
-    PureGraph(size_t totalNodes) : totalNodes(totalNodes) {
-        edges.resize(totalNodes);
-        for(auto& row : edges) 
-            row.resize(totalNodes);
+    PureGraph(size_t totalNodes) 
+        : succs(totalNodes), preds(totalNodes) {}
+
+    // both return whether the list was changed
+    static bool insert(std::vector<size_t>& list, size_t node) {
+        auto it = std::lower_bound(list.begin(), list.end(), node);
+        if (it != list.end() && *it == node) return false;
+        list.insert(it, node);
+        return true;
+    }
+    static bool erase(std::vector<size_t>& list, size_t node) {
+        auto it = std::lower_bound(list.begin(), list.end(), node);
+        if (it == list.end() || *it != node) return false;
+        list.erase(it);
+        return true;
     }
 
-    size_t totalNodes = 0, totalEdges = 0;
-    std::vector<std::vector<bool>> edges;
+    size_t totalEdges = 0;
+    std::vector<std::vector<size_t>> succs, preds;
 };
 
 inline std::ostream& operator<<(std::ostream& stream, PureGraph const& graph) {
@@ -190,8 +215,3 @@ struct Graph : PureGraph
 private:
     std::vector<T> m_nodeData;
 };
-
-using DominanceFrontiers = std::unordered_map<size_t, std::vector<size_t>>;
-
-PureGraph calculateIdom(size_t entry, PureGraph const& graph);
-DominanceFrontiers dominanceFrontier(size_t entry, size_t exit, PureGraph const& graph);
\ No newline at end of file
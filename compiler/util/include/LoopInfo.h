@@ -0,0 +1,37 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "DominatorTree.h"
+
+/*
+    Natural loops of a graph, found from its back edges (an edge whose target
+    dominates its source). Back edges sharing a header form one loop.
+    Loops are ordered outermost first, so a loop's parent always comes before it.
+*/
+class LoopInfo
+{
+public:
+    static constexpr size_t npos = DominatorTree::npos;
+
+    struct Loop
+    {
+        size_t header;
+        std::vector<size_t> latches, blocks; // blocks are sorted and include the header
+        size_t parent = npos, depth = 1;
+
+        bool contains(size_t block) const;
+    };
+
+    LoopInfo(PureGraph const& graph, DominatorTree const& tree);
+
+    std::span<const Loop> loops() const { return allLoops; }
+    // index into loops(), npos when the block is in no loop
+    size_t innermostLoop(size_t block) const { return innermost[block]; }
+    // 0 when the block is in no loop
+    size_t depth(size_t block) const { return innermost[block] == npos ? 0 : allLoops[innermost[block]].depth; }
+    bool isHeader(size_t block) const { return innermost[block] != npos && allLoops[innermost[block]].header == block; }
+
+private:
+    std::vector<Loop> allLoops;
+    std::vector<size_t> innermost;
+};
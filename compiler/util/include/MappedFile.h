@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace util
+{
+	/* Mapped File:
+		A file mapped read-only into memory, its text is read straight from the pages
+		the OS loads and stays valid as long as the mapping is alive. An empty file
+		maps nothing and has empty text.
+	*/
+	class MappedFile
+	{
+	public:
+		static std::optional<MappedFile> open(std::filesystem::path const& path);
+
+		MappedFile(MappedFile&& other) noexcept
+			: data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+		MappedFile& operator=(MappedFile&& other) noexcept {
+			std::swap(data, other.data);
+			std::swap(size, other.size);
+			return *this;
+		}
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+		~MappedFile();
+
+		std::string_view text() const { return { data, size }; }
+
+	private:
+		MappedFile(const char* data, size_t size) : data(data), size(size) {}
+
+		const char* data = nullptr;
+		size_t size = 0;
+	};
+}
@@ -51,6 +51,10 @@ protected:
 		}
 	}
 
+	//the unread rest of the stream, for scanning ahead many elements at once
+	View remainingView() const { return View{ view.data + current, view.size - current }; }
+	void skip(size_t count) { current += count; }
+
 	View currentView() { return View{ view.data + start, current - start }; }
 	size_t currentPos() { return start; }
 	void readjustStart() { start = current; }
@@ -1,6 +1,9 @@
 #pragma once
 #include <utility>
 #include <memory>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
 #include <assert.h>
 
 namespace visit {
@@ -11,6 +14,42 @@ namespace visit {
         template<typename T, typename...Args>
         concept IsIn = (std::is_same_v<std::remove_cvref_t<T>, Args> || ...);
 
+        // the pointer owning a node, a base can name its own as Owner, like one into an arena
+        template<typename ConcreteBase>
+        struct OwnerOf { using type = std::unique_ptr<ConcreteBase>; };
+        template<typename ConcreteBase> requires requires { typename ConcreteBase::Owner; }
+        struct OwnerOf<ConcreteBase> { using type = typename ConcreteBase::Owner; };
+        template<typename ConcreteBase>
+        using owner_t = typename OwnerOf<ConcreteBase>::type;
+
+        template<typename...Types>
+        struct TypeList {};
+
+        // position of the first T in Types
+        template<typename T, typename...Types>
+        constexpr uint8_t indexOf() {
+            static_assert(sizeof...(Types) <= UINT8_MAX, "Kind tags are a byte.");
+            constexpr bool matches[] = { std::is_same_v<T, Types>... };
+            for (uint8_t i = 0; i < sizeof...(Types); i++) {
+                if (matches[i]) return i;
+            }
+            return sizeof...(Types);
+        }
+
+        template<typename Node, typename Callable, typename...ConcreteChildren>
+        decltype(auto) dispatch(Node& node, Callable& callable, TypeList<ConcreteChildren...>) {
+            constexpr bool isConst = std::is_const_v<Node>;
+            using First = std::tuple_element_t<0, std::tuple<ConcreteChildren...>>;
+            using ReturnType = std::invoke_result_t<Callable&, conditional_const_t<isConst, First>&>;
+            using Entry = ReturnType(*)(Node&, Callable&);
+            static constexpr Entry table[] = {
+                [](Node& node, Callable& callable) -> ReturnType {
+                    return callable(static_cast<conditional_const_t<isConst, ConcreteChildren>&>(node));
+                }...
+            };
+            return table[node.kind()](node, callable);
+        }
+
         template<typename ConcreteBase, bool isConst, typename...ConcreteChildren>
         class VisitorVFunctions;
 
@@ -41,13 +80,14 @@ namespace visit {
             template<typename, typename> friend class Visitable;
             virtual ~Visitor() = default;
 
-            void visitChild(std::unique_ptr<ConcreteBase> const& ptr) {
+            void visitChild(owner_t<ConcreteBase> const& ptr) {
                 ptr->accept(*this);
             }
 
             template<IsIn<ConcreteChildren...> T>
             void visitChild(type_identity_t<conditional_const_t<isConst, T>>& concrete) {
-                concrete.accept(*this);
+                //accept is only reachable through the base, which names this visitor a friend
+                static_cast<conditional_const_t<isConst, ConcreteBase>&>(concrete).accept(*this);
             }
         };
 
@@ -57,7 +97,7 @@ namespace visit {
         public:
             template<typename, typename> friend class Visitable;
 
-            ReturnType visitChild(std::unique_ptr<ConcreteBase> const& ptr) {
+            ReturnType visitChild(owner_t<ConcreteBase> const& ptr) {
                 returnedValue = false;
                 this->Visitor<ConcreteBase, isConst, ConcreteChildren...>::visitChild(ptr);
                 return flushRetval();
@@ -65,7 +105,7 @@ namespace visit {
             template<IsIn<ConcreteChildren...> T>
             ReturnType visitChild(conditional_const_t<isConst, T>& concrete) {
                 returnedValue = false;
-                this->Visitor<ConcreteBase, isConst, ConcreteChildren...>::visitChild<T>(concrete);
+                this->Visitor<ConcreteBase, isConst, ConcreteChildren...>::template visitChild<T>(concrete);
                 return flushRetval();
             }
 
@@ -102,16 +142,16 @@ namespace visit {
         };
 
         template<typename ConcreteVisitor, typename ConcreteBase, typename...ConcreteChildren>
-        class CloneVisitor : protected VisitorReturner<ConcreteBase, std::unique_ptr<ConcreteBase>, true, ConcreteChildren...>
+        class CloneVisitor : protected VisitorReturner<ConcreteBase, owner_t<ConcreteBase>, true, ConcreteChildren...>
         {
-            using BaseReturner = VisitorReturner<ConcreteBase, std::unique_ptr<ConcreteBase>, true, ConcreteChildren...>;
+            using BaseReturner = VisitorReturner<ConcreteBase, owner_t<ConcreteBase>, true, ConcreteChildren...>;
         public:
-            std::unique_ptr<ConcreteBase> clone(std::unique_ptr<ConcreteBase> const& other) {
+            owner_t<ConcreteBase> clone(owner_t<ConcreteBase> const& other) {
                 return this->BaseReturner::visitChild(other);
             } 
             template<IsIn<ConcreteChildren...> T>
             T clone(T const& other) {
-                return this->BaseReturner::visitChild<T>(other);
+                return this->BaseReturner::template visitChild<T>(other);
             }
         protected:
             template<IsIn<ConcreteChildren...> T>
@@ -120,9 +160,9 @@ namespace visit {
                 for (auto& val : list) cloned.emplace_back(ConcreteVisitor{}.clone(val));
                 return cloned;
             }
-            auto cloneList(std::vector<std::unique_ptr<ConcreteBase>> const& list) const
+            auto cloneList(std::vector<owner_t<ConcreteBase>> const& list) const
             {
-                std::vector<std::unique_ptr<ConcreteBase>> cloned; cloned.reserve(list.size());
+                std::vector<owner_t<ConcreteBase>> cloned; cloned.reserve(list.size());
                 for (auto& val : list) cloned.emplace_back(ConcreteVisitor{}.clone(val));
                 return cloned;
             }
@@ -130,6 +170,8 @@ namespace visit {
 
         template<typename ConcreteBase, typename ConcreteChild>
         class Visitable : public ConcreteBase {
+        public:
+            Visitable() { this->kindTag = ConcreteBase::template kindOf<ConcreteChild>(); }
         private:
             void accept(typename ConcreteBase::VisitorType& visitor) override {
                 visitor.visit(*static_cast<ConcreteChild*>(this));
@@ -148,6 +190,10 @@ namespace visit {
         VisitorReturnType: Inherit this in your visitor that returns a value. templated return type
         VisitorType: Inherit this in you visitor that returns nothing.
         Visitable: Inherit this in the classes that derive from your generic class (using CRTP)
+
+        Every node also carries a kind tag, its position in ConcreteChildren. visit::dispatch
+        uses it to call a callable with the concrete node through a table built at compile
+        time, without a virtual call, returning whatever the callable returns.
     */
     template<typename ConcreteBase, typename...ConcreteChildren>
     class VisitableBase 
@@ -169,7 +215,18 @@ namespace visit {
         template<typename ConcreteChild>
         using Visitable = detail::Visitable<ConcreteBase, ConcreteChild>;
 
+        using Kind = uint8_t;
+        using Children = detail::TypeList<ConcreteChildren...>;
+
+        Kind kind() const { return kindTag; }
+        template<typename ConcreteChild>
+        static constexpr Kind kindOf() { return detail::indexOf<ConcreteChild, ConcreteChildren...>(); }
+        template<typename ConcreteChild>
+        bool is() const { return kindTag == kindOf<ConcreteChild>(); }
+
         virtual ~VisitableBase() = default;
+    protected:
+        Kind kindTag = 0;
     private:
         template<typename, bool, typename...> friend class detail::Visitor;
         template<typename, typename, bool, typename...> friend class detail::VisitorReturner;
@@ -178,5 +235,9 @@ namespace visit {
         virtual void accept(ConstVisitorType& visitor) const = 0;
     };
 
+    // calls callable(concrete) with node as the type its kind tag names
+    template<typename Node, typename Callable>
+    decltype(auto) dispatch(Node& node, Callable&& callable) {
+        return detail::dispatch(node, callable, typename std::remove_const_t<Node>::Children{});
+    }
 }
-
@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+#include "RegisterAllocator.h"
+#include "InstructionSelector.h"
+
+namespace
+{
+	// entry0 -> 2 -> exit1, the body is all in block 2
+	ILCtrlFlowGraph straightLine(IL::Program body)
+	{
+		ILCtrlFlowGraph graph;
+		graph.createNode(ILBlock::defaultBlock());
+		graph.addEdge(0, 2);
+		graph.addEdge(2, 1);
+		graph.nodeData(2).body = std::move(body);
+		return graph;
+	}
+
+	// inline assembly may touch every register, so whatever lives across it is spilled
+	IL::UniquePtr inlineAsm() { return IL::makeIL<IL::Instruction>(Stmt::Instruction("nop", {})); }
+
+	std::optional<z80::Register> registerOf(z80::RegisterAllocation const& allocation, size_t id)
+	{
+		auto location = allocation.locationOf(IL::Variable(id));
+		if (!location.has_value() || !std::holds_alternative<z80::Register>(location.value())) return std::nullopt;
+		return std::get<z80::Register>(location.value());
+	}
+
+	// an inline assembly instruction with the operands written in the source
+	template<typename...Args>
+	IL::UniquePtr inlineAsm(std::string_view opcode, Args...args)
+	{
+		Stmt::ArgList argList;
+		(argList.push_back(std::move(args)), ...);
+		return IL::makeIL<IL::Instruction>(Stmt::Instruction(opcode, std::move(argList)));
+	}
+
+	Expr::UniquePtr reg(std::string_view name) { return Expr::makeExpr<Expr::Register>({}, name); }
+	Expr::UniquePtr number(u16 value) { return Expr::makeExpr<Expr::Literal>({}, Token::Literal(value)); }
+
+	// the code selected for the whole graph, an instruction per line
+	std::vector<std::string> select(ILCtrlFlowGraph const& graph, IL::Type returnType, z80::CostModel model = z80::CostModel::SPEED)
+	{
+		opt::AnalysisManager analyses(graph);
+		auto allocation = z80::allocateRegisters(graph, analyses);
+		std::vector<std::string> code;
+		for (auto& block : z80::selectInstructions(graph, allocation, returnType, model)) {
+			for (auto& instr : block.code) code.push_back(z80::toString(instr));
+		}
+		return code;
+	}
+
+	bool contains(std::vector<std::string> const& code, std::string_view line)
+	{
+		return std::find(code.begin(), code.end(), line) != code.end();
+	}
+
+	// the value of a call to f, a function of no arguments
+	IL::UniquePtr callF(size_t id, IL::Type type)
+	{
+		return IL::makeIL<IL::FunctionCall>(IL::Decl(IL::Variable(id), type), std::string_view("f"), std::vector<IL::Value>{});
+	}
+
+	z80::StackSlot slotOf(z80::RegisterAllocation const& allocation, size_t id)
+	{
+		auto location = allocation.locationOf(IL::Variable(id));
+		EXPECT_TRUE(location.has_value() && std::holds_alternative<z80::StackSlot>(location.value())) << "#" << id;
+		return location.has_value() && std::holds_alternative<z80::StackSlot>(location.value()) ?
+			std::get<z80::StackSlot>(location.value()) : z80::StackSlot{ 0 };
+	}
+}
+
+TEST(RegisterAllocatorTest, SpillsShareSlots)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	body.push_back(inlineAsm());
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, 1));
+	body.push_back(inlineAsm());
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(11)));
+	auto graph = straightLine(std::move(body));
+	opt::AnalysisManager analyses(graph);
+	auto allocation = z80::allocateRegisters(graph, analyses);
+
+	// #10 dies where #11 is made, so they can take turns in one byte
+	EXPECT_EQ(slotOf(allocation, 10).offset, slotOf(allocation, 11).offset);
+	EXPECT_EQ(allocation.frameSize(), 1);
+}
+
+TEST(RegisterAllocatorTest, AddressTakenSlotsAreNotShared)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u16, 1));
+	body.push_back(IL::makeIL<IL::AddressOf>(IL::Variable(11), IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(12), IL::Type::u8, 2));
+	body.push_back(inlineAsm());
+	body.push_back(IL::makeIL<IL::Store>(IL::Variable(11), IL::Variable(12), IL::Type::u8));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(12)));
+	auto graph = straightLine(std::move(body));
+	opt::AnalysisManager analyses(graph);
+	auto allocation = z80::allocateRegisters(graph, analyses);
+
+	// #10 is not live past its address being taken, but the store through #11 still writes it
+	auto addressTaken = slotOf(allocation, 10), spilled = slotOf(allocation, 12);
+	EXPECT_NE(addressTaken.offset, spilled.offset);
+	EXPECT_EQ(allocation.frameSize(), 2 + 1 + 2);
+	EXPECT_TRUE(addressTaken.offset + 2 <= spilled.offset || spilled.offset + 1 <= addressTaken.offset);
+}
+
+TEST(RegisterAllocatorTest, ByteArgumentPassedInA)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 3));
+	body.push_back(IL::makeIL<IL::FunctionCall>(IL::Decl(IL::Variable(11), IL::Type::u16), std::string_view("f"), std::vector<IL::Value>{ IL::Variable(10) }));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(11)));
+	auto graph = straightLine(std::move(body));
+	opt::AnalysisManager analyses(graph);
+	auto allocation = z80::allocateRegisters(graph, analyses);
+
+	EXPECT_EQ(registerOf(allocation, 10), z80::Register::A);
+	EXPECT_EQ(registerOf(allocation, 11), z80::Register::HL);
+}
+
+TEST(InstructionSelectorTest, InlineAssemblyIsCopied)
+{
+	IL::Program body;
+	body.push_back(inlineAsm("LD", reg("A"), Expr::makeExpr<Expr::Parenthesis>({},
+		Expr::makeExpr<Expr::Binary>({}, reg("ix"), Token::Type::PLUS, number(3)))));
+	body.push_back(inlineAsm("jp", reg("c"), number(0x1234)));
+	body.push_back(IL::makeIL<IL::Return>());
+	auto code = select(straightLine(std::move(body)), IL::Type::void_);
+
+	// spelled the way the assembler's table knows them, the condition c is not the register
+	EXPECT_TRUE(contains(code, "ld a,(ix+3)"));
+	EXPECT_TRUE(contains(code, "jp c,4660"));
+}
+
+TEST(InstructionSelectorTest, UnreadableInlineAssemblyIsAnError)
+{
+	IL::Program labelled;
+	labelled.push_back(inlineAsm("jp", Expr::makeExpr<Expr::Identifier>({}, std::string_view("somewhere"))));
+	labelled.push_back(IL::makeIL<IL::Return>());
+	EXPECT_THROW(select(straightLine(std::move(labelled)), IL::Type::void_), z80::SelectionError);
+
+	IL::Program invalid;
+	invalid.push_back(inlineAsm("ld", reg("hl"), reg("a")));
+	invalid.push_back(IL::makeIL<IL::Return>());
+	EXPECT_THROW(select(straightLine(std::move(invalid)), IL::Type::void_), z80::SelectionError);
+}
+
+TEST(InstructionSelectorTest, CallThroughPointer)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u16, 0x1234));
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(11), IL::Type::u8, 7));
+	body.push_back(IL::makeIL<IL::FunctionCall>(IL::Decl(IL::Variable(12), IL::Type::u8), IL::Variable(10), std::vector<IL::Value>{ IL::Variable(11) }));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(12)));
+	auto graph = straightLine(std::move(body));
+	auto code = select(graph, IL::Type::u8);
+
+	// the pointer goes where __call_iy jumps through, the argument where a direct call takes it
+	EXPECT_TRUE(contains(code, "ld iy,4660"));
+	EXPECT_TRUE(contains(code, "ld a,7"));
+	EXPECT_TRUE(contains(code, "call __call_iy"));
+}
+
+TEST(InstructionSelectorTest, CostModelOfLevel)
+{
+	for (std::string_view level : { "-O0", "-O1", "-O2" }) {
+		EXPECT_EQ(z80::costModelFor(opt::PassManager::fromPipeline(level).value()), z80::CostModel::SPEED) << level;
+	}
+	auto forSize = opt::PassManager::fromPipeline("-Os");
+	ASSERT_TRUE(forSize.has_value());
+	EXPECT_EQ(z80::costModelFor(forSize.value()), z80::CostModel::SIZE);
+}
+
+TEST(InstructionSelectorTest, FrameOutOfReachIsAnError)
+{
+	// every value lives across the inline assembly, so each takes a byte of the frame
+	auto spillAll = [](size_t count) {
+		IL::Program body;
+		for (size_t id = 0; id < count; ++id) body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10 + id), IL::Type::u8, int(id)));
+		body.push_back(inlineAsm());
+		body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(1000), IL::Type::u8, 0));
+		for (size_t id = 0; id < count; ++id) {
+			body.push_back(IL::makeIL<IL::Binary>(IL::Variable(1000), IL::Type::u8, IL::Variable(1000), Token::Type::PLUS, IL::Variable(10 + id)));
+		}
+		body.push_back(IL::makeIL<IL::Return>(IL::Variable(1000)));
+		return straightLine(std::move(body));
+	};
+	auto reachable = spillAll(120);
+	EXPECT_NO_THROW(select(reachable, IL::Type::u8));
+	auto tooDeep = spillAll(140);
+	opt::AnalysisManager analyses(tooDeep);
+	EXPECT_GT(z80::allocateRegisters(tooDeep, analyses).frameSize(), 128);
+	EXPECT_THROW(select(tooDeep, IL::Type::u8), z80::SelectionError);
+}
+
+TEST(InstructionSelectorTest, WordAddThroughHL)
+{
+	IL::Program body;
+	body.push_back(callF(10, IL::Type::u16));
+	body.push_back(callF(11, IL::Type::u16));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(12), IL::Type::u16, IL::Variable(10), Token::Type::PLUS, IL::Variable(11)));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(12)));
+	auto code = select(straightLine(std::move(body)), IL::Type::u16);
+
+	// the first result is moved out of HL for the second call, then added back into it
+	EXPECT_TRUE(contains(code, "add hl,de"));
+}
+
+TEST(InstructionSelectorTest, IncAndDecForOne)
+{
+	IL::Program bytes;
+	bytes.push_back(callF(10, IL::Type::u8));
+	bytes.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, 1));
+	bytes.push_back(IL::makeIL<IL::Binary>(IL::Variable(12), IL::Type::u8, IL::Variable(11), Token::Type::MINUS, 1));
+	bytes.push_back(IL::makeIL<IL::Binary>(IL::Variable(13), IL::Type::u8, IL::Variable(12), Token::Type::STAR, IL::Variable(11)));
+	bytes.push_back(IL::makeIL<IL::Return>(IL::Variable(13)));
+	auto code = select(straightLine(std::move(bytes)), IL::Type::u8);
+	EXPECT_TRUE(std::any_of(code.begin(), code.end(), [](auto const& line) { return line.starts_with("inc "); }));
+	EXPECT_TRUE(std::any_of(code.begin(), code.end(), [](auto const& line) { return line.starts_with("dec "); }));
+	EXPECT_FALSE(std::any_of(code.begin(), code.end(), [](auto const& line) { return line.ends_with(",1"); }));
+
+	IL::Program word;
+	word.push_back(callF(10, IL::Type::u16));
+	word.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::u16, IL::Variable(10), Token::Type::MINUS, 1));
+	word.push_back(IL::makeIL<IL::Return>(IL::Variable(11)));
+	EXPECT_TRUE(contains(select(straightLine(std::move(word)), IL::Type::u16), "dec hl"));
+}
+
+TEST(InstructionSelectorTest, TestBitBranchesOnBit)
+{
+	// entry0 -> 2 ; 2 splits -> 3(T),4(F) ; 3,4 -> exit1
+	ILCtrlFlowGraph graph;
+	graph.createNode(ILBlock::defaultBlock());
+	graph.createNode(ILBlock::trueBlock());
+	graph.createNode(ILBlock::falseBlock());
+	graph.addEdge(0, 2); graph.addEdge(2, 3); graph.addEdge(2, 4); graph.addEdge(3, 1); graph.addEdge(4, 1);
+	graph.nodeData(2).body.push_back(callF(10, IL::Type::u8));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::TestBit>(IL::Variable(11), IL::Variable(10), 3));
+	graph.nodeData(2).splitWith(IL::Variable(11));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Return>(1));
+	graph.nodeData(4).body.push_back(IL::makeIL<IL::Return>(2));
+	auto code = select(graph, IL::Type::u8);
+
+	// the branch reads the Z flag BIT leaves, the bit is never moved into a register
+	EXPECT_TRUE(contains(code, "bit 3,a"));
+	EXPECT_TRUE(std::any_of(code.begin(), code.end(), [](auto const& line) { return line.starts_with("jp z,"); }));
+}
+
+TEST(InstructionSelectorTest, SpilledValuesReadFromFrame)
+{
+	IL::Program body;
+	body.push_back(callF(10, IL::Type::u8));
+	body.push_back(inlineAsm());
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, 5));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(11)));
+	auto code = select(straightLine(std::move(body)), IL::Type::u8);
+
+	EXPECT_TRUE(contains(code, "ld (ix-1),a"));
+	EXPECT_TRUE(contains(code, "ld a,(ix-1)"));
+}
+
+TEST(InstructionSelectorTest, SpeedAndSizeDiffer)
+{
+	IL::Program body;
+	body.push_back(callF(10, IL::Type::u8));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::u8, IL::Variable(10), Token::Type::SHIFT_RIGHT, 7));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(11)));
+	auto graph = straightLine(std::move(body));
+
+	// seven SRL A in a row are fastest, a DJNZ loop around one is smallest
+	auto fast = select(graph, IL::Type::u8, z80::CostModel::SPEED), small = select(graph, IL::Type::u8, z80::CostModel::SIZE);
+	EXPECT_EQ(std::count(fast.begin(), fast.end(), "srl a"), 7);
+	EXPECT_FALSE(std::any_of(fast.begin(), fast.end(), [](auto const& line) { return line.starts_with("djnz"); }));
+	EXPECT_EQ(std::count(small.begin(), small.end(), "srl a"), 1);
+	EXPECT_TRUE(contains(small, "ld b,7"));
+	EXPECT_TRUE(std::any_of(small.begin(), small.end(), [](auto const& line) { return line.starts_with("djnz"); }));
+}
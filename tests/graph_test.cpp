@@ -1,6 +1,8 @@
 
 #include <gtest/gtest.h>
 #include "Graph.h"
+#include "DominatorTree.h"
+#include "LoopInfo.h"
 
 TEST(GraphTest, HasEdge)
 {
@@ -45,6 +47,55 @@ TEST(GraphTest, OutIterator)
 	ASSERT_EQ(count, 1);
 
 }
+
+TEST(GraphTest, InIterator)
+{
+	PureGraph graph = PureGraph::trivialGraph(4);
+	graph.addEdge(3, 1);
+	graph.addEdge(0, 1);
+	graph.addEdge(2, 1);
+	std::vector<size_t> preds(graph.in(1).begin(), graph.in(1).end());
+	ASSERT_EQ(preds, std::vector<size_t>({ 0, 2, 3 })) << "Predecessors must be visited in ascending order.";
+	ASSERT_EQ(graph.predecessorCount(1), 3);
+
+	graph.removeEdge(2, 1);
+	ASSERT_EQ(graph.predecessorCount(1), 2);
+	ASSERT_EQ(graph.edgeCount(), 2);
+	graph.removeAllEdges(0);
+	ASSERT_EQ(graph.predecessorCount(1), 1);
+	ASSERT_FALSE(graph.hasEdge(0, 1));
+}
+
+TEST(GraphTest, CreateNode)
+{
+	PureGraph graph = PureGraph::trivialGraph(1);
+	size_t node = graph.createNode();
+	ASSERT_EQ(node, 1);
+	ASSERT_EQ(graph.nodeCount(), 2);
+	graph.addEdge(0, node);
+	ASSERT_TRUE(graph.hasEdge(0, node));
+	ASSERT_EQ(graph.successorCount(0), 1);
+}
+
+TEST(GraphTest, FrozenGraphMatches)
+{
+	PureGraph graph = PureGraph::trivialGraph(5);
+	graph.addEdge(0, 4);
+	graph.addEdge(0, 2);
+	graph.addEdge(2, 3);
+	graph.addEdge(3, 2);
+	graph.addEdge(4, 3);
+	FrozenGraph frozen = graph.freeze();
+	ASSERT_EQ(frozen.nodeCount(), graph.nodeCount());
+	ASSERT_EQ(frozen.edgeCount(), graph.edgeCount());
+	for (size_t node = 0; node < graph.nodeCount(); ++node) {
+		ASSERT_TRUE(std::ranges::equal(frozen.out(node), graph.out(node)));
+		ASSERT_TRUE(std::ranges::equal(frozen.in(node), graph.in(node)));
+		for (size_t other = 0; other < graph.nodeCount(); ++other)
+			ASSERT_EQ(frozen.hasEdge(node, other), graph.hasEdge(node, other));
+	}
+}
+
 TEST(GraphTest, DfsCorrectlyVisits)
 {
 	PureGraph graph = PureGraph::fullyConnected(4);
@@ -147,4 +198,78 @@ TEST(GraphTest, CytronPaper)
 	EXPECT_SET(frontiers[12], set(13, 2));
 	EXPECT_SET(frontiers[13], set());
 #undef EXPECT_SET
-}
\ No newline at end of file
+}
+TEST(GraphTest, DominatorTreeQueries)
+{
+	// diamond with a loop back edge and an unreachable node
+	PureGraph graph = PureGraph::trivialGraph(7);
+	graph.addEdge(0, 1);
+	graph.addEdge(1, 2);
+	graph.addEdge(1, 3);
+	graph.addEdge(2, 4);
+	graph.addEdge(3, 4);
+	graph.addEdge(4, 1);
+	graph.addEdge(4, 5);
+	graph.addEdge(6, 5);
+	DominatorTree tree(0, graph);
+
+	ASSERT_EQ(tree.immediateDominator(0), DominatorTree::npos);
+	ASSERT_EQ(tree.immediateDominator(4), 1);
+	ASSERT_EQ(tree.immediateDominator(5), 4);
+	ASSERT_FALSE(tree.isReachable(6));
+	ASSERT_TRUE(tree.dominates(0, 5));
+	ASSERT_TRUE(tree.dominates(1, 4));
+	ASSERT_TRUE(tree.dominates(4, 4));
+	ASSERT_FALSE(tree.strictlyDominates(4, 4));
+	ASSERT_FALSE(tree.dominates(2, 4));
+	ASSERT_FALSE(tree.dominates(6, 5));
+	ASSERT_EQ(tree.preorder(0), 0);
+	ASSERT_EQ(tree.postorder(0), tree.preorderNodes().size() - 1);
+
+	auto frontiers = dominanceFrontier(tree, graph);
+	ASSERT_EQ(frontiers[2], std::vector<size_t>({ 4 }));
+	ASSERT_EQ(frontiers[4], std::vector<size_t>({ 1 }));
+	ASSERT_EQ(frontiers[1], std::vector<size_t>({ 1 }));
+	ASSERT_TRUE(frontiers[6].empty());
+}
+
+TEST(GraphTest, DominatorTreeVirtualExit)
+{
+	PureGraph graph = PureGraph::trivialGraph(4);
+	graph.addEdge(0, 2);
+	graph.addEdge(2, 3);
+	graph.addEdge(3, 1);
+	DominatorTree plain(0, graph), withExit(0, 1, graph);
+	ASSERT_EQ(plain.immediateDominator(1), 3);
+	ASSERT_EQ(withExit.immediateDominator(1), 0);
+	ASSERT_FALSE(graph.hasEdge(0, 1)) << "The virtual edge must not modify the graph.";
+	ASSERT_EQ(dominanceFrontier(0, 1, graph)[2], std::vector<size_t>({ 1 }));
+}
+
+TEST(GraphTest, LoopInfoNesting)
+{
+	// 1 is an outer loop header, 2 an inner loop header, 5 is outside both loops
+	PureGraph graph = PureGraph::trivialGraph(6);
+	graph.addEdge(0, 1);
+	graph.addEdge(1, 2);
+	graph.addEdge(2, 3);
+	graph.addEdge(3, 2);
+	graph.addEdge(3, 4);
+	graph.addEdge(4, 1);
+	graph.addEdge(1, 5);
+	LoopInfo loops(graph, DominatorTree(0, graph));
+
+	ASSERT_EQ(loops.loops().size(), 2);
+	auto& outer = loops.loops()[0];
+	auto& inner = loops.loops()[1];
+	ASSERT_EQ(outer.header, 1);
+	ASSERT_EQ(outer.blocks, std::vector<size_t>({ 1, 2, 3, 4 }));
+	ASSERT_EQ(inner.header, 2);
+	ASSERT_EQ(inner.blocks, std::vector<size_t>({ 2, 3 }));
+	ASSERT_EQ(inner.parent, 0);
+	ASSERT_EQ(loops.depth(3), 2);
+	ASSERT_EQ(loops.depth(4), 1);
+	ASSERT_EQ(loops.depth(5), 0);
+	ASSERT_TRUE(loops.isHeader(2));
+	ASSERT_FALSE(loops.isHeader(3));
+}
@@ -0,0 +1,662 @@
+#include <gtest/gtest.h>
+#include "TokenStream.h"
+#include "ExprParser.h"
+#include "StmtParser.h"
+#include "TypeSystem.h"
+#include "SemanticError.h"
+#include "Passes.h"
+#include "AnalysisManager.h"
+#include "ILOperands.h"
+#include "ScopedTable.h"
+#include <map>
+
+namespace
+{
+	Expr::UniquePtr parseExpr(TokenStream& tokens)
+	{
+		ParserContext context;
+		return ExprParser(tokens, context).expr();
+	}
+
+	// entry0 -> 2 ; 2 splits on cond -> 3(T),4(F) ; 3,4 -> 5 -> exit1
+	ILCtrlFlowGraph diamond(IL::Variable cond)
+	{
+		ILCtrlFlowGraph graph;
+		for (int i = 0; i < 4; i++) graph.createNode(ILBlock::defaultBlock());
+		graph.nodeData(3) = ILBlock::trueBlock(); graph.nodeData(4) = ILBlock::falseBlock();
+		graph.addEdge(0, 2); graph.addEdge(2, 3); graph.addEdge(2, 4);
+		graph.addEdge(3, 5); graph.addEdge(4, 5); graph.addEdge(5, 1);
+		graph.nodeData(2).splitWith(cond);
+		return graph;
+	}
+
+	// entry0 -> 2 -> exit1
+	ILCtrlFlowGraph straightLine(IL::Program body)
+	{
+		ILCtrlFlowGraph graph;
+		graph.createNode(ILBlock::defaultBlock());
+		graph.addEdge(0, 2); graph.addEdge(2, 1);
+		graph.nodeData(2).body = std::move(body);
+		return graph;
+	}
+
+	// new variables start at #100
+	bool runPass(std::unique_ptr<opt::FunctionPass> pass, ILCtrlFlowGraph& graph)
+	{
+		size_t next = 100;
+		opt::FunctionContext function{ "test", graph, [&](IL::Type) { return IL::Variable(next++); } };
+		opt::AnalysisManager analyses(graph);
+		return pass->run(function, analyses);
+	}
+
+	bool isVariable(IL::Value const& value, size_t id)
+	{
+		auto var = std::get_if<IL::Variable>(&value);
+		return var && !var->is_global && var->id == id;
+	}
+
+	bool isConstant(IL::Value const& value, int constant)
+	{
+		auto number = std::get_if<int>(&value);
+		return number && *number == constant;
+	}
+
+	// how often each local variable is defined in the graph
+	std::map<size_t, size_t> definitionCounts(ILCtrlFlowGraph& graph)
+	{
+		std::map<size_t, size_t> counts;
+		for (size_t block = 0; block < graph.nodeCount(); ++block) {
+			for (auto& instr : graph.nodeData(block).body) {
+				IL::forEachDef(instr, [&](IL::Variable& var, IL::Type) { if (!var.is_global) counts[var.id]++; });
+			}
+		}
+		return counts;
+	}
+
+	// whether instr is a copy of variable #id
+	bool copies(IL::UniquePtr const& instr, size_t id)
+	{
+		auto copy = IL::getIf<IL::Assignment>(instr);
+		return copy && isVariable(copy->src, id);
+	}
+
+	// how many of the kinds in the list the node says it is
+	template<typename...Nodes>
+	size_t kindsMatched(IL::IL const& node, visit::detail::TypeList<Nodes...>) { return (size_t(node.is<Nodes>()) + ...); }
+	template<typename...Nodes>
+	constexpr size_t kindCount(visit::detail::TypeList<Nodes...>) { return sizeof...(Nodes); }
+}
+
+TEST(EvaluationTest, SizeofFolds)
+{
+	TypeSystem types;
+	TokenStream tokens("sizeof(u16) + 1");
+	Evaluation result = types.evaluate(parseExpr(tokens));
+	ASSERT_TRUE(result.hasValue());
+	ASSERT_TRUE(result.value().isInt());
+	EXPECT_EQ(result.value().getInt(), 3);
+}
+
+TEST(EvaluationTest, TypeModifiers)
+{
+	TypeSystem types;
+	TokenStream tokens("u8?");
+	Evaluation result = types.evaluate(parseExpr(tokens));
+	ASSERT_TRUE(result.hasValue());
+	ASSERT_TRUE(result.value().isTypeInstance());
+	EXPECT_TRUE(result.value().getTypeInstance().isOpt);
+	EXPECT_EQ(result.value().getTypeInstance().type, types.getType("u8"));
+}
+
+TEST(EvaluationTest, NestedNotConstant)
+{
+	TypeSystem types;
+	for (std::string_view source : { "sizeof(total)", "(u8, total) -> u8", "(u8) -> total", "total?", "total&", "total<u8>" })
+	{
+		TokenStream tokens(source);
+		Evaluation result(ComputedExpr{ SourcePosition{}, u16(0) });
+		ASSERT_NO_THROW(result = types.evaluate(parseExpr(tokens))) << source;
+		ASSERT_FALSE(result.hasValue()) << source;
+		EXPECT_FALSE(result.error().reason.empty()) << source;
+	}
+}
+
+TEST(EvaluationTest, ConstantThatIsNotAType)
+{
+	TypeSystem types;
+	TokenStream tokens("sizeof(5)");
+	EXPECT_THROW(types.evaluate(parseExpr(tokens)), SemanticError);
+}
+
+TEST(TypeSystemTest, EqualStructuresAreOneType)
+{
+	TypeSystem types;
+	TypeInstance u8 = types.getType("u8"), u16 = types.getType("u16");
+	EXPECT_EQ(types.addFunction({ u8, u16 }, u8), types.addFunction({ u8, u16 }, u8));
+	EXPECT_NE(types.addFunction({ u8, u16 }, u8), types.addFunction({ u16, u8 }, u8));
+	EXPECT_EQ(types.addArray(u8, 4), types.addArray(u8, 4));
+	EXPECT_NE(types.addArray(u8, 4), types.addArray(u8, 5));
+
+	// the nested dimension is part of the list's structure too
+	auto list = static_cast<ListType const*>(types.addArray(u16, 3));
+	EXPECT_EQ(types.modifyAndAddArray(list, 2), types.modifyAndAddArray(list, 2));
+}
+
+TEST(TypeSystemTest, MutIsADifferentType)
+{
+	TypeSystem types;
+	TypeInstance u8 = types.getType("u8"), mutU8 = u8;
+	mutU8.isMut = true;
+	EXPECT_NE(types.addFunction({ mutU8 }, u8), types.addFunction({ u8 }, u8));
+	EXPECT_EQ(types.addFunction({ mutU8 }, u8), types.addFunction({ mutU8 }, u8));
+	EXPECT_NE(types.addArray(mutU8, 4), types.addArray(u8, 4));
+}
+
+TEST(TypeSystemTest, TemplateInstancesAreMadeOnce)
+{
+	TypeSystem types;
+	ParserContext context;
+	TokenStream decl("bin<T : type> Pos:\n    x : T\n    y : T\n");
+	auto bin = StmtParser(decl, context).stmt();
+	ASSERT_TRUE(bin->is<Stmt::Bin>());
+	types.addBin(std::move(static_cast<Stmt::Bin&>(*bin)));
+
+	auto instantiate = [&](std::string_view source) {
+		TokenStream tokens(source);
+		return types.instantiateType(ExprParser(tokens, context).expr()).type;
+	};
+	TypePtr first = instantiate("Pos<u8>");
+	EXPECT_EQ(instantiate("Pos<u8>"), first);
+	EXPECT_NE(instantiate("Pos<u16>"), first);
+	EXPECT_EQ(first->size, 2u);
+}
+
+TEST(ScopedTableTest, InnerScopeShadows)
+{
+	ScopedTable<std::string_view, int> table;
+	table.newScope();
+	EXPECT_TRUE(table.insert("v", 1));
+	table.newScope();
+	EXPECT_TRUE(table.insert("v", 2));
+	ASSERT_NE(table.find("v"), nullptr);
+	EXPECT_EQ(*table.find("v"), 2);
+
+	// popping the scope brings the outer binding back, popping the last one unbinds it
+	table.destroyScope();
+	ASSERT_NE(table.find("v"), nullptr);
+	EXPECT_EQ(*table.find("v"), 1);
+	table.destroyScope();
+	EXPECT_FALSE(table.contains("v"));
+}
+
+TEST(ScopedTableTest, DuplicateInOneScope)
+{
+	ScopedTable<std::string_view, int> table;
+	table.newScope();
+	EXPECT_TRUE(table.insert("v", 1));
+	EXPECT_FALSE(table.insert("v", 2));
+	EXPECT_EQ(*table.find("v"), 1);
+
+	// the rejected binding left nothing to undo
+	table.newScope();
+	EXPECT_TRUE(table.insert("v", 3));
+	table.destroyScope();
+	EXPECT_EQ(*table.find("v"), 1);
+}
+
+TEST(ILTest, KindsRoundTrip)
+{
+	using enum IL::Type;
+	IL::Variable v(0), w(1);
+	// one of each node, in the order the kinds are listed
+	IL::Program nodes;
+	nodes.push_back(IL::makeIL<IL::Function>(std::string_view("f"), IL::Function::Signature({}, void_), false, IL::ILBody{}));
+	nodes.push_back(IL::makeIL<IL::Binary>(v, u8, IL::Value(w), Token::Type::PLUS, IL::Value(1)));
+	nodes.push_back(IL::makeIL<IL::Unary>(v, u8, Token::Type::MINUS, IL::Value(w)));
+	nodes.push_back(IL::makeIL<IL::Phi>(v, u8, std::vector<IL::Value>{ w, 1 }));
+	nodes.push_back(IL::makeIL<IL::Return>(IL::Value(w)));
+	nodes.push_back(IL::makeIL<IL::Assignment>(v, u8, IL::Value(w)));
+	nodes.push_back(IL::makeIL<IL::Instruction>(Stmt::Instruction(std::string_view("nop"), {})));
+	nodes.push_back(IL::makeIL<IL::Jump>(IL::Label(0)));
+	nodes.push_back(IL::makeIL<IL::FunctionCall>(IL::Decl(v, u8), IL::FunctionCall::Callable(std::string_view("f")), std::vector<IL::Value>{}));
+	nodes.push_back(IL::makeIL<IL::Label>(size_t{ 0 }));
+	nodes.push_back(IL::makeIL<IL::Test>(v, IL::Label(0)));
+	nodes.push_back(IL::makeIL<IL::Cast>(v, u16, w));
+	nodes.push_back(IL::makeIL<IL::Allocate>(v, size_t{ 2 }));
+	nodes.push_back(IL::makeIL<IL::Deref>(v, u8, w));
+	nodes.push_back(IL::makeIL<IL::Store>(v, w, u8));
+	nodes.push_back(IL::makeIL<IL::MemCopy>(v, w, size_t{ 2 }));
+	nodes.push_back(IL::makeIL<IL::AddressOf>(v, IL::AddressOf::Addressable(w)));
+	nodes.push_back(IL::makeIL<IL::TestBit>(v, w, size_t{ 3 }));
+	ASSERT_EQ(nodes.size(), kindCount(IL::IL::Children{}));
+
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		IL::IL const& node = *nodes[i];
+		EXPECT_EQ(node.kind(), i);
+		EXPECT_EQ(kindsMatched(node, IL::IL::Children{}), 1u) << i;
+		// dispatch hands back the same node as the type its kind names
+		bool sameNode = visit::dispatch(node, [&]<typename T>(T const& concrete) {
+			return static_cast<IL::IL const*>(&concrete) == &node && node.is<T>() && IL::IL::kindOf<T>() == i;
+		});
+		EXPECT_TRUE(sameNode) << i;
+	}
+}
+
+TEST(SCCPTest, PhisStayAtBlockHead)
+{
+	// entry0 -> 2 ; 2 splits -> 3(T),4(F) ; 3,4 -> 5 -> exit1
+	ILCtrlFlowGraph graph;
+	for (int i = 0; i < 4; i++) graph.createNode(ILBlock::defaultBlock());
+	graph.nodeData(3) = ILBlock::trueBlock(); graph.nodeData(4) = ILBlock::falseBlock();
+	graph.addEdge(0, 2); graph.addEdge(2, 3); graph.addEdge(2, 4); 
+	graph.addEdge(3, 5); graph.addEdge(4, 5); graph.addEdge(5, 1);
+	// two definitions leave #10 unknown, so both branches execute
+	graph.nodeData(0).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::i1, 0));
+	graph.nodeData(0).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::i1, 1));
+	graph.nodeData(2).splitWith(IL::Variable(10));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(11), IL::Type::u8, 4));
+	graph.nodeData(4).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(12), IL::Type::u8, 5));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Phi>(IL::Variable(20), IL::Type::u8, std::vector<IL::Value>{ 1, 1 }));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Phi>(IL::Variable(21), IL::Type::u8, std::vector<IL::Value>{ IL::Variable(11), IL::Variable(12) }));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(22), IL::Type::u8, IL::Variable(20), Token::Type::PLUS, IL::Variable(21)));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>(IL::Variable(22)));
+
+	size_t next = 100;
+	opt::FunctionContext function{ "phis", graph, [&](IL::Type) { return IL::Variable(next++); } };
+	opt::AnalysisManager analyses(graph);
+	EXPECT_TRUE(opt::createSCCPPass()->run(function, analyses));
+
+	auto& body = graph.nodeData(5).body;
+	ASSERT_EQ(body.size(), 4);
+	auto phi = IL::getIf<IL::Phi>(body[0]);
+	ASSERT_NE(phi, nullptr);
+	EXPECT_EQ(phi->dest.variable.id, 21);
+	ASSERT_TRUE(std::holds_alternative<int>(phi->sources[0]));
+	EXPECT_EQ(std::get<int>(phi->sources[0]), 4);
+	auto copy = IL::getIf<IL::Assignment>(body[1]);
+	ASSERT_NE(copy, nullptr);
+	EXPECT_EQ(copy->dest.variable.id, 20);
+	ASSERT_TRUE(std::holds_alternative<int>(copy->src));
+	EXPECT_EQ(std::get<int>(copy->src), 1);
+	auto sum = IL::getIf<IL::Binary>(body[2]);
+	ASSERT_NE(sum, nullptr);
+	ASSERT_TRUE(std::holds_alternative<int>(sum->lhs));
+	EXPECT_EQ(std::get<int>(sum->lhs), 1);
+}
+
+TEST(SCCPTest, FoldsWrapToTheDestType)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 200));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, 100));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(12), IL::Type::i8, IL::Variable(10), Token::Type::MINUS, 201));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(13), IL::Type::u16, IL::Variable(10), Token::Type::STAR, 400));
+	body.push_back(IL::makeIL<IL::Unary>(IL::Variable(14), IL::Type::u8, Token::Type::MINUS, IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(15), IL::Type::u8, IL::Variable(11), Token::Type::PLUS, IL::Variable(9)));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(15)));
+	auto graph = straightLine(std::move(body));
+	EXPECT_TRUE(runPass(opt::createSCCPPass(), graph));
+
+	auto& block = graph.nodeData(2).body;
+	auto folded = [&](size_t index, int expected) {
+		auto assignment = IL::getIf<IL::Assignment>(block[index]);
+		ASSERT_NE(assignment, nullptr) << index;
+		EXPECT_TRUE(isConstant(assignment->src, expected)) << index;
+	};
+	folded(1, 300 - 256);
+	folded(2, -1);
+	folded(3, 80000 - 65536);
+	folded(4, 56);
+	// #9 is not known, only the constant operand is replaced
+	auto sum = IL::getIf<IL::Binary>(block[5]);
+	ASSERT_NE(sum, nullptr);
+	EXPECT_TRUE(isConstant(sum->lhs, 44));
+	EXPECT_TRUE(isVariable(sum->rhs, 9));
+}
+
+TEST(SCCPTest, ConstantBranchRemoved)
+{
+	auto graph = diamond(IL::Variable(10));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::i1, 1));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(11), IL::Type::u8, 4));
+	graph.nodeData(4).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(12), IL::Type::u8, 5));
+	graph.nodeData(4).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(13), IL::Type::u8, IL::Variable(12), Token::Type::PLUS, IL::Variable(9)));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Phi>(IL::Variable(20), IL::Type::u8, std::vector<IL::Value>{ IL::Variable(11), IL::Variable(12) }));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>(IL::Variable(20)));
+	EXPECT_TRUE(runPass(opt::createSCCPPass(), graph));
+
+	// the test always takes the true side, so the false block never runs
+	EXPECT_FALSE(graph.nodeData(2).splits());
+	EXPECT_TRUE(graph.hasEdge(2, 3));
+	EXPECT_FALSE(graph.hasEdge(2, 4));
+	EXPECT_TRUE(graph.nodeData(4).body.empty());
+	EXPECT_EQ(graph.successorCount(4), 0);
+
+	// with the edge from 4 gone the phi only sees the constant from 3
+	ASSERT_EQ(graph.predecessorCount(5), 1);
+	auto copy = IL::getIf<IL::Assignment>(graph.nodeData(5).body[0]);
+	ASSERT_NE(copy, nullptr);
+	EXPECT_EQ(copy->dest.variable.id, 20);
+	EXPECT_TRUE(isConstant(copy->src, 4));
+	auto ret = IL::getIf<IL::Return>(graph.nodeData(5).body[1]);
+	ASSERT_NE(ret, nullptr);
+	EXPECT_TRUE(isConstant(ret->value.value(), 4));
+}
+
+TEST(GVNTest, CommutativeOperandsShareAKey)
+{
+	// #10 and #11 come from outside the graph
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(12), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, IL::Variable(11)));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(13), IL::Type::u8, IL::Variable(11), Token::Type::PLUS, IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(14), IL::Type::u8, IL::Variable(10), Token::Type::MINUS, IL::Variable(11)));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(15), IL::Type::u8, IL::Variable(11), Token::Type::MINUS, IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(16), IL::Type::u8, IL::Variable(13), Token::Type::PLUS, IL::Variable(15)));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(16)));
+	auto graph = straightLine(std::move(body));
+	EXPECT_TRUE(runPass(opt::createGVNPass(), graph));
+
+	auto& block = graph.nodeData(2).body;
+	EXPECT_TRUE(copies(block[1], 12));
+	EXPECT_NE(IL::getIf<IL::Binary>(block[3]), nullptr);
+	// uses read the leader
+	auto sum = IL::getIf<IL::Binary>(block[4]);
+	ASSERT_NE(sum, nullptr);
+	EXPECT_TRUE(isVariable(sum->lhs, 12));
+	EXPECT_TRUE(isVariable(sum->rhs, 15));
+}
+
+TEST(GVNTest, HitsOnlyFromDominators)
+{
+	auto graph = diamond(IL::Variable(9));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(12), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, IL::Variable(11)));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(13), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, IL::Variable(11)));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(14), IL::Type::u8, IL::Variable(10), Token::Type::STAR, IL::Variable(11)));
+	graph.nodeData(4).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(15), IL::Type::u8, IL::Variable(10), Token::Type::STAR, IL::Variable(11)));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>(IL::Variable(12)));
+	EXPECT_TRUE(runPass(opt::createGVNPass(), graph));
+
+	EXPECT_TRUE(copies(graph.nodeData(3).body[0], 12));
+	// the true block does not dominate its sibling, so its product is not available there
+	EXPECT_NE(IL::getIf<IL::Binary>(graph.nodeData(4).body[0]), nullptr);
+}
+
+TEST(GVNTest, RedundantAndTrivialPhis)
+{
+	auto graph = diamond(IL::Variable(9));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(11), IL::Type::u8, 1));
+	graph.nodeData(4).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(12), IL::Type::u8, 2));
+	auto& join = graph.nodeData(5).body;
+	join.push_back(IL::makeIL<IL::Phi>(IL::Variable(20), IL::Type::u8, std::vector<IL::Value>{ IL::Variable(10), IL::Variable(10) }));
+	join.push_back(IL::makeIL<IL::Phi>(IL::Variable(21), IL::Type::u8, std::vector<IL::Value>{ IL::Variable(11), IL::Variable(12) }));
+	join.push_back(IL::makeIL<IL::Phi>(IL::Variable(22), IL::Type::u8, std::vector<IL::Value>{ IL::Variable(11), IL::Variable(12) }));
+	join.push_back(IL::makeIL<IL::Binary>(IL::Variable(23), IL::Type::u8, IL::Variable(20), Token::Type::PLUS, IL::Variable(22)));
+	join.push_back(IL::makeIL<IL::Return>(IL::Variable(23)));
+	EXPECT_TRUE(runPass(opt::createGVNPass(), graph));
+
+	// the redundant phi is only renamed away, the block still starts with phis
+	ASSERT_EQ(join.size(), 5);
+	EXPECT_NE(IL::getIf<IL::Phi>(join[2]), nullptr);
+	auto sum = IL::getIf<IL::Binary>(join[3]);
+	ASSERT_NE(sum, nullptr);
+	EXPECT_TRUE(isVariable(sum->lhs, 10));
+	EXPECT_TRUE(isVariable(sum->rhs, 21));
+}
+
+TEST(GVNTest, DerefNotMergedAcrossStore)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Deref>(IL::Variable(11), IL::Type::u8, IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Deref>(IL::Variable(12), IL::Type::u8, IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Store>(IL::Variable(10), IL::Variable(9), IL::Type::u8));
+	body.push_back(IL::makeIL<IL::Deref>(IL::Variable(13), IL::Type::u8, IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(13)));
+	auto graph = straightLine(std::move(body));
+	EXPECT_TRUE(runPass(opt::createGVNPass(), graph));
+
+	auto& block = graph.nodeData(2).body;
+	EXPECT_TRUE(copies(block[1], 11));
+	EXPECT_NE(IL::getIf<IL::Deref>(block[3]), nullptr);
+}
+
+TEST(GVNTest, DerefNotMergedAcrossJoin)
+{
+	auto graph = diamond(IL::Variable(9));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Deref>(IL::Variable(11), IL::Type::u8, IL::Variable(10)));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Deref>(IL::Variable(12), IL::Type::u8, IL::Variable(10)));
+	graph.nodeData(4).body.push_back(IL::makeIL<IL::Store>(IL::Variable(10), IL::Variable(9), IL::Type::u8));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Deref>(IL::Variable(13), IL::Type::u8, IL::Variable(10)));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>(IL::Variable(13)));
+	EXPECT_TRUE(runPass(opt::createGVNPass(), graph));
+
+	// memory carries into the true block from its only predecessor, but the join may see the store
+	EXPECT_TRUE(copies(graph.nodeData(3).body[0], 11));
+	EXPECT_NE(IL::getIf<IL::Deref>(graph.nodeData(5).body[0]), nullptr);
+}
+
+TEST(GVNTest, DerefNotMergedAcrossAddressTakenDef)
+{
+	// p = &v; x = *p; v = 9; y = *p
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	body.push_back(IL::makeIL<IL::AddressOf>(IL::Variable(11), IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Deref>(IL::Variable(12), IL::Type::u8, IL::Variable(11)));
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 9));
+	body.push_back(IL::makeIL<IL::Deref>(IL::Variable(13), IL::Type::u8, IL::Variable(11)));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(14), IL::Type::u8, IL::Variable(12), Token::Type::PLUS, IL::Variable(13)));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(14)));
+	auto graph = straightLine(std::move(body));
+	runPass(opt::createGVNPass(), graph);
+
+	auto& block = graph.nodeData(2).body;
+	EXPECT_NE(IL::getIf<IL::Deref>(block[4]), nullptr);
+	auto sum = IL::getIf<IL::Binary>(block[5]);
+	ASSERT_NE(sum, nullptr);
+	EXPECT_TRUE(isVariable(sum->rhs, 13));
+}
+
+TEST(DCETest, DeadChainsRemoved)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, 2));
+	body.push_back(IL::makeIL<IL::Binary>(IL::Variable(12), IL::Type::u8, IL::Variable(11), Token::Type::STAR, 3));
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(13), IL::Type::u8, 5));
+	body.push_back(IL::makeIL<IL::Return>(IL::Variable(13)));
+	auto graph = straightLine(std::move(body));
+	EXPECT_TRUE(runPass(opt::createDCEPass(), graph));
+
+	// #12 is never read, which leaves #11 and then #10 unread as well
+	auto& block = graph.nodeData(2).body;
+	ASSERT_EQ(block.size(), 2);
+	auto kept = IL::getIf<IL::Assignment>(block[0]);
+	ASSERT_NE(kept, nullptr);
+	EXPECT_EQ(kept->dest.variable.id, 13);
+	EXPECT_FALSE(runPass(opt::createDCEPass(), graph));
+}
+
+TEST(DCETest, MemoryDefsKept)
+{
+	IL::Program body;
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	body.push_back(IL::makeIL<IL::AddressOf>(IL::Variable(11), IL::Variable(10)));
+	body.push_back(IL::makeIL<IL::Deref>(IL::Variable(12), IL::Type::u8, IL::Variable(11)));
+	body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(5, true), IL::Type::u8, 2));
+	body.push_back(IL::makeIL<IL::Return>());
+	auto graph = straightLine(std::move(body));
+	EXPECT_TRUE(runPass(opt::createDCEPass(), graph));
+
+	// nothing reads #10 or the global here, but either may be read through memory later
+	auto& block = graph.nodeData(2).body;
+	ASSERT_EQ(block.size(), 3);
+	auto local = IL::getIf<IL::Assignment>(block[0]), global = IL::getIf<IL::Assignment>(block[1]);
+	ASSERT_NE(local, nullptr);
+	ASSERT_NE(global, nullptr);
+	EXPECT_EQ(local->dest.variable.id, 10);
+	EXPECT_TRUE(global->dest.variable.is_global);
+}
+
+TEST(DCETest, SplitConditionKept)
+{
+	auto graph = diamond(IL::Variable(11));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(11), IL::Type::i1, IL::Variable(10), Token::Type::EQUAL_EQUAL, 2));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(12), IL::Type::u8, 3));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>());
+	EXPECT_TRUE(runPass(opt::createDCEPass(), graph));
+
+	// only the condition reads #11, the branch keeps it and the #10 it is made from
+	auto& block = graph.nodeData(2).body;
+	ASSERT_EQ(block.size(), 2);
+	EXPECT_NE(IL::getIf<IL::Binary>(block[1]), nullptr);
+	EXPECT_TRUE(graph.nodeData(2).splits());
+}
+
+TEST(SimplifyCFGTest, MergeTurnsPhisIntoCopies)
+{
+	// entry0 -> 2 -> 3 -> exit1
+	ILCtrlFlowGraph graph;
+	graph.createNode(ILBlock::defaultBlock());
+	graph.createNode(ILBlock::defaultBlock());
+	graph.addEdge(0, 2); graph.addEdge(2, 3); graph.addEdge(3, 1);
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Phi>(IL::Variable(20), IL::Type::u8, std::vector<IL::Value>{ IL::Variable(10) }));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Return>(IL::Variable(20)));
+	EXPECT_TRUE(runPass(opt::createSimplifyCFGPass(), graph));
+
+	// every block has a single predecessor that goes nowhere else, so all of it lands in the entry
+	ASSERT_EQ(graph.nodeCount(), 2);
+	EXPECT_TRUE(graph.hasEdge(graph.getEntryNode(), graph.getExitNode()));
+	auto& body = graph.nodeData(graph.getEntryNode()).body;
+	ASSERT_EQ(body.size(), 3);
+	auto copy = IL::getIf<IL::Assignment>(body[1]);
+	ASSERT_NE(copy, nullptr);
+	EXPECT_EQ(copy->dest.variable.id, 20);
+	EXPECT_TRUE(isVariable(copy->src, 10));
+}
+
+TEST(SimplifyCFGTest, BypassEmptyBlock)
+{
+	// entry0 -> 2 ; 2 splits -> 3(T),4(F) ; 3,4 -> 5 -> 6 -> exit1
+	auto graph = diamond(IL::Variable(9));
+	graph.createNode(ILBlock::defaultBlock());
+	graph.removeEdge(5, 1); graph.addEdge(5, 6); graph.addEdge(6, 1);
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	graph.nodeData(6).body.push_back(IL::makeIL<IL::Return>());
+	EXPECT_TRUE(runPass(opt::createSimplifyCFGPass(), graph));
+
+	// 2 merges into the entry and the empty join 5 is bypassed, but the empty false
+	// block stays, the branch that needs it as a target cannot be sent past it
+	EXPECT_EQ(graph.nodeCount(), 5);
+	std::optional<size_t> split;
+	for (size_t block = 0; block < graph.nodeCount(); ++block) {
+		if (graph.nodeData(block).splits()) split = block;
+	}
+	ASSERT_TRUE(split.has_value());
+	size_t onTrue = graph.getTrueSuccessor(split.value()), onFalse = graph.getFalseSuccessor(split.value());
+	EXPECT_TRUE(graph.nodeData(onFalse).body.empty());
+	ASSERT_EQ(graph.successorCount(onTrue), 1);
+	ASSERT_EQ(graph.successorCount(onFalse), 1);
+	size_t join = graph.out(onTrue).front();
+	EXPECT_EQ(graph.out(onFalse).front(), join);
+	ASSERT_EQ(graph.nodeData(join).body.size(), 1);
+	EXPECT_NE(IL::getIf<IL::Return>(graph.nodeData(join).body[0]), nullptr);
+}
+
+TEST(SimplifyCFGTest, EmptyDiamondCollapsed)
+{
+	auto graph = diamond(IL::Variable(10));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::i1, 1));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>());
+	EXPECT_TRUE(runPass(opt::createSimplifyCFGPass(), graph));
+
+	// with the branch gone the rest merges into the entry
+	ASSERT_EQ(graph.nodeCount(), 2);
+	EXPECT_FALSE(graph.nodeData(graph.getEntryNode()).splits());
+	EXPECT_EQ(graph.nodeData(graph.getEntryNode()).body.size(), 2);
+}
+
+TEST(SSATest, UnreachableBlocksDropped)
+{
+	// entry0 -> 2 -> exit1, and 3 -> 2 which nothing reaches
+	auto graph = straightLine({});
+	graph.createNode(ILBlock::defaultBlock());
+	graph.addEdge(3, 2);
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Return>(IL::Variable(10)));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 5));
+	EXPECT_TRUE(runPass(opt::createBuildSSAPass(), graph));
+
+	// the renamer never visits 3, it would have kept a second definition of #10
+	EXPECT_EQ(graph.nodeCount(), 3);
+	for (auto [id, count] : definitionCounts(graph)) EXPECT_EQ(count, 1) << "#" << id;
+}
+
+TEST(SSATest, PrunedPhiPlacement)
+{
+	auto graph = diamond(IL::Variable(9));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::AddressOf>(IL::Variable(13), IL::Variable(12)));
+	for (size_t side : { 3, 4 })
+	{
+		graph.nodeData(side).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, int(side)));
+		graph.nodeData(side).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(11), IL::Type::u8, int(side)));
+		graph.nodeData(side).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(12), IL::Type::u8, int(side)));
+	}
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(14), IL::Type::u8, IL::Variable(10), Token::Type::PLUS, IL::Variable(12)));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>(IL::Variable(14)));
+	opt::AnalysisManager analyses(graph);
+	placePhiNodes(graph, analyses.dominators(), analyses.assignments(), analyses.liveness());
+
+	// #11 is dead at the join and #12 lives in memory, only #10 needs a phi
+	auto& join = graph.nodeData(5).body;
+	ASSERT_EQ(join.size(), 3);
+	auto phi = IL::getIf<IL::Phi>(join[0]);
+	ASSERT_NE(phi, nullptr);
+	EXPECT_EQ(phi->dest.variable.id, 10);
+	EXPECT_EQ(phi->sources.size(), 2);
+	for (size_t block = 0; block < graph.nodeCount(); ++block) {
+		if (block != 5) EXPECT_TRUE(graph.nodeData(block).body.empty() || !IL::getIf<IL::Phi>(graph.nodeData(block).body[0]));
+	}
+}
+
+TEST(SSATest, Renaming)
+{
+	auto graph = diamond(IL::Variable(9));
+	// #20 is read before any definition, so it is live into the entry
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 0));
+	graph.nodeData(2).body.push_back(IL::makeIL<IL::Binary>(IL::Variable(21), IL::Type::u8, IL::Variable(20), Token::Type::PLUS, 1));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(10), IL::Type::u8, 1));
+	graph.nodeData(3).body.push_back(IL::makeIL<IL::Assignment>(IL::Variable(20), IL::Type::u8, 7));
+	graph.nodeData(5).body.push_back(IL::makeIL<IL::Return>(IL::Variable(10)));
+	EXPECT_TRUE(runPass(opt::createBuildSSAPass(), graph));
+
+	// the first definition of a variable not live into the entry keeps its name
+	auto first = IL::getIf<IL::Assignment>(graph.nodeData(2).body[0]);
+	ASSERT_NE(first, nullptr);
+	EXPECT_EQ(first->dest.variable.id, 10);
+	auto read = IL::getIf<IL::Binary>(graph.nodeData(2).body[1]);
+	ASSERT_NE(read, nullptr);
+	EXPECT_TRUE(isVariable(read->lhs, 20));
+	EXPECT_EQ(read->dest.variable.id, 21);
+
+	auto second = IL::getIf<IL::Assignment>(graph.nodeData(3).body[0]);
+	auto parameter = IL::getIf<IL::Assignment>(graph.nodeData(3).body[1]);
+	ASSERT_NE(second, nullptr);
+	ASSERT_NE(parameter, nullptr);
+	EXPECT_GE(second->dest.variable.id, 100);
+	EXPECT_GE(parameter->dest.variable.id, 100);
+
+	// a source per predecessor, in the order of the predecessors
+	auto& join = graph.nodeData(5).body;
+	ASSERT_EQ(join.size(), 2);
+	auto phi = IL::getIf<IL::Phi>(join[0]);
+	ASSERT_NE(phi, nullptr);
+	ASSERT_EQ(phi->sources.size(), 2);
+	EXPECT_TRUE(isVariable(phi->sources[0], second->dest.variable.id));
+	EXPECT_TRUE(isVariable(phi->sources[1], 10));
+	auto ret = IL::getIf<IL::Return>(join[1]);
+	ASSERT_NE(ret, nullptr);
+	EXPECT_GE(phi->dest.variable.id, 100);
+	EXPECT_TRUE(isVariable(ret->value.value(), phi->dest.variable.id));
+	for (auto [id, count] : definitionCounts(graph)) EXPECT_EQ(count, 1) << "#" << id;
+}
@@ -1,6 +1,12 @@
 
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
 #include "Lexer.h"
+#include "TokenStream.h"
+#include "ReservedIdentifiers.h"
 
 TEST(LexerTest, Hexidecimal) 
 {
@@ -9,8 +15,8 @@ TEST(LexerTest, Hexidecimal)
 	EXPECT_EQ(tokens.size(), 2);
 	ASSERT_EQ(tokens[0].type, Token::Type::NUMBER);
 	ASSERT_EQ(tokens[1].type, Token::Type::EOF_);
-	ASSERT_TRUE(std::holds_alternative<u16>(tokens[0].literal));
-	ASSERT_EQ(std::get<u16>(tokens[0].literal), 0x12);
+	ASSERT_TRUE(std::holds_alternative<u16>(tokens[0].literal()));
+	ASSERT_EQ(std::get<u16>(tokens[0].literal()), 0x12);
 }
 
 TEST(LexerTest, Binary)
@@ -20,6 +26,137 @@ TEST(LexerTest, Binary)
 	EXPECT_EQ(tokens.size(), 2);
 	ASSERT_EQ(tokens[0].type, Token::Type::NUMBER);
 	ASSERT_EQ(tokens[1].type, Token::Type::EOF_);
-	ASSERT_TRUE(std::holds_alternative<u16>(tokens[0].literal));
-	ASSERT_EQ(std::get<u16>(tokens[0].literal), 0b101);
+	ASSERT_TRUE(std::holds_alternative<u16>(tokens[0].literal()));
+	ASSERT_EQ(std::get<u16>(tokens[0].literal()), 0b101);
+}
+
+TEST(LexerTest, InternedStrings)
+{
+	Lexer lexer(SourceManager::instance().add("strings", "\"ab\"\n\"ab\""));
+	auto tokens = lexer.generateTokens();
+	EXPECT_EQ(tokens.size(), 4);
+	ASSERT_EQ(tokens[0].type, Token::Type::STRING);
+	ASSERT_EQ(tokens[2].type, Token::Type::STRING);
+	ASSERT_EQ(tokens.string(0), "ab");
+	ASSERT_EQ(tokens.string(0).data(), tokens.string(2).data());
+	ASSERT_EQ(SourceManager::instance().line(tokens[2].sourcePos()), 2);
+	ASSERT_EQ(tokens[2].lexeme, "\"ab\"");
+}
+
+TEST(LexerTest, LiteralPoolMoves)
+{
+	static_assert(!std::is_copy_constructible_v<LiteralPool> && !std::is_copy_assignable_v<LiteralPool>);
+	LiteralPool pool;
+	u32 index = pool.intern("abc");
+	std::string_view stored = pool.get(index);
+
+	// the strings move along, and the moved pool still finds them by their keys
+	LiteralPool moved = std::move(pool);
+	EXPECT_EQ(moved.get(index).data(), stored.data());
+	EXPECT_EQ(moved.intern(std::string("abc")), index);
+	EXPECT_EQ(moved.size(), 1u);
+}
+
+TEST(LexerTest, LazyLineColumn)
+{
+	std::string_view source = "fn f:\n\treturn 1\n\n  x";
+	u32 file = SourceManager::instance().add("positions", source);
+	auto resolve = [&](size_t offset) { return SourceManager::instance().resolve(SourcePosition(file, offset)); };
+	EXPECT_EQ(resolve(0).line, 1);
+	EXPECT_EQ(resolve(3).column, 4);
+	EXPECT_EQ(resolve(7).line, 2);
+	EXPECT_EQ(resolve(7).column, 2);
+	EXPECT_EQ(resolve(16).line, 3);
+	EXPECT_EQ(resolve(19).line, 4);
+	EXPECT_EQ(resolve(19).column, 3);
+	EXPECT_EQ(sizeof(SourcePosition), 4);
+}
+
+TEST(LexerTest, LongRuns)
+{
+	std::string source = "fn " + std::string(40, 'a') + "_1:\n" + std::string(36, ' ') + "return 000000000000000001234 ;" + std::string(50, 'c') + "\n";
+	Lexer lexer(source);
+	auto tokens = lexer.generateTokens();
+	ASSERT_EQ(tokens.size(), 10);
+	ASSERT_EQ(tokens[1].type, Token::Type::IDENT);
+	ASSERT_EQ(tokens[1].lexeme.size(), 42);
+	ASSERT_EQ(tokens[4].type, Token::Type::INDENT);
+	ASSERT_EQ(tokens[5].type, Token::Type::RETURN);
+	ASSERT_EQ(tokens.number(6), 1234);
+	ASSERT_EQ(tokens[7].type, Token::Type::NEWLINE);
+	ASSERT_EQ(tokens[8].type, Token::Type::DEDENT);
+}
+
+TEST(LexerTest, ReservedWords)
+{
+	using enum Token::Type;
+	Lexer lexer("LD af' c nz return Return and sizeofs");
+	auto tokens = lexer.generateTokens();
+	std::array expected = { OPCODE, REGISTER, REGISTER, FLAG, RETURN, IDENT, OPCODE, IDENT, EOF_ };
+	ASSERT_EQ(tokens.size(), expected.size());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		EXPECT_EQ(tokens[i].type, expected[i]);
+	}
+	EXPECT_EQ(tokens[1].lexeme, "af'");
+	EXPECT_EQ(reserved::findOpcode("DJNZ"), Opcode::DJNZ);
+}
+
+TEST(LexerTest, SourceLimits)
+{
+	auto& sources = SourceManager::instance();
+	u32 count = sources.count();
+	Lexer("fn f:\n    return 1").generateTokens();
+	TokenStream("fn f:\n    return 1")[3];
+	EXPECT_EQ(sources.count(), count);
+
+	std::string large(SourcePosition::MAX_OFFSET + 1, ' ');
+	EXPECT_THROW(Lexer{ large }, SourceLimitError);
+	EXPECT_THROW(sources.add("large", large), SourceLimitError);
+	EXPECT_EQ(sources.count(), count);
+}
+
+TEST(LexerTest, Streaming)
+{
+	std::string source;
+	for (int i = 0; i < 200; ++i) {
+		source += "fn f:\n a\n  b \"s\" 12\n   c\n    d\n";
+	}
+	auto tokens = Lexer(source).generateTokens();
+	TokenStream stream(source);
+	for (size_t i = 0; i < tokens.size(); ++i) {
+		auto token = stream[i];
+		stream.release(i + 1);
+		ASSERT_EQ(token.type, tokens[i].type);
+		ASSERT_EQ(token.lexeme, tokens[i].lexeme);
+		ASSERT_EQ(token.sourcePos().offset(), tokens[i].sourcePos().offset());
+		ASSERT_EQ(token.literal(), tokens[i].literal());
+	}
+	EXPECT_EQ(stream.type(tokens.size() + 3), Token::Type::EOF_);
+	EXPECT_LE(stream.capacity(), 16);
+}
+
+TEST(LexerTest, MappedSources)
+{
+	auto directory = std::filesystem::temp_directory_path() /
+		("z80_mapped_sources_" + std::to_string(std::random_device{}()));
+	ASSERT_TRUE(std::filesystem::create_directory(directory));
+	std::filesystem::create_directory(directory / "lib");
+	std::ofstream(directory / "main.z") << "import \"lib/util.z\"\n";
+	std::ofstream(directory / "lib" / "util.z") << "fn f:\n    return 7\n";
+
+	auto& sources = SourceManager::instance();
+	auto main = sources.load(directory / "main.z");
+	ASSERT_TRUE(main.has_value());
+	EXPECT_EQ(sources.load(directory / "lib" / ".." / "main.z"), main);
+	auto util = sources.import(main.value(), "lib/util.z");
+	ASSERT_TRUE(util.has_value());
+	EXPECT_NE(util, main);
+	EXPECT_FALSE(sources.import(main.value(), "missing.z").has_value());
+
+	TokenStream stream(util.value());
+	auto literal = stream[6];
+	ASSERT_EQ(literal.type, Token::Type::NUMBER);
+	EXPECT_EQ(literal.lexeme.data(), sources.text(util.value()).data() + 17);
+	EXPECT_EQ(sources.line(literal.sourcePos()), 2);
+	std::filesystem::remove_all(directory);
 }
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "TokenStream.h"
+#include "ExprParser.h"
+#include "ExprInterner.h"
+#include "CFGGenerator.h"
+
+namespace
+{
+	Expr::Shared parseShared(std::string_view source)
+	{
+		TokenStream tokens(source);
+		ParserContext context;
+		return Expr::Interner::current().share(ExprParser(tokens, context).expr());
+	}
+
+	// the tree with every binary, cast and template call in parentheses
+	std::string render(Expr::Expr const& expr)
+	{
+		if (expr.is<Expr::Binary>()) {
+			auto& binary = static_cast<Expr::Binary const&>(expr);
+			return "(" + render(*binary.lhs) + " " + std::string(tokenTypeToStr(binary.oper)) + " " + render(*binary.rhs) + ")";
+		}
+		if (expr.is<Expr::Cast>()) {
+			auto& cast = static_cast<Expr::Cast const&>(expr);
+			return "(" + render(*cast.expr) + " as " + render(*cast.type) + ")";
+		}
+		if (expr.is<Expr::TemplateCall>()) {
+			auto& call = static_cast<Expr::TemplateCall const&>(expr);
+			std::string args;
+			for (auto& arg : call.templateArgs) args += (args.empty() ? "" : ", ") + render(*arg);
+			return render(*call.lhs) + "<" + args + ">";
+		}
+		if (expr.is<Expr::Unary>()) {
+			auto& unary = static_cast<Expr::Unary const&>(expr);
+			return std::string(tokenTypeToStr(unary.oper)) + render(*unary.expr);
+		}
+		if (expr.is<Expr::Reference>()) return render(*static_cast<Expr::Reference const&>(expr).expr) + "&";
+		if (expr.is<Expr::Identifier>()) return std::string(static_cast<Expr::Identifier const&>(expr).ident);
+		if (expr.is<Expr::Literal>()) return literalToStr(static_cast<Expr::Literal const&>(expr).literal);
+		return "?";
+	}
+
+	// the rest of the tokens must be consumed too
+	std::string parseRendered(std::string_view source, std::initializer_list<std::string_view> templates = {})
+	{
+		TokenStream tokens(source);
+		ParserContext context;
+		for (auto name : templates) context.addTemplate(name);
+		ExprParser parser(tokens, context);
+		auto expr = parser.expr();
+		return parser.atEnd() ? render(*expr) : render(*expr) + " ...";
+	}
+
+	Expr::Binary const& asBinary(Expr::Shared expr)
+	{
+		EXPECT_TRUE(expr->is<Expr::Binary>());
+		return static_cast<Expr::Binary const&>(*expr);
+	}
+}
+
+TEST(InternerTest, EqualTreesAreOneNode)
+{
+	auto& product = asBinary(parseShared("(v + 1) * (v + 1)"));
+	EXPECT_TRUE(product.lhs->isShared());
+	EXPECT_EQ(product.lhs.get(), product.rhs.get());
+
+	// written twice, the one node maps to both places
+	auto positions = Expr::Interner::current().positionsOf(product.lhs.get());
+	ASSERT_EQ(positions.size(), 2u);
+	EXPECT_NE(positions[0], positions[1]);
+	EXPECT_EQ(positions[0], product.lhs->sourcePos);
+}
+
+TEST(InternerTest, SharingIsByStructure)
+{
+	Expr::Shared first = parseShared("w - 1"), second = parseShared("w  -  1"), other = parseShared("w - 2");
+	EXPECT_EQ(first, second);
+	EXPECT_NE(first, other);
+	// the different trees still share what is equal in them
+	EXPECT_EQ(asBinary(first).lhs.get(), asBinary(other).lhs.get());
+}
+
+TEST(InternerTest, RewriteLeavesTheSharedTree)
+{
+	Expr::Shared original = parseShared("x + 1");
+	auto replace = [](Expr::Expr const& expr) -> Expr::UniquePtr {
+		if (!expr.is<Expr::Identifier>()) return nullptr;
+		return Expr::makeExpr<Expr::Identifier>(expr.sourcePos, std::string_view("y"));
+	};
+	Expr::Shared rewritten = Expr::Interner::current().rewrite(original, replace);
+
+	ASSERT_NE(rewritten, nullptr);
+	EXPECT_EQ(rewritten, parseShared("y + 1"));
+	EXPECT_EQ(static_cast<Expr::Identifier const&>(*asBinary(original).lhs).ident, "x");
+	EXPECT_EQ(asBinary(rewritten).rhs.get(), asBinary(original).rhs.get());
+
+	auto keep = [](Expr::Expr const&) -> Expr::UniquePtr { return nullptr; };
+	EXPECT_EQ(Expr::Interner::current().rewrite(original, keep), nullptr);
+}
+
+TEST(InternerTest, CountLoopConditionIsShared)
+{
+	Stmt::StmtBody body;
+	body.push_back(Stmt::makeStmt<Stmt::CountLoop>(SourcePosition{}, std::string_view("i"),
+		Expr::makeExpr<Expr::Literal>(SourcePosition{}, Token::Literal(u16{ 3 })), Stmt::StmtBody{}));
+	CtrlFlowGraph cfg = CtrlFlowGraphGenerator(body).generate();
+
+	// checked before the body and after it, both blocks read the one const node
+	std::vector<Expr::Shared> conditions;
+	for (size_t block = 0; block < cfg.nodeCount(); ++block) {
+		if (cfg.nodeData(block).splits()) conditions.push_back(cfg.nodeData(block).splitsOn());
+	}
+	ASSERT_EQ(conditions.size(), 2u);
+	EXPECT_EQ(conditions[0], conditions[1]);
+	EXPECT_TRUE(conditions[0]->isShared());
+}
+
+TEST(ParserTest, Precedence)
+{
+	EXPECT_EQ(parseRendered("v + w * x"), "(v Plus (w Star x))");
+	EXPECT_EQ(parseRendered("v * w + x"), "((v Star w) Plus x)");
+	EXPECT_EQ(parseRendered("v << 1 + w"), "(v Shift Left (1 Plus w))");
+	EXPECT_EQ(parseRendered("v >= w >> 1"), "(v Greater than or Equal (w Shift Right 1))");
+	EXPECT_EQ(parseRendered("v + w == x * y"), "((v Plus w) Equal Equal (x Star y))");
+	EXPECT_EQ(parseRendered("v - -w"), "(v Minus Minusw)");
+}
+
+TEST(ParserTest, LeftAssociative)
+{
+	EXPECT_EQ(parseRendered("v - w - x"), "((v Minus w) Minus x)");
+	EXPECT_EQ(parseRendered("v / w / x"), "((v Slash w) Slash x)");
+	EXPECT_EQ(parseRendered("v >> 1 << 2"), "((v Shift Right 1) Shift Left 2)");
+}
+
+TEST(ParserTest, Cast)
+{
+	// as binds tighter than any binary operator
+	EXPECT_EQ(parseRendered("v + w as u8"), "(v Plus (w as u8))");
+	EXPECT_EQ(parseRendered("v as u8 * w"), "((v as u8) Star w)");
+	EXPECT_EQ(parseRendered("v as u8 as u16"), "((v as u8) as u16)");
+}
+
+TEST(ParserTest, TemplateClosers)
+{
+	EXPECT_EQ(parseRendered("Pos<u8>", { "Pos" }), "Pos<u8>");
+	// each > closes one list, glued to the next one or not
+	EXPECT_EQ(parseRendered("Pos<Pos<u8>>", { "Pos" }), "Pos<Pos<u8>>");
+	EXPECT_EQ(parseRendered("Pos<Pos<u8> >", { "Pos" }), "Pos<Pos<u8>>");
+	EXPECT_EQ(parseRendered("Pos<Pos<Pos<u8>>>", { "Pos" }), "Pos<Pos<Pos<u8>>>");
+	// after the closing >, > and >> are binary again
+	EXPECT_EQ(parseRendered("Pos<u8>> 1", { "Pos" }), "(Pos<u8> Greater than 1)");
+	EXPECT_EQ(parseRendered("Pos<u8> > v", { "Pos" }), "(Pos<u8> Greater than v)");
+	EXPECT_EQ(parseRendered("Pos<u8> >> v", { "Pos" }), "(Pos<u8> Shift Right v)");
+	EXPECT_EQ(parseRendered("v >> 2", { "Pos" }), "(v Shift Right 2)");
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "Arena.h"
+
+namespace
+{
+	// counts how many of its kind were destroyed
+	struct Counted
+	{
+		static inline thread_local int destroyed = 0;
+		static inline int destroyedAnywhere = 0;
+		~Counted() { ++destroyed; ++destroyedAnywhere; }
+	};
+}
+
+TEST(ArenaTest, AllocatesAligned)
+{
+	util::Arena arena;
+	EXPECT_EQ(arena.blockCount(), 0u);
+	auto byte = static_cast<std::byte*>(arena.allocate(1, 1));
+	auto word = static_cast<std::byte*>(arena.allocate(8, 8));
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(word) % 8, 0u);
+	EXPECT_GT(word, byte);
+	EXPECT_EQ(arena.blockCount(), 1u);
+
+	// too large to share a block, the current one keeps filling after it
+	arena.allocate(util::Arena::BLOCK_SIZE, 16);
+	EXPECT_EQ(arena.blockCount(), 2u);
+	EXPECT_EQ(static_cast<std::byte*>(arena.allocate(1, 1)), word + 8);
+}
+
+TEST(ArenaTest, ResetFreesEverything)
+{
+	util::Arena arena;
+	int* value = arena.make<int>(5);
+	EXPECT_EQ(*value, 5);
+	Counted::destroyed = 0;
+	Counted& attached = arena.attached<Counted>();
+	EXPECT_EQ(&arena.attached<Counted>(), &attached);
+
+	arena.reset();
+	EXPECT_EQ(Counted::destroyed, 1);
+	EXPECT_EQ(arena.blockCount(), 0u);
+
+	// usable again, with a new attachment
+	EXPECT_EQ(*arena.make<int>(7), 7);
+	arena.attached<Counted>();
+	EXPECT_EQ(arena.blockCount(), 1u);
+	arena.reset();
+	EXPECT_EQ(Counted::destroyed, 2);
+}
+
+TEST(ArenaTest, ScopesAndFallback)
+{
+	util::Arena& fallback = util::Arena::current();
+	{
+		util::Arena arena;
+		util::Arena::Scope scope{ arena };
+		EXPECT_EQ(&util::Arena::current(), &arena);
+	}
+	EXPECT_EQ(&util::Arena::current(), &fallback);
+
+	// every thread has its own fallback, freed when the thread exits
+	Counted::destroyedAnywhere = 0;
+	util::Arena* other = nullptr;
+	std::thread([&] {
+		other = &util::Arena::current();
+		other->attached<Counted>();
+	}).join();
+	EXPECT_NE(other, &fallback);
+	EXPECT_EQ(Counted::destroyedAnywhere, 1);
+}